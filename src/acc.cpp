@@ -5,6 +5,17 @@
  * @version 0.1
  * @date 2020-07-24
  * 
+ * The LIS3DH collects samples in its FIFO (stream mode) all the time, every
+ * MCU wakeup classifies the batch that is in it:
+ *   movement  While still only a movement over the INT1 threshold wakes
+ *   batch     After a change INT1 is the FIFO watermark, one wakeup per
+ *             ACC_FIFO_WTM samples, until the class is the same for
+ *             ACC_STEADY_BATCHES batches (ACC_STILL_BATCHES if still)
+ *   paced     Steady walking or driving, INT1 is off and the FIFO is
+ *             checked every ACC_PACE_MS
+ * The on-chip sleep-to-wake drops the sensor to low power mode after
+ * ACC_ACT_DUR of no activity over ACC_ACT_THS.
+ * 
  * @copyright Copyright (c) 2020
  * 
  */
@@ -12,8 +23,66 @@
 
 void acc_int_callback(void);
 
+/** Sleep-to-wake registers, not in SparkFunLIS3DH.h */
+#define ACC_ACT_THS_REG 0x3E
+#define ACC_ACT_DUR_REG 0x3F
+/** Activity threshold, 16mg steps at 2g range */
+#define ACC_ACT_THS 2
+/** Low power after (ACC_ACT_DUR + 1) * 8 / ODR s without activity, 30s */
+#define ACC_ACT_DUR 37
+/** Samples per batch, 3s */
+#define ACC_FIFO_WTM 30
+/** Back to the movement interrupt after this many still batches */
+#define ACC_STILL_BATCHES 2
+/** Paced after this many batches of the same moving class */
+#define ACC_STEADY_BATCHES 2
+/** Batch interval while paced */
+#ifndef ACC_PACE_MS
+#define ACC_PACE_MS 30000
+#endif
+
+/** Wakeup modes */
+#define ACC_MODE_MOVEMENT 0
+#define ACC_MODE_BATCH 1
+#define ACC_MODE_PACED 2
+
+/** CTRL_REG3, INT1 sources */
+#define ACC_INT1_AOI 0x60
+#define ACC_INT1_WTM 0x04
+/** CTRL_REG5 */
+#define ACC_FIFO_EN 0x40
+#define ACC_LIR_INT1 0x08
+/** FIFO_CTRL_REG */
+#define ACC_FIFO_BYPASS 0x00
+#define ACC_FIFO_STREAM 0x80
+/** FIFO_SRC_REG */
+#define ACC_FIFO_OVRN 0x40
+#define ACC_FIFO_FSS 0x1F
+/** Register address bit for multi byte reads */
+#define ACC_AUTO_INC 0x80
+/** OUT_X_L..OUT_Z_H */
+#define ACC_SAMPLE_BYTES 6
+/** FIFO samples per burst, stays within the 64 byte Wire buffer */
+#define ACC_BURST_SAMPLES 10
+
 /** The LIS3DH sensor */
 LIS3DH acc_sensor(I2C_MODE, 0x18);
+/** Sensor was found */
+bool acc_ready = false;
+/** Current wakeup mode */
+uint8_t acc_mode = ACC_MODE_MOVEMENT;
+/** Class of the last batch and how many in a row had it */
+uint8_t acc_last_activity = ACTIVITY_STILL;
+uint8_t acc_same_batches = 0;
+/** Wakes the MCU for the next batch while paced */
+SoftwareTimer acc_pace_timer;
+void acc_pace_due(TimerHandle_t unused);
+
+/** Stats */
+uint32_t g_acc_wakes = 0;
+uint32_t g_acc_samples = 0;
+uint32_t g_acc_overruns = 0;
+uint32_t g_acc_i2c_transactions = 0;
 
 /**
  * @brief Initialize LIS3DH 3-axis 
@@ -29,7 +98,7 @@ bool init_acc(void)
 
 	Wire.begin();
 
-	acc_sensor.settings.accelSampleRate = 10; //Hz.  Can be: 0,1,10,25,50,100,200,400,1600,5000 Hz
+	acc_sensor.settings.accelSampleRate = ACC_ODR_HZ; //Hz.  Can be: 0,1,10,25,50,100,200,400,1600,5000 Hz
 	acc_sensor.settings.accelRange = 2;		  //Max G force readable.  Can be: 2, 4, 8, 16
 
 	acc_sensor.settings.adcEnabled = 0;
@@ -38,8 +107,15 @@ bool init_acc(void)
 	acc_sensor.settings.yAccelEnabled = 1;
 	acc_sensor.settings.zAccelEnabled = 1;
 
+	// Register setup in one go, the display and GNSS wait
+	if (!i2c_acquire(I2C_DEV_ACC))
+	{
+		return false;
+	}
+
 	if (acc_sensor.begin() != 0)
 	{
+		i2c_release(I2C_DEV_ACC);
 		MYLOG("ACC", "ACC sensor initialization failed");
 		return false;
 	}
@@ -65,16 +141,24 @@ bool init_acc(void)
 	data_to_write |= 0x01; // 1 * 1/50 s = 20ms
 	acc_sensor.writeRegister(LIS3DH_INT1_DURATION, data_to_write);
 
+	// Sleep-to-wake, low power mode while there is no activity
+	acc_sensor.writeRegister(ACC_ACT_THS_REG, ACC_ACT_THS);
+	acc_sensor.writeRegister(ACC_ACT_DUR_REG, ACC_ACT_DUR);
+
 	acc_sensor.readRegister(&data_to_write, LIS3DH_CTRL_REG5);
-	data_to_write &= 0xF3;									   //Clear bits of interest
-	data_to_write |= 0x08;									   //Latch interrupt (Cleared by reading int1_src)
+	data_to_write &= 0xB3;									   //Clear bits of interest
+	data_to_write |= ACC_LIR_INT1;							   //Latch interrupt (Cleared by reading int1_src)
+	data_to_write |= ACC_FIFO_EN;							   //FIFO on
 	acc_sensor.writeRegister(LIS3DH_CTRL_REG5, data_to_write); // Set interrupt to latching
 
-	// Select interrupt pin 1
-	data_to_write = 0;
-	data_to_write |= 0x40; //AOI1 event (Generator 1 interrupt on pin 1)
-	data_to_write |= 0x20; //AOI2 event ()
-	acc_sensor.writeRegister(LIS3DH_CTRL_REG3, data_to_write);
+	// Bypass resets the FIFO, stream mode keeps the newest samples
+	acc_sensor.writeRegister(LIS3DH_FIFO_CTRL_REG, ACC_FIFO_BYPASS);
+	acc_sensor.writeRegister(LIS3DH_FIFO_CTRL_REG, ACC_FIFO_STREAM | ACC_FIFO_WTM);
+
+	// Select interrupt pin 1, movement until the first batch
+	acc_sensor.writeRegister(LIS3DH_CTRL_REG3, ACC_INT1_AOI);
+	acc_mode = ACC_MODE_MOVEMENT;
+	acc_pace_timer.begin(ACC_PACE_MS, acc_pace_due, NULL, false);
 
 	// No interrupt on pin 2
 	acc_sensor.writeRegister(LIS3DH_CTRL_REG6, 0x00); 
@@ -83,23 +167,196 @@ bool init_acc(void)
 	acc_sensor.writeRegister(LIS3DH_CTRL_REG2, 0x01); 
 
 	clear_acc_int();
+	i2c_release(I2C_DEV_ACC);
 
 	// Set the interrupt callback function
 	attachInterrupt(INT1_PIN, acc_int_callback, RISING);
 	
+	acc_ready = true;
+	return true;
+}
+
+/**
+ * @brief Read consecutive registers in one I2C transaction
+ * 
+ * @param reg First register
+ * @param data Output
+ * @param len Number of bytes
+ * @return true If the sensor answered
+ */
+static bool acc_read_regs(uint8_t reg, uint8_t *data, uint8_t len)
+{
+	if (!i2c_acquire(I2C_DEV_ACC))
+	{
+		return false;
+	}
+	g_acc_i2c_transactions++;
+	if (len > 1)
+	{
+		reg |= ACC_AUTO_INC;
+	}
+	bool ok = acc_sensor.readRegisterRegion(data, reg, len) == IMU_SUCCESS;
+	i2c_release(I2C_DEV_ACC);
+	return ok;
+}
+
+/**
+ * @brief Write one register
+ * 
+ */
+static void acc_write_reg(uint8_t reg, uint8_t value)
+{
+	if (!i2c_acquire(I2C_DEV_ACC))
+	{
+		return;
+	}
+	g_acc_i2c_transactions++;
+	acc_sensor.writeRegister(reg, value);
+	i2c_release(I2C_DEV_ACC);
+}
+
+/**
+ * @brief Convert a raw OUT_X_L..OUT_Z_H sample
+ * @note 10 bit left aligned, 4mg per LSB at 2g
+ * 
+ */
+static void acc_sample_mg(const uint8_t *raw, int16_t &acc_x, int16_t &acc_y, int16_t &acc_z)
+{
+	acc_x = ((int16_t)(raw[0] | (raw[1] << 8)) >> 6) * 4;
+	acc_y = ((int16_t)(raw[2] | (raw[3] << 8)) >> 6) * 4;
+	acc_z = ((int16_t)(raw[4] | (raw[5] << 8)) >> 6) * 4;
+}
+
+/**
+ * @brief Read the current acceleration, one burst of OUT_X_L..OUT_Z_H
+ * @note With the FIFO on this is the oldest sample in it
+ * 
+ * @param acc_x X in mg
+ * @param acc_y Y in mg
+ * @param acc_z Z in mg
+ * @return true If the sensor is there
+ */
+bool read_acc(int16_t &acc_x, int16_t &acc_y, int16_t &acc_z)
+{
+	uint8_t raw[ACC_SAMPLE_BYTES];
+	if (!acc_ready || !acc_read_regs(LIS3DH_OUT_X_L, raw, ACC_SAMPLE_BYTES))
+	{
+		return false;
+	}
+	acc_sample_mg(raw, acc_x, acc_y, acc_z);
 	return true;
 }
 
-void read_acc(void)
+/**
+ * @brief Read FIFO samples, ACC_BURST_SAMPLES per I2C transaction
+ * @note With the FIFO on the address wraps from OUT_Z_H back to OUT_X_L
+ * 
+ * @param acc_x X in mg
+ * @param acc_y Y in mg
+ * @param acc_z Z in mg
+ * @param count Samples to read, no more than the FIFO holds
+ * @return uint8_t Samples read
+ */
+uint8_t read_acc_block(int16_t *acc_x, int16_t *acc_y, int16_t *acc_z, uint8_t count)
 {
-	int16_t acc_x = (int16_t)(acc_sensor.readFloatAccelX() * 1000.0);
-	int16_t acc_y = (int16_t)(acc_sensor.readFloatAccelY() * 1000.0);
-	int16_t acc_z = (int16_t)(acc_sensor.readFloatAccelZ() * 1000.0);
+	if (!acc_ready)
+	{
+		return 0;
+	}
+	uint8_t raw[ACC_BURST_SAMPLES * ACC_SAMPLE_BYTES];
+	uint8_t done = 0;
+	while (done < count)
+	{
+		uint8_t burst = min((uint8_t)(count - done), (uint8_t)ACC_BURST_SAMPLES);
+		if (!acc_read_regs(LIS3DH_OUT_X_L, raw, burst * ACC_SAMPLE_BYTES))
+		{
+			break;
+		}
+		for (uint8_t i = 0; i < burst; i++, done++)
+		{
+			acc_sample_mg(&raw[i * ACC_SAMPLE_BYTES], acc_x[done], acc_y[done], acc_z[done]);
+		}
+	}
+	return done;
+}
 
-	MYLOG("ACC", "X %.3f %.3f %d", acc_sensor.readFloatAccelX(), acc_sensor.readFloatAccelX() * 1000.0, acc_x);
-	MYLOG("ACC", "Y %.3f %.3f %d", acc_sensor.readFloatAccelY(), acc_sensor.readFloatAccelY() * 1000.0, acc_y);
-	MYLOG("ACC", "Z %.3f %.3f %d", acc_sensor.readFloatAccelZ(), acc_sensor.readFloatAccelZ() * 1000.0, acc_z);
+/**
+ * @brief Read the samples waiting in the FIFO
+ * 
+ * @param x X in mg
+ * @param y Y in mg
+ * @param z Z in mg
+ * @return uint8_t Number of samples
+ */
+static uint8_t read_acc_fifo(int16_t *x, int16_t *y, int16_t *z)
+{
+	uint8_t fifo_src = 0;
+	acc_read_regs(LIS3DH_FIFO_SRC_REG, &fifo_src, 1);
+	if ((fifo_src & ACC_FIFO_OVRN) && acc_mode == ACC_MODE_BATCH)
+	{
+		// The MCU was late for the watermark, the oldest samples are gone
+		g_acc_overruns++;
+	}
+	return read_acc_block(x, y, z, fifo_src & ACC_FIFO_FSS);
+}
 
+/**
+ * @brief Handle an ACC wakeup, classify what is in the FIFO
+ * @note Call on ACC_TRIGGER, also re-arms the interrupt
+ * 
+ * @return uint8_t ACTIVITY_STILL, ACTIVITY_WALKING or ACTIVITY_DRIVING
+ */
+uint8_t acc_batch(void)
+{
+	g_acc_wakes++;
+	if (!acc_ready)
+	{
+		return ACTIVITY_DRIVING;
+	}
+
+	int16_t x[ACC_FIFO_SIZE];
+	int16_t y[ACC_FIFO_SIZE];
+	int16_t z[ACC_FIFO_SIZE];
+	uint8_t count = read_acc_fifo(x, y, z);
+	g_acc_samples += count;
+	uint8_t activity = activity_classify(x, y, z, count);
+
+	acc_same_batches = activity == acc_last_activity ? acc_same_batches + 1 : 1;
+	acc_last_activity = activity;
+
+	uint8_t mode = ACC_MODE_BATCH;
+	if (activity == ACTIVITY_STILL)
+	{
+		// Still again, only movement wakes us
+		if (acc_mode == ACC_MODE_MOVEMENT || acc_same_batches >= ACC_STILL_BATCHES)
+		{
+			mode = ACC_MODE_MOVEMENT;
+		}
+	}
+	else if (acc_same_batches >= ACC_STEADY_BATCHES)
+	{
+		// Steady walking or driving, no need to follow every batch
+		mode = ACC_MODE_PACED;
+	}
+
+	if (mode != acc_mode)
+	{
+		static const uint8_t int1_sources[3] = {ACC_INT1_AOI, ACC_INT1_WTM, 0x00};
+		acc_write_reg(LIS3DH_CTRL_REG3, int1_sources[mode]);
+		acc_mode = mode;
+	}
+	acc_pace_timer.stop();
+	if (acc_mode == ACC_MODE_PACED)
+	{
+		acc_pace_timer.start();
+	}
+	// Re-arm the latched movement interrupt
+	clear_acc_int();
+
+	static const char *mode_names[3] = {"movement", "batch", "paced"};
+	MYLOG("ACC", "Next wakeup on %s, %ld wakeups in %lds, %ld overruns", mode_names[acc_mode], (long)g_acc_wakes, (long)(millis() / 1000), (long)g_acc_overruns);
+	MYLOG("ACC", "%ld I2C transactions", (long)g_acc_i2c_transactions);
+	return activity;
 }
 
 /**
@@ -114,14 +371,27 @@ void acc_int_callback(void)
 	xSemaphoreGiveFromISR(g_task_sem, pdFALSE);
 }
 
+/**
+ * @brief Next batch while paced
+ * @note gives semaphore to wake up main loop
+ * 
+ * @param unused 
+ * 			Timer handle, not used
+ */
+void acc_pace_due(TimerHandle_t unused)
+{
+	g_task_event_type |= ACC_TRIGGER;
+	xSemaphoreGiveFromISR(g_task_sem, &g_higher_priority_task_woken);
+}
+
 /**
  * @brief Clear ACC interrupt register to enable next wakeup
  * 
  */
 void clear_acc_int(void)
 {
-	uint8_t data_read;
-	acc_sensor.readRegister(&data_read, LIS3DH_INT1_SRC);
+	uint8_t data_read = 0;
+	acc_read_regs(LIS3DH_INT1_SRC, &data_read, 1);
 	if (data_read & 0x40)
 		MYLOG("ACC", "Interrupt Active 0x%X\n", data_read);
 	if (data_read & 0x20)
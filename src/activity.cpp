@@ -0,0 +1,115 @@
+/**
+ * @file activity.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Still, walking or driving from one batch of accelerometer samples
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * A batch is the LIS3DH FIFO, up to 32 samples at ACC_ODR_HZ. The classifier
+ * only looks at |a|, the mounting doesn't matter:
+ *   activity  Mean deviation of |a| from its batch mean, mg
+ *   rhythm    How often |a| crosses its mean by more than ACTIVITY_HYST_MG
+ * Still is below ACTIVITY_STILL_MG. Walking is a strong swing at step
+ * rhythm, 1 to 3.5 steps per second. Everything else that moves is
+ * driving (car, bike, train), road vibration is weaker and has no rhythm
+ * at 10Hz.
+ * tools/acc_classify.py is the same classifier for recorded traces.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Below this |a| deviation it is still, mg */
+#ifndef ACTIVITY_STILL_MG
+#define ACTIVITY_STILL_MG 15
+#endif
+/** Walking swings at least this much, mg */
+#ifndef ACTIVITY_WALK_MG
+#define ACTIVITY_WALK_MG 60
+#endif
+/** Mean crossings smaller than this are noise, mg */
+#define ACTIVITY_HYST_MG 20
+/** Step rhythm, 0.1 Hz */
+#define ACTIVITY_STEP_MIN_HZ_X10 10
+#define ACTIVITY_STEP_MAX_HZ_X10 35
+
+static const char *activityNames[ACTIVITY_CLASSES] = {"still", "walking", "driving"};
+
+/** Stats of the last batch */
+uint16_t g_activity_mg = 0;
+uint16_t g_activity_hz_x10 = 0;
+/** Batches per class */
+uint32_t g_activity_batches[ACTIVITY_CLASSES] = {0};
+
+/**
+ * @brief Classify one batch
+ *
+ * @param x X in mg
+ * @param y Y in mg
+ * @param z Z in mg
+ * @param count Number of samples, at most ACC_FIFO_SIZE
+ * @return uint8_t ACTIVITY_STILL, ACTIVITY_WALKING or ACTIVITY_DRIVING
+ */
+uint8_t activity_classify(const int16_t *x, const int16_t *y, const int16_t *z, uint8_t count)
+{
+    if(count < 2)
+    {
+        /** Nothing to go by, a wakeup still means movement */
+        return ACTIVITY_DRIVING;
+    }
+
+    int32_t magnitude[ACC_FIFO_SIZE];
+    int32_t sum = 0;
+    count = min(count, (uint8_t)ACC_FIFO_SIZE);
+    for(uint8_t i = 0; i < count; i++)
+    {
+        magnitude[i] = sqrtf((float)x[i] * x[i] + (float)y[i] * y[i] + (float)z[i] * z[i]);
+        sum += magnitude[i];
+    }
+    int32_t mean = sum / count;
+
+    uint32_t deviation = 0;
+    uint8_t crossings = 0;
+    int8_t side = 0;
+    for(uint8_t i = 0; i < count; i++)
+    {
+        int32_t d = magnitude[i] - mean;
+        deviation += abs(d);
+        if(d > ACTIVITY_HYST_MG || d < -ACTIVITY_HYST_MG)
+        {
+            int8_t now = d > 0 ? 1 : -1;
+            if(side != 0 && now != side)
+            {
+                crossings++;
+            }
+            side = now;
+        }
+    }
+    g_activity_mg = deviation / count;
+    /** Two crossings per step */
+    g_activity_hz_x10 = (uint32_t)crossings * 10 * ACC_ODR_HZ / (2 * count);
+
+    uint8_t activity = ACTIVITY_DRIVING;
+    if(g_activity_mg < ACTIVITY_STILL_MG)
+    {
+        activity = ACTIVITY_STILL;
+    }
+    else if(g_activity_mg >= ACTIVITY_WALK_MG && g_activity_hz_x10 >= ACTIVITY_STEP_MIN_HZ_X10 && g_activity_hz_x10 <= ACTIVITY_STEP_MAX_HZ_X10)
+    {
+        activity = ACTIVITY_WALKING;
+    }
+    g_activity_batches[activity]++;
+    MYLOG("ACT", "%d samples, %dmg, %d swings/10s, %s", count, g_activity_mg, g_activity_hz_x10, activityNames[activity]);
+    return activity;
+}
+
+/**
+ * @brief Name of a class for the logs
+ *
+ */
+const char *activity_name(uint8_t activity)
+{
+    return activity < ACTIVITY_CLASSES ? activityNames[activity] : "?";
+}
@@ -0,0 +1,296 @@
+/**
+ * @file airtime.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Region data rate tables, time on air and duty cycle budget
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Tables follow the LoRaWAN Regional Parameters (RP002-1.0.x) and are in
+ * the same order as region_names / LoRaMacRegion_t. Max payload is the
+ * application payload without FOpts. Regions with a 400ms uplink dwell
+ * time (US915, AU915, AS923-x) use the dwell limited payload sizes.
+ *
+ * Time on air is the Semtech formula (AN1200.13), 8 symbol preamble,
+ * explicit header, CRC on, coding rate 4/5, low data rate optimize for
+ * SF11/SF12 at 125kHz.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** LoRaWAN overhead, MHDR(1) + FHDR(7) + FPort(1) + MIC(4) */
+#define LORAWAN_OVERHEAD 13
+/** Number of entries in region_names */
+#define LORA_REGION_COUNT 13
+/** Max data rates per region */
+#define LORA_MAX_DR 14
+/** Duty cycle budget window, ETSI counts over one hour */
+#define DUTY_CYCLE_WINDOW_MS 3600000UL
+/** Time the TX cycle (RX1 and RX2 windows) needs, shortest send interval */
+#define AIRTIME_TX_CYCLE_MS 3000UL
+
+/** Bandwidth codes */
+enum lora_bw_e : uint8_t
+{
+    BW125 = 0,
+    BW250 = 1,
+    BW500 = 2,
+};
+
+/** One data rate, sf 0 is not available (RFU, FSK or downlink only) */
+struct lora_dr_s
+{
+    uint8_t sf;
+    lora_bw_e bw;
+    uint8_t max_payload;
+};
+
+/** Region parameters */
+struct lora_region_s
+{
+    uint8_t num_dr;
+    /** 1/x duty cycle, 0 is no duty cycle */
+    uint8_t duty_cycle_div;
+    /** Max time on air per uplink, 0 is no limit */
+    uint16_t dwell_ms;
+    lora_dr_s dr[LORA_MAX_DR];
+};
+
+/** EU868 like regions, DR0..DR6 */
+#define DR_TABLE_EU {{12, BW125, 51}, {11, BW125, 51}, {10, BW125, 51}, {9, BW125, 115}, {8, BW125, 222}, {7, BW125, 222}, {7, BW250, 222}}
+/** AS923 family with uplink dwell time, DR0/DR1 can't be used */
+#define DR_TABLE_AS923 {{12, BW125, 0}, {11, BW125, 0}, {10, BW125, 11}, {9, BW125, 53}, {8, BW125, 125}, {7, BW125, 242}, {7, BW250, 242}}
+
+static constexpr lora_region_s regions[LORA_REGION_COUNT] = {
+    /** AS923 */
+    {7, 0, 400, DR_TABLE_AS923},
+    /** AU915, DR8..DR13 are downlink only */
+    {7, 0, 400, {{12, BW125, 0}, {11, BW125, 0}, {10, BW125, 11}, {9, BW125, 53}, {8, BW125, 125}, {7, BW125, 242}, {8, BW500, 242}}},
+    /** CN470 */
+    {6, 0, 0, {{12, BW125, 51}, {11, BW125, 51}, {10, BW125, 51}, {9, BW125, 115}, {8, BW125, 242}, {7, BW125, 242}}},
+    /** CN779 */
+    {7, 100, 0, DR_TABLE_EU},
+    /** EU433 */
+    {7, 100, 0, DR_TABLE_EU},
+    /** EU868 */
+    {7, 100, 0, DR_TABLE_EU},
+    /** KR920 */
+    {6, 0, 0, {{12, BW125, 51}, {11, BW125, 51}, {10, BW125, 51}, {9, BW125, 115}, {8, BW125, 222}, {7, BW125, 222}}},
+    /** IN865 */
+    {6, 0, 0, {{12, BW125, 51}, {11, BW125, 51}, {10, BW125, 51}, {9, BW125, 115}, {8, BW125, 222}, {7, BW125, 222}}},
+    /** US915, DR5..DR7 RFU, DR8..DR13 are downlink only */
+    {14, 0, 400, {{10, BW125, 11}, {9, BW125, 53}, {8, BW125, 125}, {7, BW125, 242}, {8, BW500, 242}, {0, BW125, 0}, {0, BW125, 0}, {0, BW125, 0},
+                  {12, BW500, 33}, {11, BW500, 109}, {10, BW500, 222}, {9, BW500, 222}, {8, BW500, 222}, {7, BW500, 222}}},
+    /** AS923-2 */
+    {7, 0, 400, DR_TABLE_AS923},
+    /** AS923-3 */
+    {7, 0, 400, DR_TABLE_AS923},
+    /** AS923-4 */
+    {7, 0, 400, DR_TABLE_AS923},
+    /** RU864 */
+    {7, 100, 0, DR_TABLE_EU},
+};
+
+/** Last uplink start and its time on air */
+static uint32_t lastTxTime = 0;
+static uint32_t lastTxAirtime = 0;
+static bool hasTx = false;
+/** Duty cycle budget left in ms of airtime, refills at the duty cycle rate */
+static uint32_t budgetMs = 0;
+static uint32_t budgetTime = 0;
+static bool budgetInit = false;
+
+/**
+ * @brief Look up a data rate of a region
+ *
+ * @param region LoRaMacRegion_t
+ * @param dr Data rate
+ * @return const lora_dr_s* NULL if the region or data rate doesn't exist
+ */
+static const lora_dr_s *getDr(uint8_t region, uint8_t dr)
+{
+    if(region >= LORA_REGION_COUNT || dr >= regions[region].num_dr)
+    {
+        return NULL;
+    }
+    const lora_dr_s *entry = &regions[region].dr[dr];
+    return entry->sf == 0 ? NULL : entry;
+}
+
+/**
+ * @brief Spreading factor of a data rate
+ *
+ * @param region LoRaMacRegion_t
+ * @param dr Data rate
+ * @return int8_t Spreading factor, 0 if not available
+ */
+int8_t lora_dr_sf(uint8_t region, uint8_t dr)
+{
+    const lora_dr_s *entry = getDr(region, dr);
+    return entry == NULL ? 0 : entry->sf;
+}
+
+/**
+ * @brief Max application payload of a data rate
+ *
+ * @param region LoRaMacRegion_t
+ * @param dr Data rate
+ * @return uint8_t Max payload in bytes, 0 if not available
+ */
+uint8_t lora_dr_max_payload(uint8_t region, uint8_t dr)
+{
+    const lora_dr_s *entry = getDr(region, dr);
+    return entry == NULL ? 0 : entry->max_payload;
+}
+
+/**
+ * @brief Time on air of one LoRa frame
+ *
+ * @param sf Spreading factor 7..12
+ * @param bw_khz Bandwidth 125, 250 or 500
+ * @param phy_len PHY payload length in bytes
+ * @return uint32_t Time on air in us
+ */
+uint32_t lora_time_on_air_us(uint8_t sf, uint16_t bw_khz, uint8_t phy_len)
+{
+    /** Symbol time, exact in us for all SF/BW combinations */
+    uint32_t tsym = ((uint32_t)1 << sf) * 1000 / bw_khz;
+    /** Low data rate optimize */
+    int32_t de = (sf >= 11 && bw_khz == 125) ? 1 : 0;
+    /** 8PL - 4SF + 28 + 16CRC - 20IH */
+    int32_t num = 8 * (int32_t)phy_len - 4 * sf + 28 + 16;
+    int32_t den = 4 * (sf - 2 * de);
+    int32_t blocks = num > 0 ? (num + den - 1) / den : 0;
+    /** Coding rate 4/5 */
+    uint32_t payloadSym = 8 + blocks * 5;
+    /** Preamble 8 + 4.25 symbols */
+    return (49 * tsym) / 4 + payloadSym * tsym;
+}
+
+/**
+ * @brief Time on air of an uplink with the current region and data rate
+ *
+ * @param app_len Application payload length
+ * @return uint32_t Time on air in ms, 0 if the data rate is not available
+ */
+uint32_t lora_uplink_airtime_ms(uint8_t app_len)
+{
+    const lora_dr_s *entry = getDr(g_lorawan_settings.lora_region, g_lorawan_settings.data_rate);
+    if(entry == NULL)
+    {
+        return 0;
+    }
+    static const uint16_t bwKhz[] = {125, 250, 500};
+    return (lora_time_on_air_us(entry->sf, bwKhz[entry->bw], app_len + LORAWAN_OVERHEAD) + 999) / 1000;
+}
+
+/**
+ * @brief Refill the duty cycle budget up to now
+ *
+ * @param now millis()
+ * @param div 1/x duty cycle
+ */
+static void refillBudget(uint32_t now, uint8_t div)
+{
+    uint32_t capacity = DUTY_CYCLE_WINDOW_MS / div;
+    if(!budgetInit)
+    {
+        budgetMs = capacity;
+        budgetTime = now;
+        budgetInit = true;
+        return;
+    }
+    uint32_t refill = (now - budgetTime) / div;
+    /** Keep the remainder for the next refill */
+    budgetTime += refill * div;
+    budgetMs = min(capacity, budgetMs + refill);
+}
+
+/**
+ * @brief Time until the next uplink is allowed
+ * Duty cycle regions: the next uplink starts no earlier than airtime * div
+ * after the last one started (an off time of airtime * (div - 1) after it
+ * ended), and the rolling one hour budget has to cover its airtime.
+ * Other regions: TX cycle only
+ *
+ * @param app_len Application payload length of the next uplink
+ * @return uint32_t Wait time in ms, 0 if it can be sent now
+ */
+uint32_t airtime_wait_ms(uint8_t app_len)
+{
+    uint32_t now = millis();
+    uint32_t earliest = now;
+    const lora_region_s *region = g_lorawan_settings.lora_region < LORA_REGION_COUNT ? &regions[g_lorawan_settings.lora_region] : NULL;
+
+    if(hasTx)
+    {
+        uint32_t offTime = AIRTIME_TX_CYCLE_MS;
+        if(region != NULL && region->duty_cycle_div != 0)
+        {
+            offTime = max(offTime, lastTxAirtime * region->duty_cycle_div);
+        }
+        uint32_t allowed = lastTxTime + offTime;
+        if((int32_t)(allowed - earliest) > 0)
+        {
+            earliest = allowed;
+        }
+    }
+
+    if(region != NULL && region->duty_cycle_div != 0)
+    {
+        refillBudget(now, region->duty_cycle_div);
+        uint32_t airtime = lora_uplink_airtime_ms(app_len);
+        if(budgetMs < airtime)
+        {
+            uint32_t allowed = now + (airtime - budgetMs) * region->duty_cycle_div;
+            if((int32_t)(allowed - earliest) > 0)
+            {
+                earliest = allowed;
+            }
+        }
+    }
+    return earliest - now;
+}
+
+/**
+ * @brief Check if a payload fits the current data rate (size and dwell time)
+ *
+ * @param app_len Application payload length
+ * @return true Payload can be sent
+ */
+bool airtime_payload_ok(uint8_t app_len)
+{
+    uint8_t region = g_lorawan_settings.lora_region;
+    if(app_len > lora_dr_max_payload(region, g_lorawan_settings.data_rate))
+    {
+        return false;
+    }
+    uint16_t dwell = region < LORA_REGION_COUNT ? regions[region].dwell_ms : 0;
+    return dwell == 0 || lora_uplink_airtime_ms(app_len) <= dwell;
+}
+
+/**
+ * @brief An uplink was queued, charge it to the duty cycle budget
+ *
+ * @param app_len Application payload length
+ */
+void airtime_tx_started(uint8_t app_len)
+{
+    uint32_t now = millis();
+    lastTxTime = now;
+    lastTxAirtime = lora_uplink_airtime_ms(app_len);
+    hasTx = true;
+
+    if(g_lorawan_settings.lora_region < LORA_REGION_COUNT)
+    {
+        uint8_t div = regions[g_lorawan_settings.lora_region].duty_cycle_div;
+        if(div != 0)
+        {
+            refillBudget(now, div);
+            budgetMs = budgetMs > lastTxAirtime ? budgetMs - lastTxAirtime : 0;
+        }
+    }
+    MYLOG("AIR", "Uplink %d bytes, %ld ms on air, budget %ld ms", app_len, (long)lastTxAirtime, (long)budgetMs);
+}
@@ -32,16 +32,25 @@ batt_s batt_level;
 /** Flag if delayed sending is already activated */
 bool delayed_active = false;
 
-/** Minimum delay between sending new locations, set to 45 seconds */
-time_t min_delay = 45000;
-
 /** The GPS module to use */
 uint8_t gnss_option;
 
+/** BLE UART bytes to AT command lines */
+LineAssembler<AT_LINE_MAX> at_line;
+/** Runs a command that came without line end once no more data follows */
+SoftwareTimer at_idle_timer;
+volatile bool at_idle_expired = false;
+/** AT command handling stats */
+uint32_t g_at_cmd_count = 0;
+uint32_t g_at_cmd_us_last = 0;
+uint32_t g_at_cmd_us_max = 0;
+
 
 
 // Forward declaration
 void send_delayed(TimerHandle_t unused);
+void at_idle(TimerHandle_t unused);
+void run_at_line(void);
 
 /**
  * @brief Application specific setup functions
@@ -59,6 +68,9 @@ void setup_app(void)
 	/**************************************************************/
 	g_enable_ble = true;
 	api_set_version(1, 0, 2);
+
+	// Log lines are queued from here on and printed by the log task
+	log_init();
 }
 
 /**
@@ -72,43 +84,35 @@ bool init_app(void)
 	// Add your application specific initialization here
 	bool init_result = true;
 
-	MYLOG("APP", "Application initialization");
-	if (g_ble_uart_is_connected)
-	{
-		g_ble_uart.print("Application initialization\n");
-	}
+	APP_LOG("APP", "Application initialization");
 
 	pinMode(WB_IO2, OUTPUT);
 	digitalWrite(WB_IO2, HIGH);
 
+	// OLED, RAK12500 and LIS3DH share Wire, before any of them is used
+	i2c_bus_init();
+
 	// Initialize GNSS module
 	gnss_option = init_gnss();
+	// GNSS sleeps between beacons from now on
+	gnss_power_init(gnss_option);
 
 	// Initialize ACC sensor
 	init_result |= init_acc();
 
-	if (g_lorawan_settings.send_repeat_time != 0)
-	{
-		// Set delay for sending to 1/2 of scheduled sending
-		//min_delay = g_lorawan_settings.send_repeat_time / 2;
-		min_delay = 15000;
-	}
-	else
-	{
-		// Send repeat time is 0, set delay to 30 seconds
-		min_delay = 30000;
-	}
-	// Set to 1/2 of programmed send interval or 30 seconds
-	delayed_sending.begin(min_delay, send_delayed, NULL, false);
+	// Period is set from the duty cycle budget before every start
+	delayed_sending.begin(15000, send_delayed, NULL, false);
+
+	// Beacons wait here while the radio can't take them
+	uplink_queue_init();
+
+	at_idle_timer.begin(AT_LINE_IDLE_MS, at_idle, NULL, false);
 
 	/** Field Tester initalize display here 
 	 * So we can get most up to date info
 	*/
 	ftester_init();
 
-	// Power down GNSS module
-	// pinMode(WB_IO2, OUTPUT);
-	// digitalWrite(WB_IO2, LOW);
 	return init_result;
 }
 
@@ -127,11 +131,7 @@ void app_event_handler(void)
 	{
 		g_task_event_type &= N_STATUS;
 		
-		MYLOG("APP", "Timer wakeup");
-		if (g_ble_uart_is_connected)
-		{
-			g_ble_uart.print("Timer wakeup\n");
-		}
+		APP_LOG("APP", "Timer wakeup");
 
 		clear_acc_int();
 
@@ -141,124 +141,65 @@ void app_event_handler(void)
 			restart_advertising(15);
 		}
 
-		if (lora_busy)
-		{
-			MYLOG("APP", "LoRaWAN TX cycle not finished, skip this event");
-			if (g_ble_uart_is_connected)
-			{
-				g_ble_uart.print("LoRaWAN TX cycle not finished, skip this event\n");
-			}
-		}
-		else
+		// Get battery level
+		batt_level.batt16 = read_batt();
+		g_mapper_data.batt_1 = batt_level.batt8[0];
+		g_mapper_data.batt_2 = batt_level.batt8[1];
+		
+		APP_LOG("APP", "Battery: %.2f V", batt_level.batt16 / 1000.0);
+		APP_LOG("APP", "Trying to poll GNSS position");
+		
+		gnss_power_wake();
+		bool has_fix = poll_gnss(gnss_option);
+		gnss_power_fix(has_fix);
+		if (has_fix)
 		{
-			// Get battery level
-			batt_level.batt16 = read_batt();
-			g_mapper_data.batt_1 = batt_level.batt8[0];
-			g_mapper_data.batt_2 = batt_level.batt8[1];
-			
-			MYLOG("APP", "Battery level %d", batt_level.batt16);
-			MYLOG("APP", "Trying to poll GNSS position");
-			if(g_ble_uart_is_connected)
-			{
-				g_ble_uart.printf("Battery: %.2f V\n", batt_level.batt16 / 1000.0);
-				g_ble_uart.print("Trying to poll GNSS position\n");
-			}
-			
-			if (poll_gnss(gnss_option))
-			{
-				MYLOG("APP", "Valid GNSS position acquired");
+			// Dead reckoning starts over from this fix
+			motion_fix(g_last_fix);
 
-				//Hook for Field Tester
-				ftester_gps_fix(true);
+			APP_LOG("APP", "Valid GNSS position acquired");
 
-				if (g_ble_uart_is_connected)
-				{
-					g_ble_uart.print("Valid GNSS position acquired\n");
-				}
+			//Hook for Field Tester
+			ftester_gps_fix(true);
 
-				MYLOG("APP", "Lat 1: %02X", g_mapper_data.lat_1);
-				MYLOG("APP", "Lat 2: %02X", g_mapper_data.lat_2);
-				MYLOG("APP", "Lat 3: %02X", g_mapper_data.lat_3);
-				MYLOG("APP", "Lat 4: %02X", g_mapper_data.lat_4);
-				MYLOG("APP", "Long 1: %02X", g_mapper_data.long_1);
-				MYLOG("APP", "Long 2: %02X", g_mapper_data.long_2);
-				MYLOG("APP", "Long 3: %02X", g_mapper_data.long_3);
-				MYLOG("APP", "Long 4: %02X", g_mapper_data.long_4);
-				MYLOG("APP", "Alt 1: %02X", g_mapper_data.alt_1);
-				MYLOG("APP", "Alt 2: %02X", g_mapper_data.alt_2);
-				MYLOG("APP", "Acy 1: %02X", g_mapper_data.acy_1);
-				MYLOG("APP", "Acy 2: %02X", g_mapper_data.acy_2);
-				MYLOG("APP", "Batt 1: %02X", g_mapper_data.batt_1);
-				MYLOG("APP", "Batt 2: %02X", g_mapper_data.batt_2);
-
-				if (g_ble_uart_is_connected) {
-					g_ble_uart.printf("Lat 1: %02X\n", g_mapper_data.lat_1);
-					g_ble_uart.printf("Lat 2: %02X\n", g_mapper_data.lat_2);
-					g_ble_uart.printf("Lat 3: %02X\n", g_mapper_data.lat_3);
-					g_ble_uart.printf("Lat 4: %02X\n", g_mapper_data.lat_4);
-					g_ble_uart.printf("Long 1: %02X\n", g_mapper_data.long_1);
-					g_ble_uart.printf("Long 2: %02X\n", g_mapper_data.long_2);
-					g_ble_uart.printf("Long 3: %02X\n", g_mapper_data.long_3);
-					g_ble_uart.printf("Long 4: %02X\n", g_mapper_data.long_4);
-					g_ble_uart.printf("Alt 1: %02X\n", g_mapper_data.alt_1);
-					g_ble_uart.printf("Alt 2: %02X\n", g_mapper_data.alt_2);
-					g_ble_uart.printf("Acy 1: %02X\n", g_mapper_data.acy_1);
-					g_ble_uart.printf("Acy 2: %02X\n", g_mapper_data.acy_2);
-					g_ble_uart.printf("Batt 1: %02X\n", g_mapper_data.batt_1);
-					g_ble_uart.printf("Batt 2: %02X\n", g_mapper_data.batt_2);
-				}
-
-				/** Hook for Field Tester */
-				ftester_tx_beacon();
-				
-				lmh_error_status result = send_lora_packet((uint8_t *)&g_mapper_data, MAPPER_DATA_LEN);
-				switch (result)
-				{
-				case LMH_SUCCESS:
-					MYLOG("APP", "Packet enqueued");
-					if (g_ble_uart_is_connected)
-					{
-						g_ble_uart.print("Packet enqueued\n");
-					}
-					/// \todo set a flag that TX cycle is running
-					lora_busy = true;
-					
-					break;
-				case LMH_BUSY:
-					MYLOG("APP", "LoRa transceiver is busy");
-					if (g_ble_uart_is_connected)
-					{
-						g_ble_uart.print("LoRa transceiver is busy\n");
-					}
-					break;
-				case LMH_ERROR:
-					MYLOG("APP", "Packet error, too big to send with current DR");
-					if (g_ble_uart_is_connected)
-					{
-						g_ble_uart.print("Packet error, too big to send with current DR\n");
-					}
-					break;
-				}
+			APP_LOG("APP", "Lat: %02X %02X %02X %02X", g_mapper_data.lat_1, g_mapper_data.lat_2, g_mapper_data.lat_3, g_mapper_data.lat_4);
+			APP_LOG("APP", "Long: %02X %02X %02X %02X", g_mapper_data.long_1, g_mapper_data.long_2, g_mapper_data.long_3, g_mapper_data.long_4);
+			APP_LOG("APP", "Alt: %02X %02X Acy: %02X %02X", g_mapper_data.alt_1, g_mapper_data.alt_2, g_mapper_data.acy_1, g_mapper_data.acy_2);
+			APP_LOG("APP", "Batt: %02X %02X", g_mapper_data.batt_1, g_mapper_data.batt_2);
 
+			// Only beacon if we moved/turned enough or it is time to
+			if (!beacon_should_send(g_last_fix))
+			{
+				APP_LOG("APP", "Beacon suppressed, not moved enough");
 			}
 			else
 			{
-				MYLOG("APP", "No valid GNSS position");
-
-				//Hook for Field Tester
-				ftester_gps_fix(false);
-
-				if (g_ble_uart_is_connected)
-				{
-					g_ble_uart.print("No valid GNSS position\n");
-				}
+				/** Hook for Field Tester */
+				ftester_tx_beacon();
+			
+				// Sent now or as soon as the radio is free
+				beacon_sent(g_last_fix);
+				uplink_queue_add(&g_last_fix, batt_level.batt16, UPLINK_PRIO_FIX);
 			}
 
-			// Remember last time sending
-			last_pos_send = millis();
-			// Just in case
-			delayed_active = false;
 		}
+		else
+		{
+			APP_LOG("APP", "No valid GNSS position");
+
+			//Hook for Field Tester
+			ftester_gps_fix(false);
+		}
+
+		// Remember last time sending
+		last_pos_send = millis();
+		// Just in case
+		delayed_active = false;
+
+		// Sleep until just before the next timer beacon
+		gnss_power_sleep(g_lorawan_settings.send_repeat_time);
+		gnss_power_report();
+		i2c_bus_report();
 	}
 
 	// ACC trigger event
@@ -266,66 +207,72 @@ void app_event_handler(void)
 	{
 		g_task_event_type &= N_ACC_TRIGGER;
 
-		/** Hook for Field Tester */
-		ftester_acc_event();
+		// One wakeup per FIFO batch, updates the dead reckoned position
+		uint8_t activity = acc_batch();
+		motion_wake(activity);
 
-		MYLOG("APP", "ACC triggered");
-		if (g_ble_uart_is_connected)
+		// A still batch has nothing to send
+		if (activity != ACTIVITY_STILL)
 		{
-			g_ble_uart.print("ACC triggered\n");
-		}
+			/** Hook for Field Tester */
+			ftester_acc_event();
 
-		// Check time since last send
-		bool send_now = true;
-		if (g_lorawan_settings.send_repeat_time != 0)
-		{
-			if ((millis() - last_pos_send) < min_delay)
+			APP_LOG("APP", "ACC triggered, %s", activity_name(activity));
+
+			// Skip the GNSS poll if we can't have moved enough since the last beacon
+			bool send_now = beacon_wake_needed();
+
+			// Check earliest legal send time for region/DR (duty cycle, TX cycle)
+			if (send_now && g_lorawan_settings.send_repeat_time != 0)
 			{
-				send_now = false;
-				if (!delayed_active)
+				time_t wait_time = airtime_wait_ms(MAPPER_DATA_LEN);
+				if (wait_time > 0)
 				{
-					delayed_sending.stop();
-					MYLOG("APP", "Expired time %d", (int)(millis() - last_pos_send));
-					MYLOG("APP", "Max delay time %d", (int)min_delay);
-					if (g_ble_uart_is_connected)
+					send_now = false;
+					if (!delayed_active)
 					{
-						g_ble_uart.printf("Expired time %d\n", (millis() - last_pos_send));
-						g_ble_uart.printf("Max delay time %d\n", min_delay);
+						delayed_sending.stop();
+						APP_LOG("APP", "Expired time %d", (int)(millis() - last_pos_send));
+						APP_LOG("APP", "Wait time %ld", (long)wait_time);
+
+						APP_LOG("APP", "Only %lds since last position message, send delayed in %lds", (long)((millis() - last_pos_send) / 1000), (long)(wait_time / 1000));
+						delayed_sending.setPeriod(wait_time);
+						delayed_sending.start();
+						delayed_active = true;
 					}
-					time_t wait_time = abs(min_delay - (millis() - last_pos_send) >= 0) ? (min_delay - (millis() - last_pos_send)) : min_delay;
-					MYLOG("APP", "Wait time %ld", (long)wait_time);
-					if (g_ble_uart_is_connected)
-					{
-						g_ble_uart.printf("Wait time %d\n", wait_time);
-					}
-
-					MYLOG("APP", "Only %lds since last position message, send delayed in %lds", (long)((millis() - last_pos_send) / 1000), (long)(wait_time / 1000));
-					if (g_ble_uart_is_connected)
-					{
-						g_ble_uart.printf("Only %ds since last pos msg, delay by %ds\n", ((millis() - last_pos_send) / 1000), (wait_time / 1000));
-					}
-					delayed_sending.setPeriod(wait_time);
-					delayed_sending.start();
-					delayed_active = true;
 				}
 			}
-		}
 
-		if (send_now)
-		{
-			// Remember last send time
-			last_pos_send = millis();
+			if (send_now)
+			{
+				// Remember last send time
+				last_pos_send = millis();
 
-			// Trigger a GNSS reading and packet sending
-			g_task_event_type |= STATUS;
-		}
+				// Trigger a GNSS reading and packet sending
+				g_task_event_type |= STATUS;
+			}
 
-		// Reset the standard timer
-		if (g_lorawan_settings.send_repeat_time != 0)
-		{
-			api_timer_restart(g_lorawan_settings.send_repeat_time);
+			// Reset the standard timer
+			if (g_lorawan_settings.send_repeat_time != 0)
+			{
+				api_timer_restart(g_lorawan_settings.send_repeat_time);
+			}
 		}
 	}
+
+	// Session log export, one burst of frames per event
+	if ((g_task_event_type & BLE_EXPORT) == BLE_EXPORT)
+	{
+		g_task_event_type &= N_BLE_EXPORT;
+		ble_export_run();
+	}
+
+	// Queued beacons, retry after busy, not joined or duty cycle
+	if ((g_task_event_type & UPLINK_DRAIN) == UPLINK_DRAIN)
+	{
+		g_task_event_type &= N_UPLINK_DRAIN;
+		uplink_queue_drain();
+	}
 }
 
 /**
@@ -345,20 +292,68 @@ void ble_data_handler(void)
 			/// \todo parse them here
 			/**************************************************************/
 			/**************************************************************/
-			MYLOG("AT", "Received BLE");
 			/** BLE UART data arrived */
 			g_task_event_type &= N_BLE_DATA;
 
+			// Take everything that is there, commands can span BLE packets
 			while (g_ble_uart.available() > 0)
 			{
-				at_serial_input(uint8_t(g_ble_uart.read()));
-				delay(5);
+				if (at_line.push(uint8_t(g_ble_uart.read())))
+				{
+					run_at_line();
+				}
+			}
+
+			// WisBlock Toolbox sends commands without line end
+			if (at_idle_expired)
+			{
+				at_idle_expired = false;
+				if (at_line.flush())
+				{
+					run_at_line();
+				}
+			}
+			else if (at_line.pending())
+			{
+				at_idle_timer.reset();
 			}
-			at_serial_input(uint8_t('\n'));
 		}
 	}
 }
 
+/**
+ * @brief Hand a complete command line to the AT parser
+ * 
+ */
+void run_at_line(void)
+{
+	uint32_t start = micros();
+	const char *cmd = at_line.line();
+	while (*cmd != '\0')
+	{
+		at_serial_input(uint8_t(*cmd++));
+	}
+	at_serial_input(uint8_t('\n'));
+
+	g_at_cmd_us_last = micros() - start;
+	g_at_cmd_us_max = max(g_at_cmd_us_max, g_at_cmd_us_last);
+	g_at_cmd_count++;
+	MYLOG("AT", "Command %d chars handled in %ldus (max %ldus)", at_line.length(), (long)g_at_cmd_us_last, (long)g_at_cmd_us_max);
+}
+
+/**
+ * @brief No BLE data for AT_LINE_IDLE_MS, run the pending command
+ * 
+ * @param unused 
+ * 			Timer handle, not used
+ */
+void at_idle(TimerHandle_t unused)
+{
+	at_idle_expired = true;
+	g_task_event_type |= BLE_DATA;
+	xSemaphoreGiveFromISR(g_task_sem, &g_higher_priority_task_woken);
+}
+
 /**
  * @brief Handle received LoRa Data
  * 
@@ -380,41 +375,16 @@ void lora_data_handler(void)
 		*	Event already exists */
 		ftester_lora_data_handler();
 
-		MYLOG("APP", "Received package over LoRa");
-		if (g_ble_uart_is_connected)
-		{
-			g_ble_uart.print("Received package over LoRa\n");
-		}
+		APP_LOG("APP", "Received package over LoRa");
 
-		char log_buff[g_rx_data_len * 3] = {0};
-		uint8_t log_idx = 0;
-		for (int idx = 0; idx < g_rx_data_len; idx++)
-		{
-			sprintf(&log_buff[log_idx], "%02X ", g_rx_lora_data[idx]);
-			log_idx += 3;
-		}
 		lora_busy = false;
 
-		MYLOG("APP", "%s", log_buff);
-		if (g_ble_uart_is_connected)
+		// Payload dump, up to 4 bytes per log line
+		static const char *rx_formats[4] = {"%02X", "%02X %02X", "%02X %02X %02X", "%02X %02X %02X %02X"};
+		for (int idx = 0; idx < g_rx_data_len; idx += 4)
 		{
-			g_ble_uart.printf("%s", log_buff);
-		}
-
-		/**************************************************************/
-		/**************************************************************/
-		/// \todo Just an example, if BLE is enabled and BLE UART
-		/// \todo is connected you can send the received data
-		/// \todo for debugging
-		/**************************************************************/
-		/**************************************************************/
-		if (g_ble_uart_is_connected && g_enable_ble)
-		{
-			for (int idx = 0; idx < g_rx_data_len; idx++)
-			{
-				g_ble_uart.printf("%02X ", g_rx_lora_data[idx]);
-			}
-			g_ble_uart.print("");
+			uint8_t *rx = &g_rx_lora_data[idx];
+			APP_LOG("APP", rx_formats[min(g_rx_data_len - idx, 4) - 1], rx[0], rx[1], rx[2], rx[3]);
 		}
 	}
 
@@ -430,14 +400,16 @@ void lora_data_handler(void)
 		/**************************************************************/
 		g_task_event_type &= N_LORA_TX_FIN;
 
-		MYLOG("APP", "LPWAN TX cycle %s", g_rx_fin_result ? "finished ACK" : "failed NAK");
-		if (g_ble_uart_is_connected)
-		{
-			g_ble_uart.printf("LPWAN TX cycle %s\n", g_rx_fin_result ? "finished ACK" : "failed NAK");
-		}
+		APP_LOG("APP", "LPWAN TX cycle %s", g_rx_fin_result ? "finished ACK" : "failed NAK");
 
 		/// \todo reset flag that TX cycle is running
 		lora_busy = false;
+
+		// A good frame is the base for the next compact deltas
+		payload_tx_done(g_rx_fin_result);
+
+		// Radio is free, send what queued up meanwhile
+		uplink_queue_drain();
 	}
 }
 
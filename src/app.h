@@ -22,14 +22,12 @@
 // Field Tester Includes
 #include <SPI.h>
 #include <U8g2lib.h>
-#include <string>
 #include <ArduinoJson.h>
-#include <vector>
-#include <iostream>
-#include <sstream>
-#include <iomanip>
-#include <algorithm>
 #include <rak_image.h>
+#include <line_buffer.h>
+#include <text_buf.h>
+#include <line_assembler.h>
+#include <app_log.h>
 
 // Debug output set to 0 to disable app debug output
 #ifndef MY_DEBUG
@@ -37,17 +35,12 @@
 #endif
 
 #if MY_DEBUG > 0
-#define MYLOG(tag, ...)           \
-  do                            \
-  {                             \
-    if (tag)                  \
-      PRINTF("[%s] ", tag); \
-    PRINTF(__VA_ARGS__);      \
-    PRINTF("\n");             \
-  } while (0)
+#define MYLOG(tag, ...) app_log(LOG_SERIAL, tag, __VA_ARGS__)
 #else
 #define MYLOG(...)
 #endif
+/** Log to USB serial (with MY_DEBUG) and to BLE UART, queued, never blocks */
+#define APP_LOG(tag, ...) app_log(LOG_SERIAL | LOG_BLE, tag, __VA_ARGS__)
 
 /** Application function definitions */
 void setup_app(void);
@@ -69,9 +62,78 @@ void ftester_GPSBusy(bool busy);
 void ftester_SetGPSType(bool type);
 extern bool lora_busy;
 
+/** Hot spot info from the mapper integration downlink */
+struct downlink_hotspot_s
+{
+	char name[48] = {0};		// Hot spot name
+	int16_t rssi = 0;			// dBm
+	int16_t snr_x10 = 0;		// 0.1 dB
+	int32_t lat = 0;			// 1e-5 deg
+	int32_t lon = 0;			// 1e-5 deg
+	uint8_t hotspots = 0;		// Hot spots that heard the beacon, 0 if unknown
+	bool has_pos = false;
+};
+bool downlink_decode(const uint8_t *data, uint16_t len, downlink_hotspot_s &hs);
+
+// Geodesy on 1e-5 deg fixed point coordinates
+uint32_t geo_distance_m(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2);
+uint16_t geo_bearing_cdeg(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2);
+void geo_offset(int32_t lat, int32_t lon, uint16_t bearing_cdeg, uint32_t dist_m, int32_t &lat2, int32_t &lon2);
+
+// Region data rates, time on air and duty cycle
+int8_t lora_dr_sf(uint8_t region, uint8_t dr);
+uint8_t lora_dr_max_payload(uint8_t region, uint8_t dr);
+uint32_t lora_time_on_air_us(uint8_t sf, uint16_t bw_khz, uint8_t phy_len);
+uint32_t lora_uplink_airtime_ms(uint8_t app_len);
+uint32_t airtime_wait_ms(uint8_t app_len);
+bool airtime_payload_ok(uint8_t app_len);
+void airtime_tx_started(uint8_t app_len);
+
+// CRC for flash records and export frames
+uint16_t crc16_ccitt(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF);
+
+// Lifetime beacon counters in flash
+void counters_init(void);
+void counters_tx(void);
+void counters_rx(void);
+extern uint32_t g_lifetime_tx;
+extern uint32_t g_lifetime_rx;
+extern uint32_t g_counter_flash_writes;
+extern uint32_t g_counter_flash_prog_bytes;
+extern uint32_t g_counter_flash_erases;
+
+// OLED partial updates
+uint16_t oled_flush(U8G2 &display);
+void oled_invalidate(void);
+extern uint16_t g_oled_bytes_last;
+extern uint32_t g_oled_bytes_total;
+extern uint32_t g_oled_bytes_full;
+extern uint32_t g_frames_requested;
+extern uint32_t g_frames_drawn;
+
 /** Examples for application events */
 #define ACC_TRIGGER 0b1000000000000000
 #define N_ACC_TRIGGER 0b0111111111111111
+#define DISPLAY_REFRESH 0b0100000000000000
+#define N_DISPLAY_REFRESH 0b1011111111111111
+#define BLE_EXPORT 0b0010000000000000
+#define N_BLE_EXPORT 0b1101111111111111
+#define UPLINK_DRAIN 0b0001000000000000
+#define N_UPLINK_DRAIN 0b1110111111111111
+#define DISPLAY_POWER 0b0000100000000000
+#define N_DISPLAY_POWER 0b1111011111111111
+
+/** Longest AT command line */
+#define AT_LINE_MAX 128
+/** A partial AT line is run as a command after this much BLE silence */
+#ifndef AT_LINE_IDLE_MS
+#define AT_LINE_IDLE_MS 100
+#endif
+
+/** Minimum time between two OLED frames, redraws inside it are merged */
+#ifndef FTESTER_FRAME_BUDGET_MS
+#define FTESTER_FRAME_BUDGET_MS 50
+#endif
 
 /** Application stuff */
 extern BaseType_t g_higher_priority_task_woken;
@@ -81,21 +143,231 @@ extern BaseType_t g_higher_priority_task_woken;
 #define RAK12500_GNSS		2
 
 // GNSS functions
-#include "TinyGPS++.h"
 #include <SoftwareSerial.h>
 #include <SparkFun_u-blox_GNSS_Arduino_Library.h>	// RAK12500_GNSS
 uint8_t init_gnss(void);
 bool poll_gnss(uint8_t gnss_option);
+
+/** RAK1910 NMEA task, how often it drains the UART buffer */
+#ifndef GNSS_RX_PERIOD_MS
+#define GNSS_RX_PERIOD_MS 50
+#endif
+/** Longest wait for a fix in poll_gnss() */
+#ifndef GNSS_POLL_WAIT_MS
+#define GNSS_POLL_WAIT_MS 10000
+#endif
+/** A fix older than this is not used for a beacon */
+#define GNSS_FIX_MAX_AGE_MS 2000
+/** RAK12500, how often poll_gnss() checks for NAV-PVT while waiting */
+#define GNSS_PVT_POLL_MS 250
+
+/** Position with motion info from the last valid poll */
+struct gnss_fix_s
+{
+	int32_t lat = 0;			// 1e-5 deg
+	int32_t lon = 0;			// 1e-5 deg
+	int32_t alt = 0;			// m
+	uint16_t hdop = 0;			// 0.01
+	uint32_t speed = 0;			// mm/s
+	uint16_t heading = 0;		// 0.01 deg, 0 is north
+	uint8_t siv = 0;			// Satellites in view
+	uint32_t time = 0;			// millis() of the fix
+	uint32_t epoch = 0;			// UTC Unix time of the fix, 0 if unknown
+	bool valid = false;
+};
+extern gnss_fix_s g_last_fix;
+
+// RAK1910 NMEA decoder, GGA and RMC only
+#define NMEA_NONE 0
+#define NMEA_GGA 1
+#define NMEA_RMC 2
+struct nmea_fix_s
+{
+	int32_t lat = 0;			// 1e-5 deg, GGA
+	int32_t lon = 0;			// 1e-5 deg, GGA
+	int32_t alt = 0;			// m, GGA
+	uint16_t hdop = 0;			// 0.01, GGA
+	uint8_t siv = 0;			// Satellites used, GGA
+	uint32_t speed = 0;			// mm/s, RMC
+	uint16_t heading = 0;		// 0.01 deg, RMC
+	uint16_t year = 0;			// UTC date and time, RMC
+	uint8_t month = 0;
+	uint8_t day = 0;
+	uint8_t hour = 0;
+	uint8_t minute = 0;
+	uint8_t second = 0;
+	bool pos_valid = false;
+	bool alt_valid = false;
+	bool date_valid = false;
+};
+uint8_t nmea_encode(char c);
+void nmea_send(const char *body);
+extern nmea_fix_s g_nmea;
+extern uint32_t g_nmea_sentences;
+extern uint32_t g_nmea_bad_checksum;
+
+// RAK1910 background NMEA parsing
+void gnss_rx_task(void *pvParameters);
+bool gnss_rx_get(gnss_fix_s &fix, uint32_t wait_ms);
+uint8_t gnss_rx_satellites(void);
+extern uint32_t g_gnss_rx_bytes;
+extern uint32_t g_gnss_rx_parse_us;
+extern uint32_t g_gnss_wait_ms;
+extern uint32_t g_gnss_polls;
+extern uint32_t g_gnss_poll_timeouts;
+extern uint32_t g_gnss_decision_ms;
+extern uint32_t g_gnss_decision_ms_max;
+extern uint32_t g_gnss_decision_ms_total;
+extern uint32_t g_gnss_first_fix_ms;
+extern uint32_t g_zero_packets;
+
+// GNSS sleep between beacons
+#ifndef GNSS_POWER_SAVE
+#define GNSS_POWER_SAVE 1
+#endif
+#define GNSS_PWR_ACQUIRE 0
+#define GNSS_PWR_TRACK 1
+#define GNSS_PWR_SLEEP 2
+#define GNSS_PWR_STATES 3
+void gnss_power_init(uint8_t gnss_option);
+void gnss_power_wake(void);
+void gnss_power_fix(bool fix);
+void gnss_power_sleep(uint32_t next_poll_ms);
+void gnss_power_report(void);
+void gnss_module_sleep(uint8_t gnss_option, uint32_t duration_ms);
+void gnss_module_wake(uint8_t gnss_option);
+uint32_t gnss_module_ttff(uint8_t gnss_option, uint32_t woke_at);
+extern uint32_t g_gnss_power_ms[GNSS_PWR_STATES];
+extern uint32_t g_gnss_sleeps;
+extern uint32_t g_gnss_early_wakes;
+extern uint32_t g_gnss_ttff_last;
+
+// RAK1910 NMEA record/replay
+#ifndef GNSS_RECORD
+#define GNSS_RECORD 0
+#endif
+#ifndef GNSS_REPLAY
+#define GNSS_REPLAY 0
+#endif
+/** Most bytes gnss_rx_task() handles per read */
+#define GNSS_TRACE_CHUNK 64
+
+// InternalFS budget, 28 KB are 7 blocks of 4 KB, LittleFS keeps 2 for the
+// superblock and root directory and every file takes whole blocks
+#define FS_BLOCK_SIZE 4096
+#define FS_BLOCKS(size) (((size) + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE)
+#define FS_FREE_BLOCKS 5
+/** WisBlock-API LoRaWAN settings, and one free block for copy-on-write appends */
+#define FS_RESERVED_BLOCKS 2
+/** Counter log in use, the switch to the other one borrows the free block */
+#define COUNTER_LOG_SIZE 4096
+/** Session log file before it is rotated */
+#define SESSION_LOG_FILE_MAX 4096
+/** Positions that don't fit the uplink queue go to /uplink.q */
+#ifndef UPLINK_QUEUE_SPILL
+#define UPLINK_QUEUE_SPILL 0
+#endif
+#define UPLINK_SPILL_FILE_MAX 4096
+/** Session log files, spill builds keep no old one, /uplink.q takes its block */
+#define SESSION_LOG_FILES (UPLINK_QUEUE_SPILL > 0 ? 1 : 2)
+/** Record/replay builds have no session log, the trace gets its blocks.
+ *  LittleFS keeps a block pointer in the second block of a file */
+#ifndef GNSS_TRACE_MAX
+#define GNSS_TRACE_MAX (SESSION_LOG_FILES * SESSION_LOG_FILE_MAX - 8)
+#endif
+static_assert(FS_RESERVED_BLOCKS + FS_BLOCKS(COUNTER_LOG_SIZE) + SESSION_LOG_FILES * FS_BLOCKS(SESSION_LOG_FILE_MAX)
+	+ (UPLINK_QUEUE_SPILL > 0 ? FS_BLOCKS(UPLINK_SPILL_FILE_MAX) : 0) <= FS_FREE_BLOCKS, "InternalFS over budget");
+static_assert(GNSS_TRACE_MAX <= SESSION_LOG_FILES * SESSION_LOG_FILE_MAX - 8, "GNSS trace over the session log budget");
+bool gnss_trace_init(void);
+void gnss_trace_record(const uint8_t *data, uint8_t len);
+uint8_t gnss_trace_read(uint8_t *buf, uint8_t size);
+bool gnss_trace_replaying(void);
+extern uint32_t g_gnss_trace_bytes;
+extern uint32_t g_gnss_replay_loops;
+
+// RAK12500 auto NAV-PVT snapshot
+void gnss_pvt_callback(UBX_NAV_PVT_data_t *pvt);
+void gnss_dop_callback(UBX_NAV_DOP_data_t *dop);
+bool gnss_pvt_update(void);
+uint8_t gnss_pvt_satellites(void);
+extern uint32_t g_gnss_i2c_polls;
+extern uint32_t g_gnss_i2c_polls_beacon;
+
+// Movement driven beacon scheduling
+bool beacon_wake_needed(void);
+bool beacon_should_send(const gnss_fix_s &fix);
+void beacon_sent(const gnss_fix_s &fix);
+extern uint32_t g_beacons_sent;
+extern uint32_t g_beacons_suppressed;
+extern uint32_t g_wakes_suppressed;
+
+// Dead reckoning between fixes
+void motion_fix(const gnss_fix_s &fix);
+void motion_wake(uint8_t activity);
+uint32_t motion_predict(int32_t &lat, int32_t &lon);
+bool motion_poll_needed(const gnss_fix_s &beacon, uint32_t min_distance_m);
+extern uint32_t g_motion_wakes;
+extern uint32_t g_motion_still;
+extern uint32_t g_gnss_polls_avoided;
+
+// Binary session log in flash
+void session_log_beacon(const gnss_fix_s &fix);
+void session_log_hotspot(const downlink_hotspot_s &hs);
+void session_log_flush(void);
+void session_log_clear(void);
+extern uint32_t g_session_log_records;
+extern uint32_t g_session_log_flash_bytes;
+uint32_t session_log_size(void);
+uint32_t session_log_id(void);
+uint32_t session_log_read_start(void);
+bool session_log_reading(void);
+uint16_t session_log_read(uint32_t offset, uint8_t *buf, uint16_t len);
+void session_log_read_done(void);
+
+// Session log export over BLE (AT+EXPORT)
+void ble_export_run(void);
+bool ble_export_active(void);
+extern uint32_t g_export_bytes;
+extern uint32_t g_export_ms;
+
+// AT command handling stats
+extern uint32_t g_at_cmd_count;
+extern uint32_t g_at_cmd_us_last;
+extern uint32_t g_at_cmd_us_max;
+
+// Deferred log task
+void log_init(void);
+extern uint32_t g_log_records;
+extern uint32_t g_log_dropped;
 // Field Mapper
-extern TinyGPSPlus my_rak1910_gnss;
 extern SFE_UBLOX_GNSS my_rak12500_gnss;
 
 /** Accelerometer stuff */
 #include <SparkFunLIS3DH.h>
 #define INT1_PIN WB_IO5
+/** Output data rate and FIFO depth */
+#define ACC_ODR_HZ 10
+#define ACC_FIFO_SIZE 32
 bool init_acc(void);
 void clear_acc_int(void);
-void read_acc(void);
+bool read_acc(int16_t &acc_x, int16_t &acc_y, int16_t &acc_z);
+uint8_t read_acc_block(int16_t *acc_x, int16_t *acc_y, int16_t *acc_z, uint8_t count);
+uint8_t acc_batch(void);
+extern uint32_t g_acc_wakes;
+extern uint32_t g_acc_samples;
+extern uint32_t g_acc_overruns;
+extern uint32_t g_acc_i2c_transactions;
+
+// Activity from one accelerometer batch
+#define ACTIVITY_STILL 0
+#define ACTIVITY_WALKING 1
+#define ACTIVITY_DRIVING 2
+#define ACTIVITY_CLASSES 3
+uint8_t activity_classify(const int16_t *x, const int16_t *y, const int16_t *z, uint8_t count);
+const char *activity_name(uint8_t activity);
+extern uint16_t g_activity_mg;
+extern uint16_t g_activity_hz_x10;
+extern uint32_t g_activity_batches[ACTIVITY_CLASSES];
 
 // LoRaWan functions
 struct mapper_data_s
@@ -119,6 +391,59 @@ struct mapper_data_s
 extern mapper_data_s g_mapper_data;
 #define MAPPER_DATA_LEN 14 // sizeof(g_mapper_data)
 
+// Uplink payload layout, see payload.cpp
+#define PAYLOAD_LEGACY 0
+#define PAYLOAD_COMPACT 1
+#ifndef PAYLOAD_PROFILE
+#define PAYLOAD_PROFILE PAYLOAD_LEGACY
+#endif
+/** Longest payload of either layout */
+#define PAYLOAD_MAX_LEN 14
+uint8_t payload_build(const gnss_fix_s *fix, uint16_t batt_mv, uint8_t *out);
+uint8_t payload_append(const gnss_fix_s *fix, uint16_t batt_mv, uint8_t *out, uint8_t space);
+void payload_queued(uint8_t len);
+void payload_tx_done(bool success);
+extern uint32_t g_payload_frames;
+extern uint32_t g_payload_bytes;
+extern uint32_t g_payload_absolute;
+
+// Store and forward uplink queue, see uplink_queue.cpp
+#define UPLINK_PRIO_NOGPS 0
+#define UPLINK_PRIO_FIX 1
+void uplink_queue_init(void);
+void uplink_queue_add(const gnss_fix_s *fix, uint16_t batt_mv, uint8_t prio);
+void uplink_queue_drain(void);
+uint16_t uplink_queue_depth(void);
+void uplink_queue_report(void);
+extern uint32_t g_uplink_queued;
+extern uint32_t g_uplink_dropped;
+extern uint32_t g_uplink_spilled;
+extern uint32_t g_uplink_packed;
+extern uint8_t g_uplink_depth_max;
+extern uint32_t g_uplink_age_last_ms;
+extern uint32_t g_uplink_age_max_ms;
+
+// Shared I2C bus, see i2c_bus.cpp
+#define I2C_DEV_ACC 0
+#define I2C_DEV_GNSS 1
+#define I2C_DEV_OLED 2
+#define I2C_DEV_COUNT 3
+struct i2c_bus_stats_s
+{
+	uint32_t transactions = 0;
+	uint32_t busy_ms = 0;
+	uint32_t wait_us_total = 0;
+	uint32_t wait_us_max = 0;
+	uint32_t preempted = 0;
+	uint32_t timeouts = 0;
+};
+void i2c_bus_init(void);
+bool i2c_acquire(uint8_t dev);
+void i2c_release(uint8_t dev);
+bool i2c_yield(uint8_t dev);
+void i2c_bus_report(void);
+extern i2c_bus_stats_s g_i2c_stats[I2C_DEV_COUNT];
+
 /** Battery level uinion */
 union batt_s
 {
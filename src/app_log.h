@@ -0,0 +1,61 @@
+/**
+ * @file app_log.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Deferred log, callers only queue a record, a low priority task formats it
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef APP_LOG_H
+#define APP_LOG_H
+
+#include <stdint.h>
+
+/** Most arguments one log line can have */
+#define LOG_MAX_ARGS 4
+
+/** Where a record goes */
+#define LOG_SERIAL 0x01
+#define LOG_BLE 0x02
+
+/** One raw argument, the format string tells the log task which one it is */
+union log_arg_u
+{
+    int32_t i;
+    float f;
+    const char *s;
+};
+
+inline log_arg_u log_arg(int v) { log_arg_u a; a.i = v; return a; }
+inline log_arg_u log_arg(unsigned int v) { log_arg_u a; a.i = v; return a; }
+inline log_arg_u log_arg(long v) { log_arg_u a; a.i = v; return a; }
+inline log_arg_u log_arg(unsigned long v) { log_arg_u a; a.i = v; return a; }
+inline log_arg_u log_arg(long long v) { log_arg_u a; a.i = v; return a; }
+inline log_arg_u log_arg(unsigned long long v) { log_arg_u a; a.i = v; return a; }
+inline log_arg_u log_arg(double v) { log_arg_u a; a.f = v; return a; }
+/** Strings are not copied, only pass static text */
+inline log_arg_u log_arg(const char *v) { log_arg_u a; a.s = v; return a; }
+
+void log_push(uint8_t sinks, const char *tag, const char *fmt, const log_arg_u *args, uint8_t count);
+
+/**
+ * @brief Queue a log record, never blocks, safe in interrupts
+ * Integers are kept as 32 bit, floats as float
+ *
+ * @param sinks LOG_SERIAL and/or LOG_BLE
+ * @param tag Tag, static text
+ * @param fmt printf format, static text
+ * @param args Up to LOG_MAX_ARGS arguments
+ */
+template <typename... Args>
+inline void app_log(uint8_t sinks, const char *tag, const char *fmt, Args... args)
+{
+    static_assert(sizeof...(args) <= LOG_MAX_ARGS, "Too many log arguments");
+    const log_arg_u list[sizeof...(args) + 1] = {log_arg(args)...};
+    log_push(sinks, tag, fmt, list, sizeof...(args));
+}
+
+#endif
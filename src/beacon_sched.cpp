@@ -0,0 +1,148 @@
+/**
+ * @file beacon_sched.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Decide when a movement wakeup is worth a GNSS poll and a beacon
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * A beacon is sent when one of these is crossed since the last beacon:
+ *   Distance travelled      BEACON_MIN_DISTANCE_M
+ *   Heading change          BEACON_MIN_HEADING_CDEG (only while moving)
+ *   Elapsed time            send_repeat_time (or BEACON_MAX_INTERVAL_MS)
+ * Accelerometer wakeups only poll the GNSS when the dead reckoned position
+ * (motion.cpp) may be the minimum distance away by now.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Distance from last beacon that triggers a new one */
+#ifndef BEACON_MIN_DISTANCE_M
+#define BEACON_MIN_DISTANCE_M 150
+#endif
+/** Heading change from last beacon that triggers a new one, 0.01 deg */
+#ifndef BEACON_MIN_HEADING_CDEG
+#define BEACON_MIN_HEADING_CDEG 3000
+#endif
+/** Max time between beacons if send_repeat_time is 0 */
+#ifndef BEACON_MAX_INTERVAL_MS
+#define BEACON_MAX_INTERVAL_MS 300000UL
+#endif
+/** Slack for the send_repeat_time timer firing a bit early */
+#define BEACON_INTERVAL_SLACK_MS 1000UL
+/** Below this distance GNSS heading is mostly noise */
+#define BEACON_HEADING_MIN_MOVE_M 30
+
+/** Last beacon sent */
+static gnss_fix_s lastBeacon;
+static uint32_t lastBeaconTime = 0;
+
+/** Counters */
+uint32_t g_beacons_sent = 0;
+uint32_t g_beacons_suppressed = 0;
+uint32_t g_wakes_suppressed = 0;
+
+/**
+ * @brief Max time between two beacons
+ *
+ * @return uint32_t ms
+ */
+static uint32_t maxInterval(void)
+{
+    uint32_t interval = g_lorawan_settings.send_repeat_time != 0 ? g_lorawan_settings.send_repeat_time : BEACON_MAX_INTERVAL_MS;
+    return interval > BEACON_INTERVAL_SLACK_MS ? interval - BEACON_INTERVAL_SLACK_MS : interval;
+}
+
+/**
+ * @brief Smallest difference between two headings
+ *
+ * @param a Heading 0.01 deg
+ * @param b Heading 0.01 deg
+ * @return uint16_t 0..18000
+ */
+static uint16_t headingDiff(uint16_t a, uint16_t b)
+{
+    uint16_t diff = a > b ? a - b : b - a;
+    return diff > 18000 ? 36000 - diff : diff;
+}
+
+/**
+ * @brief Should a movement wakeup poll the GNSS
+ * Uses the dead reckoned position to guess if we moved enough
+ *
+ * @return true Poll GNSS and maybe send
+ */
+bool beacon_wake_needed(void)
+{
+    if(!lastBeacon.valid)
+    {
+        return true;
+    }
+
+    uint32_t elapsed = millis() - lastBeaconTime;
+    if(elapsed >= maxInterval())
+    {
+        return true;
+    }
+
+    if(motion_poll_needed(lastBeacon, BEACON_MIN_DISTANCE_M))
+    {
+        return true;
+    }
+
+    g_wakes_suppressed++;
+    MYLOG("BCN", "Wakeup skipped after %lds, %ld polls avoided", (long)(elapsed / 1000), (long)g_gnss_polls_avoided);
+    return false;
+}
+
+/**
+ * @brief Should a beacon be sent for this fix
+ *
+ * @param fix Current position
+ * @return true Send beacon
+ */
+bool beacon_should_send(const gnss_fix_s &fix)
+{
+    if(!lastBeacon.valid || !fix.valid)
+    {
+        return true;
+    }
+
+    uint32_t elapsed = millis() - lastBeaconTime;
+    if(elapsed >= maxInterval())
+    {
+        MYLOG("BCN", "Send, %lds since last beacon", (long)(elapsed / 1000));
+        return true;
+    }
+
+    uint32_t dist = geo_distance_m(lastBeacon.lat, lastBeacon.lon, fix.lat, fix.lon);
+    if(dist >= BEACON_MIN_DISTANCE_M)
+    {
+        MYLOG("BCN", "Send, moved %ldm", (long)dist);
+        return true;
+    }
+
+    if(dist >= BEACON_HEADING_MIN_MOVE_M && headingDiff(lastBeacon.heading, fix.heading) >= BEACON_MIN_HEADING_CDEG)
+    {
+        MYLOG("BCN", "Send, heading %d -> %d", lastBeacon.heading / 100, fix.heading / 100);
+        return true;
+    }
+
+    g_beacons_suppressed++;
+    MYLOG("BCN", "Suppressed, moved %ldm, sent %ld suppressed %ld", (long)dist, (long)g_beacons_sent, (long)g_beacons_suppressed);
+    return false;
+}
+
+/**
+ * @brief A beacon with this fix was sent
+ *
+ * @param fix Position sent
+ */
+void beacon_sent(const gnss_fix_s &fix)
+{
+    lastBeacon = fix;
+    lastBeaconTime = millis();
+    g_beacons_sent++;
+}
@@ -0,0 +1,294 @@
+/**
+ * @file ble_export.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Bulk export of the session log over BLE UART
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * AT+EXPORT=?             Log size in bytes and log id
+ * AT+EXPORT               Export from the start
+ * AT+EXPORT=<offset>,<id> Resume from offset (last good offset + length)
+ *                         of the log with that id, "+EXPORT:log changed"
+ *                         if its start was dropped since
+ * AT+EXPORT=STOP          Stop a running export
+ *
+ * The log id is the length and CRC of the first batch of the log, the 4
+ * bytes after its first byte with bit 31 cleared, so a receiver can work
+ * it out from the data it already has.
+ * The session log holds its writes while an export runs. If it can't hold
+ * them any longer the export stops without an end frame, a resume then
+ * finds out whether the offset is still good.
+ *
+ * Frame, one per notification, sized to the negotiated MTU:
+ *   [0xA5][seq u16][offset u32][len u8][len bytes of data][crc16 u16]
+ * The CRC (CRC-16/CCITT-FALSE) covers everything before it. A frame with
+ * len 0 ends the export, its offset is the log size.
+ * Frames are sent from the app task, BLE_EXPORT is raised again after every
+ * burst so other events still run. Notifications block while the SoftDevice
+ * queue is full, that is the flow control.
+ * tools/ble_export_receive.py receives and checks the frames.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Frame layout */
+#define EXPORT_SYNC 0xA5
+#define EXPORT_HEADER 8
+#define EXPORT_OVERHEAD (EXPORT_HEADER + 2)
+/** Largest frame, ATT MTU 247 less 3 bytes of ATT header */
+#define EXPORT_FRAME_MAX 244
+/** Frames per BLE_EXPORT event */
+#define EXPORT_BURST 8
+/** Connection interval while exporting, 1.25ms units (7.5ms) */
+#define EXPORT_CONN_INTERVAL 6
+
+/** Export state */
+static bool exportActive = false;
+static uint32_t exportOffset = 0;
+static uint32_t exportSize = 0;
+static uint16_t exportSeq = 0;
+static uint8_t exportData = 0;
+static uint16_t oldConnInterval = 0;
+static uint32_t exportStart = 0;
+
+/** Stats of the last export */
+uint32_t g_export_bytes = 0;
+uint32_t g_export_ms = 0;
+
+/**
+ * @brief Print an AT answer to USB and BLE
+ *
+ * @param text Answer
+ */
+static void atAnswer(const char *text)
+{
+    Serial.print(text);
+    if(g_ble_uart_is_connected)
+    {
+        g_ble_uart.print(text);
+    }
+}
+
+/**
+ * @brief Ask the central for a fast connection and a big MTU
+ *
+ */
+static void tuneConnection(void)
+{
+    BLEConnection *conn = Bluefruit.Connection(Bluefruit.connHandle());
+    if(conn == nullptr)
+    {
+        return;
+    }
+    oldConnInterval = conn->getConnectionInterval();
+    conn->requestMtuExchange(EXPORT_FRAME_MAX + 3);
+    conn->requestDataLengthUpdate();
+    conn->requestConnectionParameter(EXPORT_CONN_INTERVAL);
+    /** MTU exchange is answered later, start small and grow in sendFrame() */
+    exportData = min(conn->getMtu() - 3, EXPORT_FRAME_MAX) - EXPORT_OVERHEAD;
+}
+
+/**
+ * @brief Give the connection its old interval back
+ *
+ */
+static void restoreConnection(void)
+{
+    BLEConnection *conn = Bluefruit.Connection(Bluefruit.connHandle());
+    if(conn != nullptr && oldConnInterval != 0)
+    {
+        conn->requestConnectionParameter(oldConnInterval);
+    }
+    oldConnInterval = 0;
+}
+
+/**
+ * @brief Stop the export
+ *
+ * @param done True if the whole log was sent
+ */
+static void stopExport(bool done)
+{
+    exportActive = false;
+    session_log_read_done();
+    restoreConnection();
+    g_export_ms = millis() - exportStart;
+    MYLOG("EXP", "Export %s at %ld of %ld", done ? "done" : "stopped", (long)exportOffset, (long)exportSize);
+    MYLOG("EXP", "%ld bytes in %ldms", (long)g_export_bytes, (long)g_export_ms);
+}
+
+/**
+ * @brief Send one frame from the current offset
+ *
+ * @return true More to send
+ */
+static bool sendFrame(void)
+{
+    BLEConnection *conn = Bluefruit.Connection(Bluefruit.connHandle());
+    if(conn != nullptr)
+    {
+        exportData = min(conn->getMtu() - 3, EXPORT_FRAME_MAX) - EXPORT_OVERHEAD;
+    }
+
+    uint8_t frame[EXPORT_FRAME_MAX];
+    uint8_t len = session_log_read(exportOffset, &frame[EXPORT_HEADER], exportData);
+
+    frame[0] = EXPORT_SYNC;
+    frame[1] = exportSeq & 0xFF;
+    frame[2] = exportSeq >> 8;
+    frame[3] = exportOffset & 0xFF;
+    frame[4] = (exportOffset >> 8) & 0xFF;
+    frame[5] = (exportOffset >> 16) & 0xFF;
+    frame[6] = exportOffset >> 24;
+    frame[7] = len;
+    uint16_t crc = crc16_ccitt(frame, EXPORT_HEADER + len);
+    frame[EXPORT_HEADER + len] = crc & 0xFF;
+    frame[EXPORT_HEADER + len + 1] = crc >> 8;
+
+    if(g_ble_uart.write(frame, EXPORT_OVERHEAD + len) != EXPORT_OVERHEAD + len)
+    {
+        /** Not queued, retry the same frame on the next burst */
+        return true;
+    }
+    exportSeq++;
+    exportOffset += len;
+    g_export_bytes += len;
+    return len != 0;
+}
+
+/**
+ * @brief Is an export running, the log keeps off BLE meanwhile
+ *
+ */
+bool ble_export_active(void)
+{
+    return exportActive;
+}
+
+/**
+ * @brief Send a burst of frames, called on BLE_EXPORT
+ *
+ */
+void ble_export_run(void)
+{
+    if(!exportActive)
+    {
+        return;
+    }
+    if(!g_ble_uart_is_connected)
+    {
+        /** Central is gone, it can resume with AT+EXPORT=<offset> */
+        stopExport(false);
+        return;
+    }
+
+    for(uint8_t i = 0; i < EXPORT_BURST; i++)
+    {
+        if(!session_log_reading())
+        {
+            /** The log had to move on */
+            stopExport(false);
+            return;
+        }
+        if(!sendFrame())
+        {
+            stopExport(true);
+            return;
+        }
+    }
+    /** Come back after the other events had their turn */
+    g_task_event_type |= BLE_EXPORT;
+}
+
+/**
+ * @brief Start an export
+ *
+ * @param offset Offset to start from
+ * @param id Log id the offset belongs to, not checked for offset 0
+ */
+static void startExport(uint32_t offset, uint32_t id)
+{
+    /** Pending batch goes to flash first so it is part of the export, it can rotate the log */
+    session_log_flush();
+    if(offset != 0 && id != session_log_id())
+    {
+        atAnswer("+EXPORT:log changed\r\n");
+        return;
+    }
+    exportSize = session_log_read_start();
+    exportOffset = min(offset, exportSize);
+    exportSeq = 0;
+    g_export_bytes = 0;
+    exportStart = millis();
+    tuneConnection();
+    exportActive = true;
+    MYLOG("EXP", "Export from %ld of %ld", (long)exportOffset, (long)exportSize);
+    g_task_event_type |= BLE_EXPORT;
+}
+
+/**
+ * @brief Custom AT commands, called by WisBlock-API
+ *
+ * @param user_cmd Command
+ * @param cmd_size Command length
+ * @return true Command was handled
+ */
+bool user_at_handler(char *user_cmd, uint8_t cmd_size)
+{
+    /** "AT" may or may not be there */
+    if(strncasecmp(user_cmd, "AT", 2) == 0)
+    {
+        user_cmd += 2;
+    }
+    if(strncasecmp(user_cmd, "+EXPORT", 7) != 0)
+    {
+        return false;
+    }
+    const char *param = user_cmd + 7;
+
+    TextBuf<32> answer;
+    if(strcasecmp(param, "=?") == 0 || strcmp(param, "?") == 0)
+    {
+        answer.add("+EXPORT:").addInt(session_log_size()).add(',').addInt(session_log_id()).add("\r\n");
+        atAnswer(answer.c_str());
+        return true;
+    }
+    if(strcasecmp(param, "=STOP") == 0)
+    {
+        if(exportActive)
+        {
+            stopExport(false);
+        }
+        answer.add("+EXPORT:").addInt(exportOffset).add("\r\n");
+        atAnswer(answer.c_str());
+        return true;
+    }
+    if(!g_ble_uart_is_connected)
+    {
+        atAnswer("+EXPORT:needs BLE\r\n");
+        return true;
+    }
+
+    uint32_t offset = 0;
+    uint32_t id = 0;
+    if(param[0] == '=')
+    {
+        char *end;
+        offset = strtoul(param + 1, &end, 10);
+        /** An offset is only good in the log it was taken from */
+        if(offset != 0 && *end != ',')
+        {
+            atAnswer("+EXPORT:needs id\r\n");
+            return true;
+        }
+        if(*end == ',')
+        {
+            id = strtoul(end + 1, nullptr, 10);
+        }
+    }
+    startExport(offset, id);
+    return true;
+}
@@ -0,0 +1,296 @@
+/**
+ * @file counters.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Lifetime beacon counters kept in internal flash
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Every update appends one 16 byte record to a log file. LittleFS is
+ * copy-on-write, so the append still programs the tail block of the file
+ * again plus a metadata commit, and now and then erases a block. That
+ * cost is bounded by the log size (4 KB), not by how many records were
+ * ever written, and LittleFS spreads it over the free blocks. The real
+ * program and erase operations are counted from the flash driver and
+ * logged per record, see g_counter_flash_prog_bytes.
+ * One record per beacon: a reply only bumps the RX count in RAM, it is
+ * written with the next beacon, so a power loss can lose the last reply.
+ * The record with the highest sequence number and a valid CRC wins on
+ * boot, a record cut by a power loss fails its CRC and is skipped.
+ * When the log is full the newest record is written to the other log
+ * file first. The full one is only removed once that record reads back
+ * with a valid CRC, if it doesn't the switch is tried with the next one.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Records per log file before switching to the other one */
+#define COUNTER_LOG_MAX_RECORDS (COUNTER_LOG_SIZE / sizeof(counter_record_s))
+/** Record marker */
+#define COUNTER_MAGIC 0xC0A7
+
+/** The two log files, only one is in use at a time */
+static const char *logFiles[2] = {"/ftcnt0", "/ftcnt1"};
+
+/** One counter record */
+struct __attribute__((packed)) counter_record_s
+{
+    uint16_t magic;
+    uint16_t crc;
+    uint32_t seq;
+    uint32_t tx;
+    uint32_t rx;
+};
+
+/** Lifetime counters */
+uint32_t g_lifetime_tx = 0;
+uint32_t g_lifetime_rx = 0;
+/** Records written since boot */
+uint32_t g_counter_flash_writes = 0;
+/** Bytes programmed and blocks erased by the flash driver for those records */
+uint32_t g_counter_flash_prog_bytes = 0;
+uint32_t g_counter_flash_erases = 0;
+
+/** Sequence of the last record written */
+static uint32_t seq = 0;
+/** Log file in use and records in it */
+static uint8_t activeLog = 0;
+static uint16_t activeRecords = 0;
+static bool countersReady = false;
+
+/** Flash driver callbacks of InternalFS, wrapped to count what a record costs */
+static int (*flashProg)(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size) = NULL;
+static int (*flashErase)(const struct lfs_config *c, lfs_block_t block) = NULL;
+/** Set while a record is written */
+static bool countFlash = false;
+
+/**
+ * @brief Program callback of InternalFS, counts bytes while a record is written
+ *
+ */
+static int countingProg(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size)
+{
+    if(countFlash)
+    {
+        g_counter_flash_prog_bytes += size;
+    }
+    return flashProg(c, block, off, buffer, size);
+}
+
+/**
+ * @brief Erase callback of InternalFS, counts blocks while a record is written
+ *
+ */
+static int countingErase(const struct lfs_config *c, lfs_block_t block)
+{
+    if(countFlash)
+    {
+        g_counter_flash_erases++;
+    }
+    return flashErase(c, block);
+}
+
+/**
+ * @brief Put the counting callbacks between LittleFS and the flash driver
+ * The InternalFS config is a static in the core, not in flash, so it can
+ * be patched once after mounting
+ *
+ */
+static void hookFlash(void)
+{
+    struct lfs_config *cfg = const_cast<struct lfs_config *>(InternalFS._getFS()->cfg);
+    if(cfg == NULL || flashProg != NULL)
+    {
+        return;
+    }
+    flashProg = cfg->prog;
+    flashErase = cfg->erase;
+    cfg->prog = countingProg;
+    cfg->erase = countingErase;
+}
+
+/**
+ * @brief CRC of a record, without magic and crc fields
+ *
+ * @param rec Record
+ * @return uint16_t CRC
+ */
+static uint16_t recordCrc(const counter_record_s &rec)
+{
+    return crc16_ccitt((const uint8_t *)&rec.seq, sizeof(rec) - 4);
+}
+
+/**
+ * @brief Find the newest valid record in a log file
+ *
+ * @param name File name
+ * @param newest Updated if a newer record is found
+ * @param found Set if a valid record was found
+ * @return uint16_t Number of records in the file
+ */
+static uint16_t scanLog(const char *name, counter_record_s &newest, bool &found)
+{
+    File file(InternalFS);
+    if(!file.open(name, FILE_O_READ))
+    {
+        return 0;
+    }
+
+    counter_record_s rec;
+    uint16_t count = 0;
+    while(file.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec))
+    {
+        count++;
+        if(rec.magic != COUNTER_MAGIC || rec.crc != recordCrc(rec))
+        {
+            continue;
+        }
+        if(!found || rec.seq > newest.seq)
+        {
+            newest = rec;
+            found = true;
+        }
+    }
+    file.close();
+    return count;
+}
+
+/**
+ * @brief Read back the last record of a log file
+ *
+ * @param name File name
+ * @param rec Record just written
+ * @return true The file ends with rec and its CRC is valid
+ */
+static bool verifyRecord(const char *name, const counter_record_s &rec)
+{
+    File file(InternalFS);
+    if(!file.open(name, FILE_O_READ))
+    {
+        return false;
+    }
+
+    counter_record_s back;
+    bool ok = file.size() >= sizeof(back) && file.seek(file.size() - sizeof(back)) && file.read((uint8_t *)&back, sizeof(back)) == sizeof(back);
+    file.close();
+    return ok && back.magic == COUNTER_MAGIC && back.crc == recordCrc(back) && back.seq == rec.seq;
+}
+
+/**
+ * @brief Append a record with the current counters
+ *
+ * @return true The record is in flash and reads back
+ */
+static bool writeRecord(void)
+{
+    if(activeRecords >= COUNTER_LOG_MAX_RECORDS)
+    {
+        /** Newest record goes to the other log first, the full one is dropped once it reads back */
+        uint8_t full = activeLog;
+        activeLog ^= 1;
+        activeRecords = 0;
+        countFlash = true;
+        InternalFS.remove(logFiles[activeLog]);
+        countFlash = false;
+        if(!writeRecord())
+        {
+            /** The full log still has the newest good record, switch again next time */
+            activeLog = full;
+            activeRecords = COUNTER_LOG_MAX_RECORDS;
+            return false;
+        }
+        countFlash = true;
+        InternalFS.remove(logFiles[full]);
+        countFlash = false;
+        return true;
+    }
+
+    counter_record_s rec;
+    rec.magic = COUNTER_MAGIC;
+    rec.seq = ++seq;
+    rec.tx = g_lifetime_tx;
+    rec.rx = g_lifetime_rx;
+    rec.crc = recordCrc(rec);
+
+    uint32_t progBefore = g_counter_flash_prog_bytes;
+    uint32_t erasesBefore = g_counter_flash_erases;
+    countFlash = true;
+    File file(InternalFS);
+    bool ok = file.open(logFiles[activeLog], FILE_O_WRITE);
+    if(ok)
+    {
+        /** FILE_O_WRITE opens at the end of the file */
+        ok = file.write((const uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+        /** The data is committed on close */
+        file.close();
+    }
+    countFlash = false;
+    ok = ok && verifyRecord(logFiles[activeLog], rec);
+    if(!ok)
+    {
+        MYLOG("CNT", "Can't write %s", logFiles[activeLog]);
+        return false;
+    }
+    activeRecords++;
+    g_counter_flash_writes++;
+    MYLOG("CNT", "Record %ld: %ld bytes programmed, %ld erases", (long)rec.seq, (long)(g_counter_flash_prog_bytes - progBefore), (long)(g_counter_flash_erases - erasesBefore));
+    return true;
+}
+
+/**
+ * @brief Load the lifetime counters from flash
+ *
+ */
+void counters_init(void)
+{
+    InternalFS.begin();
+    hookFlash();
+
+    counter_record_s newest;
+    bool found = false;
+    uint16_t records[2];
+    records[0] = scanLog(logFiles[0], newest, found);
+    bool newestIn0 = found;
+    uint32_t seq0 = found ? newest.seq : 0;
+    records[1] = scanLog(logFiles[1], newest, found);
+
+    if(found)
+    {
+        g_lifetime_tx = newest.tx;
+        g_lifetime_rx = newest.rx;
+        seq = newest.seq;
+        /** Keep appending to the log that holds the newest record */
+        activeLog = (newestIn0 && newest.seq == seq0) ? 0 : 1;
+        activeRecords = records[activeLog];
+    }
+    countersReady = true;
+    MYLOG("CNT", "Lifetime TX %ld RX %ld (seq %ld)", (long)g_lifetime_tx, (long)g_lifetime_rx, (long)seq);
+}
+
+/**
+ * @brief Count a sent beacon
+ *
+ */
+void counters_tx(void)
+{
+    g_lifetime_tx++;
+    if(countersReady)
+    {
+        writeRecord();
+    }
+}
+
+/**
+ * @brief Count a received beacon reply, written with the next beacon
+ *
+ */
+void counters_rx(void)
+{
+    g_lifetime_rx++;
+}
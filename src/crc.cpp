@@ -0,0 +1,33 @@
+/**
+ * @file crc.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief CRC used by the flash records and the BLE export frames
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021)
+ *
+ * @param data Data
+ * @param len Length of data
+ * @param crc Start value, pass the last result to continue a CRC
+ * @return uint16_t CRC
+ */
+uint16_t crc16_ccitt(const uint8_t *data, size_t len, uint16_t crc)
+{
+    while(len--)
+    {
+        crc ^= (uint16_t)(*data++) << 8;
+        for(uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
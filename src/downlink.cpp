@@ -0,0 +1,220 @@
+/**
+ * @file downlink.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Decode hot spot info downlinks from the mapper integration
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Two formats are accepted, detected from the first byte:
+ *
+ * Binary TLV (first byte DOWNLINK_BIN_MAGIC | version)
+ *   [0xA1] then any number of [type][len][value...]
+ *   DL_TLV_NAME     len bytes, hot spot name (not NULL terminated)
+ *   DL_TLV_SIGNAL   2 bytes, int8 RSSI (dBm), int8 SNR (0.25 dB)
+ *   DL_TLV_POSITION 8 bytes, int32 lat, int32 long (1e-5 deg, little endian)
+ *   DL_TLV_HOTSPOTS 1 byte, number of hot spots that heard the beacon
+ *   Unknown types are skipped so newer integrations can add fields.
+ *
+ * JSON (legacy)
+ *   {"name":"...","rssi":-100,"snr":5.5,"lat":45.1,"long":-75.2}
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Binary format marker, low nibble is the version */
+#define DOWNLINK_BIN_MAGIC 0xA0
+#define DOWNLINK_BIN_VERSION 1
+
+/** Binary TLV types */
+#define DL_TLV_NAME 0x01
+#define DL_TLV_SIGNAL 0x02
+#define DL_TLV_POSITION 0x03
+#define DL_TLV_HOTSPOTS 0x04
+
+/** Longest hot spot name a JSON downlink may carry, longer ones are NoMemory */
+#define DL_JSON_NAME_MAX 80
+/** The filter keys, copied from the input with their terminators */
+#define DL_JSON_KEYS_SIZE (sizeof("name") + sizeof("rssi") + sizeof("snr") + sizeof("lat") + sizeof("long"))
+/** Filtered object with 5 members, the copied keys and the name
+*   Slots are 16 bytes on the nRF52: 80 + 23 + 81 = 184
+*   and 32 bytes on a 64 bit host: 160 + 23 + 81 = 264 */
+#define DL_JSON_CAPACITY (JSON_OBJECT_SIZE(5) + DL_JSON_KEYS_SIZE + DL_JSON_NAME_MAX + 1)
+
+/**
+ * @brief Read little endian int32 from buffer
+ *
+ * @param p Buffer
+ * @return int32_t
+ */
+static int32_t readInt32(const uint8_t *p)
+{
+    return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+/**
+ * @brief Decode binary TLV downlink
+ *
+ * @param data Payload, starting at the version byte
+ * @param len Length of payload
+ * @param hs Decoded hot spot info
+ * @return true Valid payload with a hot spot name
+ */
+static bool decodeBinary(const uint8_t *data, uint16_t len, downlink_hotspot_s &hs)
+{
+    if((data[0] & 0x0F) != DOWNLINK_BIN_VERSION)
+    {
+        MYLOG("DL", "Unknown binary downlink version %d", data[0] & 0x0F);
+        return false;
+    }
+
+    uint16_t idx = 1;
+    while(idx + 2 <= len)
+    {
+        uint8_t type = data[idx];
+        uint8_t tlvLen = data[idx + 1];
+        const uint8_t *value = &data[idx + 2];
+        idx += 2;
+        if(idx + tlvLen > len)
+        {
+            /** Truncated TLV */
+            return false;
+        }
+
+        switch(type)
+        {
+            case DL_TLV_NAME:
+            {
+                uint8_t nameLen = min((uint8_t)(sizeof(hs.name) - 1), tlvLen);
+                memcpy(hs.name, value, nameLen);
+                hs.name[nameLen] = '\0';
+                break;
+            }
+            case DL_TLV_SIGNAL:
+                if(tlvLen >= 2)
+                {
+                    hs.rssi = (int8_t)value[0];
+                    /** 0.25dB to 0.1dB, rounded half away from zero like lroundf() in the JSON path */
+                    int16_t snr = (int8_t)value[1] * 10;
+                    hs.snr_x10 = (snr + (snr < 0 ? -2 : 2)) / 4;
+                }
+                break;
+            case DL_TLV_POSITION:
+                if(tlvLen >= 8)
+                {
+                    hs.lat = readInt32(value);
+                    hs.lon = readInt32(value + 4);
+                    hs.has_pos = true;
+                }
+                break;
+            case DL_TLV_HOTSPOTS:
+                if(tlvLen >= 1)
+                {
+                    hs.hotspots = value[0];
+                }
+                break;
+            default:
+                /** Skip unknown types */
+                break;
+        }
+        idx += tlvLen;
+    }
+    return hs.name[0] != '\0';
+}
+
+/**
+ * @brief Build the JSON filter once, only the members we
+ * display are kept in the document pool
+ * The keys are literals, stored as pointers, so each member is one slot
+ *
+ * @return JsonDocument& Filter document
+ */
+static JsonDocument &jsonFilter(void)
+{
+    static StaticJsonDocument<JSON_OBJECT_SIZE(5)> filter;
+    if(filter.isNull())
+    {
+        filter["name"] = true;
+        filter["rssi"] = true;
+        filter["snr"] = true;
+        filter["lat"] = true;
+        filter["long"] = true;
+        if(filter.overflowed())
+        {
+            MYLOG("DL", "JSON filter lost members");
+        }
+    }
+    return filter;
+}
+
+/**
+ * @brief Decode legacy JSON downlink
+ *
+ * @param input JSON format, not NULL terminated
+ * @param len Length of input
+ * @param hs Decoded hot spot info
+ * @return true Valid payload with a hot spot name
+ */
+static bool decodeJSON(const char *input, uint16_t len, downlink_hotspot_s &hs)
+{
+    StaticJsonDocument<DL_JSON_CAPACITY> jsonObj;
+    DeserializationError error = deserializeJson(jsonObj, input, len, DeserializationOption::Filter(jsonFilter()));
+    if(error)
+    {
+        MYLOG("DL", "JSON error %s", error.c_str());
+        return false;
+    }
+
+    /** Using .as<> for safety */
+    const char *hsName = jsonObj["name"];
+    if(hsName == nullptr || hsName[0] == '\0')
+    {
+        return false;
+    }
+    strncpy(hs.name, hsName, sizeof(hs.name) - 1);
+    hs.name[sizeof(hs.name) - 1] = '\0';
+    hs.rssi = jsonObj["rssi"].as<int16_t>();
+    hs.snr_x10 = lroundf(jsonObj["snr"].as<float>() * 10.0f);
+    if(jsonObj.containsKey("lat") && jsonObj.containsKey("long"))
+    {
+        hs.lat = lround(jsonObj["lat"].as<double>() * 100000.0);
+        hs.lon = lround(jsonObj["long"].as<double>() * 100000.0);
+        hs.has_pos = true;
+    }
+    return true;
+}
+
+/**
+ * @brief Decode a hot spot info downlink, binary or JSON
+ *
+ * @param data Payload
+ * @param len Length of payload
+ * @param hs Decoded hot spot info, empty when the payload is rejected
+ * @return true Valid payload with a hot spot name
+ */
+bool downlink_decode(const uint8_t *data, uint16_t len, downlink_hotspot_s &hs)
+{
+    hs = downlink_hotspot_s();
+    if(len == 0)
+    {
+        return false;
+    }
+
+    bool valid;
+    if((data[0] & 0xF0) == DOWNLINK_BIN_MAGIC)
+    {
+        valid = decodeBinary(data, len, hs);
+    }
+    else
+    {
+        valid = decodeJSON((const char *)data, len, hs);
+    }
+    /** Nothing of a rejected payload is kept, a bad TLV can follow good ones */
+    if(!valid)
+    {
+        hs = downlink_hotspot_s();
+    }
+    return valid;
+}
@@ -13,15 +13,15 @@
 
 #include <app.h>
 
-/** Vector string array for display. MAX 9 lines Y. MAX 32 characters X */
-std::vector<std::string> displayBuffer;
-/** Keep track of beacons */
-int32_t txCount = 0;
-int32_t rxCount = 0; 
+/** Ring buffer for display. MAX 9 lines Y. MAX 32 characters X */
+LineBuffer<9, 32> displayBuffer;
+/** Keep track of beacons this session, lifetime counts are in counters.cpp */
+uint32_t txCount = 0;
+uint32_t rxCount = 0;
 /** Battery level */
 int8_t battLevel = 0;
 /** Version */
-std::string ver = "";
+TextBuf<16> ver;
 /** Is display is on/off */
 bool displayOn = true;
 /** Timer to put display to sleep, mostly to save burn in */
@@ -32,9 +32,9 @@ SoftwareTimer battTimer;
 SoftwareTimer startTimer;
 /** Timer to refresh splash screen */
 SoftwareTimer splashTimer;
-/** Field tester lat/long */
-double ftester_lat = 0.0;
-double ftester_long = 0.0;
+/** Field tester lat/long, 1e-5 deg */
+int32_t ftester_lat = 0;
+int32_t ftester_long = 0;
 /** GPS sat count/fix status */
 int8_t ftester_satCount = 0;
 bool ftester_gpsLock = false;
@@ -48,12 +48,25 @@ batt_s ftester_batt_level;
 bool pause_buffer = true;
 /** Should we send Zero Packet */
 bool zero_packet = true;
-/** US915 DF->SF Look up*/
-int8_t US915_SF[] = {10, 9, 8, 7, 8, 0, 0, 0, 12, 11, 8, 7, 0, 0};
-/** EU868 DF->SF Look up*/
-int8_t EU868_SF[] = {12, 11, 10, 9, 8, 7, 7};
 /** Current join retries*/
 uint16_t retries = 0;
+/** No-GPS beacons tried */
+uint32_t g_zero_packets = 0;
+/** Timer to coalesce display updates into one frame */
+SoftwareTimer frameTimer;
+/** Display content changed since last frame */
+volatile bool frameDirty = false;
+/** Frame timer is running */
+volatile bool framePending = false;
+/** Timer asked for a splash redraw or display sleep, done on the app task */
+volatile bool splashDue = false;
+volatile bool sleepDue = false;
+static void drawSplash(void);
+/** Frame timer is set up, display is initialized */
+bool frameTimerReady = false;
+/** Redraws asked for vs frames actually drawn */
+uint32_t g_frames_requested = 0;
+uint32_t g_frames_drawn = 0;
 /* Set the OLED driver that you are using to 1, and the other to 0 */
 #define SSD1306 1
 #define SSD1309 0
@@ -70,6 +83,7 @@ U8G2_SSD1309_128X64_NONAME0_F_HW_I2C u8g2(U8G2_R0, U8X8_PIN_NONE);
 
 /**
  * @brief Redraw info bar and display buffer with up to date info
+ * Only called from the frame scheduler, use refreshDisplay()
  * 
  * Firmware version
  * GPS fix status
@@ -79,7 +93,7 @@ U8G2_SSD1309_128X64_NONAME0_F_HW_I2C u8g2(U8G2_R0, U8X8_PIN_NONE);
  * Display buffer
  * 
  */
-void refreshDisplay(void)
+void drawFrame(void)
 {
     ftester_busy = true;
     if(displayOn)
@@ -89,6 +103,7 @@ void refreshDisplay(void)
         
         /** Draw firmware version */
         u8g2.drawStr(0, 5, ver.c_str());
+        TextBuf<16> text;
 
         /** Draw GPS sat fix count */
         u8g2.drawStr(38, 5, "(GPS)");
@@ -96,15 +111,17 @@ void refreshDisplay(void)
         {
             u8g2.drawStr(58, 5, "-");
         } else {
-            u8g2.drawStr(58, 5, std::to_string(ftester_satCount).c_str());
+            text.addInt(ftester_satCount);
+            u8g2.drawStr(58, 5, text.c_str());
         }
 
         /** Draw Helium Join Status
         *   RX/TX Count
         */
         u8g2.drawStr(68, 5, "(H)");
-        std::string count = std::to_string(rxCount) + "/" + std::to_string(txCount);
-        u8g2.drawStr(80, 5,  count.c_str());
+        text.clear();
+        text.addCompact(rxCount).add('/').addCompact(txCount);
+        u8g2.drawStr(80, 5, text.c_str());
 
         /** Draw battery level based on mv */
         if(battLevel == 100)
@@ -117,23 +134,53 @@ void refreshDisplay(void)
             u8g2.drawGlyph(115, 6, 0xe084);
             u8g2.setFont(u8g2_font_micro_mr);
         } else {
-            std::string battLevelD = std::to_string(battLevel) + "%";
-            u8g2.drawStr(110, 6, battLevelD.c_str());
+            text.clear();
+            text.addInt(battLevel).add('%');
+            u8g2.drawStr(110, 6, text.c_str());
         }
 
         u8g2.drawLine(0, 6, 128, 6);
 
         /** Draw our display buffer */
-        int16_t size = displayBuffer.size();
-        for (int y = 0; y < size; y++) 
+        uint8_t size = displayBuffer.size();
+        for (uint8_t y = 0; y < size; y++) 
         {
-            u8g2.drawStr(0, 13 + (y*6), displayBuffer[y].c_str());
+            u8g2.drawStr(0, 13 + (y*6), displayBuffer[y]);
         }
-        if(!pause_buffer) { u8g2.sendBuffer(); }
+        /** Only changed tiles are sent */
+        if(!pause_buffer) { oled_flush(u8g2); }
     }
     ftester_busy = false;
 }
 
+/**
+ * @brief Frame budget is over, wake the app task to draw
+ * 
+ * @param unused 
+ */
+void ftester_frame_due(TimerHandle_t unused)
+{
+    g_task_event_type |= DISPLAY_REFRESH;
+    xSemaphoreGiveFromISR(g_task_sem, &g_higher_priority_task_woken);
+}
+
+/**
+ * @brief Ask for a redraw
+ * Changes within one frame budget are drawn together
+ * in a single frame from the app task
+ * 
+ */
+void refreshDisplay(void)
+{
+    g_frames_requested++;
+    frameDirty = true;
+    if(frameTimerReady && !framePending)
+    {
+        framePending = true;
+        frameTimer.start();
+    }
+}
+
 /**
  * @brief Sends text to display
  * We want to refresh everytime info is added
@@ -143,214 +190,153 @@ void refreshDisplay(void)
  * @param s String to send.
  * 
  */
-void sendToDisplay(std::string s)
+void sendToDisplay(const char *s)
 {
-    if(!s.empty())
+    if(s[0] != '\0')
     {
-        /** Get display buffer size */
-        int16_t size = displayBuffer.size();
-
-        /** MAX 9 lines Y */
-        if(size < 9)
-        {
-            /** MAX 32 characters X */
-            if(s.length() <= 32)
-            {
-                /** Push the newest data to the back of array */
-                displayBuffer.push_back(s);
-            } else {
-                /** If text too long, resize then push to back */
-                s.resize(30);
-                displayBuffer.push_back(s + "..");
-            }
-        } else {
-            /** Erase oldest data and push newest to the back of array */
-            displayBuffer.erase(displayBuffer.begin());
-            /** MAX 32 characters X */
-            if(s.length() <= 32)
-            {
-                /** Push the newest data to the back of array */
-                displayBuffer.push_back(s);
-            } else {
-                /** If text too long, resize then push to back */
-                s.resize(30);
-                displayBuffer.push_back(s + "..");
-            }
-        }
+        /** Oldest line is dropped once 9 lines are shown,
+        *   text over 32 characters is cut */
+        displayBuffer.push(s);
         refreshDisplay();
     }
 }
 
 /**
  * @brief RX Counter
- * Max 999 because of screen limits
- * TODO: Track how many resets (1000 beacons sent)
+ * Session count is shown compact (i.e. 1.2k) to fit the screen
  * 
  */
 void rxCounter()
 {
-    if(rxCount < 999)
-    {
-        rxCount++;
-        refreshDisplay();
-    } else {
-        rxCount = 0;
-        txCount = 0;
-        rxCount++;
-        sendToDisplay("Resetting RX/TX Beacon Count!");
-    }
+    rxCount++;
+    counters_rx();
+    refreshDisplay();
 }
 
 /**
  * @brief TX Counter
- * Max 999 because of screen limits
+ * Session count is shown compact (i.e. 1.2k) to fit the screen
  * 
  */
 void txCounter()
 {
-    if(txCount < 999)
-    {
-        txCount++;
-        refreshDisplay();
-    } else {
-        rxCount = 0;
-        txCount = 0;
-        txCount++;
-        sendToDisplay("Resetting RX/TX Beacon Count!");
-    }
+    txCount++;
+    counters_tx();
+    refreshDisplay();
 }
 
 /**
- * @brief Convert Regional Data Rate to Spreading Factor
- * Only one different is US915, so if in any other region, use EU lookup
+ * @brief Display hot spot info from the mapper integration downlink
  * 
- * @param reg Regional code
- * @return int8_t Return spread factor
+ * @param input Downlink payload, binary or JSON format
+ * @param len Length of input
  */
-int8_t dataRateToSF(int8_t reg)
+void parseDownlink(const uint8_t *input, uint16_t len)
 {
-    switch (reg)
+    downlink_hotspot_s hs;
+    if(downlink_decode(input, len, hs))
     {
-        case 8:
-            return US915_SF[g_lorawan_settings.data_rate];
-            break;
-        default:
-            return EU868_SF[g_lorawan_settings.data_rate];
-            break;
-    }
-}
+        /** Increase RX counter */
+        rxCounter();
+        session_log_hotspot(hs);
+        
+        /** Start building hot spot name */
+        TextBuf<sizeof(hs.name)> hsName;
+        hsName.add(hs.name);
 
-/**
- * @brief Parse incoming JSON LoRaWAN data from LLIS
- * 
- * @param input JSON format
- */
-void parseJSON(std::string input)
-{
-    /** Total (minimum) 152
-    *   Total (recommended) 192
-    *   Using 256 to leave room as 'input' is not static */
-    DynamicJsonDocument jsonObj(256);
-    DeserializationError error = deserializeJson(jsonObj, input);
+        uint32_t distM = 0;
+        TextBuf<12> distS;
 
-    if(!error)
-    {
-        /** Build vars from JSON data
-        *   Using .as<> for safety */
-        const char* hsName = jsonObj["name"];
-        int16_t hsRssi = jsonObj["rssi"].as<int16_t>();
-        float hsSnr =  jsonObj["snr"].as<float>();
-        double hsLat = jsonObj["lat"].as<double>();
-        double hsLong = jsonObj["long"].as<double>();
-        if(hsName != nullptr)
+        /** Get distance between tester and hot spot */
+        if(ftester_gpsLock && hs.has_pos)
         {
-            /** Increase RX counter */
-            rxCounter();
-            
-            /** Start building hot spot name */
-            std::ostringstream namess;
-            namess << hsName;
-            std::string hsNameS = namess.str();
-
-            /** Build hot spot snr and set precision to 1, i.e. 0.1 */
-            std::ostringstream snrss;
-            snrss << std::fixed << std::setprecision(1) << hsSnr;
-
-            /** Get the SNR/RSSI from field tester */
-            std::string rxrssi = std::to_string(g_last_rssi);
-            std::string rxsnr = std::to_string(g_last_snr);
-
-            double distM = 0.0;
-            double distKM = 0.0;
-            std::string distS = "";
-
-            /** Get distance between tester and hot spot */
-            if(ftester_gpsLock)
-            {
-                distM = my_rak1910_gnss.distanceBetween(ftester_lat, ftester_long, hsLat, hsLong);
-                distKM = distM / 1000.0;
-            } else {
-                distKM = 0;
-            }
-            /** If distance is less than 0.1km we just display it as <0.1 */
-            if(distKM <= 0.1)
-            {
-                distS = "<0.1";
-            } else {
-                /** Set precision to 1 for distance */
-                std::ostringstream dss;
-                dss << std::fixed << std::setprecision(1) << distKM;
-                distS = dss.str();
-            }
-
-            /** Distance and HS count is critical info, so we deal with it differently
-            *   This needs to mimic displayName */
-            std::string lenCheck = std::to_string(rxCount) + "." + hsNameS + " " + distS + "km";            
-            int16_t nameLen = lenCheck.length();
-
-            /** Nibble away at hot spot name to save
-            *   important info (i.e. HS count/distance)
-            *   Most dynamic way I can think to do this */
-            if(nameLen > 32)
-            {
-                std::string delimiter = "-";
-                /** Find first '-' */
-                int16_t pos = hsNameS.find(delimiter);
-                /** Chunk size to fit on screen */
-                int16_t chunk = nameLen - 32;
-                /** Erase chunk, but keep first '-' */
-                hsNameS.erase(pos+1, chunk);
-            }
+            distM = geo_distance_m(ftester_lat, ftester_long, hs.lat, hs.lon);
+        }
+        /** If distance is less than 0.1km we just display it as <0.1 */
+        if(distM <= 100)
+        {
+            distS.add("<0.1");
+        } else {
+            /** Set precision to 1 for distance, in 0.1km */
+            distS.addFixed((distM + 50) / 100, 1);
+        }
 
-            /** Get Spread Factor from region setting data rate */
-            int8_t spreadFactor = dataRateToSF(g_lorawan_settings.lora_region);
+        /** How many other hot spots heard the beacon (+#), only sent in binary format */
+        TextBuf<8> hsCount;
+        if(hs.hotspots > 1)
+        {
+            hsCount.add(" +").addInt(hs.hotspots - 1);
+        }
 
-            /** Final strings for display, ready to send to OLED */
-            std::string displayName = std::to_string(rxCount) + "." + hsNameS + " " + distS + "km";
-            std::string signalInfo = "RSSI:" + rxrssi + "/" + std::to_string(hsRssi) + " SNR:" + rxsnr + "/" + snrss.str() + " SF:" + std::to_string(spreadFactor);
+        /** Distance and HS count is critical info, so we deal with it differently
+        *   This needs to mimic displayName */
+        TextBuf<12> rxCountS;
+        rxCountS.addCompact(rxCount).add('.');
+        int16_t nameLen = rxCountS.length() + hsName.length() + hsCount.length() + 1 + distS.length() + 2;
 
-            sendToDisplay(displayName);
-            sendToDisplay(signalInfo);
+        /** Nibble away at hot spot name to save
+        *   important info (i.e. HS count/distance)
+        *   Most dynamic way I can think to do this */
+        if(nameLen > 32)
+        {
+            /** Find first '-' */
+            const char *dash = strchr(hsName.c_str(), '-');
+            int16_t pos = dash != nullptr ? dash - hsName.c_str() : -1;
+            /** Chunk size to fit on screen */
+            int16_t chunk = nameLen - 32;
+            /** Erase chunk, but keep first '-' */
+            hsName.erase(pos+1, chunk);
         }
+
+        /** Get Spread Factor from region setting data rate */
+        int8_t spreadFactor = lora_dr_sf(g_lorawan_settings.lora_region, g_lorawan_settings.data_rate);
+
+        /** Final strings for display, ready to send to OLED
+        *   SNR/RSSI from field tester / hot spot, SNR precision is 0.1 */
+        TextBuf<40> displayName;
+        displayName.add(rxCountS.c_str()).add(hsName.c_str()).add(hsCount.c_str()).add(' ').add(distS.c_str()).add("km");
+        TextBuf<48> signalInfo;
+        signalInfo.add("RSSI:").addInt(g_last_rssi).add('/').addInt(hs.rssi)
+                  .add(" SNR:").addInt(g_last_snr).add('/').addFixed(hs.snr_x10, 1)
+                  .add(" SF:").addInt(spreadFactor);
+
+        sendToDisplay(displayName.c_str());
+        sendToDisplay(signalInfo.c_str());
     }
 }
 
 /**
- * @brief Put display into Power Saver mode
- * Mostly to save burn in. leave screen on if
- * data is being processed
+ * @brief Display timeout, wake the app task to put the display to sleep
+ * The bus may be busy for a while, the timer task must not wait for it
  * 
  * @param unused 
  * 
  */
 void ftester_display_sleep(TimerHandle_t unused)
+{
+    sleepDue = true;
+    g_task_event_type |= DISPLAY_POWER;
+    xSemaphoreGiveFromISR(g_task_sem, &g_higher_priority_task_woken);
+}
+
+/**
+ * @brief Put display into Power Saver mode
+ * Mostly to save burn in. leave screen on if
+ * data is being processed
+ * 
+ */
+static void displaySleep(void)
 {
     if(!ftester_busy)
     {
         displayOn = false;
         displayTimeoutTimer.stop();
         battTimer.stop();
-        u8g2.setPowerSave(true);
+        if(i2c_acquire(I2C_DEV_OLED))
+        {
+            u8g2.setPowerSave(true);
+            i2c_release(I2C_DEV_OLED);
+        }
     } else {
         /** This should never happen right? */
         displayTimeoutTimer.reset();
@@ -400,6 +386,34 @@ void ftester_delay_start(TimerHandle_t unused)
  */
 void ftester_event_handler(void)
 {
+    if((g_task_event_type & DISPLAY_POWER) == DISPLAY_POWER)
+    {
+        g_task_event_type &= N_DISPLAY_POWER;
+        if(splashDue)
+        {
+            splashDue = false;
+            drawSplash();
+        }
+        if(sleepDue)
+        {
+            sleepDue = false;
+            displaySleep();
+        }
+    }
+
+    if((g_task_event_type & DISPLAY_REFRESH) == DISPLAY_REFRESH)
+    {
+        g_task_event_type &= N_DISPLAY_REFRESH;
+        framePending = false;
+        if(frameDirty)
+        {
+            frameDirty = false;
+            drawFrame();
+            g_frames_drawn++;
+            MYLOG("OLED", "Frames drawn %ld of %ld requested", (long)g_frames_drawn, (long)g_frames_requested);
+        }
+    }
+
     if((g_task_event_type & LORA_JOIN_FIN) == LORA_JOIN_FIN)
     {
         g_task_event_type &= N_LORA_JOIN_FIN;
@@ -407,12 +421,20 @@ void ftester_event_handler(void)
         {
             /** Stop splash screen tick */
             splashTimer.stop();
+            splashDue = false;
+            /** Send what was queued while joining */
+            uplink_queue_drain();
             /** Display some LoRa network info */
-            std::string region = region_names[g_lorawan_settings.lora_region];
-            sendToDisplay("Joined Helium Network! (" + region + ")");
-            std::string networkInfo = "Datarate:" + std::to_string(g_lorawan_settings.data_rate) + 
-                                      " Subband:" + std::to_string(g_lorawan_settings.subband_channels);
-            sendToDisplay(networkInfo);
+            TextBuf<33> networkInfo;
+            networkInfo.add("Joined Helium Network! (").add(region_names[g_lorawan_settings.lora_region]).add(')');
+            sendToDisplay(networkInfo.c_str());
+            networkInfo.clear();
+            networkInfo.add("Datarate:").addInt(g_lorawan_settings.data_rate)
+                       .add(" Subband:").addInt(g_lorawan_settings.subband_channels);
+            sendToDisplay(networkInfo.c_str());
+            networkInfo.clear();
+            networkInfo.add("Lifetime RX/TX: ").addCompact(g_lifetime_rx).add('/').addCompact(g_lifetime_tx);
+            sendToDisplay(networkInfo.c_str());
             /** Don't turn off screen until joined Helium */
             displayTimeoutTimer.begin(305137, ftester_display_sleep);
             displayTimeoutTimer.start();
@@ -426,39 +448,14 @@ void ftester_event_handler(void)
 
 /**
  * @brief Field Testers LoRa Data handler
- * Parse incoming(RX) JSON data from LLIS
- * Convert from HEX to string
- * Build JSON obj
- * Iterate through JSON obj
+ * Parse incoming(RX) hot spot data from LLIS
+ * The RX buffer is parsed in place
  * 
  */
 void ftester_lora_data_handler(void)
 {
     ftester_busy = true;
-    /** Convert RX data buffer to char */
-    char log_buff[g_rx_data_len * 3] = {0};
-    uint8_t log_idx = 0;
-    for (int idx = 0; idx < g_rx_data_len; idx++)
-    {
-        sprintf(&log_buff[log_idx], "%02X ", g_rx_lora_data[idx]);
-        log_idx += 3;
-    }
-
-    std::string jsonString;
-    std::string hexString = std::string(log_buff);
-    /** Remove spaces */
-    std::string::iterator end_pos = std::remove(hexString.begin(), hexString.end(), ' ');
-    hexString.erase(end_pos, hexString.end());
-
-    /** Convert from HEX to "text" to build JSON string */
-    int16_t len = hexString.length();
-    for(int i = 0; i < len; i+=2)
-    {
-        std::string byte = hexString.substr(i,2);
-        char chr = (char) (int)strtol(byte.c_str(), nullptr, 16);
-        jsonString.push_back(chr);
-    }
-    parseJSON(jsonString);
+    parseDownlink(g_rx_lora_data, g_rx_data_len);
     ftester_busy = false;
 }
 
@@ -471,15 +468,22 @@ void ftester_acc_event(void)
 {
     if(displayOn)
     {
-        /** Keep display on */
+        /** Keep display on, also if the timeout already fired */
+        sleepDue = false;
         displayTimeoutTimer.reset();
     } else {
         /** Screen is off, wake up */
-        u8g2.setPowerSave(false);
+        if(i2c_acquire(I2C_DEV_OLED))
+        {
+            u8g2.setPowerSave(false);
+            i2c_release(I2C_DEV_OLED);
+        }
         displayTimeoutTimer.reset();
         battTimer.reset();
         displayOn = true;
         ftester_updateBattLevel(nullptr);
+        /** Show what changed while the screen was off */
+        refreshDisplay();
     }
 }
 
@@ -495,13 +499,13 @@ void ftester_tx_beacon(void)
 /**
  * @brief Set GPS data for device
  * 
- * @param lat 
- * @param lon 
+ * @param lat Latitude, 1e-5 deg
+ * @param lon Longitude, 1e-5 deg
  */
 void ftester_setGPSData(int64_t lat, int64_t lon)
 {
-    ftester_lat = lat / 100000.0;
-    ftester_long = lon / 100000.0;
+    ftester_lat = lat;
+    ftester_long = lon;
 }
 
 /**
@@ -512,53 +516,11 @@ void ftester_setGPSData(int64_t lat, int64_t lon)
  */
 void ftester_send_lora_zero(void)
 {
+    g_zero_packets++;
     ftester_batt_level.batt16 = read_batt();
-    g_mapper_data.batt_1 = ftester_batt_level.batt8[0];
-    g_mapper_data.batt_2 = ftester_batt_level.batt8[1];
-    g_mapper_data.lat_1 = 0;
-    g_mapper_data.lat_2 = 0;
-    g_mapper_data.lat_3 = 0;
-    g_mapper_data.lat_4 = 0;
-
-    g_mapper_data.long_1 = 0;
-    g_mapper_data.long_2 = 0;
-    g_mapper_data.long_3 = 0;
-    g_mapper_data.long_4 = 0;
-
-    g_mapper_data.alt_1 = 0;
-    g_mapper_data.alt_2 = 0;
-
-    g_mapper_data.acy_1 = 0;
-    g_mapper_data.acy_2 = 0;
-    lmh_error_status result = send_lora_packet((uint8_t *)&g_mapper_data, MAPPER_DATA_LEN);
-    switch (result)
-    {
-    case LMH_SUCCESS:
-        MYLOG("APP", "Packet enqueued");
-        ftester_tx_beacon();
-        if (g_ble_uart_is_connected)
-        {
-            g_ble_uart.print("Packet enqueued\n");
-        }
-        /// \todo set a flag that TX cycle is running
-        lora_busy = true;
-        
-        break;
-    case LMH_BUSY:
-        MYLOG("APP", "LoRa transceiver is busy");
-        if (g_ble_uart_is_connected)
-        {
-            g_ble_uart.print("LoRa transceiver is busy\n");
-        }
-        break;
-    case LMH_ERROR:
-        MYLOG("APP", "Packet error, too big to send with current DR");
-        if (g_ble_uart_is_connected)
-        {
-            g_ble_uart.print("Packet error, too big to send with current DR\n");
-        }
-        break;
-    }
+    /** No position in a zero packet, the queue builds it with zeros, first to go if the queue fills up */
+    uplink_queue_add(nullptr, ftester_batt_level.batt16, UPLINK_PRIO_NOGPS);
+    ftester_tx_beacon();
 }
 
 /**
@@ -570,9 +532,9 @@ void ftester_gps_fix(bool fix)
 {
     if(israk12500)
     {
-        ftester_satCount = my_rak12500_gnss.getSIV();
+        ftester_satCount = gnss_pvt_satellites();
     } else {
-        ftester_satCount = my_rak1910_gnss.satellites.value();
+        ftester_satCount = gnss_rx_satellites();
     }
 
     if(fix)
@@ -620,7 +582,11 @@ void ftester_SetGPSType(bool type)
     {
         sendToDisplay("Initialized RAK12500");
         /**TODO: Add to user menu */
-		my_rak12500_gnss.setHighPrecisionMode(false);
+		if(i2c_acquire(I2C_DEV_GNSS))
+		{
+			my_rak12500_gnss.setHighPrecisionMode(false);
+			i2c_release(I2C_DEV_GNSS);
+		}
     } else {
         sendToDisplay("Initialized RAK1910");
     }
@@ -637,30 +603,59 @@ void ftester_GPSBusy(bool busy)
     ftester_busy = busy;
 }
 
-void drawSplash(TimerHandle_t unused)
+/**
+ * @brief Splash screen with the join retries, app task only
+ * 
+ */
+static void drawSplash(void)
 {
-    ver = "R4K v" + std::to_string(SW_VERSION_1) + "." + std::to_string(SW_VERSION_2) + "a";
-    u8g2.begin();
+    ver.clear();
+    ver.add("R4K v").addInt(SW_VERSION_1).add('.').addInt(SW_VERSION_2).add('a');
+    /** The init sequence waits for the bus too */
+    if(i2c_acquire(I2C_DEV_OLED))
+    {
+        u8g2.begin();
+        i2c_release(I2C_DEV_OLED);
+    }
+    /** Display was reset, send everything */
+    oled_invalidate();
     u8g2.setFont(u8g2_font_micro_mr);
     u8g2.drawXBM(0, 0, rak_width, rak_height, rak_bits);
     u8g2.drawStr(68, 10, ver.c_str());
     u8g2.drawStr(68, 16, "Field Tester");
     u8g2.drawStr(68, 22, "Alpha Build");
-    std::string joinTrials = "Joining Helium, retries: " + std::to_string(retries) + "/" + std::to_string(g_lorawan_settings.join_trials);
+    TextBuf<33> joinTrials;
+    joinTrials.add("Joining Helium, retries: ").addInt(retries).add('/').addInt(g_lorawan_settings.join_trials);
     u8g2.drawStr(0, 64, joinTrials.c_str());
-    u8g2.sendBuffer();
+    oled_flush(u8g2);
     retries++;
     if(retries >= g_lorawan_settings.join_trials) { splashTimer.stop(); }
 }
 
+/**
+ * @brief Splash tick while joining, wake the app task to draw
+ * 
+ * @param unused 
+ */
+void ftester_splash_due(TimerHandle_t unused)
+{
+    splashDue = true;
+    g_task_event_type |= DISPLAY_POWER;
+    xSemaphoreGiveFromISR(g_task_sem, &g_higher_priority_task_woken);
+}
+
 /**
  * @brief Initialize Display here
  * 
  */
 void ftester_init(void)
 {
-    drawSplash(NULL);
+    /** Load lifetime beacon counters */
+    counters_init();
+    frameTimer.begin(FTESTER_FRAME_BUDGET_MS, ftester_frame_due, NULL, false);
+    frameTimerReady = true;
+    drawSplash();
     /** Hardcode to 30s as join interval is not implemented */
-    splashTimer.begin(30000, drawSplash, NULL, true);
+    splashTimer.begin(30000, ftester_splash_due, NULL, true);
     splashTimer.start();
 }
\ No newline at end of file
@@ -0,0 +1,161 @@
+/**
+ * @file geo.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Distance and bearing on 1e-5 degree fixed point coordinates
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The nRF52840 FPU is single precision, so everything here is float or
+ * integer. Coordinate differences are taken in int32 first, which keeps
+ * them exact before they are converted to float.
+ *
+ * Spherical earth, radius GEO_EARTH_RADIUS_M. Error against a double
+ * precision haversine on the same sphere, beyond the rounding to whole
+ * meters, measured by test/test_geo:
+ *   < 50 km and < 0.5 deg of longitude   equirectangular, < 0.002 %
+ *   otherwise                            haversine, < 0.0005 %
+ * The bearing is always the great circle one, within 0.01 deg.
+ * Cosines of latitudes come from the integer colatitude, so this holds
+ * up to the poles.
+ * The sphere itself differs from WGS84 by up to 0.5 %.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Mean earth radius in meters */
+#define GEO_EARTH_RADIUS_M 6371009.0f
+/** Above this the equirectangular approximation is not used */
+#define GEO_SHORT_RANGE_M 50000
+/** Nor across more than 0.5 deg of longitude, 1e-5 deg */
+#define GEO_SHORT_DLON_E5 50000
+/** 1e-5 degree to radians */
+#define GEO_E5_TO_RAD (3.14159265f / 18000000.0f)
+/** 180 degrees in 1e-5 degree */
+#define GEO_E5_HALF_TURN 18000000L
+
+/**
+ * @brief Longitude difference wrapped to +/-180 deg
+ *
+ * @param lon1 From, 1e-5 deg
+ * @param lon2 To, 1e-5 deg
+ * @return int32_t lon2 - lon1, 1e-5 deg
+ */
+static int32_t deltaLon(int32_t lon1, int32_t lon2)
+{
+    int32_t dlon = lon2 - lon1;
+    if(dlon > GEO_E5_HALF_TURN)
+    {
+        dlon -= 2 * GEO_E5_HALF_TURN;
+    } else if(dlon < -GEO_E5_HALF_TURN) {
+        dlon += 2 * GEO_E5_HALF_TURN;
+    }
+    return dlon;
+}
+
+/**
+ * @brief Cosine of a latitude
+ *
+ * Taken as the sine of the colatitude, which is exact in int32, so it
+ * keeps its precision next to the poles where cosf() of a float angle
+ * near pi/2 does not.
+ *
+ * @param lat Latitude, 1e-5 deg
+ */
+static float cosLat(int32_t lat)
+{
+    return sinf((GEO_E5_HALF_TURN / 2 - abs(lat)) * GEO_E5_TO_RAD);
+}
+
+/**
+ * @brief Equirectangular projection around the mean latitude
+ *
+ * @param dist Distance, meters
+ * @return true The projection is accurate here, short range and not across
+ *         many meridians (near the poles a short distance can)
+ */
+static bool projectShort(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, float &dist)
+{
+    int32_t dlon = deltaLon(lon1, lon2);
+    float x = dlon * cosLat((lat1 + lat2) / 2);
+    float y = (float)(lat2 - lat1);
+    dist = sqrtf(x * x + y * y) * (GEO_EARTH_RADIUS_M * GEO_E5_TO_RAD);
+    return dist < GEO_SHORT_RANGE_M && abs(dlon) <= GEO_SHORT_DLON_E5;
+}
+
+/**
+ * @brief Distance between two points
+ *
+ * @param lat1 From latitude, 1e-5 deg
+ * @param lon1 From longitude, 1e-5 deg
+ * @param lat2 To latitude, 1e-5 deg
+ * @param lon2 To longitude, 1e-5 deg
+ * @return uint32_t Distance in meters
+ */
+uint32_t geo_distance_m(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    float dist;
+    if(projectShort(lat1, lon1, lat2, lon2, dist))
+    {
+        return (uint32_t)(dist + 0.5f);
+    }
+
+    /** Haversine */
+    float sinLat = sinf((lat2 - lat1) * GEO_E5_TO_RAD * 0.5f);
+    float sinLon = sinf(deltaLon(lon1, lon2) * GEO_E5_TO_RAD * 0.5f);
+    float h = sinLat * sinLat + cosLat(lat1) * cosLat(lat2) * sinLon * sinLon;
+    if(h > 1.0f)
+    {
+        h = 1.0f;
+    }
+    return (uint32_t)(2.0f * GEO_EARTH_RADIUS_M * asinf(sqrtf(h)) + 0.5f);
+}
+
+/**
+ * @brief Initial bearing from point 1 to point 2, great circle
+ *
+ * @param lat1 From latitude, 1e-5 deg
+ * @param lon1 From longitude, 1e-5 deg
+ * @param lat2 To latitude, 1e-5 deg
+ * @param lon2 To longitude, 1e-5 deg
+ * @return uint16_t Bearing in 0.01 deg, 0 is north, 9000 is east
+ */
+uint16_t geo_bearing_cdeg(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    float cosLat2 = cosLat(lat2);
+    float dlon = deltaLon(lon1, lon2) * GEO_E5_TO_RAD;
+    float sinHalfLon = sinf(dlon * 0.5f);
+    float x = sinf(dlon) * cosLat2;
+    /** cos(phi1)sin(phi2) - sin(phi1)cos(phi2)cos(dlon), rewritten so short
+    *   distances don't cancel in float */
+    float y = sinf((lat2 - lat1) * GEO_E5_TO_RAD) + 2.0f * sinf(lat1 * GEO_E5_TO_RAD) * cosLat2 * sinHalfLon * sinHalfLon;
+
+    int32_t cdeg = lroundf(atan2f(x, y) * (18000.0f / 3.14159265f));
+    if(cdeg < 0)
+    {
+        cdeg += 36000;
+    }
+    return cdeg >= 36000 ? 0 : cdeg;
+}
+
+/**
+ * @brief Point at a distance and bearing, short range only (< GEO_SHORT_RANGE_M)
+ *
+ * @param lat From latitude, 1e-5 deg
+ * @param lon From longitude, 1e-5 deg
+ * @param bearing_cdeg Bearing in 0.01 deg, 0 is north
+ * @param dist_m Distance in meters
+ * @param lat2 To latitude, 1e-5 deg
+ * @param lon2 To longitude, 1e-5 deg
+ */
+void geo_offset(int32_t lat, int32_t lon, uint16_t bearing_cdeg, uint32_t dist_m, int32_t &lat2, int32_t &lon2)
+{
+    float bearing = bearing_cdeg * (3.14159265f / 18000.0f);
+    float arc = dist_m / (GEO_EARTH_RADIUS_M * GEO_E5_TO_RAD);
+    /** Keep away from the poles */
+    float scale = max(cosLat(lat), 0.01f);
+    lat2 = lat + lroundf(arc * cosf(bearing));
+    lon2 = deltaLon(0, lon + lroundf(arc * sinf(bearing) / scale));
+}
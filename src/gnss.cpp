@@ -16,21 +16,143 @@
 #include "app.h"
 
 // The GNSS object
-TinyGPSPlus my_rak1910_gnss;	 // RAK1910_GNSS
 SFE_UBLOX_GNSS my_rak12500_gnss; // RAK12500_GNSS
 
 /** GNSS polling function */
 bool poll_gnss(void);
 
+/** RAK1910 background task start */
+static void gnss_rx_start(void);
+
 /** Location data as byte array */
 mapper_data_s g_mapper_data;
 
+/** Last valid position with speed and heading */
+gnss_fix_s g_last_fix;
+
 /** Latitude/Longitude value converter */
 latLong_s pos_union;
 
 /** Flag if location was found */
 bool last_read_ok = false;
 
+/** RAK1910 NMEA is parsed by this task, poll_gnss() only reads its snapshot */
+TaskHandle_t gnss_rx_task_handle = NULL;
+/** Given by the task for every new fix */
+SemaphoreHandle_t gnss_rx_fix_sem = NULL;
+/** Newest fix from the NMEA stream */
+gnss_fix_s gnss_rx_fix;
+/** Satellites of the last GGA, with or without fix */
+volatile uint8_t gnss_rx_siv = 0;
+/** millis() of the first fix after the last wake up, 0 if none yet */
+volatile uint32_t gnss_rx_first_fix = 0;
+
+/** RAK12500 NAV-PVT/NAV-DOP snapshot, one per navigation epoch */
+gnss_fix_s gnss_pvt_fix;
+/** Satellites of the last NAV-PVT, with or without fix */
+uint8_t gnss_pvt_siv = 0;
+/** hDOP of the last NAV-DOP */
+uint16_t gnss_pvt_hdop = 0;
+/** Bus reads for the RAK12500, all beacons and the current one */
+uint32_t g_gnss_i2c_polls = 0;
+uint32_t g_gnss_i2c_polls_beacon = 0;
+
+/** NMEA ingestion stats */
+uint32_t g_gnss_rx_bytes = 0;
+uint32_t g_gnss_rx_parse_us = 0;
+uint32_t g_gnss_wait_ms = 0;
+uint32_t g_gnss_polls = 0;
+
+/** Poll results, time from poll start to fix or give up */
+uint32_t g_gnss_poll_timeouts = 0;
+uint32_t g_gnss_decision_ms = 0;
+uint32_t g_gnss_decision_ms_max = 0;
+uint32_t g_gnss_decision_ms_total = 0;
+/** millis() of the first poll with a fix, 0 until then */
+uint32_t g_gnss_first_fix_ms = 0;
+
+/**
+ * @brief Convert a UTC date/time to Unix time
+ * 
+ * @return Seconds since 1970-01-01 (uint32_t)
+ */
+static uint32_t gnss_epoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+	// Days from civil, March based year so leap days are at the end
+	int32_t y = year - (month <= 2 ? 1 : 0);
+	int32_t era = y / 400;
+	uint32_t yoe = y - era * 400;
+	uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	uint32_t days = era * 146097 + doe - 719468;
+	return days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+/**
+ * @brief Turn off the NMEA sentences nmea_encode() doesn't use
+ *        PUBX,40 sets the rate of one sentence per port, DDC,UART1,UART2,USB,SPI
+ * 
+ */
+static void gnss_rak1910_config(void)
+{
+	static const char *unused[] = {"GLL", "GSA", "GSV", "VTG"};
+	TextBuf<32> cmd;
+	for (uint8_t i = 0; i < sizeof(unused) / sizeof(unused[0]); i++)
+	{
+		cmd.clear();
+		cmd.add("PUBX,40,").add(unused[i]).add(",0,0,0,0,0,0");
+		nmea_send(cmd.c_str());
+	}
+}
+
+/**
+ * @brief RAK12500 settings that are not saved in the module
+ * 
+ */
+static void gnss_rak12500_config(void)
+{
+	if (!i2c_acquire(I2C_DEV_GNSS))
+	{
+		return;
+	}
+	// Module sends NAV-PVT and NAV-DOP once per epoch by itself, no polling per value
+	my_rak12500_gnss.setNavigationFrequency(1);
+	my_rak12500_gnss.setAutoPVTcallbackPtr(&gnss_pvt_callback);
+	my_rak12500_gnss.setAutoDOPcallbackPtr(&gnss_dop_callback);
+	i2c_release(I2C_DEV_GNSS);
+}
+
+/**
+ * @brief Send a UBX message on the UART
+ * 
+ * @param msg_class UBX class
+ * @param msg_id UBX id
+ * @param payload Payload
+ * @param len Payload length
+ */
+static void gnss_ubx_send(uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t len)
+{
+	uint8_t header[4] = {msg_class, msg_id, (uint8_t)(len & 0xFF), (uint8_t)(len >> 8)};
+	uint8_t ck_a = 0;
+	uint8_t ck_b = 0;
+	for (uint8_t i = 0; i < sizeof(header); i++)
+	{
+		ck_a += header[i];
+		ck_b += ck_a;
+	}
+	for (uint16_t i = 0; i < len; i++)
+	{
+		ck_a += payload[i];
+		ck_b += ck_a;
+	}
+	Serial1.write(0xB5);
+	Serial1.write(0x62);
+	Serial1.write(header, sizeof(header));
+	Serial1.write(payload, len);
+	Serial1.write(ck_a);
+	Serial1.write(ck_b);
+}
+
 /**
  * @brief Detect and initialize a connected GNSS module. Supports RAK12500 and RAK1910.
  * 
@@ -38,6 +160,15 @@ bool last_read_ok = false;
  */
 uint8_t init_gnss(void)
 {
+	// Recorded NMEA instead of a module, see gnss_trace.cpp
+	if (gnss_trace_init())
+	{
+		gnss_rx_start();
+		MYLOG("GNSS", "Replaying RAK1910 trace");
+		ftester_SetGPSType(false);
+		return RAK1910_GNSS;
+	}
+
 	// Give the module some time to power up
 	// delay(2000);
 
@@ -51,7 +182,10 @@ uint8_t init_gnss(void)
 
 	// Initialize RAK12500 if present, otherwise initialize RAK1910
 	Wire.begin();
-	bool rak12500_present = my_rak12500_gnss.begin();
+	// Detection and setup in one go, released on either path
+	// Without the bus the RAK12500 can't be probed, the RAK1910 is tried
+	bool bus_owned = i2c_acquire(I2C_DEV_GNSS);
+	bool rak12500_present = bus_owned && my_rak12500_gnss.begin();
 
 	MYLOG("GNSS", "Trying to initialize RAK12500");
 
@@ -61,18 +195,33 @@ uint8_t init_gnss(void)
 		ftester_SetGPSType(true);
 		my_rak12500_gnss.setI2COutput(COM_TYPE_UBX);				 // Set the I2C port to output UBX only (turn off NMEA noise)
 		my_rak12500_gnss.saveConfigSelective(VAL_CFG_SUBSEC_IOPORT); // Save (only) the communications port settings to flash and BBR
+		gnss_rak12500_config();
+		i2c_release(I2C_DEV_GNSS);
 		MYLOG("GNSS", "Detected and initialized RAK12500");
 		return RAK12500_GNSS;
 	}
 	else
 	{
-		MYLOG("GNSS", "RAK12500 not detected at default I2C address");
-		Wire.end();
+		if (bus_owned)
+		{
+			i2c_release(I2C_DEV_GNSS);
+			MYLOG("GNSS", "RAK12500 not detected at default I2C address");
+		}
+		else
+		{
+			MYLOG("GNSS", "No I2C bus, RAK12500 detection skipped");
+		}
+		// Wire stays up, the LIS3DH and the OLED are on it too
 
 		MYLOG("GNSS", "Trying to initialize RAK1910");
 		Serial1.begin(9600);
 		while (!Serial1)
 			;
+		// Only RMC and GGA, the MAX-7Q sends GLL, GSA, GSV and VTG too by default
+		gnss_rak1910_config();
+
+		// NMEA is parsed in the background from now on
+		gnss_rx_start();
 		MYLOG("GNSS", "Initialized RAK1910");
 		/** Hook for Field Tester */
 		ftester_SetGPSType(false);
@@ -80,6 +229,320 @@ uint8_t init_gnss(void)
 	}
 }
 
+/**
+ * @brief Start the RAK1910 background task
+ * 
+ */
+static void gnss_rx_start(void)
+{
+	gnss_rx_fix_sem = xSemaphoreCreateBinary();
+	xTaskCreate(gnss_rx_task, "GNSS", 512, NULL, TASK_PRIO_LOW, &gnss_rx_task_handle);
+}
+
+/**
+ * @brief Read what the RAK1910 sent, or the trace when replaying
+ * 
+ * @param buf Output
+ * @param size Size of buf
+ * @return Number of bytes (uint8_t)
+ */
+static uint8_t gnss_rx_read(uint8_t *buf, uint8_t size)
+{
+	if (gnss_trace_replaying())
+	{
+		return gnss_trace_read(buf, size);
+	}
+	uint8_t len = 0;
+	while (len < size && Serial1.available() > 0)
+	{
+		buf[len++] = Serial1.read();
+	}
+	gnss_trace_record(buf, len);
+	return len;
+}
+
+/**
+ * @brief A GGA completed a fix, hand it to poll_gnss()
+ * 
+ */
+static void gnss_rx_publish(void)
+{
+	gnss_rx_siv = g_nmea.siv;
+	if (!g_nmea.pos_valid || !g_nmea.alt_valid)
+	{
+		return;
+	}
+
+	gnss_fix_s fix;
+	fix.lat = g_nmea.lat;
+	fix.lon = g_nmea.lon;
+	fix.alt = g_nmea.alt;
+	fix.hdop = g_nmea.hdop;
+	fix.speed = g_nmea.speed;
+	fix.heading = g_nmea.heading;
+	fix.siv = g_nmea.siv;
+	if (g_nmea.date_valid && g_nmea.year >= 2020)
+	{
+		fix.epoch = gnss_epoch(g_nmea.year, g_nmea.month, g_nmea.day, g_nmea.hour, g_nmea.minute, g_nmea.second);
+	}
+	fix.time = millis();
+	fix.valid = true;
+	if (gnss_rx_first_fix == 0)
+	{
+		gnss_rx_first_fix = fix.time;
+	}
+
+	taskENTER_CRITICAL();
+	gnss_rx_fix = fix;
+	taskEXIT_CRITICAL();
+	xSemaphoreGive(gnss_rx_fix_sem);
+}
+
+/**
+ * @brief Parse everything the RAK1910 sent since the last call
+ * 
+ */
+static void gnss_rx_drain(void)
+{
+	uint8_t chunk[GNSS_TRACE_CHUNK];
+	uint32_t start = micros();
+	uint8_t len;
+	while ((len = gnss_rx_read(chunk, sizeof(chunk))) > 0)
+	{
+		g_gnss_rx_bytes += len;
+		for (uint8_t i = 0; i < len; i++)
+		{
+			// RMC comes before GGA, a GGA completes the fix
+			if (nmea_encode(chunk[i]) == NMEA_GGA)
+			{
+				gnss_rx_publish();
+			}
+		}
+	}
+	g_gnss_rx_parse_us += micros() - start;
+}
+
+/**
+ * @brief RAK1910 background task, parses the NMEA stream into gnss_rx_fix
+ *        The UART interrupt fills the Serial1 RX buffer, this task drains it
+ *        every GNSS_RX_PERIOD_MS and sleeps in between
+ * 
+ * @param pvParameters unused
+ */
+void gnss_rx_task(void *pvParameters)
+{
+	(void)pvParameters;
+
+	while (true)
+	{
+		gnss_rx_drain();
+		vTaskDelay(pdMS_TO_TICKS(GNSS_RX_PERIOD_MS));
+	}
+}
+
+/**
+ * @brief Get the newest RAK1910 fix, wait for one if there is no recent fix
+ * 
+ * @param fix Filled with the fix
+ * @param wait_ms Longest time to wait, 0 returns at once
+ * @return Is fix valid and not older than GNSS_FIX_MAX_AGE_MS (bool)
+ */
+bool gnss_rx_get(gnss_fix_s &fix, uint32_t wait_ms)
+{
+	uint32_t start = millis();
+	while (true)
+	{
+		taskENTER_CRITICAL();
+		fix = gnss_rx_fix;
+		taskEXIT_CRITICAL();
+		if (fix.valid && (millis() - fix.time) <= GNSS_FIX_MAX_AGE_MS)
+		{
+			break;
+		}
+
+		uint32_t waited = millis() - start;
+		if (gnss_rx_fix_sem == NULL || waited >= wait_ms)
+		{
+			fix.valid = false;
+			break;
+		}
+		// Sleeps until the task has a new fix
+		xSemaphoreTake(gnss_rx_fix_sem, pdMS_TO_TICKS(wait_ms - waited));
+	}
+	g_gnss_wait_ms += millis() - start;
+	return fix.valid;
+}
+
+/**
+ * @brief Satellites the RAK1910 sees, also without fix
+ * 
+ * @return Satellites in view (uint8_t)
+ */
+uint8_t gnss_rx_satellites(void)
+{
+	return gnss_rx_siv;
+}
+
+/**
+ * @brief RAK12500 NAV-PVT arrived, take the whole epoch at once
+ * 
+ * @param pvt NAV-PVT data
+ */
+void gnss_pvt_callback(UBX_NAV_PVT_data_t *pvt)
+{
+	gnss_pvt_siv = pvt->numSV;
+
+	gnss_fix_s fix;
+	fix.valid = pvt->flags.bits.gnssFixOK;
+	fix.lat = pvt->lat / 100;
+	fix.lon = pvt->lon / 100;
+	fix.alt = pvt->hMSL / 1000;
+	fix.hdop = gnss_pvt_hdop;
+	fix.speed = pvt->gSpeed > 0 ? pvt->gSpeed : 0;
+	fix.heading = (uint32_t)(pvt->headMot / 1000) % 36000;
+	fix.siv = pvt->numSV;
+	fix.time = millis();
+	if (pvt->valid.bits.validDate && pvt->valid.bits.validTime)
+	{
+		fix.epoch = gnss_epoch(pvt->year, pvt->month, pvt->day, pvt->hour, pvt->min, pvt->sec);
+	}
+	gnss_pvt_fix = fix;
+}
+
+/**
+ * @brief RAK12500 NAV-DOP arrived
+ * 
+ * @param dop NAV-DOP data
+ */
+void gnss_dop_callback(UBX_NAV_DOP_data_t *dop)
+{
+	gnss_pvt_hdop = dop->hDOP;
+	gnss_pvt_fix.hdop = dop->hDOP;
+}
+
+/**
+ * @brief Read what the RAK12500 has buffered and run the callbacks
+ * 
+ * @return Is there a valid fix not older than GNSS_FIX_MAX_AGE_MS (bool)
+ */
+bool gnss_pvt_update(void)
+{
+	g_gnss_i2c_polls++;
+	g_gnss_i2c_polls_beacon++;
+	if (i2c_acquire(I2C_DEV_GNSS))
+	{
+		my_rak12500_gnss.checkUblox();
+		i2c_release(I2C_DEV_GNSS);
+	}
+	// Callbacks only copy what checkUblox() buffered, no bus needed
+	my_rak12500_gnss.checkCallbacks();
+	return gnss_pvt_fix.valid && (millis() - gnss_pvt_fix.time) <= GNSS_FIX_MAX_AGE_MS;
+}
+
+/**
+ * @brief Satellites the RAK12500 sees, also without fix
+ * 
+ * @return Satellites in view (uint8_t)
+ */
+uint8_t gnss_pvt_satellites(void)
+{
+	return gnss_pvt_siv;
+}
+
+/**
+ * @brief Put the module in backup mode, RTC and ephemeris are kept
+ * 
+ * @param gnss_option RAK1910_GNSS or RAK12500_GNSS
+ * @param duration_ms Wake up after this long, 0 only wakes on UART activity
+ */
+void gnss_module_sleep(uint8_t gnss_option, uint32_t duration_ms)
+{
+	gnss_rx_first_fix = 0;
+	switch (gnss_option)
+	{
+	case RAK1910_GNSS:
+	{
+		// UBX-RXM-PMREQ, duration and flags, bit 1 is backup
+		uint8_t pmreq[8] = {(uint8_t)(duration_ms & 0xFF), (uint8_t)((duration_ms >> 8) & 0xFF),
+							(uint8_t)((duration_ms >> 16) & 0xFF), (uint8_t)(duration_ms >> 24),
+							0x02, 0x00, 0x00, 0x00};
+		gnss_ubx_send(0x02, 0x41, pmreq, sizeof(pmreq));
+		break;
+	}
+	case RAK12500_GNSS:
+		// I2C can't wake it, its UART RX is on Serial1 TX
+		if (i2c_acquire(I2C_DEV_GNSS))
+		{
+			my_rak12500_gnss.powerOffWithInterrupt(duration_ms, VAL_RXM_PMREQ_WAKEUPSOURCE_UARTRX);
+			i2c_release(I2C_DEV_GNSS);
+		}
+		break;
+	}
+}
+
+/**
+ * @brief Wake the module from backup mode and set it up again
+ * 
+ * @param gnss_option RAK1910_GNSS or RAK12500_GNSS
+ */
+void gnss_module_wake(uint8_t gnss_option)
+{
+	static bool uart_ready = false;
+	if (!uart_ready && gnss_option == RAK12500_GNSS)
+	{
+		Serial1.begin(9600);
+		uart_ready = true;
+	}
+
+	// Any edge on its RX wakes it, the bytes themselves are lost
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		Serial1.write(0xFF);
+	}
+	Serial1.flush();
+	delay(100);
+
+	if (gnss_option == RAK12500_GNSS)
+	{
+		gnss_rak12500_config();
+	}
+	else
+	{
+		gnss_rak1910_config();
+	}
+}
+
+/**
+ * @brief Time to first fix after the last wake up
+ * 
+ * @param gnss_option RAK1910_GNSS or RAK12500_GNSS
+ * @param woke_at millis() of the wake up
+ * @return Time to first fix in ms, 0 if unknown (uint32_t)
+ */
+uint32_t gnss_module_ttff(uint8_t gnss_option, uint32_t woke_at)
+{
+	if (gnss_option == RAK12500_GNSS)
+	{
+		// NAV-STATUS counts from the module start, that is the wake up
+		uint32_t ttff = 0;
+		if (i2c_acquire(I2C_DEV_GNSS))
+		{
+			if (my_rak12500_gnss.getNAVSTATUS())
+			{
+				ttff = my_rak12500_gnss.packetUBXNAVSTATUS->data.ttff;
+			}
+			i2c_release(I2C_DEV_GNSS);
+		}
+		return ttff;
+	}
+	uint32_t first_fix = gnss_rx_first_fix;
+	if (first_fix == 0 || (int32_t)(first_fix - woke_at) < 0)
+	{
+		return 0;
+	}
+	return first_fix - woke_at;
+}
+
 /**
  * @brief Check GNSS module for position
  * 
@@ -95,10 +558,11 @@ bool poll_gnss(uint8_t gnss_option)
 	int64_t longitude = 0;
 	int32_t altitude = 0;
 	int32_t accuracy = 0;
-	uint32_t polling_seconds;
-	uint32_t polling_miliseconds;
-
-	bool has_alt = false;
+	uint32_t speed = 0;
+	uint16_t heading = 0;
+	uint8_t siv = 0;
+	uint32_t epoch = 0;
+	gnss_fix_s rx_fix;
 
 	digitalWrite(LED_BUILTIN, HIGH);
 
@@ -106,133 +570,96 @@ bool poll_gnss(uint8_t gnss_option)
 	switch (gnss_option)
 	{
 	case RAK1910_GNSS:
-		MYLOG("GNSS", "Polling RAK1910");
-		if (g_ble_uart_is_connected)
-		{
-			g_ble_uart.print("Polling RAK1910\n");
-		}
+		APP_LOG("GNSS", "Polling RAK1910");
 
-		while ((millis() - time_out) < 10000)
+		// Newest fix from the background task, sleeps until one arrives
+		g_gnss_polls++;
+		if (gnss_rx_get(rx_fix, GNSS_POLL_WAIT_MS))
 		{
-			polling_miliseconds = millis() - time_out;
-
-			if ( (polling_miliseconds % 1000 == 0) && (polling_miliseconds / 1000 != polling_seconds)) 
-			{
-				polling_seconds = polling_miliseconds / 1000;
-				MYLOG("GNSS", "Polling elapsed time: %d s", polling_seconds);
-				if (g_ble_uart_is_connected)
-				{
-					g_ble_uart.printf("Polling elapsed time: %d s", polling_seconds);
-				}
-			} 
-
-			while (Serial1.available() > 0)
-			{
-				// if (my_rak1910_gnss.encode(ss.read()))
-				if (my_rak1910_gnss.encode(Serial1.read()))
-				{
-					digitalToggle(LED_BUILTIN);
-					if (my_rak1910_gnss.location.isUpdated() && my_rak1910_gnss.location.isValid())
-					{
-						has_pos = true;
-						latitude = my_rak1910_gnss.location.lat() * 100000;
-						longitude = my_rak1910_gnss.location.lng() * 100000;
-					}
-					else if (my_rak1910_gnss.altitude.isUpdated() && my_rak1910_gnss.altitude.isValid())
-					{
-						has_alt = true;
-						altitude = my_rak1910_gnss.altitude.meters();
-					}
-					else if (my_rak1910_gnss.hdop.isUpdated() && my_rak1910_gnss.hdop.isValid())
-					{
-						accuracy = my_rak1910_gnss.hdop.hdop() * 100;
-					}
-				}
-				if (has_pos && has_alt)
-				{
-					break;
-				}
-			}
-			if (has_pos && has_alt)
-			{
-				break;
-			}
+			has_pos = true;
+			latitude = rx_fix.lat;
+			longitude = rx_fix.lon;
+			altitude = rx_fix.alt;
+			accuracy = rx_fix.hdop;
+			speed = rx_fix.speed;
+			heading = rx_fix.heading;
+			siv = rx_fix.siv;
+			epoch = rx_fix.epoch;
 		}
+		APP_LOG("GNSS", "Waited %ldms, NMEA parse %ldus for %ld bytes", (long)(millis() - time_out), (long)g_gnss_rx_parse_us, (long)g_gnss_rx_bytes);
 		break;
 
 	case RAK12500_GNSS:
-		/** PR to base mapper (multi gnss try)
-		 * If we already have a fix, poll once
-		 */
-		if (my_rak12500_gnss.getGnssFixOk())
+		APP_LOG("GNSS", "Polling RAK12500");
+		g_gnss_polls++;
+		g_gnss_i2c_polls_beacon = 0;
+
+		// NAV-PVT comes once per epoch, check the buffer a few times per epoch until a fix shows
+		while (true)
 		{
-			MYLOG("GNSS", "Polling RAK12500 (Has fix)");
-			digitalToggle(LED_BUILTIN);
-			if (g_ble_uart_is_connected)
+			if (gnss_pvt_update())
 			{
-				g_ble_uart.print("Polling RAK12500 (Has fix)\n");
+				has_pos = true;
+				latitude = gnss_pvt_fix.lat;
+				longitude = gnss_pvt_fix.lon;
+				altitude = gnss_pvt_fix.alt;
+				accuracy = gnss_pvt_fix.hdop;
+				speed = gnss_pvt_fix.speed;
+				heading = gnss_pvt_fix.heading;
+				siv = gnss_pvt_fix.siv;
+				epoch = gnss_pvt_fix.epoch;
+				break;
 			}
-			latitude = my_rak12500_gnss.getLatitude() / 100;
-			longitude = my_rak12500_gnss.getLongitude() / 100;
-			altitude = my_rak12500_gnss.getAltitude() / 1000;
-			accuracy = my_rak12500_gnss.getHorizontalDOP();
-			has_pos = true;
-		} else {
-			/** We don't have a fix so lets poll the GNSS module multiple times 
-			 * Break us out of the loop when a fix happens but make sure we update GNSS info
-			*/
-			while ((millis() - time_out) < 10000)
+			if ((millis() - time_out) >= GNSS_POLL_WAIT_MS)
 			{
-				MYLOG("GNSS", "Polling RAK12500 (Multi try)");
-				digitalToggle(LED_BUILTIN);
-				if (g_ble_uart_is_connected)
-				{
-					g_ble_uart.print("Polling RAK12500 (Multi try)\n");
-				}
-				if (my_rak12500_gnss.getGnssFixOk())
-				{
-					MYLOG("GNSS", "Polling RAK12500 (Aquired fix)");
-					if (g_ble_uart_is_connected)
-					{
-						g_ble_uart.print("Polling RAK12500 (Aquired fix)\n");
-					}
-					latitude = my_rak12500_gnss.getLatitude() / 100;
-					longitude = my_rak12500_gnss.getLongitude() / 100;
-					altitude = my_rak12500_gnss.getAltitude() / 1000;
-					accuracy = my_rak12500_gnss.getHorizontalDOP();
-					has_pos = true;
-					break;
-				} 
+				break;
 			}
+			digitalToggle(LED_BUILTIN);
+			delay(GNSS_PVT_POLL_MS);
 		}
+		APP_LOG("GNSS", "Waited %ldms, %ld I2C reads", (long)(millis() - time_out), (long)g_gnss_i2c_polls_beacon);
 		break;
 
 	default:
-		MYLOG("GNSS", "No valid gnss_option provided");
-		if (g_ble_uart_is_connected)
-		{
-			g_ble_uart.print("No valid gnss_option provided\n");
-		}
+		APP_LOG("GNSS", "No valid gnss_option provided");
 	}
 
 	digitalWrite(LED_BUILTIN, LOW);
+
+	g_gnss_decision_ms = millis() - time_out;
+	g_gnss_decision_ms_total += g_gnss_decision_ms;
+	g_gnss_decision_ms_max = max(g_gnss_decision_ms_max, g_gnss_decision_ms);
+	if (!has_pos)
+	{
+		g_gnss_poll_timeouts++;
+	}
+	else if (g_gnss_first_fix_ms == 0)
+	{
+		g_gnss_first_fix_ms = millis();
+	}
+	APP_LOG("GNSS", "Decision %ldms, %ld of %ld polls timed out, %ld zero packets", (long)g_gnss_decision_ms, (long)g_gnss_poll_timeouts, (long)g_gnss_polls, (long)g_zero_packets);
 	delay(10);
 
 	if (has_pos)
 	{
-		MYLOG("GNSS", "Lat: %.4fº Lon: %.4fº", latitude / 100000.0, longitude / 100000.0);
-		MYLOG("GNSS", "Alt: %d m", altitude);
-		MYLOG("GNSS", "Acy: %.2f ", accuracy / 100.0);
+		APP_LOG("GNSS", "Lat: %.4fº Lon: %.4fº", latitude / 100000.0, longitude / 100000.0);
+		APP_LOG("GNSS", "Alt: %d m", altitude);
+		APP_LOG("GNSS", "Acy: %.2f", accuracy / 100.0);
 
 		/** Hook for Field Tester */
 		ftester_setGPSData(latitude, longitude);
 
-		if (g_ble_uart_is_connected)
-		{
-			g_ble_uart.printf("Lat: %.4fº Lon: %.4fº\n", latitude / 100000.0, longitude / 100000.0);
-			g_ble_uart.printf("Alt: %d m\n", altitude);
-			g_ble_uart.printf("Acy: %.2f\n", accuracy / 100.0);
-		}
+		g_last_fix.lat = latitude;
+		g_last_fix.lon = longitude;
+		g_last_fix.alt = altitude;
+		g_last_fix.hdop = accuracy;
+		g_last_fix.speed = speed;
+		g_last_fix.heading = heading % 36000;
+		g_last_fix.siv = siv;
+		g_last_fix.time = millis();
+		g_last_fix.epoch = epoch;
+		g_last_fix.valid = true;
+
 		pos_union.val32 = latitude;
 		g_mapper_data.lat_1 = pos_union.val8[0];
 		g_mapper_data.lat_2 = pos_union.val8[1];
@@ -253,10 +680,6 @@ bool poll_gnss(uint8_t gnss_option)
 		g_mapper_data.acy_1 = pos_union.val8[0];
 		g_mapper_data.acy_2 = pos_union.val8[1];
 	}
-	else
-	{
-		delay(1000);
-	}
 
 	if (has_pos)
 	{
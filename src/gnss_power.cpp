@@ -0,0 +1,262 @@
+/**
+ * @file gnss_power.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Puts the GNSS module to sleep between beacons, wakes it early enough for a fix
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * WB_IO2 also powers the other sensor slots, so the module is not cut off.
+ * It is sent to u-blox backup mode instead (UBX-RXM-PMREQ), RTC and
+ * ephemeris are kept, it wakes by itself after the requested time or on
+ * UART activity.
+ *
+ * After a beacon the module sleeps until the lead time before the next
+ * timer beacon. The lead time is the slowest of the last GNSS_TTFF_HISTORY
+ * time to first fix values of the same start type, plus a margin:
+ *   cold  First fix after boot, nothing known
+ *   warm  Slept longer than GNSS_HOT_OFF_MS, ephemeris is outdated
+ *   hot   Slept shorter
+ * An accelerometer beacon while the module sleeps wakes it at once.
+ * The module only sleeps once it has a fix, or after GNSS_ACQUIRE_MAX_MS
+ * without one, so it gets to download ephemeris.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Shortest sleep worth the wake up */
+#ifndef GNSS_SLEEP_MIN_MS
+#define GNSS_SLEEP_MIN_MS 30000
+#endif
+/** Sleep anyway if there is no fix after this long */
+#define GNSS_ACQUIRE_MAX_MS 300000
+/** Sleeps longer than this end in a warm start */
+#define GNSS_HOT_OFF_MS 7200000
+/** Added to the learned time to first fix */
+#define GNSS_LEAD_MARGIN_MS 2000
+/** Time to first fix values kept per start type */
+#define GNSS_TTFF_HISTORY 4
+
+/** Start types */
+#define GNSS_START_HOT 0
+#define GNSS_START_WARM 1
+#define GNSS_START_COLD 2
+#define GNSS_STARTS 3
+
+/** Until there is history, typical u-blox values */
+static const uint32_t ttffDefault[GNSS_STARTS] = {5000, 30000, 60000};
+static const char *startNames[GNSS_STARTS] = {"hot", "warm", "cold"};
+static const char *stateNames[GNSS_PWR_STATES] = {"acquire", "track", "sleep"};
+
+static uint32_t ttffHistory[GNSS_STARTS][GNSS_TTFF_HISTORY];
+static uint8_t ttffCount[GNSS_STARTS];
+static uint8_t ttffNext[GNSS_STARTS];
+
+static uint8_t gnssOption = 0;
+static uint8_t state = GNSS_PWR_ACQUIRE;
+static uint32_t stateSince = 0;
+/** Start type and time of the current wake up */
+static uint8_t startType = GNSS_START_COLD;
+static uint32_t wokeAt = 0;
+/** Sleep start and planned length, 0 is until woken */
+static uint32_t sleepAt = 0;
+static uint32_t sleepFor = 0;
+/** Module needs the wake up and its settings again */
+static bool slept = false;
+
+/** Time spent per state, ms */
+uint32_t g_gnss_power_ms[GNSS_PWR_STATES] = {0};
+uint32_t g_gnss_sleeps = 0;
+uint32_t g_gnss_early_wakes = 0;
+uint32_t g_gnss_ttff_last = 0;
+
+/**
+ * @brief Book the time of the current state and switch
+ *
+ * @param next New state
+ * @param now millis() of the switch
+ */
+static void setState(uint8_t next, uint32_t now)
+{
+    g_gnss_power_ms[state] += now - stateSince;
+    stateSince = now;
+    state = next;
+}
+
+/**
+ * @brief A timed sleep that is over ends at its wake up time
+ *
+ */
+static void updateState(void)
+{
+    if(state == GNSS_PWR_SLEEP && sleepFor != 0 && (millis() - sleepAt) >= sleepFor)
+    {
+        wokeAt = sleepAt + sleepFor;
+        setState(GNSS_PWR_ACQUIRE, wokeAt);
+    }
+}
+
+/**
+ * @brief Time the module needs for a fix, plus margin
+ *
+ * @param type Start type
+ * @return uint32_t Lead time in ms
+ */
+static uint32_t leadTime(uint8_t type)
+{
+    uint32_t slowest = ttffDefault[type];
+    if(ttffCount[type] != 0)
+    {
+        slowest = 0;
+        for(uint8_t i = 0; i < ttffCount[type]; i++)
+        {
+            slowest = max(slowest, ttffHistory[type][i]);
+        }
+    }
+    return slowest + GNSS_LEAD_MARGIN_MS;
+}
+
+/**
+ * @brief Start the power manager, the module is on
+ *
+ * @param gnss_option RAK1910_GNSS or RAK12500_GNSS from init_gnss()
+ */
+void gnss_power_init(uint8_t gnss_option)
+{
+    gnssOption = gnss_option;
+    state = GNSS_PWR_ACQUIRE;
+    stateSince = millis();
+    wokeAt = stateSince;
+    startType = GNSS_START_COLD;
+}
+
+/**
+ * @brief Module must be on for a poll, call before poll_gnss()
+ *
+ */
+void gnss_power_wake(void)
+{
+    updateState();
+    if(state == GNSS_PWR_SLEEP)
+    {
+        /** Woken before its time, the start type follows the real sleep time */
+        wokeAt = millis();
+        if(startType != GNSS_START_COLD)
+        {
+            startType = (wokeAt - sleepAt) <= GNSS_HOT_OFF_MS ? GNSS_START_HOT : GNSS_START_WARM;
+        }
+        setState(GNSS_PWR_ACQUIRE, wokeAt);
+        g_gnss_early_wakes++;
+    }
+    if(!slept)
+    {
+        return;
+    }
+    /** The UART wake up is harmless if it woke up by itself, settings are lost in backup mode */
+    gnss_module_wake(gnssOption);
+    slept = false;
+}
+
+/**
+ * @brief Result of poll_gnss(), learns the time to first fix
+ *
+ * @param fix Poll found a fix
+ */
+void gnss_power_fix(bool fix)
+{
+    updateState();
+    if(!fix || state != GNSS_PWR_ACQUIRE)
+    {
+        return;
+    }
+
+    uint32_t ttff = gnss_module_ttff(gnssOption, wokeAt);
+    if(ttff == 0)
+    {
+        /** Module didn't say, the fix came before now */
+        ttff = millis() - wokeAt;
+    }
+    g_gnss_ttff_last = ttff;
+    ttffHistory[startType][ttffNext[startType]] = ttff;
+    ttffNext[startType] = (ttffNext[startType] + 1) % GNSS_TTFF_HISTORY;
+    ttffCount[startType] = min(ttffCount[startType] + 1, GNSS_TTFF_HISTORY);
+    /** It was tracking since the fix, not since the poll */
+    setState(GNSS_PWR_TRACK, min(wokeAt + ttff, millis()));
+    MYLOG("GPWR", "%s start, fix after %ldms, lead now %ldms", startNames[startType], (long)ttff, (long)leadTime(startType));
+}
+
+/**
+ * @brief Beacon is done, sleep until the lead time before the next one
+ *
+ * @param next_poll_ms Time to the next timer beacon, 0 if there is no timer
+ */
+void gnss_power_sleep(uint32_t next_poll_ms)
+{
+    if(GNSS_POWER_SAVE == 0 || gnss_trace_replaying())
+    {
+        return;
+    }
+    updateState();
+    uint32_t now = millis();
+    if(state == GNSS_PWR_SLEEP)
+    {
+        return;
+    }
+    if(state == GNSS_PWR_ACQUIRE && (now - wokeAt) < GNSS_ACQUIRE_MAX_MS)
+    {
+        /** Let it finish, a sleep now means a cold start again */
+        return;
+    }
+
+    uint32_t duration = 0;
+    uint8_t nextStart = GNSS_START_WARM;
+    if(next_poll_ms != 0)
+    {
+        uint32_t lead = leadTime(GNSS_START_HOT);
+        if(next_poll_ms > GNSS_HOT_OFF_MS + lead)
+        {
+            lead = leadTime(GNSS_START_WARM);
+        }
+        if(next_poll_ms < lead + GNSS_SLEEP_MIN_MS)
+        {
+            return;
+        }
+        duration = next_poll_ms - lead;
+    }
+    if(duration != 0 && duration <= GNSS_HOT_OFF_MS)
+    {
+        nextStart = GNSS_START_HOT;
+    }
+    /** Without a fix in this wake up the module knows no more than at boot */
+    if(state == GNSS_PWR_ACQUIRE && startType == GNSS_START_COLD)
+    {
+        nextStart = GNSS_START_COLD;
+    }
+
+    gnss_module_sleep(gnssOption, duration);
+    startType = nextStart;
+    sleepAt = now;
+    sleepFor = duration;
+    slept = true;
+    setState(GNSS_PWR_SLEEP, now);
+    g_gnss_sleeps++;
+    MYLOG("GPWR", "Sleep %ldms, then %s start", (long)duration, startNames[startType]);
+}
+
+/**
+ * @brief Time per state so far, acquire/track/sleep
+ *
+ */
+void gnss_power_report(void)
+{
+    updateState();
+    uint32_t now = millis();
+    uint32_t ms[GNSS_PWR_STATES];
+    for(uint8_t i = 0; i < GNSS_PWR_STATES; i++)
+    {
+        ms[i] = g_gnss_power_ms[i] + (i == state ? now - stateSince : 0);
+    }
+    APP_LOG("GPWR", "GNSS %s, acquiring %lds, tracking %lds, asleep %lds", stateNames[state], (long)(ms[GNSS_PWR_ACQUIRE] / 1000), (long)(ms[GNSS_PWR_TRACK] / 1000), (long)(ms[GNSS_PWR_SLEEP] / 1000));
+}
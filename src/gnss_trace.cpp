@@ -0,0 +1,210 @@
+/**
+ * @file gnss_trace.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Record the RAK1910 NMEA stream to flash and replay it instead of the module
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Build with -DGNSS_RECORD=1 and drive the route once: everything the
+ * RAK1910 sends is written to /gnss.trc with its timing. Build with
+ * -DGNSS_REPLAY=1 and gnss_rx_task() gets the recorded bytes at the
+ * recorded times instead of Serial1, so poll_gnss(), ftester_gps_fix() and
+ * the zero packet logic see the same cold start, fix loss or tunnel again
+ * and again at the desk. The trace is played in a loop.
+ *
+ * Trace: chunks of [ms since previous chunk u16][len u8][len bytes of NMEA]
+ * The internal FS is only 28k, the trace takes the session log's blocks
+ * (see the budget in app.h): recording clears the log first, and stops at
+ * GNSS_TRACE_MAX or when a write comes up short. Chunks are written
+ * GNSS_TRACE_BATCH bytes at a time, the last few seconds before a power
+ * off are not in the trace.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Chunks are collected in RAM and written in one go */
+#define GNSS_TRACE_BATCH 256
+#define GNSS_TRACE_HEADER 3
+
+static const char traceName[] = "/gnss.trc";
+
+/** Recording */
+static uint8_t batch[GNSS_TRACE_BATCH];
+static uint16_t batchLen = 0;
+static uint32_t lastChunk = 0;
+static uint32_t traceSize = 0;
+static bool recording = false;
+
+/** Replay */
+static File traceFile(InternalFS);
+static bool replaying = false;
+static uint8_t nextHeader[GNSS_TRACE_HEADER];
+static bool haveNext = false;
+static uint32_t nextDue = 0;
+
+/** Stats */
+uint32_t g_gnss_trace_bytes = 0;
+uint32_t g_gnss_replay_loops = 0;
+
+/**
+ * @brief Open the trace for the mode selected at build time
+ *
+ * @return true Replay is on, there is no need for a module
+ */
+bool gnss_trace_init(void)
+{
+    if(GNSS_RECORD == 0 && GNSS_REPLAY == 0)
+    {
+        return false;
+    }
+    InternalFS.begin();
+
+    if(GNSS_REPLAY > 0)
+    {
+        replaying = traceFile.open(traceName, FILE_O_READ);
+        if(!replaying)
+        {
+            MYLOG("TRC", "No %s to replay, using the module", traceName);
+            return false;
+        }
+        MYLOG("TRC", "Replaying %ld bytes of NMEA", (long)traceFile.size());
+        nextDue = millis();
+        return true;
+    }
+
+    /** New recording every boot */
+    InternalFS.remove(traceName);
+    session_log_clear();
+    recording = true;
+    lastChunk = millis();
+    MYLOG("TRC", "Recording NMEA to %s", traceName);
+    return false;
+}
+
+/**
+ * @brief Write the collected chunks
+ *
+ */
+static void writeBatch(void)
+{
+    if(batchLen == 0)
+    {
+        return;
+    }
+    File file(InternalFS);
+    size_t written = 0;
+    if(file.open(traceName, FILE_O_WRITE))
+    {
+        written = file.write(batch, batchLen);
+        file.close();
+    }
+    traceSize += written;
+    if(written != batchLen)
+    {
+        /** Flash is full, a cut last chunk is dropped by the decoder */
+        recording = false;
+        MYLOG("TRC", "Can't write %s, trace stopped at %ld bytes", traceName, (long)traceSize);
+    }
+    batchLen = 0;
+}
+
+/**
+ * @brief Add what was just read from the module, called from gnss_rx_task()
+ *
+ * @param data Bytes from Serial1
+ * @param len Number of bytes, at most GNSS_TRACE_CHUNK
+ */
+void gnss_trace_record(const uint8_t *data, uint8_t len)
+{
+    if(!recording || len == 0)
+    {
+        return;
+    }
+    if(traceSize + batchLen + GNSS_TRACE_HEADER + len > GNSS_TRACE_MAX)
+    {
+        writeBatch();
+        recording = false;
+        MYLOG("TRC", "Trace full at %ld bytes", (long)traceSize);
+        return;
+    }
+    if(batchLen + GNSS_TRACE_HEADER + len > GNSS_TRACE_BATCH)
+    {
+        writeBatch();
+        if(!recording)
+        {
+            return;
+        }
+    }
+
+    uint32_t now = millis();
+    uint16_t delta = min(now - lastChunk, (uint32_t)0xFFFF);
+    lastChunk = now;
+    batch[batchLen++] = delta & 0xFF;
+    batch[batchLen++] = delta >> 8;
+    batch[batchLen++] = len;
+    memcpy(&batch[batchLen], data, len);
+    batchLen += len;
+    g_gnss_trace_bytes += len;
+}
+
+/**
+ * @brief Bytes of the trace that are due by now, called from gnss_rx_task()
+ *
+ * @param buf Output, at least GNSS_TRACE_CHUNK bytes
+ * @param size Size of buf
+ * @return uint8_t Number of bytes, 0 if nothing is due yet
+ */
+uint8_t gnss_trace_read(uint8_t *buf, uint8_t size)
+{
+    if(!replaying)
+    {
+        return 0;
+    }
+    if(!haveNext)
+    {
+        if(traceFile.read(nextHeader, GNSS_TRACE_HEADER) != GNSS_TRACE_HEADER)
+        {
+            /** End of the trace, start over */
+            g_gnss_replay_loops++;
+            traceFile.seek(0);
+            if(traceFile.read(nextHeader, GNSS_TRACE_HEADER) != GNSS_TRACE_HEADER)
+            {
+                replaying = false;
+                return 0;
+            }
+        }
+        nextDue += nextHeader[0] | (nextHeader[1] << 8);
+        haveNext = true;
+    }
+    if((int32_t)(millis() - nextDue) < 0)
+    {
+        return 0;
+    }
+
+    haveNext = false;
+    uint8_t len = nextHeader[2];
+    uint8_t got = traceFile.read(buf, min(len, size));
+    if(len > got)
+    {
+        /** Only with a trace from a bigger GNSS_TRACE_CHUNK */
+        traceFile.seek(traceFile.position() + len - got);
+    }
+    g_gnss_trace_bytes += got;
+    return got;
+}
+
+/**
+ * @brief Is the module replaced by the trace
+ *
+ */
+bool gnss_trace_replaying(void)
+{
+    return replaying;
+}
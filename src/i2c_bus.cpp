@@ -0,0 +1,221 @@
+/**
+ * @file i2c_bus.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Arbitrate the shared I2C bus between the OLED, RAK12500 and LIS3DH
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * All three devices hang on Wire. Every transaction is wrapped in
+ * i2c_acquire() / i2c_release(), only one device owns the bus at a time.
+ * Timer callbacks never wait for the bus, that would hold up every other
+ * timer, they set an event (DISPLAY_REFRESH, DISPLAY_POWER) and the app
+ * task does the bus work.
+ *
+ * Sensors go first. The RAK12500 and LIS3DH have the same priority and wait
+ * in line for the bus. The OLED only takes the bus while no sensor is
+ * waiting, and oled_flush() sends the frame one tile row (128 bytes) at a
+ * time with i2c_yield() in between, so a sensor waits at most one row
+ * instead of a whole 1KB frame.
+ *
+ * Calls nest, a task that owns the bus can acquire it again (the GNSS init
+ * writes to the display through ftester_SetGPSType()).
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Give up waiting for the bus, saveConfigSelective() can hold it ~1s */
+#ifndef I2C_WAIT_MAX_MS
+#define I2C_WAIT_MAX_MS 1500
+#endif
+
+/** Higher is served first */
+#define I2C_PRIO_DISPLAY 0
+#define I2C_PRIO_SENSOR 1
+static const uint8_t devPrio[I2C_DEV_COUNT] = {I2C_PRIO_SENSOR, I2C_PRIO_SENSOR, I2C_PRIO_DISPLAY};
+static const char *devNames[I2C_DEV_COUNT] = {"ACC", "GNSS", "OLED"};
+
+static SemaphoreHandle_t busLock = nullptr;
+/** Task that owns the bus and how often it acquired it */
+static TaskHandle_t owner = nullptr;
+static uint8_t ownerDepth = 0;
+static uint8_t ownerDev = 0;
+static uint32_t ownedSince = 0;
+/** Tasks waiting for the bus per device */
+static volatile uint8_t waiting[I2C_DEV_COUNT] = {0};
+/** Busy time not yet counted in whole ms */
+static uint32_t busyRestUs[I2C_DEV_COUNT] = {0};
+
+/** Bus stats per device */
+i2c_bus_stats_s g_i2c_stats[I2C_DEV_COUNT];
+
+/**
+ * @brief Create the bus lock, before the first device is initialized
+ *
+ */
+void i2c_bus_init(void)
+{
+    if(busLock == nullptr)
+    {
+        busLock = xSemaphoreCreateMutex();
+    }
+}
+
+/**
+ * @brief Is a device with a higher priority waiting for the bus
+ *
+ */
+static bool higherWaiting(uint8_t dev)
+{
+    for(uint8_t i = 0; i < I2C_DEV_COUNT; i++)
+    {
+        if(devPrio[i] > devPrio[dev] && waiting[i] != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Count a waiting task
+ *
+ */
+static void setWaiting(uint8_t dev, bool wait)
+{
+    taskENTER_CRITICAL();
+    if(wait)
+    {
+        waiting[dev]++;
+    } else {
+        waiting[dev]--;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Wait for the bus
+ *
+ * @param dev I2C_DEV_ACC, I2C_DEV_GNSS or I2C_DEV_OLED
+ * @return true Bus is owned until i2c_release()
+ * @return false Timed out, skip the transaction
+ */
+bool i2c_acquire(uint8_t dev)
+{
+    if(busLock == nullptr)
+    {
+        return true;
+    }
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if(owner == self)
+    {
+        ownerDepth++;
+        return true;
+    }
+
+    uint32_t start = micros();
+    uint32_t startMs = millis();
+    bool owned = false;
+    setWaiting(dev, true);
+    uint32_t waitedMs;
+    while(!owned && (waitedMs = millis() - startMs) < I2C_WAIT_MAX_MS)
+    {
+        if(higherWaiting(dev))
+        {
+            /** Don't race the sensor for the lock it is about to get */
+            delay(1);
+            continue;
+        }
+        /** Sensors wait in line, the display checks for sensors every tick */
+        uint32_t slice = devPrio[dev] == I2C_PRIO_SENSOR ? I2C_WAIT_MAX_MS - waitedMs : 1;
+        if(xSemaphoreTake(busLock, pdMS_TO_TICKS(slice)) != pdTRUE)
+        {
+            continue;
+        }
+        if(higherWaiting(dev))
+        {
+            /** A sensor showed up while we got the lock */
+            xSemaphoreGive(busLock);
+            continue;
+        }
+        owned = true;
+    }
+    setWaiting(dev, false);
+
+    i2c_bus_stats_s &stats = g_i2c_stats[dev];
+    uint32_t waited = micros() - start;
+    stats.wait_us_total += waited;
+    stats.wait_us_max = max(stats.wait_us_max, waited);
+    if(!owned)
+    {
+        stats.timeouts++;
+        MYLOG("I2C", "%s timed out waiting for the bus", devNames[dev]);
+        return false;
+    }
+    stats.transactions++;
+    owner = self;
+    ownerDepth = 1;
+    ownerDev = dev;
+    ownedSince = micros();
+    return true;
+}
+
+/**
+ * @brief Done with the bus
+ *
+ * @param dev Device passed to i2c_acquire()
+ */
+void i2c_release(uint8_t dev)
+{
+    if(busLock == nullptr || owner != xTaskGetCurrentTaskHandle())
+    {
+        return;
+    }
+    if(--ownerDepth != 0)
+    {
+        return;
+    }
+    i2c_bus_stats_s &stats = g_i2c_stats[ownerDev];
+    busyRestUs[ownerDev] += micros() - ownedSince;
+    stats.busy_ms += busyRestUs[ownerDev] / 1000;
+    busyRestUs[ownerDev] %= 1000;
+    owner = nullptr;
+    xSemaphoreGive(busLock);
+}
+
+/**
+ * @brief Let a waiting sensor in between two chunks of a bulk transfer
+ *
+ * @param dev Device that owns the bus
+ * @return true Bus is owned again
+ * @return false Timed out getting it back, stop the transfer
+ */
+bool i2c_yield(uint8_t dev)
+{
+    if(busLock == nullptr || ownerDepth != 1 || !higherWaiting(dev))
+    {
+        return true;
+    }
+    g_i2c_stats[dev].preempted++;
+    i2c_release(dev);
+    return i2c_acquire(dev);
+}
+
+/**
+ * @brief Log bus occupancy and wait times per device
+ *
+ */
+void i2c_bus_report(void)
+{
+    uint32_t up = max(millis(), (uint32_t)1);
+    for(uint8_t i = 0; i < I2C_DEV_COUNT; i++)
+    {
+        i2c_bus_stats_s &stats = g_i2c_stats[i];
+        uint32_t waitAvg = stats.transactions ? stats.wait_us_total / stats.transactions : 0;
+        APP_LOG("I2C", "%s busy %ldms (%ld.%ld%%)", devNames[i], (long)stats.busy_ms, (long)((uint64_t)stats.busy_ms * 100 / up), (long)((uint64_t)stats.busy_ms * 1000 / up % 10));
+        APP_LOG("I2C", "%s %ld transactions, wait avg %ldus max %ldus", devNames[i], (long)stats.transactions, (long)waitAvg, (long)stats.wait_us_max);
+        APP_LOG("I2C", "%s %ld preempted, %ld timeouts", devNames[i], (long)stats.preempted, (long)stats.timeouts);
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @file line_assembler.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Splits a byte stream into text lines, lines can span several reads
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef LINE_ASSEMBLER_H
+#define LINE_ASSEMBLER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Line assembler on a char[N]
+ * '\r', '\n' and "\r\n" end a line, empty lines are skipped.
+ * A line longer than N-1 characters is dropped up to its line end.
+ *
+ * @tparam N Buffer size including the NULL terminator
+ */
+template <uint16_t N>
+class LineAssembler
+{
+public:
+    /**
+     * @brief Add one received byte
+     *
+     * @param c Byte
+     * @return true A line is complete, read it with line() before the next push()
+     */
+    bool push(uint8_t c)
+    {
+        if(_ready)
+        {
+            _len = 0;
+            _ready = false;
+        }
+        if(c == '\r' || c == '\n')
+        {
+            return finish();
+        }
+        if(_overflow)
+        {
+            return false;
+        }
+        if(_len >= N - 1)
+        {
+            _overflow = true;
+            return false;
+        }
+        _buf[_len++] = c;
+        return false;
+    }
+
+    /**
+     * @brief End the current line without a line end, i.e. after an idle time
+     *
+     * @return true A line is complete
+     */
+    bool flush(void)
+    {
+        if(_ready)
+        {
+            _len = 0;
+            _ready = false;
+        }
+        return finish();
+    }
+
+    /** Characters waiting for a line end */
+    bool pending(void) const { return !_ready && (_len != 0 || _overflow); }
+    const char *line(void) const { return _buf; }
+    uint16_t length(void) const { return _len; }
+    /** Lines dropped because they didn't fit */
+    uint32_t overflows(void) const { return _overflows; }
+
+private:
+    bool finish(void)
+    {
+        if(_overflow)
+        {
+            _overflow = false;
+            _len = 0;
+            _overflows++;
+            return false;
+        }
+        if(_len == 0)
+        {
+            return false;
+        }
+        _buf[_len] = '\0';
+        _ready = true;
+        return true;
+    }
+
+    char _buf[N];
+    uint16_t _len = 0;
+    bool _ready = false;
+    bool _overflow = false;
+    uint32_t _overflows = 0;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file line_buffer.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Fixed size ring buffer of text lines, no heap allocation
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef LINE_BUFFER_H
+#define LINE_BUFFER_H
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Ring buffer of LINES lines, each up to COLS characters
+ * Once full, pushing a line drops the oldest one in O(1).
+ * Lines longer than COLS are cut and end with ".."
+ *
+ * @tparam LINES Number of lines kept
+ * @tparam COLS Max characters per line
+ */
+template <uint8_t LINES, uint8_t COLS>
+class LineBuffer
+{
+public:
+    /**
+     * @brief Add a line, dropping the oldest if full
+     *
+     * @param s NULL terminated text
+     */
+    void push(const char *s)
+    {
+        uint8_t slot;
+        if(_count < LINES)
+        {
+            slot = (_head + _count) % LINES;
+            _count++;
+        } else {
+            /** Overwrite oldest line */
+            slot = _head;
+            _head = (_head + 1) % LINES;
+        }
+
+        char *line = _lines[slot];
+        size_t len = strnlen(s, COLS + 1);
+        if(len <= COLS)
+        {
+            memcpy(line, s, len);
+            line[len] = '\0';
+        } else {
+            /** If text too long, cut and show there is more */
+            memcpy(line, s, COLS - 2);
+            line[COLS - 2] = '.';
+            line[COLS - 1] = '.';
+            line[COLS] = '\0';
+        }
+    }
+
+    /**
+     * @brief Line by age
+     *
+     * @param idx 0 is the oldest line
+     * @return const char* Line text
+     */
+    const char *operator[](uint8_t idx) const
+    {
+        return _lines[(_head + idx) % LINES];
+    }
+
+    uint8_t size(void) const { return _count; }
+
+    void clear(void)
+    {
+        _head = 0;
+        _count = 0;
+    }
+
+private:
+    char _lines[LINES][COLS + 1] = {{0}};
+    /** Index of the oldest line */
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+};
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * @file log_sink.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Deferred log records, drained to USB serial and BLE by a low priority task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Callers copy tag, format pointer and raw arguments into a ring of
+ * LOG_RING_SIZE records and return, there is no formatting and no I/O on
+ * the calling task. The ring is a bounded multi producer / single consumer
+ * queue (sequence number per slot), so the app task, timer callbacks and
+ * interrupts can log without a lock. A full ring drops the record and
+ * counts it, the log task reports the drops with the next line.
+ * Records are only formatted if a sink is attached: USB serial with
+ * MY_DEBUG, BLE UART while connected and no export is running.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Records in the ring, power of 2 */
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64
+#endif
+/** Longest formatted line */
+#define LOG_LINE_MAX 128
+
+/** One queued log line
+ *  seq + slot index is the ring position the slot is ready for, so the
+ *  zeroed ring is valid before log_init() runs */
+struct log_record_s
+{
+    uint32_t seq;
+    const char *tag;
+    const char *fmt;
+    log_arg_u args[LOG_MAX_ARGS];
+    uint8_t count;
+    uint8_t sinks;
+};
+
+static log_record_s ring[LOG_RING_SIZE];
+static uint32_t ringHead = 0;
+static uint32_t ringTail = 0;
+static TaskHandle_t logTaskHandle = NULL;
+
+/** Stats */
+uint32_t g_log_records = 0;
+uint32_t g_log_dropped = 0;
+static uint32_t reportedDrops = 0;
+
+/**
+ * @brief Queue a record, see app_log()
+ *
+ */
+void log_push(uint8_t sinks, const char *tag, const char *fmt, const log_arg_u *args, uint8_t count)
+{
+    /** Claim a slot, the slot sequence says if it is free for this position */
+    uint32_t pos = __atomic_load_n(&ringHead, __ATOMIC_RELAXED);
+    uint32_t slot;
+    log_record_s *rec;
+    while(true)
+    {
+        slot = pos & (LOG_RING_SIZE - 1);
+        rec = &ring[slot];
+        int32_t diff = (int32_t)(__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) + slot - pos);
+        if(diff == 0)
+        {
+            if(__atomic_compare_exchange_n(&ringHead, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        } else if(diff < 0) {
+            /** Full, the log task is behind */
+            __atomic_fetch_add(&g_log_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&ringHead, __ATOMIC_RELAXED);
+        }
+    }
+
+    rec->tag = tag;
+    rec->fmt = fmt;
+    rec->sinks = sinks;
+    rec->count = count;
+    for(uint8_t i = 0; i < count; i++)
+    {
+        rec->args[i] = args[i];
+    }
+    __atomic_store_n(&rec->seq, pos + 1 - slot, __ATOMIC_RELEASE);
+
+    if(logTaskHandle != NULL)
+    {
+        if((SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0)
+        {
+            vTaskNotifyGiveFromISR(logTaskHandle, NULL);
+        } else {
+            xTaskNotifyGive(logTaskHandle);
+        }
+    }
+}
+
+/**
+ * @brief Format a record, one conversion at a time
+ *
+ * @param rec Record
+ * @param line Output
+ * @param size Size of output
+ * @return uint16_t Length of the text
+ */
+static uint16_t formatRecord(const log_record_s &rec, char *line, uint16_t size)
+{
+    uint16_t len = 0;
+    uint8_t arg = 0;
+    const char *p = rec.fmt;
+    while(*p != '\0' && len < size - 1)
+    {
+        if(*p != '%')
+        {
+            line[len++] = *p++;
+            continue;
+        }
+        if(p[1] == '%')
+        {
+            line[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        /** Copy flags, width and precision, drop length modifiers, arguments are 32 bit */
+        char spec[12];
+        uint8_t specLen = 0;
+        spec[specLen++] = *p++;
+        while(*p != '\0' && strchr("-+ #0123456789.lhzjt", *p) != nullptr)
+        {
+            if(strchr("lhzjt", *p) == nullptr && specLen < sizeof(spec) - 2)
+            {
+                spec[specLen++] = *p;
+            }
+            p++;
+        }
+        if(*p == '\0')
+        {
+            break;
+        }
+        char conv = *p++;
+        spec[specLen++] = conv;
+        spec[specLen] = '\0';
+
+        if(arg >= rec.count)
+        {
+            continue;
+        }
+        log_arg_u value = rec.args[arg++];
+        int written;
+        switch(conv)
+        {
+        case 'f':
+        case 'e':
+        case 'g':
+            written = snprintf(&line[len], size - len, spec, (double)value.f);
+            break;
+        case 's':
+            written = snprintf(&line[len], size - len, spec, value.s != nullptr ? value.s : "(null)");
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+            written = snprintf(&line[len], size - len, spec, (unsigned int)value.i);
+            break;
+        default:
+            written = snprintf(&line[len], size - len, spec, (int)value.i);
+            break;
+        }
+        if(written > 0)
+        {
+            len = min(len + written, size - 1);
+        }
+    }
+    line[len] = '\0';
+    return len;
+}
+
+/**
+ * @brief Send one line to the attached sinks
+ *
+ */
+static void writeLine(uint8_t sinks, const char *tag, const char *text, uint16_t len)
+{
+#if MY_DEBUG > 0
+    if((sinks & LOG_SERIAL) && Serial)
+    {
+        if(tag != nullptr)
+        {
+            Serial.printf("[%s] ", tag);
+        }
+        Serial.write(text, len);
+        Serial.write('\n');
+    }
+#endif
+    if((sinks & LOG_BLE) && g_ble_uart_is_connected && !ble_export_active())
+    {
+        /** BLE lines had no tag */
+        g_ble_uart.write((const uint8_t *)text, len);
+        g_ble_uart.write('\n');
+    }
+}
+
+/**
+ * @brief Is anyone listening for these sinks
+ *
+ */
+static bool sinkAttached(uint8_t sinks)
+{
+#if MY_DEBUG > 0
+    if((sinks & LOG_SERIAL) && Serial)
+    {
+        return true;
+    }
+#endif
+    return (sinks & LOG_BLE) && g_ble_uart_is_connected && !ble_export_active();
+}
+
+/**
+ * @brief Send every record that is ready and hand the slots back
+ *
+ * @param line Line buffer of LOG_LINE_MAX
+ */
+static void drainRing(char *line)
+{
+    while(true)
+    {
+        uint32_t slot = ringTail & (LOG_RING_SIZE - 1);
+        log_record_s *rec = &ring[slot];
+        if(__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) + slot != ringTail + 1)
+        {
+            break;
+        }
+
+        uint32_t dropped = __atomic_load_n(&g_log_dropped, __ATOMIC_RELAXED);
+        if(dropped != reportedDrops)
+        {
+            uint16_t len = snprintf(line, LOG_LINE_MAX, "%ld records dropped", (long)(dropped - reportedDrops));
+            writeLine(LOG_SERIAL, "LOG", line, len);
+            reportedDrops = dropped;
+        }
+
+        if(sinkAttached(rec->sinks))
+        {
+            uint16_t len = formatRecord(*rec, line, LOG_LINE_MAX);
+            writeLine(rec->sinks, rec->tag, line, len);
+        }
+        g_log_records++;
+
+        /** Hand the slot back to the producers */
+        __atomic_store_n(&rec->seq, ringTail + LOG_RING_SIZE - slot, __ATOMIC_RELEASE);
+        ringTail++;
+    }
+}
+
+/**
+ * @brief Log task, drains the ring whenever it is notified
+ *
+ */
+static void logTask(void *pvParameters)
+{
+    (void)pvParameters;
+    char line[LOG_LINE_MAX];
+    while(true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        drainRing(line);
+    }
+}
+
+/**
+ * @brief Start the log task
+ * Records queued before this are kept and printed once the task runs
+ *
+ */
+void log_init(void)
+{
+    if(logTaskHandle == NULL)
+    {
+        xTaskCreate(logTask, "LOG", 1024, NULL, TASK_PRIO_LOWEST, &logTaskHandle);
+        /** Print what was queued during boot */
+        xTaskNotifyGive(logTaskHandle);
+    }
+}
@@ -0,0 +1,188 @@
+/**
+ * @file motion.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Dead reckoning between GNSS fixes from the last fix and the accelerometer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The LIS3DH can't be integrated into a position, it is too noisy. It is
+ * good enough to tell still, walking and driving apart, every accelerometer
+ * batch is classified by activity.cpp. While moving the position is carried
+ * forward along the last GNSS heading, walking at walking speed, driving at
+ * the last GNSS speed (at least MOTION_DRIVE_SPEED_MMS). While still it
+ * stays put. The last heading only holds for the kind of move of the fix,
+ * walking off after a still fix only widens the uncertainty, and driving
+ * off after a walking or still fix needs a poll, its speed is unknown.
+ *
+ * The uncertainty starts at the fix accuracy (hDOP * MOTION_UERE_M) and
+ * grows with the time spent moving, by MOTION_SPEED_ERR_PCT of the speed
+ * plus MOTION_SPEED_ERR_MMS. A movement wakeup only needs a GNSS poll if the
+ * predicted position, give or take the uncertainty, may be far enough from
+ * the last beacon, or if the uncertainty got too big to say.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** GNSS speed below this is still, mm/s */
+#define MOTION_MOVING_MMS 500
+/** Speed assumed while the accelerometer says walking, mm/s */
+#define MOTION_WALK_SPEED_MMS 1500
+/** Slowest speed assumed while the accelerometer says driving, mm/s */
+#define MOTION_DRIVE_SPEED_MMS 5000
+/** GNSS speed above this is driving, mm/s */
+#define MOTION_DRIVING_MMS 3000
+/** User range error, meters per hDOP */
+#define MOTION_UERE_M 5
+/** Uncertainty growth while moving, share of the speed plus a floor */
+#define MOTION_SPEED_ERR_PCT 30
+#define MOTION_SPEED_ERR_MMS 500
+/** Uncertainty growth while still, mm/s */
+#define MOTION_STILL_ERR_MMS 20
+/** Poll anyway above this uncertainty */
+#ifndef MOTION_MAX_SIGMA_M
+#define MOTION_MAX_SIGMA_M 75
+#endif
+
+/** Last GNSS fix everything is predicted from */
+static gnss_fix_s anchor;
+/** Prediction since the anchor, millimeters */
+static uint32_t alongMm = 0;
+static uint32_t sigmaMm = 0;
+static uint32_t lastUpdate = 0;
+static uint8_t activity = ACTIVITY_STILL;
+/** Kind of move at the fix, its heading and speed hold for that one only */
+static uint8_t anchorActivity = ACTIVITY_STILL;
+
+/** Stats */
+uint32_t g_motion_wakes = 0;
+uint32_t g_motion_still = 0;
+uint32_t g_gnss_polls_avoided = 0;
+
+/**
+ * @brief Speed the prediction uses while moving
+ *
+ */
+static uint32_t movingSpeed(void)
+{
+    if(activity == ACTIVITY_WALKING)
+    {
+        return MOTION_WALK_SPEED_MMS;
+    }
+    return max(anchor.speed, (uint32_t)MOTION_DRIVE_SPEED_MMS);
+}
+
+/**
+ * @brief Carry the prediction forward to now with the current motion state
+ *
+ */
+static void advance(void)
+{
+    uint32_t now = millis();
+    uint32_t dt = now - lastUpdate;
+    lastUpdate = now;
+    if(activity != ACTIVITY_STILL)
+    {
+        uint32_t speed = movingSpeed();
+        uint32_t err = speed * MOTION_SPEED_ERR_PCT / 100 + MOTION_SPEED_ERR_MMS;
+        if(activity == anchorActivity)
+        {
+            alongMm += (uint64_t)speed * dt / 1000;
+        } else {
+            /** Heading unknown, it may have gone any way */
+            err += speed;
+        }
+        sigmaMm += (uint64_t)err * dt / 1000;
+    } else {
+        sigmaMm += (uint64_t)MOTION_STILL_ERR_MMS * dt / 1000;
+    }
+}
+
+/**
+ * @brief New GNSS fix, the prediction starts over from it
+ *
+ * @param fix Fix from poll_gnss()
+ */
+void motion_fix(const gnss_fix_s &fix)
+{
+    anchor = fix;
+    alongMm = 0;
+    sigmaMm = (uint32_t)fix.hdop * MOTION_UERE_M * 10;
+    lastUpdate = millis();
+    activity = ACTIVITY_STILL;
+    if(fix.speed >= MOTION_MOVING_MMS)
+    {
+        activity = fix.speed >= MOTION_DRIVING_MMS ? ACTIVITY_DRIVING : ACTIVITY_WALKING;
+    }
+    anchorActivity = activity;
+}
+
+/**
+ * @brief Accelerometer batch was classified, the prediction goes on with it
+ *
+ * @param batch_activity Result of acc_batch()
+ */
+void motion_wake(uint8_t batch_activity)
+{
+    g_motion_wakes++;
+    advance();
+    activity = batch_activity;
+    if(activity == ACTIVITY_STILL)
+    {
+        g_motion_still++;
+    }
+}
+
+/**
+ * @brief Predicted position now
+ *
+ * @param lat Latitude, 1e-5 deg
+ * @param lon Longitude, 1e-5 deg
+ * @return uint32_t Uncertainty in meters
+ */
+uint32_t motion_predict(int32_t &lat, int32_t &lon)
+{
+    advance();
+    geo_offset(anchor.lat, anchor.lon, anchor.heading, alongMm / 1000, lat, lon);
+    return sigmaMm / 1000;
+}
+
+/**
+ * @brief Does a movement wakeup need a GNSS poll
+ *
+ * @param beacon Position of the last beacon
+ * @param min_distance_m Distance from it that is worth a new beacon
+ * @return true Poll the GNSS
+ */
+bool motion_poll_needed(const gnss_fix_s &beacon, uint32_t min_distance_m)
+{
+    if(!anchor.valid || !beacon.valid)
+    {
+        return true;
+    }
+
+    int32_t lat, lon;
+    uint32_t sigma = motion_predict(lat, lon);
+    if(activity == ACTIVITY_DRIVING && anchorActivity != ACTIVITY_DRIVING)
+    {
+        MYLOG("MOT", "Poll, driving off at unknown speed");
+        return true;
+    }
+    if(sigma >= MOTION_MAX_SIGMA_M)
+    {
+        MYLOG("MOT", "Poll, uncertainty %ldm", (long)sigma);
+        return true;
+    }
+    uint32_t dist = geo_distance_m(beacon.lat, beacon.lon, lat, lon);
+    if(dist + sigma >= min_distance_m)
+    {
+        MYLOG("MOT", "Poll, ~%ldm +/-%ldm from last beacon", (long)dist, (long)sigma);
+        return true;
+    }
+
+    g_gnss_polls_avoided++;
+    MYLOG("MOT", "No poll, %s, ~%ldm +/-%ldm from last beacon", activity_name(activity), (long)dist, (long)sigma);
+    return false;
+}
@@ -0,0 +1,321 @@
+/**
+ * @file nmea.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief GGA/RMC only NMEA decoder for the RAK1910, integer math only
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Bytes are decoded as they come in, a field is converted as soon as its
+ * ',' or '*' arrives, so only the current field is buffered. Values go to
+ * a work copy and are taken over into g_nmea only when the checksum of the
+ * sentence matches. Any talker (GP, GN, GL, ...) is accepted.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Longest field we need to keep, "01131.00000" */
+#define NMEA_FIELD_MAX 16
+
+/** Decoder state */
+enum nmea_step_e
+{
+    NMEA_WAIT_START,
+    NMEA_IN_FIELDS,
+    NMEA_CHECKSUM_1,
+    NMEA_CHECKSUM_2
+};
+
+/** Last good GGA/RMC values */
+nmea_fix_s g_nmea;
+/** Stats */
+uint32_t g_nmea_sentences = 0;
+uint32_t g_nmea_bad_checksum = 0;
+
+static nmea_fix_s work;
+static uint8_t step = NMEA_WAIT_START;
+static uint8_t sentence = NMEA_NONE;
+static uint8_t fieldIdx = 0;
+static char field[NMEA_FIELD_MAX];
+static uint8_t fieldLen = 0;
+static uint8_t checksum = 0;
+static uint8_t received = 0;
+/** Hemisphere comes after the value */
+static int32_t pendingLat = 0;
+static int32_t pendingLon = 0;
+static bool rmcActive = false;
+
+/**
+ * @brief Decimal field to fixed point, extra digits are cut
+ *
+ * @param f Field text
+ * @param decimals Digits after the decimal point to keep
+ * @return int32_t Value * 10^decimals
+ */
+static int32_t fieldFixed(const char *f, uint8_t decimals)
+{
+    bool negative = *f == '-';
+    if(negative)
+    {
+        f++;
+    }
+    int32_t value = 0;
+    int8_t fraction = -1;
+    for(; *f != '\0'; f++)
+    {
+        if(*f == '.')
+        {
+            fraction = 0;
+            continue;
+        }
+        if(*f < '0' || *f > '9' || fraction == decimals)
+        {
+            break;
+        }
+        value = value * 10 + (*f - '0');
+        if(fraction >= 0)
+        {
+            fraction++;
+        }
+    }
+    for(int8_t i = fraction < 0 ? 0 : fraction; i < decimals; i++)
+    {
+        value *= 10;
+    }
+    return negative ? -value : value;
+}
+
+/**
+ * @brief ddmm.mmmmm / dddmm.mmmmm to 1e-5 deg
+ *
+ * @param f Field text
+ * @return int32_t Degrees * 1e5
+ */
+static int32_t fieldDegrees(const char *f)
+{
+    int32_t raw = fieldFixed(f, 5);
+    int32_t degrees = raw / 10000000;
+    int32_t minutes = raw % 10000000;
+    return degrees * 100000 + (minutes + 30) / 60;
+}
+
+/**
+ * @brief Two digits at text
+ *
+ */
+static uint8_t twoDigits(const char *f)
+{
+    return (f[0] - '0') * 10 + (f[1] - '0');
+}
+
+/**
+ * @brief Convert the field that just ended
+ *
+ */
+static void endField(void)
+{
+    field[fieldLen] = '\0';
+    bool empty = fieldLen == 0;
+
+    if(fieldIdx == 0)
+    {
+        /** Talker is 2 characters, then the sentence type */
+        sentence = NMEA_NONE;
+        if(fieldLen == 5 && strcmp(&field[2], "GGA") == 0)
+        {
+            sentence = NMEA_GGA;
+        } else if(fieldLen == 5 && strcmp(&field[2], "RMC") == 0) {
+            sentence = NMEA_RMC;
+            rmcActive = false;
+        }
+    } else if(sentence == NMEA_GGA) {
+        switch(fieldIdx)
+        {
+        case 2:
+            pendingLat = empty ? 0 : fieldDegrees(field);
+            break;
+        case 3:
+            work.lat = field[0] == 'S' ? -pendingLat : pendingLat;
+            break;
+        case 4:
+            pendingLon = empty ? 0 : fieldDegrees(field);
+            break;
+        case 5:
+            work.lon = field[0] == 'W' ? -pendingLon : pendingLon;
+            break;
+        case 6:
+            /** Fix quality, 0 is no fix */
+            work.pos_valid = !empty && field[0] != '0';
+            break;
+        case 7:
+            work.siv = fieldFixed(field, 0);
+            break;
+        case 8:
+            work.hdop = fieldFixed(field, 2);
+            break;
+        case 9:
+            work.alt = fieldFixed(field, 0);
+            work.alt_valid = !empty;
+            break;
+        }
+    } else if(sentence == NMEA_RMC) {
+        switch(fieldIdx)
+        {
+        case 1:
+            if(fieldLen >= 6)
+            {
+                work.hour = twoDigits(&field[0]);
+                work.minute = twoDigits(&field[2]);
+                work.second = twoDigits(&field[4]);
+            }
+            break;
+        case 2:
+            rmcActive = field[0] == 'A';
+            break;
+        case 7:
+            /** Knots * 1000 to mm/s */
+            work.speed = rmcActive ? ((int64_t)fieldFixed(field, 3) * 514444) / 1000000 : 0;
+            break;
+        case 8:
+            work.heading = rmcActive ? fieldFixed(field, 2) % 36000 : 0;
+            break;
+        case 9:
+            work.date_valid = rmcActive && fieldLen == 6;
+            if(work.date_valid)
+            {
+                work.day = twoDigits(&field[0]);
+                work.month = twoDigits(&field[2]);
+                work.year = 2000 + twoDigits(&field[4]);
+            }
+            break;
+        }
+    }
+    fieldIdx++;
+    fieldLen = 0;
+}
+
+/**
+ * @brief Take the sentence over if its checksum is right
+ *
+ * @return uint8_t Sentence type or NMEA_NONE
+ */
+static uint8_t endSentence(void)
+{
+    step = NMEA_WAIT_START;
+    if(received != checksum)
+    {
+        g_nmea_bad_checksum++;
+        return NMEA_NONE;
+    }
+    if(sentence != NMEA_NONE)
+    {
+        g_nmea = work;
+        g_nmea_sentences++;
+    }
+    return sentence;
+}
+
+/**
+ * @brief Value of a hex digit
+ *
+ */
+static int8_t hexValue(char c)
+{
+    if(c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if(c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Feed one received byte
+ *
+ * @param c Byte from the module
+ * @return uint8_t NMEA_GGA or NMEA_RMC when one was taken over into g_nmea, else NMEA_NONE
+ */
+uint8_t nmea_encode(char c)
+{
+    if(c == '$')
+    {
+        /** Start over, also in the middle of a broken sentence */
+        step = NMEA_IN_FIELDS;
+        work = g_nmea;
+        checksum = 0;
+        fieldIdx = 0;
+        fieldLen = 0;
+        sentence = NMEA_NONE;
+        return NMEA_NONE;
+    }
+
+    switch(step)
+    {
+    case NMEA_IN_FIELDS:
+        if(c == '*')
+        {
+            endField();
+            step = NMEA_CHECKSUM_1;
+        } else if(c == '\r' || c == '\n') {
+            /** No checksum, not trusted */
+            step = NMEA_WAIT_START;
+        } else {
+            checksum ^= c;
+            if(c == ',')
+            {
+                endField();
+            } else if(fieldLen < NMEA_FIELD_MAX - 1) {
+                field[fieldLen++] = c;
+            }
+        }
+        break;
+    case NMEA_CHECKSUM_1:
+    case NMEA_CHECKSUM_2:
+    {
+        int8_t value = hexValue(c);
+        if(value < 0)
+        {
+            g_nmea_bad_checksum++;
+            step = NMEA_WAIT_START;
+            break;
+        }
+        if(step == NMEA_CHECKSUM_1)
+        {
+            received = value << 4;
+            step = NMEA_CHECKSUM_2;
+            break;
+        }
+        received |= value;
+        return endSentence();
+    }
+    default:
+        break;
+    }
+    return NMEA_NONE;
+}
+
+/**
+ * @brief Send a proprietary NMEA command, the checksum is added here
+ *
+ * @param body Command without '$' and checksum, i.e. "PUBX,40,GSV,0,0,0,0,0,0"
+ */
+void nmea_send(const char *body)
+{
+    uint8_t sum = 0;
+    for(const char *p = body; *p != '\0'; p++)
+    {
+        sum ^= *p;
+    }
+    static const char hex[] = "0123456789ABCDEF";
+    Serial1.write('$');
+    Serial1.write(body);
+    Serial1.write('*');
+    Serial1.write(hex[sum >> 4]);
+    Serial1.write(hex[sum & 0x0F]);
+    Serial1.write("\r\n");
+}
@@ -0,0 +1,133 @@
+/**
+ * @file oled.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Send only the changed parts of the OLED frame buffer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The frame buffer is split in 8x8 tiles (8 bytes each). A copy of the
+ * last frame sent is kept, every flush compares tile by tile and only
+ * runs of changed tiles are pushed with updateDisplayArea().
+ * The I2C bus is shared with the RAK12500 and LIS3DH, so less bytes
+ * means less time they have to wait. A frame goes out one tile row at a
+ * time, a waiting sensor gets the bus in between (see i2c_bus.cpp).
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** 128x64 mono, 16x8 tiles of 8 bytes */
+#define OLED_BUFFER_SIZE 1024
+/** Bytes per tile */
+#define OLED_TILE_BYTES 8
+/** Estimated overhead of one area update (I2C address, control byte, page and column commands) */
+#define OLED_AREA_OVERHEAD 5
+
+/** Last frame that was sent to the display */
+static uint8_t sentFrame[OLED_BUFFER_SIZE];
+/** Is sentFrame what the display shows */
+static bool sentValid = false;
+
+/** Bytes sent by the last flush */
+uint16_t g_oled_bytes_last = 0;
+/** Bytes sent since boot */
+uint32_t g_oled_bytes_total = 0;
+/** Bytes a full frame push would have sent since boot */
+uint32_t g_oled_bytes_full = 0;
+
+/**
+ * @brief Next flush sends the whole frame
+ * Call after the display was reset or written without oled_flush()
+ *
+ */
+void oled_invalidate(void)
+{
+    sentValid = false;
+}
+
+/**
+ * @brief Check if a tile differs from the last frame sent
+ *
+ * @param buf Frame buffer
+ * @param offset Offset of the tile in the buffer
+ * @return true Tile changed
+ */
+static bool tileDirty(const uint8_t *buf, uint16_t offset)
+{
+    return memcmp(&buf[offset], &sentFrame[offset], OLED_TILE_BYTES) != 0;
+}
+
+/**
+ * @brief Send the changed tiles of the frame buffer to the display
+ *
+ * @param display Display object
+ * @return uint16_t Bytes sent (estimated, including command overhead)
+ */
+uint16_t oled_flush(U8G2 &display)
+{
+    uint8_t *buf = display.getBufferPtr();
+    uint8_t tileWidth = display.getBufferTileWidth();
+    uint8_t tileHeight = display.getBufferTileHeight();
+    uint16_t frameSize = tileWidth * tileHeight * OLED_TILE_BYTES;
+    uint16_t sent = 0;
+    bool full = !sentValid || frameSize > OLED_BUFFER_SIZE;
+    bool done = true;
+
+    if(!i2c_acquire(I2C_DEV_OLED))
+    {
+        /** Changed tiles are still changed next time */
+        return 0;
+    }
+    for(uint8_t ty = 0; ty < tileHeight; ty++)
+    {
+        if(ty != 0 && !i2c_yield(I2C_DEV_OLED))
+        {
+            /** Lost the bus, the rest goes with the next flush */
+            done = false;
+            break;
+        }
+        uint16_t rowOffset = ty * tileWidth * OLED_TILE_BYTES;
+        if(full)
+        {
+            display.updateDisplayArea(0, ty, tileWidth, 1);
+            if(frameSize <= OLED_BUFFER_SIZE)
+            {
+                memcpy(&sentFrame[rowOffset], &buf[rowOffset], tileWidth * OLED_TILE_BYTES);
+            }
+            sent += tileWidth * OLED_TILE_BYTES + OLED_AREA_OVERHEAD;
+            continue;
+        }
+        uint8_t tx = 0;
+        while(tx < tileWidth)
+        {
+            if(!tileDirty(buf, rowOffset + tx * OLED_TILE_BYTES))
+            {
+                tx++;
+                continue;
+            }
+            /** Collect a run of changed tiles, one transfer per run */
+            uint8_t start = tx;
+            while(tx < tileWidth && tileDirty(buf, rowOffset + tx * OLED_TILE_BYTES))
+            {
+                tx++;
+            }
+            uint8_t run = tx - start;
+            display.updateDisplayArea(start, ty, run, 1);
+            memcpy(&sentFrame[rowOffset + start * OLED_TILE_BYTES], &buf[rowOffset + start * OLED_TILE_BYTES], run * OLED_TILE_BYTES);
+            sent += run * OLED_TILE_BYTES + OLED_AREA_OVERHEAD;
+        }
+    }
+    i2c_release(I2C_DEV_OLED);
+    if(full && done && frameSize <= OLED_BUFFER_SIZE)
+    {
+        sentValid = true;
+    }
+
+    g_oled_bytes_last = sent;
+    g_oled_bytes_total += sent;
+    g_oled_bytes_full += frameSize + tileHeight * OLED_AREA_OVERHEAD;
+    MYLOG("OLED", "Sent %d bytes, total %ld/%ld", sent, (long)g_oled_bytes_total, (long)g_oled_bytes_full);
+    return sent;
+}
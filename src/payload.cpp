@@ -0,0 +1,314 @@
+/**
+ * @file payload.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Uplink payload, legacy 14 byte mapper layout or compact delta frames
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * PAYLOAD_PROFILE selects the layout at build time:
+ *
+ * PAYLOAD_LEGACY, what the Helium mapper integrations expect, 14 bytes:
+ *   [lat i32][long i32][alt i16][hdop*100 u16][batt mV u16], little endian
+ *   all zero but the battery for a No-GPS beacon, one fix per uplink
+ *
+ * PAYLOAD_COMPACT, version 1:
+ *   [header u8][seq u8]
+ *   header  bits 7..6 version (1), 0x20 absolute, 0x10 battery,
+ *           0x08 no position (No-GPS beacon)
+ *   absolute  [lat i32][long i32][alt i16][hdop*10 u8]
+ *   delta     [ref seq u8][lat][long][alt] zigzag varint deltas from the
+ *             frame with ref seq, [hdop*10 u8]
+ *   battery   [(mV - 2500) / 10 u8]
+ * With confirmed uplinks a frame becomes the reference for the following
+ * deltas once it is acknowledged. Unconfirmed uplinks may be lost without
+ * notice, there only absolute frames become the reference, so a lost delta
+ * frame costs nothing. Every PAYLOAD_ABS_EVERY position frames one is
+ * absolute, a receiver that missed a reference can decode again after
+ * that. The battery is only sent when it changed and with every
+ * absolute frame.
+ * Frames are self delimiting, payload_append() packs more of them into
+ * one uplink. A frame may reference an earlier frame of the same uplink,
+ * they arrive together or not at all.
+ * tools/payload_decode.py decodes both layouts and compares their airtime.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+
+/** Compact header */
+#define PAYLOAD_VERSION 0x40
+#define PAYLOAD_ABS 0x20
+#define PAYLOAD_BATT 0x10
+#define PAYLOAD_NOPOS 0x08
+/** lat, long and alt of an absolute frame */
+#define PAYLOAD_ABS_LEN 10
+/** Position frames per absolute frame */
+#ifndef PAYLOAD_ABS_EVERY
+#define PAYLOAD_ABS_EVERY 8
+#endif
+/** Battery quantization */
+#define PAYLOAD_BATT_BASE_MV 2500
+#define PAYLOAD_BATT_STEP_MV 10
+
+/** Reference the deltas are taken from */
+struct payload_ref_s
+{
+    int32_t lat = 0;
+    int32_t lon = 0;
+    int32_t alt = 0;
+    uint8_t seq = 0;
+    bool valid = false;
+};
+
+/** Coder state, what the receiver is assumed to know */
+struct payload_state_s
+{
+    uint8_t seq = 0;
+    payload_ref_s ref;
+    uint8_t batt = 0;
+    bool battValid = false;
+    uint8_t sinceAbs = 0;
+};
+
+/** State after the last sent uplink */
+static payload_state_s sent;
+
+/** Uplink built last, it becomes the reference once it is sent */
+static payload_state_s pending;
+/** Last absolute frame of it */
+static payload_ref_s pendingAbsRef;
+static uint8_t pendingFrames = 0;
+static uint8_t pendingAbsFrames = 0;
+static bool pendingQueued = false;
+
+/** Stats */
+uint32_t g_payload_frames = 0;
+uint32_t g_payload_bytes = 0;
+uint32_t g_payload_absolute = 0;
+
+/**
+ * @brief Append a signed value as zigzag varint
+ *
+ * @return uint8_t New length
+ */
+static uint8_t putVarint(uint8_t *out, uint8_t len, int32_t value)
+{
+    uint32_t zz = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    while(zz >= 0x80)
+    {
+        out[len++] = (zz & 0x7F) | 0x80;
+        zz >>= 7;
+    }
+    out[len++] = zz;
+    return len;
+}
+
+/**
+ * @brief Append a little endian value
+ *
+ * @return uint8_t New length
+ */
+static uint8_t putLe(uint8_t *out, uint8_t len, uint32_t value, uint8_t bytes)
+{
+    for(uint8_t i = 0; i < bytes; i++)
+    {
+        out[len++] = (value >> (8 * i)) & 0xFF;
+    }
+    return len;
+}
+
+/**
+ * @brief Battery voltage in one byte
+ *
+ */
+static uint8_t quantizeBatt(uint16_t batt_mv)
+{
+    if(batt_mv <= PAYLOAD_BATT_BASE_MV)
+    {
+        return 0;
+    }
+    return min((batt_mv - PAYLOAD_BATT_BASE_MV + PAYLOAD_BATT_STEP_MV / 2) / PAYLOAD_BATT_STEP_MV, 255);
+}
+
+/**
+ * @brief The 14 byte mapper layout, same bytes as g_mapper_data
+ *
+ */
+static uint8_t buildLegacy(const gnss_fix_s *fix, uint16_t batt_mv, uint8_t *out)
+{
+    bool pos = fix != nullptr && fix->valid;
+    uint8_t len = 0;
+    len = putLe(out, len, pos ? fix->lat : 0, 4);
+    len = putLe(out, len, pos ? fix->lon : 0, 4);
+    len = putLe(out, len, pos ? fix->alt : 0, 2);
+    len = putLe(out, len, pos ? fix->hdop : 0, 2);
+    len = putLe(out, len, batt_mv, 2);
+    return len;
+}
+
+/**
+ * @brief One compact frame, coded against and advancing state
+ *
+ * @param isAbs Set if the frame is absolute
+ * @return uint8_t Frame length, at most PAYLOAD_MAX_LEN
+ */
+static uint8_t buildFrame(const gnss_fix_s *fix, uint16_t batt_mv, uint8_t *out, payload_state_s &state, bool &isAbs)
+{
+    uint8_t header = PAYLOAD_VERSION;
+    uint8_t len = 2;
+    isAbs = false;
+    if(fix == nullptr || !fix->valid)
+    {
+        header |= PAYLOAD_NOPOS;
+    } else {
+        int32_t alt = constrain(fix->alt, -32768, 32767);
+        isAbs = !state.ref.valid || state.sinceAbs >= PAYLOAD_ABS_EVERY - 1;
+        if(!isAbs)
+        {
+            out[len++] = state.ref.seq;
+            len = putVarint(out, len, fix->lat - state.ref.lat);
+            len = putVarint(out, len, fix->lon - state.ref.lon);
+            len = putVarint(out, len, alt - state.ref.alt);
+            /** Far from the reference, absolute is not bigger */
+            isAbs = len > 2 + PAYLOAD_ABS_LEN;
+        }
+        if(isAbs)
+        {
+            header |= PAYLOAD_ABS;
+            len = 2;
+            len = putLe(out, len, fix->lat, 4);
+            len = putLe(out, len, fix->lon, 4);
+            len = putLe(out, len, alt, 2);
+        }
+        out[len++] = min(fix->hdop / 10, 255);
+        state.ref.lat = fix->lat;
+        state.ref.lon = fix->lon;
+        state.ref.alt = alt;
+        state.ref.seq = state.seq;
+        state.ref.valid = true;
+        state.sinceAbs = isAbs ? 0 : state.sinceAbs + 1;
+    }
+
+    uint8_t batt = quantizeBatt(batt_mv);
+    if(isAbs || !state.battValid || batt != state.batt)
+    {
+        header |= PAYLOAD_BATT;
+        out[len++] = batt;
+        state.batt = batt;
+        state.battValid = true;
+    }
+
+    out[0] = header;
+    out[1] = state.seq++;
+    return len;
+}
+
+/**
+ * @brief Build the uplink for a beacon
+ *
+ * @param fix Position, nullptr for a No-GPS beacon
+ * @param batt_mv Battery voltage
+ * @param out Output, PAYLOAD_MAX_LEN bytes
+ * @return uint8_t Payload length
+ */
+uint8_t payload_build(const gnss_fix_s *fix, uint16_t batt_mv, uint8_t *out)
+{
+    pendingQueued = false;
+    if(PAYLOAD_PROFILE == PAYLOAD_LEGACY)
+    {
+        return buildLegacy(fix, batt_mv, out);
+    }
+
+    pending = sent;
+    pendingAbsRef = payload_ref_s();
+    pendingFrames = 0;
+    pendingAbsFrames = 0;
+    return payload_append(fix, batt_mv, out, PAYLOAD_MAX_LEN);
+}
+
+/**
+ * @brief Pack one more beacon into the uplink from payload_build()
+ *
+ * @param fix Position, nullptr for a No-GPS beacon
+ * @param batt_mv Battery voltage
+ * @param out Where the frame goes, after the uplink so far
+ * @param space Bytes left in the uplink
+ * @return uint8_t Frame length, 0 if it doesn't fit or the layout can't pack
+ */
+uint8_t payload_append(const gnss_fix_s *fix, uint16_t batt_mv, uint8_t *out, uint8_t space)
+{
+    if(PAYLOAD_PROFILE == PAYLOAD_LEGACY)
+    {
+        return 0;
+    }
+
+    uint8_t frame[PAYLOAD_MAX_LEN];
+    payload_state_s state = pending;
+    bool isAbs;
+    uint8_t len = buildFrame(fix, batt_mv, frame, state, isAbs);
+    if(len > space)
+    {
+        return 0;
+    }
+    memcpy(out, frame, len);
+    pending = state;
+    pendingFrames++;
+    if(isAbs)
+    {
+        pendingAbsRef = state.ref;
+        pendingAbsFrames++;
+    }
+    return len;
+}
+
+/**
+ * @brief The uplink from payload_build() was accepted by the LoRaWAN stack
+ *
+ * @param len Its length
+ */
+void payload_queued(uint8_t len)
+{
+    g_payload_bytes += len;
+    if(PAYLOAD_PROFILE == PAYLOAD_LEGACY)
+    {
+        g_payload_frames++;
+        return;
+    }
+    g_payload_frames += pendingFrames;
+    g_payload_absolute += pendingAbsFrames;
+    pendingQueued = true;
+    /** Sequence numbers are used up, whatever happens to the uplink */
+    sent.seq = pending.seq;
+}
+
+/**
+ * @brief TX cycle finished, an acknowledged frame becomes the delta reference
+ *
+ * @param success TX cycle result, ACK for confirmed uplinks
+ */
+void payload_tx_done(bool success)
+{
+    if(!pendingQueued)
+    {
+        return;
+    }
+    pendingQueued = false;
+    if(!success)
+    {
+        return;
+    }
+    bool acked = g_lorawan_settings.confirmed_msg_enabled == LMH_CONFIRMED_MSG;
+    if(acked)
+    {
+        sent.ref = pending.ref;
+    }
+    else if(pendingAbsRef.valid)
+    {
+        sent.ref = pendingAbsRef;
+    }
+    sent.sinceAbs = pending.sinceAbs;
+    sent.batt = pending.batt;
+    sent.battValid = pending.battValid;
+}
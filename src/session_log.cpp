@@ -0,0 +1,520 @@
+/**
+ * @file session_log.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Binary log of every beacon result in internal flash
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Records are collected in RAM and written as one batch, so flash is
+ * touched once per SESSION_LOG_BATCH_RECORDS beacons.
+ *
+ * Batch:  [0x5A][len u16][crc16 u16][len bytes of records]
+ *         Each batch decodes on its own, a batch cut by a power loss
+ *         fails its CRC and only that batch is lost.
+ * Record: [flags u8]
+ *         [time]                   uvarint seconds since previous record,
+ *                                  uint32 difference, wraps like the clock
+ *         [dr | sf << 4 u8]
+ *         SLOG_POS      [lat][lon][alt] zigzag varint delta, [hdop/10 u8]
+ *         SLOG_HOTSPOT  -rssi is clamped to 0..255
+ *                       [-rssi u8][snr i8] tester side of the downlink
+ *                       [-rssi u8][snr*4 i8][hot spots u8] hot spot side
+ *                       SLOG_NAME_NEW [len u8][name], else [name index u8]
+ *         SLOG_BATT     [mV] zigzag varint delta
+ * Deltas start from 0 at the start of a batch. Names get the next index
+ * in order of appearance, the table starts empty in every batch.
+ * While an export reads the log the files are pinned, nothing is written
+ * or rotated under it. One finished batch is held in RAM meanwhile and
+ * written when the export ends; if a second one is due first, the export
+ * is cut off instead. The length and CRC of the first batch identify the
+ * stream. They change when a rotation drops the old file and the offsets
+ * shift, a resume checks them so it can't continue at the wrong data.
+ * tools/session_log_decode.py streams the log to CSV or GeoJSON.
+ * Both files fit the InternalFS budget in app.h, record/replay builds of
+ * gnss_trace.cpp clear the log and write none. Builds with
+ * UPLINK_QUEUE_SPILL keep no old file, a full log starts over.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Records per batch before it is written */
+#ifndef SESSION_LOG_BATCH_RECORDS
+#define SESSION_LOG_BATCH_RECORDS 16
+#endif
+/** Batch buffer size */
+#define SESSION_LOG_BATCH_SIZE 512
+/** Worst case size of one record */
+#define SESSION_LOG_RECORD_MAX 96
+/** Names remembered per batch */
+#define SESSION_LOG_NAMES 8
+/** Batch header */
+#define SESSION_LOG_SYNC 0x5A
+#define SESSION_LOG_HEADER 5
+
+/** Record flags */
+#define SLOG_POS 0x01
+#define SLOG_HOTSPOT 0x02
+#define SLOG_NAME_NEW 0x04
+#define SLOG_BATT 0x08
+#define SLOG_UPTIME 0x10
+
+/** Previous and current log file */
+static const char *logFiles[2] = {"/slog.old", "/slog.bin"};
+
+/** One beacon result */
+struct session_entry_s
+{
+    uint32_t time;
+    bool uptime;
+    gnss_fix_s fix;
+    uint8_t dr;
+    uint8_t sf;
+    uint16_t batt;
+    bool has_hotspot;
+    int16_t rssi;
+    int8_t snr;
+    downlink_hotspot_s hs;
+};
+
+/** Beacon waiting for its downlink */
+static session_entry_s pending;
+static bool hasPending = false;
+
+/** Batch being built */
+static uint8_t batch[SESSION_LOG_BATCH_SIZE];
+static uint16_t batchLen = SESSION_LOG_HEADER;
+static uint8_t batchRecords = 0;
+static bool batchUptime = false;
+/** Delta references, reset every batch */
+static uint32_t refTime = 0;
+static int32_t refLat = 0;
+static int32_t refLon = 0;
+static int32_t refAlt = 0;
+static int32_t refBatt = 0;
+static char names[SESSION_LOG_NAMES][sizeof(((downlink_hotspot_s *)0)->name)];
+static uint8_t nameCount = 0;
+
+/** Reader for the export, kept open between reads */
+static File readFile(InternalFS);
+static int8_t readIdx = -1;
+static uint32_t readSizes[2] = {0, 0};
+/** Files are pinned for a reader */
+static bool reading = false;
+/** Batch finished while the files were pinned */
+static uint8_t held[SESSION_LOG_BATCH_SIZE];
+static uint16_t heldLen = 0;
+
+/** Stats */
+uint32_t g_session_log_records = 0;
+uint32_t g_session_log_flash_bytes = 0;
+
+static void putByte(uint8_t value)
+{
+    batch[batchLen++] = value;
+}
+
+static void putVarint(uint32_t value)
+{
+    while(value >= 0x80)
+    {
+        putByte((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    putByte(value);
+}
+
+static void putZigzag(int32_t value)
+{
+    putVarint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+/**
+ * @brief Start a new batch, all references back to 0
+ *
+ */
+static void resetBatch(void)
+{
+    batchLen = SESSION_LOG_HEADER;
+    batchRecords = 0;
+    refTime = 0;
+    refLat = 0;
+    refLon = 0;
+    refAlt = 0;
+    refBatt = 0;
+    nameCount = 0;
+}
+
+/**
+ * @brief Append a finished batch to the log file, rotate it when full
+ *
+ * @param buf Batch with header
+ * @param len Length with header
+ */
+static void writeBatch(const uint8_t *buf, uint16_t len)
+{
+    /** The GNSS trace has the log's blocks in record/replay builds */
+    if(GNSS_RECORD > 0 || GNSS_REPLAY > 0)
+    {
+        return;
+    }
+    File file(InternalFS);
+    if(file.open(logFiles[1], FILE_O_READ))
+    {
+        uint32_t size = file.size();
+        file.close();
+        if(size + len > SESSION_LOG_FILE_MAX)
+        {
+            /** Keep one old file, drop the one before */
+            InternalFS.remove(logFiles[0]);
+            if(SESSION_LOG_FILES > 1)
+            {
+                InternalFS.rename(logFiles[1], logFiles[0]);
+            } else {
+                InternalFS.remove(logFiles[1]);
+            }
+        }
+    }
+
+    if(file.open(logFiles[1], FILE_O_WRITE))
+    {
+        file.write(buf, len);
+        file.close();
+        g_session_log_flash_bytes += len;
+        MYLOG("SLOG", "Wrote %d bytes", len);
+    } else {
+        MYLOG("SLOG", "Can't open %s", logFiles[1]);
+    }
+}
+
+/**
+ * @brief Write the batch to flash, or hold it while an export reads
+ *
+ */
+void session_log_flush(void)
+{
+    if(batchRecords == 0)
+    {
+        return;
+    }
+
+    uint16_t len = batchLen - SESSION_LOG_HEADER;
+    uint16_t crc = crc16_ccitt(&batch[SESSION_LOG_HEADER], len);
+    batch[0] = SESSION_LOG_SYNC;
+    batch[1] = len & 0xFF;
+    batch[2] = len >> 8;
+    batch[3] = crc & 0xFF;
+    batch[4] = crc >> 8;
+
+    if(reading)
+    {
+        if(heldLen == 0)
+        {
+            memcpy(held, batch, batchLen);
+            heldLen = batchLen;
+            MYLOG("SLOG", "Holding %d records until the export ends", batchRecords);
+            resetBatch();
+            return;
+        }
+        /** No room for a second one, the export gives way */
+        MYLOG("SLOG", "Log moves on, export cut off");
+        session_log_read_done();
+    }
+
+    writeBatch(batch, batchLen);
+    resetBatch();
+}
+
+/**
+ * @brief Encode one beacon result into the batch
+ *
+ * @param entry Beacon result
+ */
+static void encodeEntry(const session_entry_s &entry)
+{
+    /** One time base per batch */
+    if(batchRecords != 0 && entry.uptime != batchUptime)
+    {
+        session_log_flush();
+    }
+    if(batchLen + SESSION_LOG_RECORD_MAX > SESSION_LOG_BATCH_SIZE)
+    {
+        session_log_flush();
+    }
+    batchUptime = entry.uptime;
+
+    /** Look up hot spot name */
+    int8_t nameIdx = -1;
+    if(entry.has_hotspot)
+    {
+        for(uint8_t i = 0; i < nameCount; i++)
+        {
+            if(strcmp(names[i], entry.hs.name) == 0)
+            {
+                nameIdx = i;
+                break;
+            }
+        }
+    }
+
+    uint8_t flags = 0;
+    flags |= entry.fix.valid ? SLOG_POS : 0;
+    flags |= entry.has_hotspot ? SLOG_HOTSPOT : 0;
+    flags |= (entry.has_hotspot && nameIdx < 0) ? SLOG_NAME_NEW : 0;
+    /** Battery only when it changed more than 10mV */
+    flags |= (batchRecords == 0 || abs((int32_t)entry.batt - refBatt) > 10) ? SLOG_BATT : 0;
+    flags |= entry.uptime ? SLOG_UPTIME : 0;
+
+    putByte(flags);
+    putVarint(entry.time - refTime);
+    refTime = entry.time;
+    putByte(entry.dr | (entry.sf << 4));
+
+    if(flags & SLOG_POS)
+    {
+        putZigzag(entry.fix.lat - refLat);
+        putZigzag(entry.fix.lon - refLon);
+        putZigzag(entry.fix.alt - refAlt);
+        putByte(min(entry.fix.hdop / 10, 255));
+        refLat = entry.fix.lat;
+        refLon = entry.fix.lon;
+        refAlt = entry.fix.alt;
+    }
+
+    if(flags & SLOG_HOTSPOT)
+    {
+        putByte(constrain(-entry.rssi, 0, 255));
+        putByte((uint8_t)entry.snr);
+        putByte(constrain(-entry.hs.rssi, 0, 255));
+        putByte((uint8_t)(int8_t)constrain(entry.hs.snr_x10 * 4 / 10, -128, 127));
+        putByte(entry.hs.hotspots);
+        if(flags & SLOG_NAME_NEW)
+        {
+            uint8_t len = strlen(entry.hs.name);
+            putByte(len);
+            memcpy(&batch[batchLen], entry.hs.name, len);
+            batchLen += len;
+            if(nameCount < SESSION_LOG_NAMES)
+            {
+                strcpy(names[nameCount++], entry.hs.name);
+            }
+        } else {
+            putByte(nameIdx);
+        }
+    }
+
+    if(flags & SLOG_BATT)
+    {
+        putZigzag((int32_t)entry.batt - refBatt);
+        refBatt = entry.batt;
+    }
+
+    batchRecords++;
+    g_session_log_records++;
+    if(batchRecords >= SESSION_LOG_BATCH_RECORDS)
+    {
+        session_log_flush();
+    }
+}
+
+/**
+ * @brief A beacon was sent, keep it until its downlink arrives
+ *
+ * @param fix Position sent, not valid for a no-GPS beacon
+ */
+void session_log_beacon(const gnss_fix_s &fix)
+{
+    /** Previous beacon got no downlink */
+    if(hasPending)
+    {
+        encodeEntry(pending);
+    }
+
+    pending = session_entry_s();
+    pending.uptime = fix.epoch == 0;
+    pending.time = pending.uptime ? millis() / 1000 : fix.epoch;
+    pending.fix = fix;
+    pending.dr = g_lorawan_settings.data_rate;
+    pending.sf = lora_dr_sf(g_lorawan_settings.lora_region, g_lorawan_settings.data_rate);
+    pending.batt = read_batt();
+    hasPending = true;
+}
+
+/**
+ * @brief Downlink for the last beacon arrived, log it
+ *
+ * @param hs Hot spot info from the downlink
+ */
+void session_log_hotspot(const downlink_hotspot_s &hs)
+{
+    if(!hasPending)
+    {
+        return;
+    }
+    pending.has_hotspot = true;
+    pending.rssi = g_last_rssi;
+    pending.snr = g_last_snr;
+    pending.hs = hs;
+    encodeEntry(pending);
+    hasPending = false;
+}
+
+/**
+ * @brief Size of the log, old and current file
+ *
+ * @return uint32_t Bytes
+ */
+uint32_t session_log_size(void)
+{
+    uint32_t size = 0;
+    File file(InternalFS);
+    for(uint8_t i = 0; i < 2; i++)
+    {
+        if(file.open(logFiles[i], FILE_O_READ))
+        {
+            size += file.size();
+            file.close();
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief Identity of the log stream, changes when the log is rotated
+ * Length and CRC of the first batch, the 4 bytes after its sync byte
+ * with bit 31 cleared so it prints as a positive number
+ *
+ * @return uint32_t Identity, 0 if the log is empty
+ */
+uint32_t session_log_id(void)
+{
+    File file(InternalFS);
+    for(uint8_t i = 0; i < 2; i++)
+    {
+        if(!file.open(logFiles[i], FILE_O_READ))
+        {
+            continue;
+        }
+        uint8_t header[SESSION_LOG_HEADER];
+        bool ok = file.read(header, sizeof(header)) == sizeof(header);
+        file.close();
+        if(ok)
+        {
+            return (header[1] | header[2] << 8 | header[3] << 16 | (uint32_t)header[4] << 24) & 0x7FFFFFFF;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Pin the log files for a reader until session_log_read_done()
+ *
+ * @return uint32_t Size of the log in bytes
+ */
+uint32_t session_log_read_start(void)
+{
+    session_log_read_done();
+    File file(InternalFS);
+    for(uint8_t i = 0; i < 2; i++)
+    {
+        readSizes[i] = 0;
+        if(file.open(logFiles[i], FILE_O_READ))
+        {
+            readSizes[i] = file.size();
+            file.close();
+        }
+    }
+    reading = true;
+    return readSizes[0] + readSizes[1];
+}
+
+/**
+ * @brief Are the files still pinned, false once the log had to move on
+ *
+ */
+bool session_log_reading(void)
+{
+    return reading;
+}
+
+/**
+ * @brief Read the log as one stream, old file first
+ * Call session_log_read_start() first, reads stop at the size it returned
+ *
+ * @param offset Offset in the stream
+ * @param buf Buffer
+ * @param len Max bytes to read
+ * @return uint16_t Bytes read, can be short at the end of a file, 0 at the
+ *         end or when the files are not pinned
+ */
+uint16_t session_log_read(uint32_t offset, uint8_t *buf, uint16_t len)
+{
+    if(!reading)
+    {
+        return 0;
+    }
+    uint8_t idx = 0;
+    if(offset >= readSizes[0])
+    {
+        offset -= readSizes[0];
+        idx = 1;
+    }
+    if(offset >= readSizes[idx])
+    {
+        return 0;
+    }
+
+    if(readIdx != idx)
+    {
+        if(readIdx >= 0)
+        {
+            readFile.close();
+        }
+        readIdx = -1;
+        if(!readFile.open(logFiles[idx], FILE_O_READ))
+        {
+            return 0;
+        }
+        readIdx = idx;
+    }
+
+    len = min((uint32_t)len, readSizes[idx] - offset);
+    readFile.seek(offset);
+    return readFile.read(buf, len);
+}
+
+/**
+ * @brief Close the reader and unpin the files, a held batch is written
+ *
+ */
+void session_log_read_done(void)
+{
+    if(readIdx >= 0)
+    {
+        readFile.close();
+        readIdx = -1;
+    }
+    reading = false;
+    if(heldLen != 0)
+    {
+        writeBatch(held, heldLen);
+        heldLen = 0;
+    }
+}
+
+/**
+ * @brief Remove both log files, the GNSS recorder needs their blocks
+ *
+ */
+void session_log_clear(void)
+{
+    InternalFS.remove(logFiles[0]);
+    InternalFS.remove(logFiles[1]);
+    MYLOG("SLOG", "Log removed");
+}
@@ -0,0 +1,165 @@
+/**
+ * @file text_buf.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Fixed size text builder for display strings, no heap allocation
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef TEXT_BUF_H
+#define TEXT_BUF_H
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Text builder on a char[N]
+ * Appends stop at N-1 characters, the text is always NULL terminated
+ *
+ * @tparam N Buffer size including the NULL terminator
+ */
+template <size_t N>
+class TextBuf
+{
+public:
+    TextBuf() { clear(); }
+
+    /**
+     * @brief Append a string, cut if the buffer is full
+     *
+     * @param s NULL terminated text
+     * @return TextBuf& for chaining
+     */
+    TextBuf &add(const char *s)
+    {
+        while(*s != '\0' && _len < N - 1)
+        {
+            _buf[_len++] = *s++;
+        }
+        _buf[_len] = '\0';
+        return *this;
+    }
+
+    /**
+     * @brief Append a single character
+     *
+     * @param c Character
+     * @return TextBuf& for chaining
+     */
+    TextBuf &add(char c)
+    {
+        if(_len < N - 1)
+        {
+            _buf[_len++] = c;
+            _buf[_len] = '\0';
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Append a signed integer
+     *
+     * @param value Value
+     * @return TextBuf& for chaining
+     */
+    TextBuf &addInt(int32_t value)
+    {
+        return addFixed(value, 0);
+    }
+
+    /**
+     * @brief Append a fixed point decimal, i.e. (-55, 1) is "-5.5"
+     *
+     * @param value Value scaled by 10^decimals
+     * @param decimals Digits after the decimal point, at most 10
+     * @return TextBuf& for chaining
+     */
+    TextBuf &addFixed(int32_t value, uint8_t decimals)
+    {
+        /** Work on the magnitude as unsigned so INT32_MIN is safe */
+        uint32_t mag = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+        char digits[12];
+        uint8_t count = 0;
+        do
+        {
+            digits[count++] = '0' + (mag % 10);
+            mag /= 10;
+        } while(count < sizeof(digits) && (mag != 0 || count <= decimals));
+
+        if(value < 0)
+        {
+            add('-');
+        }
+        while(count > 0)
+        {
+            if(count == decimals)
+            {
+                add('.');
+            }
+            add(digits[--count]);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Append a count in at most 4 characters, i.e. 999, 1.2k, 12k, 1.2M, 4.2G
+     * Cut, not rounded, 1999 is 1.9k
+     *
+     * @param value Count
+     * @return TextBuf& for chaining
+     */
+    TextBuf &addCompact(uint32_t value)
+    {
+        if(value < 1000)
+        {
+            return addInt(value);
+        } else if(value < 10000) {
+            return addFixed(value / 100, 1).add('k');
+        } else if(value < 1000000) {
+            return addInt(value / 1000).add('k');
+        } else if(value < 10000000) {
+            return addFixed(value / 100000, 1).add('M');
+        } else if(value < 1000000000) {
+            return addInt(value / 1000000).add('M');
+        }
+        return addFixed(value / 100000000, 1).add('G');
+    }
+
+    /**
+     * @brief Remove characters from the middle of the text
+     *
+     * @param pos First character to remove
+     * @param count Number of characters to remove
+     */
+    void erase(size_t pos, size_t count)
+    {
+        if(pos >= _len)
+        {
+            return;
+        }
+        if(count > _len - pos)
+        {
+            count = _len - pos;
+        }
+        memmove(&_buf[pos], &_buf[pos + count], _len - pos - count + 1);
+        _len -= count;
+    }
+
+    void clear(void)
+    {
+        _len = 0;
+        _buf[0] = '\0';
+    }
+
+    const char *c_str(void) const { return _buf; }
+    size_t length(void) const { return _len; }
+
+private:
+    char _buf[N];
+    size_t _len;
+};
+
+#endif
@@ -0,0 +1,443 @@
+/**
+ * @file uplink_queue.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Store and forward for beacons the radio can't take right now
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Every beacon goes through the queue. It is sent at once if the device has
+ * joined, no TX cycle is running and the duty cycle allows it, otherwise it
+ * waits for LORA_TX_FIN, the join or a retry timer. The payload is built at
+ * send time from the stored fix, so the compact delta coding always sees
+ * the beacons in the order they go out.
+ *
+ * The queue holds UPLINK_QUEUE_LEN beacons in RAM. When it is full the
+ * lowest priority, oldest beacon makes room, a No-GPS beacon before a
+ * position. With -DUPLINK_QUEUE_SPILL=1 a position that makes room goes to
+ * /uplink.q in flash instead, and is read back once the RAM queue has room
+ * again. Beacons older than UPLINK_QUEUE_MAX_AGE_MS are dropped, a mapper
+ * point sent much later is heard by the hotspots around the new position.
+ *
+ * With PAYLOAD_COMPACT all queued beacons that fit the max payload of the
+ * current DR are packed into one uplink, highest priority first. The
+ * legacy layout is one beacon per uplink, the mapper integrations expect
+ * exactly 14 bytes.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <app.h>
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+using namespace Adafruit_LittleFS_Namespace;
+
+/** Beacons kept in RAM */
+#ifndef UPLINK_QUEUE_LEN
+#define UPLINK_QUEUE_LEN 8
+#endif
+/** Older beacons are dropped */
+#ifndef UPLINK_QUEUE_MAX_AGE_MS
+#define UPLINK_QUEUE_MAX_AGE_MS 600000
+#endif
+/** Retry while busy or not joined */
+#define UPLINK_RETRY_MS 10000
+/** Largest packed uplink, EU868 DR0..DR2 */
+#define UPLINK_PACK_MAX 51
+
+/** A beacon waiting for the radio */
+struct uplink_entry_s
+{
+    gnss_fix_s fix;
+    uint32_t queued_at = 0;
+    uint16_t batt_mv = 0;
+    uint8_t prio = UPLINK_PRIO_NOGPS;
+    bool used = false;
+};
+
+/** Spill file record */
+struct uplink_spill_s
+{
+    uplink_entry_s entry;
+    uint16_t crc;
+};
+
+/** Records in the flash spill file until it is empty again, UPLINK_SPILL_FILE_MAX in app.h */
+#define UPLINK_SPILL_MAX (UPLINK_SPILL_FILE_MAX / sizeof(uplink_spill_s))
+
+static const char spillName[] = "/uplink.q";
+
+static uplink_entry_s queue[UPLINK_QUEUE_LEN];
+static uint8_t depth = 0;
+/** Records written to and read back from the spill file */
+static uint16_t spillWritten = 0;
+static uint16_t spillRead = 0;
+
+/** Retries the drain, period set before every start */
+static SoftwareTimer drainTimer;
+
+/** Stats */
+uint32_t g_uplink_queued = 0;
+uint32_t g_uplink_dropped = 0;
+uint32_t g_uplink_spilled = 0;
+uint32_t g_uplink_packed = 0;
+uint8_t g_uplink_depth_max = 0;
+uint32_t g_uplink_age_last_ms = 0;
+uint32_t g_uplink_age_max_ms = 0;
+
+/**
+ * @brief Retry timer, drain from the app task
+ *
+ * @param unused Timer handle, not used
+ */
+static void drainDue(TimerHandle_t unused)
+{
+    g_task_event_type |= UPLINK_DRAIN;
+    xSemaphoreGiveFromISR(g_task_sem, &g_higher_priority_task_woken);
+}
+
+/**
+ * @brief Drain again in ms
+ *
+ */
+static void retryIn(uint32_t ms)
+{
+    drainTimer.stop();
+    drainTimer.setPeriod(max(ms, (uint32_t)100));
+    drainTimer.start();
+}
+
+/**
+ * @brief Highest priority, oldest beacon not in skip
+ *
+ * @param skip Entries already taken, nullptr for none
+ * @return int8_t Index, -1 if there is none
+ */
+static int8_t nextEntry(const bool *skip)
+{
+    int8_t best = -1;
+    for(uint8_t i = 0; i < UPLINK_QUEUE_LEN; i++)
+    {
+        if(!queue[i].used || (skip != nullptr && skip[i]))
+        {
+            continue;
+        }
+        if(best < 0 || queue[i].prio > queue[best].prio
+           || (queue[i].prio == queue[best].prio && (int32_t)(queue[i].queued_at - queue[best].queued_at) < 0))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Lowest priority, oldest beacon, the one that makes room
+ *
+ * @return int8_t Index, -1 if the queue is empty
+ */
+static int8_t victimEntry(void)
+{
+    int8_t victim = -1;
+    for(uint8_t i = 0; i < UPLINK_QUEUE_LEN; i++)
+    {
+        if(!queue[i].used)
+        {
+            continue;
+        }
+        if(victim < 0 || queue[i].prio < queue[victim].prio
+           || (queue[i].prio == queue[victim].prio && (int32_t)(queue[i].queued_at - queue[victim].queued_at) < 0))
+        {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+/**
+ * @brief Free RAM slot
+ *
+ * @return int8_t Index, -1 if the queue is full
+ */
+static int8_t freeEntry(void)
+{
+    for(uint8_t i = 0; i < UPLINK_QUEUE_LEN; i++)
+    {
+        if(!queue[i].used)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Put a beacon into the spill file
+ *
+ * @return true Written
+ */
+static bool spill(const uplink_entry_s &entry)
+{
+    if(spillWritten >= UPLINK_SPILL_MAX)
+    {
+        return false;
+    }
+    uplink_spill_s rec;
+    rec.entry = entry;
+    rec.crc = crc16_ccitt((const uint8_t *)&rec.entry, sizeof(rec.entry));
+
+    File file(InternalFS);
+    if(!file.open(spillName, FILE_O_WRITE))
+    {
+        return false;
+    }
+    /** FILE_O_WRITE opens at the end of the file */
+    bool ok = file.write((const uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    file.close();
+    if(ok)
+    {
+        spillWritten++;
+    }
+    return ok;
+}
+
+/**
+ * @brief Move spilled beacons back into free RAM slots, oldest first
+ *
+ */
+static void refill(void)
+{
+    if(spillRead >= spillWritten || depth >= UPLINK_QUEUE_LEN)
+    {
+        return;
+    }
+    File file(InternalFS);
+    if(file.open(spillName, FILE_O_READ))
+    {
+        file.seek(spillRead * sizeof(uplink_spill_s));
+        uplink_spill_s rec;
+        while(spillRead < spillWritten && depth < UPLINK_QUEUE_LEN
+              && file.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec))
+        {
+            spillRead++;
+            if(rec.crc != crc16_ccitt((const uint8_t *)&rec.entry, sizeof(rec.entry)))
+            {
+                g_uplink_dropped++;
+                continue;
+            }
+            queue[freeEntry()] = rec.entry;
+            depth++;
+        }
+        file.close();
+    } else {
+        spillRead = spillWritten;
+    }
+    if(spillRead >= spillWritten)
+    {
+        InternalFS.remove(spillName);
+        spillRead = 0;
+        spillWritten = 0;
+    }
+}
+
+/**
+ * @brief A beacon has to make room, spill it or drop it
+ *
+ */
+static void evict(const uplink_entry_s &entry)
+{
+    if(UPLINK_QUEUE_SPILL > 0 && entry.prio >= UPLINK_PRIO_FIX && spill(entry))
+    {
+        g_uplink_spilled++;
+        return;
+    }
+    g_uplink_dropped++;
+    MYLOG("UPQ", "Queue full, %s beacon dropped", entry.prio >= UPLINK_PRIO_FIX ? "position" : "No-GPS");
+}
+
+/**
+ * @brief Drop beacons that are too old to be worth sending
+ *
+ */
+static void dropStale(void)
+{
+    uint32_t now = millis();
+    for(uint8_t i = 0; i < UPLINK_QUEUE_LEN; i++)
+    {
+        if(queue[i].used && (now - queue[i].queued_at) > UPLINK_QUEUE_MAX_AGE_MS)
+        {
+            queue[i].used = false;
+            depth--;
+            g_uplink_dropped++;
+            MYLOG("UPQ", "Beacon dropped after %lds in the queue", (long)((now - queue[i].queued_at) / 1000));
+        }
+    }
+}
+
+/**
+ * @brief Start the queue, a spill file from before the reset is stale
+ *
+ */
+void uplink_queue_init(void)
+{
+    drainTimer.begin(UPLINK_RETRY_MS, drainDue, NULL, false);
+    if(UPLINK_QUEUE_SPILL > 0)
+    {
+        InternalFS.begin();
+        InternalFS.remove(spillName);
+    }
+}
+
+/**
+ * @brief Queue a beacon and send what the radio takes
+ *
+ * @param fix Position, nullptr for a No-GPS beacon
+ * @param batt_mv Battery voltage
+ * @param prio UPLINK_PRIO_NOGPS or UPLINK_PRIO_FIX
+ */
+void uplink_queue_add(const gnss_fix_s *fix, uint16_t batt_mv, uint8_t prio)
+{
+    uplink_entry_s entry;
+    if(fix != nullptr)
+    {
+        entry.fix = *fix;
+    }
+    entry.batt_mv = batt_mv;
+    entry.prio = prio;
+    entry.queued_at = millis();
+    entry.used = true;
+    g_uplink_queued++;
+
+    dropStale();
+    int8_t slot = freeEntry();
+    if(slot < 0)
+    {
+        int8_t victim = victimEntry();
+        if(queue[victim].prio > prio)
+        {
+            evict(entry);
+            return;
+        }
+        evict(queue[victim]);
+        queue[victim].used = false;
+        depth--;
+        slot = victim;
+    }
+    queue[slot] = entry;
+    depth++;
+    g_uplink_depth_max = max(g_uplink_depth_max, depth);
+
+    uplink_queue_drain();
+}
+
+/**
+ * @brief Send the queued beacons, as many per uplink as the DR allows
+ *        Called on LORA_TX_FIN, after the join and from the retry timer
+ *
+ */
+void uplink_queue_drain(void)
+{
+    dropStale();
+    refill();
+    if(depth == 0)
+    {
+        return;
+    }
+    if(!g_lpwan_has_joined || lora_busy)
+    {
+        retryIn(UPLINK_RETRY_MS);
+        return;
+    }
+
+    uint8_t payload[UPLINK_PACK_MAX];
+    uint8_t space = min(lora_dr_max_payload(g_lorawan_settings.lora_region, g_lorawan_settings.data_rate), (uint8_t)UPLINK_PACK_MAX);
+    bool taken[UPLINK_QUEUE_LEN] = {false};
+    int8_t first = nextEntry(nullptr);
+    uint8_t len = payload_build(&queue[first].fix, queue[first].batt_mv, payload);
+    taken[first] = true;
+    uint8_t count = 1;
+    while(count < depth && len < space)
+    {
+        int8_t next = nextEntry(taken);
+        uint8_t frame = payload_append(&queue[next].fix, queue[next].batt_mv, &payload[len], space - len);
+        if(frame == 0)
+        {
+            break;
+        }
+        len += frame;
+        taken[next] = true;
+        count++;
+    }
+
+    uint32_t wait = airtime_wait_ms(len);
+    if(wait > 0)
+    {
+        MYLOG("UPQ", "%d beacons wait %ldms for the duty cycle", depth, (long)wait);
+        retryIn(wait);
+        return;
+    }
+
+    lmh_error_status result = send_lora_packet(payload, len);
+    switch(result)
+    {
+    case LMH_SUCCESS:
+    {
+        APP_LOG("APP", "Packet enqueued, %d bytes, %d beacons, %ldms on air", len, count, (long)lora_uplink_airtime_ms(len));
+        airtime_tx_started(len);
+        payload_queued(len);
+        lora_busy = true;
+        uint32_t now = millis();
+        g_uplink_age_last_ms = 0;
+        for(uint8_t i = 0; i < UPLINK_QUEUE_LEN; i++)
+        {
+            if(!taken[i])
+            {
+                continue;
+            }
+            session_log_beacon(queue[i].fix);
+            g_uplink_age_last_ms = max(g_uplink_age_last_ms, now - queue[i].queued_at);
+            queue[i].used = false;
+            depth--;
+        }
+        g_uplink_age_max_ms = max(g_uplink_age_max_ms, g_uplink_age_last_ms);
+        g_uplink_packed += count - 1;
+        uplink_queue_report();
+        break;
+    }
+    case LMH_BUSY:
+        APP_LOG("APP", "LoRa transceiver is busy, %d beacons queued", depth);
+        retryIn(UPLINK_RETRY_MS);
+        break;
+    case LMH_ERROR:
+        /** Packing stays within the DR, only a single beacon can be too big */
+        APP_LOG("APP", "Packet error, too big to send with current DR");
+        queue[first].used = false;
+        depth--;
+        g_uplink_dropped++;
+        if(depth > 0)
+        {
+            retryIn(UPLINK_RETRY_MS);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Beacons waiting, in RAM and in flash
+ *
+ */
+uint16_t uplink_queue_depth(void)
+{
+    return depth + spillWritten - spillRead;
+}
+
+/**
+ * @brief Queue depth, drops and how old the sent beacons were
+ *
+ */
+void uplink_queue_report(void)
+{
+    APP_LOG("UPQ", "Queue %d (max %d, %d in flash), %ld dropped", uplink_queue_depth(), g_uplink_depth_max, spillWritten - spillRead, (long)g_uplink_dropped);
+    APP_LOG("UPQ", "Last uplink %lds old (max %lds), %ld beacons packed", (long)(g_uplink_age_last_ms / 1000), (long)(g_uplink_age_max_ms / 1000), (long)g_uplink_packed);
+}
@@ -0,0 +1,262 @@
+/**
+ * @file Adafruit_LittleFS.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in for Adafruit_LittleFS, files live in RAM
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Space is counted in whole 4 KB blocks per file like LittleFS v1 (no
+ * inline files), so a test can fill the 28 KB InternalFS. Writes that
+ * don't fit are short, like on the device. Copy-on-write blocks are not
+ * counted as space beyond the blocks LittleFS keeps for itself.
+ *
+ * What LittleFS v1 programs and erases goes through lfs_config prog and
+ * erase, so a hook on them sees it, and is added up in progBytes and
+ * erases. An append on close erases a fresh block, copies the partial
+ * last block to it and programs the new data, every further block is
+ * erased and gets a 4 byte skip-list pointer. Creating, closing after a
+ * write, removing and renaming commit the root directory: one erase and
+ * the whole directory, 20 bytes plus 12 and the name per file.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_ADAFRUIT_LITTLEFS_H
+#define HOST_ADAFRUIT_LITTLEFS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** The parts of lfs.h src/ uses */
+typedef uint32_t lfs_block_t;
+typedef uint32_t lfs_off_t;
+typedef uint32_t lfs_size_t;
+struct lfs_config
+{
+    void *context;
+    int (*prog)(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size);
+    int (*erase)(const struct lfs_config *c, lfs_block_t block);
+};
+typedef struct lfs
+{
+    const struct lfs_config *cfg;
+} lfs_t;
+
+#define FILE_O_READ 0
+#define FILE_O_WRITE 1
+
+namespace Adafruit_LittleFS_Namespace
+{
+
+class Adafruit_LittleFS
+{
+public:
+    bool begin(void) { return true; }
+    bool exists(const char *name) { return files.count(name) != 0; }
+    bool remove(const char *name)
+    {
+        if(files.erase(name) == 0)
+        {
+            return false;
+        }
+        commitDir();
+        return true;
+    }
+    bool rename(const char *from, const char *to)
+    {
+        if(!exists(from) || exists(to))
+        {
+            return false;
+        }
+        files[to] = files[from];
+        files.erase(from);
+        commitDir();
+        return true;
+    }
+    lfs_t *_getFS(void) { return &lfs; }
+
+    /** Host side */
+    static uint32_t blocksOf(size_t size) { return (uint32_t)((size + blockSize - 1) / blockSize); }
+    uint32_t usedBlocks(void)
+    {
+        uint32_t used = 0;
+        for(auto &file : files)
+        {
+            used += max(blocksOf(file.second->size()), 1U);
+        }
+        return used;
+    }
+    void format(void) { files.clear(); }
+
+    /** Flash cost of writing len bytes at from, on close */
+    void writeCost(size_t from, size_t len)
+    {
+        size_t off = from % blockSize;
+        if(from != 0 && off == 0)
+        {
+            /** Last block is full, a new one with its pointer */
+            flashErase();
+            flashProg(4);
+            off = 4;
+        }
+        else
+        {
+            flashErase();
+            if(off != 0)
+            {
+                flashProg(off);
+            }
+        }
+        while(len > 0)
+        {
+            size_t chunk = min(len, blockSize - off);
+            flashProg(chunk);
+            len -= chunk;
+            if(len > 0)
+            {
+                flashErase();
+                flashProg(4);
+                off = 4;
+            }
+        }
+    }
+    /** Root directory written to the other block of its pair */
+    void commitDir(void)
+    {
+        size_t dirBytes = 20;
+        for(auto &file : files)
+        {
+            dirBytes += 12 + file.first.size() - 1;
+        }
+        flashErase();
+        flashProg(dirBytes);
+    }
+
+    static const size_t blockSize = 4096;
+    /** 28 KB InternalFS, less the superblock and root directory pair */
+    uint32_t blockCount = 5;
+    /** Shared so an open file keeps its data when it is removed, like LittleFS */
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+    /** What reached the flash driver */
+    uint32_t progBytes = 0;
+    uint32_t erases = 0;
+    lfs_config config = {this, hostProg, hostErase};
+    lfs_t lfs = {&config};
+
+private:
+    uint32_t nextBlock = 0;
+
+    static int hostProg(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size)
+    {
+        static_cast<Adafruit_LittleFS *>(c->context)->progBytes += size;
+        return 0;
+    }
+    static int hostErase(const struct lfs_config *c, lfs_block_t block)
+    {
+        static_cast<Adafruit_LittleFS *>(c->context)->erases++;
+        return 0;
+    }
+    /** Through the config, where a hook may sit */
+    void flashProg(size_t size)
+    {
+        static const uint8_t blank[blockSize] = {0};
+        lfs.cfg->prog(lfs.cfg, nextBlock, 0, blank, (lfs_size_t)size);
+    }
+    void flashErase(void)
+    {
+        nextBlock = (nextBlock + 1) % blockCount;
+        lfs.cfg->erase(lfs.cfg, nextBlock);
+    }
+};
+
+class File
+{
+public:
+    File(Adafruit_LittleFS &fs) : fs(fs) {}
+    bool open(const char *name, uint8_t mode)
+    {
+        close();
+        if(mode == FILE_O_READ && !fs.exists(name))
+        {
+            return false;
+        }
+        if(mode == FILE_O_WRITE && !fs.exists(name) && fs.usedBlocks() >= fs.blockCount)
+        {
+            return false;
+        }
+        std::shared_ptr<std::vector<uint8_t>> &entry = fs.files[name];
+        if(!entry)
+        {
+            entry = std::make_shared<std::vector<uint8_t>>();
+            fs.commitDir();
+        }
+        data = entry;
+        /** FILE_O_WRITE appends */
+        pos = mode == FILE_O_WRITE ? data->size() : 0;
+        dirtyFrom = SIZE_MAX;
+        return true;
+    }
+    size_t write(const uint8_t *buf, size_t len)
+    {
+        if(data == nullptr)
+        {
+            return 0;
+        }
+        /** Room left in the blocks this file has plus the free ones */
+        uint32_t otherBlocks = fs.usedBlocks() - max(Adafruit_LittleFS::blocksOf(data->size()), 1U);
+        size_t room = (fs.blockCount - min(otherBlocks, fs.blockCount)) * Adafruit_LittleFS::blockSize;
+        len = min(len, room > pos ? room - pos : 0);
+        if(data->size() < pos + len)
+        {
+            data->resize(pos + len);
+        }
+        memcpy(&(*data)[pos], buf, len);
+        dirtyFrom = len != 0 ? min(dirtyFrom, pos) : dirtyFrom;
+        pos += len;
+        return len;
+    }
+    int read(uint8_t *buf, size_t len)
+    {
+        if(data == nullptr)
+        {
+            return -1;
+        }
+        len = min(len, data->size() > pos ? data->size() - pos : 0);
+        memcpy(buf, &(*data)[pos], len);
+        pos += len;
+        return (int)len;
+    }
+    bool seek(uint32_t offset)
+    {
+        pos = offset;
+        return data != nullptr && offset <= data->size();
+    }
+    uint32_t position(void) { return pos; }
+    uint32_t size(void) { return data == nullptr ? 0 : data->size(); }
+    void close(void)
+    {
+        if(data != nullptr && dirtyFrom != SIZE_MAX)
+        {
+            fs.writeCost(dirtyFrom, data->size() - dirtyFrom);
+            fs.commitDir();
+        }
+        dirtyFrom = SIZE_MAX;
+        data.reset();
+    }
+    explicit operator bool() const { return data != nullptr; }
+
+private:
+    Adafruit_LittleFS &fs;
+    std::shared_ptr<std::vector<uint8_t>> data;
+    size_t pos = 0;
+    /** Lowest offset written since open */
+    size_t dirtyFrom = SIZE_MAX;
+};
+
+}
+
+#endif
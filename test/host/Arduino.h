@@ -0,0 +1,200 @@
+/**
+ * @file Arduino.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in for the nRF52 Arduino core and FreeRTOS, native tests only
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Just enough of the core for src/ to compile on the host. Time is
+ * virtual, it only moves with delay(), vTaskDelay() and host_advance_ms().
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+
+typedef uint8_t byte;
+
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+#ifndef TWO_PI
+#define TWO_PI 6.283185307179586476925286766559
+#endif
+#define radians(deg) ((deg) * 0.017453292519943295769236907684886)
+#define degrees(rad) ((rad) * 57.295779513082320876798154814105)
+#define sq(x) ((x) * (x))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/** Virtual time */
+extern uint64_t host_now_us;
+/** Called on every delay(), lets a test feed input while the code waits */
+extern void (*host_delay_hook)(void);
+inline uint32_t millis(void) { return (uint32_t)(host_now_us / 1000); }
+inline uint32_t micros(void) { return (uint32_t)host_now_us; }
+inline void host_advance_ms(uint32_t ms) { host_now_us += (uint64_t)ms * 1000; }
+inline void delay(uint32_t ms)
+{
+    host_advance_ms(ms);
+    if(host_delay_hook != nullptr)
+    {
+        host_delay_hook();
+    }
+}
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define RISING 3
+#define LED_BUILTIN 35
+#define WB_IO2 34
+#define WB_IO5 9
+inline void pinMode(uint32_t, uint32_t) {}
+inline void digitalWrite(uint32_t, uint32_t) {}
+inline void digitalToggle(uint32_t) {}
+inline void attachInterrupt(uint32_t, void (*)(void), uint32_t) {}
+
+/** UART, writes are kept for the tests to look at */
+class HardwareSerial
+{
+public:
+    void begin(uint32_t) {}
+    explicit operator bool() const { return true; }
+    size_t write(uint8_t c) { if(txLen < sizeof(tx)) { tx[txLen++] = c; } return 1; }
+    size_t write(const uint8_t *buf, size_t len) { for(size_t i = 0; i < len; i++) { write(buf[i]); } return len; }
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t write(const char *buf, size_t len) { return write((const uint8_t *)buf, len); }
+    size_t print(const char *s) { return write(s); }
+    size_t printf(const char *fmt, ...)
+    {
+        char text[256];
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(text, sizeof(text), fmt, args);
+        va_end(args);
+        return len > 0 ? write((const uint8_t *)text, min((size_t)len, sizeof(text) - 1)) : 0;
+    }
+    int available(void) { return rxLen - rxPos; }
+    int read(void) { return rxPos < rxLen ? rx[rxPos++] : -1; }
+    size_t readBytes(uint8_t *buf, size_t len)
+    {
+        size_t n = 0;
+        while(n < len && rxPos < rxLen)
+        {
+            buf[n++] = rx[rxPos++];
+        }
+        return n;
+    }
+    void flush(void) {}
+    /** Host side */
+    void feed(const uint8_t *buf, size_t len)
+    {
+        if(rxPos == rxLen)
+        {
+            rxPos = rxLen = 0;
+        }
+        for(size_t i = 0; i < len && rxLen < (int)sizeof(rx); i++)
+        {
+            rx[rxLen++] = buf[i];
+        }
+    }
+    uint8_t tx[1024];
+    size_t txLen = 0;
+    uint8_t rx[1024];
+    int rxLen = 0;
+    int rxPos = 0;
+};
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+/** FreeRTOS, one task at a time, semaphores are counters
+*   A test sets host_task to run code as another task */
+typedef int32_t BaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void *TimerHandle_t;
+struct host_sem_s
+{
+    int32_t count;
+    bool mutex;
+};
+typedef host_sem_s *SemaphoreHandle_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define TASK_PRIO_LOWEST 0
+#define TASK_PRIO_LOW 1
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+inline SemaphoreHandle_t xSemaphoreCreateBinary(void) { return new host_sem_s{0, false}; }
+inline SemaphoreHandle_t xSemaphoreCreateMutex(void) { return new host_sem_s{1, true}; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) { sem->count = sem->mutex ? 1 : sem->count + 1; return pdTRUE; }
+inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *) { return xSemaphoreGive(sem); }
+/** Nobody else runs, a wait moves time in 1 ms ticks so a delay hook can give */
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    for(TickType_t waited = 0; sem->count <= 0 && waited < wait && wait != portMAX_DELAY; waited++)
+    {
+        delay(1);
+    }
+    if(sem->count > 0)
+    {
+        sem->count--;
+        return pdTRUE;
+    }
+    return pdFALSE;
+}
+extern TaskHandle_t host_task;
+inline TaskHandle_t xTaskGetCurrentTaskHandle(void) { return host_task; }
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+inline BaseType_t xTaskCreate(void (*)(void *), const char *, uint32_t, void *, uint32_t, TaskHandle_t *) { return pdPASS; }
+/** Tasks are never created, nobody waits for a notification */
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 1; }
+
+/** Cortex-M system control block, never in an interrupt */
+struct host_scb_s
+{
+    uint32_t ICSR;
+};
+extern host_scb_s host_scb;
+#define SCB (&host_scb)
+#define SCB_ICSR_VECTACTIVE_Msk 0x1FFUL
+
+/** Timers never fire by themselves, tests call the callbacks */
+class SoftwareTimer
+{
+public:
+    void begin(uint32_t ms, void (*cb)(TimerHandle_t), void * = nullptr, bool repeating = true)
+    {
+        period = ms;
+        callback = cb;
+        repeat = repeating;
+    }
+    void setPeriod(uint32_t ms) { period = ms; }
+    void start(void) { running = true; }
+    void stop(void) { running = false; }
+    void reset(void) { running = true; }
+    uint32_t period = 0;
+    void (*callback)(TimerHandle_t) = nullptr;
+    bool repeat = true;
+    bool running = false;
+};
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * @file InternalFileSystem.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in for the nRF52 InternalFS
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_INTERNAL_FILE_SYSTEM_H
+#define HOST_INTERNAL_FILE_SYSTEM_H
+
+#include <Adafruit_LittleFS.h>
+
+inline Adafruit_LittleFS_Namespace::Adafruit_LittleFS InternalFS;
+
+#endif
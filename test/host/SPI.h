@@ -0,0 +1,15 @@
+/**
+ * @file SPI.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in, nothing of SPI is used on the host
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#endif
@@ -0,0 +1,15 @@
+/**
+ * @file SoftwareSerial.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in, nothing of SoftwareSerial is used on the host
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_SOFTWARESERIAL_H
+#define HOST_SOFTWARESERIAL_H
+
+#endif
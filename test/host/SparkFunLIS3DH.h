@@ -0,0 +1,208 @@
+/**
+ * @file SparkFunLIS3DH.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in for the SparkFun LIS3DH library, a LIS3DH on a counting bus
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Every register access the library makes is one I2C transaction and is
+ * counted in transactions. Samples pushed by the test are in mg, they are
+ * read back 10 bit left aligned like the sensor in normal mode at 2g. With
+ * CTRL_REG5 FIFO on, OUT_X_L..OUT_Z_H reads pop the FIFO and the address
+ * wraps from OUT_Z_H back to OUT_X_L.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_SPARKFUN_LIS3DH_H
+#define HOST_SPARKFUN_LIS3DH_H
+
+#include <Arduino.h>
+#include <array>
+#include <deque>
+
+#define I2C_MODE 0
+#define SPI_MODE 1
+
+#define LIS3DH_CTRL_REG1 0x20
+#define LIS3DH_CTRL_REG2 0x21
+#define LIS3DH_CTRL_REG3 0x22
+#define LIS3DH_CTRL_REG4 0x23
+#define LIS3DH_CTRL_REG5 0x24
+#define LIS3DH_CTRL_REG6 0x25
+#define LIS3DH_OUT_X_L 0x28
+#define LIS3DH_OUT_X_H 0x29
+#define LIS3DH_OUT_Y_L 0x2A
+#define LIS3DH_OUT_Y_H 0x2B
+#define LIS3DH_OUT_Z_L 0x2C
+#define LIS3DH_OUT_Z_H 0x2D
+#define LIS3DH_FIFO_CTRL_REG 0x2E
+#define LIS3DH_FIFO_SRC_REG 0x2F
+#define LIS3DH_INT1_CFG 0x30
+#define LIS3DH_INT1_SRC 0x31
+#define LIS3DH_INT1_THS 0x32
+#define LIS3DH_INT1_DURATION 0x33
+
+typedef enum
+{
+    IMU_SUCCESS,
+    IMU_HW_ERROR,
+    IMU_NOT_SUPPORTED,
+    IMU_GENERIC_ERROR,
+    IMU_OUT_OF_BOUNDS,
+    IMU_ALL_ONES_WARNING,
+} status_t;
+
+struct SensorSettings
+{
+    uint8_t adcEnabled;
+    uint8_t tempEnabled;
+    uint16_t accelSampleRate;
+    uint8_t accelRange;
+    uint8_t xAccelEnabled;
+    uint8_t yAccelEnabled;
+    uint8_t zAccelEnabled;
+    uint8_t fifoEnabled;
+    uint8_t fifoMode;
+    uint8_t fifoThreshold;
+};
+
+class LIS3DH
+{
+public:
+    LIS3DH(uint8_t busType = I2C_MODE, uint8_t inputArg = 0x19) {}
+    SensorSettings settings = {};
+
+    status_t begin(void) { return present ? IMU_SUCCESS : IMU_HW_ERROR; }
+
+    /** Library register access, one bus transaction each */
+    status_t readRegisterRegion(uint8_t *outputPointer, uint8_t offset, uint8_t length)
+    {
+        transactions++;
+        readBytesMax = max(readBytesMax, length);
+        /** Address bit 7 is the auto increment */
+        uint8_t reg = offset & 0x7F;
+        for(uint8_t i = 0; i < length; i++)
+        {
+            outputPointer[i] = registerByte(reg);
+            if(offset & 0x80)
+            {
+                reg = fifoOn() && reg == LIS3DH_OUT_Z_H ? LIS3DH_OUT_X_L : reg + 1;
+            }
+        }
+        return present ? IMU_SUCCESS : IMU_HW_ERROR;
+    }
+    status_t readRegister(uint8_t *outputPointer, uint8_t offset)
+    {
+        return readRegisterRegion(outputPointer, offset, 1);
+    }
+    status_t readRegisterInt16(int16_t *outputPointer, uint8_t offset)
+    {
+        uint8_t raw[2];
+        status_t result = readRegisterRegion(raw, offset | 0x80, 2);
+        *outputPointer = (int16_t)(raw[0] | (raw[1] << 8));
+        return result;
+    }
+    status_t writeRegister(uint8_t offset, uint8_t dataToWrite)
+    {
+        transactions++;
+        regs[offset & 0x7F] = dataToWrite;
+        return present ? IMU_SUCCESS : IMU_HW_ERROR;
+    }
+
+    /** One register pair read per axis, like the library */
+    int16_t readRawAccelX(void)
+    {
+        int16_t raw = 0;
+        readRegisterInt16(&raw, LIS3DH_OUT_X_L);
+        return raw;
+    }
+    int16_t readRawAccelY(void)
+    {
+        int16_t raw = 0;
+        readRegisterInt16(&raw, LIS3DH_OUT_Y_L);
+        return raw;
+    }
+    int16_t readRawAccelZ(void)
+    {
+        int16_t raw = 0;
+        readRegisterInt16(&raw, LIS3DH_OUT_Z_L);
+        return raw;
+    }
+    float readFloatAccelX(void) { return calcAccel(readRawAccelX()); }
+    float readFloatAccelY(void) { return calcAccel(readRawAccelY()); }
+    float readFloatAccelZ(void) { return calcAccel(readRawAccelZ()); }
+    float calcAccel(int16_t input) { return (float)input / 15987; }
+
+    /** Host side */
+    bool present = true;
+    uint32_t transactions = 0;
+    uint8_t readBytesMax = 0;
+    /** Newest sample, what OUT_X_L..OUT_Z_H hold with the FIFO off */
+    int16_t now[3] = {0, 0, 0};
+    /** FIFO, 32 samples, the oldest is lost on overrun */
+    std::deque<std::array<int16_t, 3>> fifo;
+    bool overrun = false;
+    uint8_t int1Src = 0;
+
+    void push(int16_t x, int16_t y, int16_t z)
+    {
+        now[0] = x;
+        now[1] = y;
+        now[2] = z;
+        if(fifo.size() == 32)
+        {
+            fifo.pop_front();
+            overrun = true;
+        }
+        fifo.push_back({x, y, z});
+    }
+
+private:
+    uint8_t regs[0x40] = {0};
+    /** Sample being read out of the FIFO */
+    std::array<int16_t, 3> out = {0, 0, 0};
+
+    bool fifoOn(void) { return (regs[LIS3DH_CTRL_REG5] & 0x40) != 0; }
+
+    /** 10 bit left aligned, 4mg per LSB */
+    static uint8_t sampleByte(const int16_t *mg, uint8_t index)
+    {
+        uint16_t raw = (uint16_t)((mg[index / 2] / 4) << 6);
+        return index % 2 == 0 ? raw & 0xFF : raw >> 8;
+    }
+
+    uint8_t registerByte(uint8_t reg)
+    {
+        if(reg >= LIS3DH_OUT_X_L && reg <= LIS3DH_OUT_Z_H)
+        {
+            if(!fifoOn())
+            {
+                return sampleByte(now, reg - LIS3DH_OUT_X_L);
+            }
+            if(reg == LIS3DH_OUT_X_L && !fifo.empty())
+            {
+                out = fifo.front();
+                fifo.pop_front();
+            }
+            return sampleByte(out.data(), reg - LIS3DH_OUT_X_L);
+        }
+        if(reg == LIS3DH_FIFO_SRC_REG)
+        {
+            /** FSS tops out at 31 */
+            uint8_t src = (uint8_t)min(fifo.size(), (size_t)31) | (overrun ? 0x40 : 0x00);
+            overrun = false;
+            return src;
+        }
+        if(reg == LIS3DH_INT1_SRC)
+        {
+            uint8_t src = int1Src;
+            int1Src = 0;
+            return src;
+        }
+        return regs[reg];
+    }
+};
+
+#endif
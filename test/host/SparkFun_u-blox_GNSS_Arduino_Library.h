@@ -0,0 +1,124 @@
+/**
+ * @file SparkFun_u-blox_GNSS_Arduino_Library.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in for the SparkFun u-blox GNSS library, a RAK12500 fed by the test
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * checkUblox() asks the test for what the module has buffered by now
+ * (onCheck), checkCallbacks() hands it to the auto NAV-DOP and NAV-PVT
+ * callbacks like the library does.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_SPARKFUN_UBLOX_GNSS_H
+#define HOST_SPARKFUN_UBLOX_GNSS_H
+
+#include <Arduino.h>
+
+#define COM_TYPE_UBX 0x01
+#define VAL_CFG_SUBSEC_IOPORT 0x00000001
+#define VAL_RXM_PMREQ_WAKEUPSOURCE_UARTRX 0x00000008
+
+struct UBX_NAV_PVT_data_t
+{
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    union
+    {
+        uint8_t all;
+        struct
+        {
+            uint8_t validDate : 1;
+            uint8_t validTime : 1;
+        } bits;
+    } valid;
+    uint8_t fixType;
+    union
+    {
+        uint8_t all;
+        struct
+        {
+            uint8_t gnssFixOK : 1;
+        } bits;
+    } flags;
+    uint8_t numSV;
+    int32_t lon;
+    int32_t lat;
+    int32_t hMSL;
+    int32_t gSpeed;
+    int32_t headMot;
+};
+
+struct UBX_NAV_DOP_data_t
+{
+    uint16_t hDOP;
+};
+
+struct UBX_NAV_STATUS_data_t
+{
+    uint32_t ttff;
+};
+struct UBX_NAV_STATUS_t
+{
+    UBX_NAV_STATUS_data_t data;
+};
+
+class SFE_UBLOX_GNSS
+{
+public:
+    bool begin(void) { return present; }
+    bool setI2COutput(uint8_t) { return true; }
+    bool saveConfigSelective(uint32_t) { return true; }
+    bool setNavigationFrequency(uint8_t) { return true; }
+    bool setHighPrecisionMode(bool) { return true; }
+    bool setAutoPVTcallbackPtr(void (*cb)(UBX_NAV_PVT_data_t *)) { pvtCallback = cb; return true; }
+    bool setAutoDOPcallbackPtr(void (*cb)(UBX_NAV_DOP_data_t *)) { dopCallback = cb; return true; }
+    bool powerOffWithInterrupt(uint32_t, uint32_t) { return true; }
+    bool getNAVSTATUS(void) { return true; }
+    bool checkUblox(void)
+    {
+        reads++;
+        if(onCheck != nullptr)
+        {
+            onCheck(*this);
+        }
+        return true;
+    }
+    void checkCallbacks(void)
+    {
+        if(dopFresh && dopCallback != nullptr)
+        {
+            dopCallback(&dop);
+        }
+        if(pvtFresh && pvtCallback != nullptr)
+        {
+            pvtCallback(&pvt);
+        }
+        dopFresh = false;
+        pvtFresh = false;
+    }
+    UBX_NAV_STATUS_t *packetUBXNAVSTATUS = &navStatus;
+
+    /** Host side */
+    bool present = false;
+    void (*onCheck)(SFE_UBLOX_GNSS &gnss) = nullptr;
+    UBX_NAV_PVT_data_t pvt = {};
+    UBX_NAV_DOP_data_t dop = {};
+    bool pvtFresh = false;
+    bool dopFresh = false;
+    UBX_NAV_STATUS_t navStatus = {};
+    uint32_t reads = 0;
+
+private:
+    void (*pvtCallback)(UBX_NAV_PVT_data_t *) = nullptr;
+    void (*dopCallback)(UBX_NAV_DOP_data_t *) = nullptr;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file U8g2lib.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in for U8g2, a frame buffer, the areas sent and what the panel shows
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_U8G2LIB_H
+#define HOST_U8G2LIB_H
+
+#include <Arduino.h>
+#include <vector>
+
+/** One updateDisplayArea() call, in tiles */
+struct u8g2_area_s
+{
+    uint8_t x;
+    uint8_t y;
+    uint8_t w;
+    uint8_t h;
+};
+
+class U8G2
+{
+public:
+    uint8_t *getBufferPtr(void) { return buffer; }
+    uint8_t getBufferTileWidth(void) { return 16; }
+    uint8_t getBufferTileHeight(void) { return 8; }
+    void sendBuffer(void)
+    {
+        tilesSent += 16 * 8;
+        memcpy(panel, buffer, sizeof(panel));
+    }
+    /** Copies the tiles to the panel, a tile row is 16 tiles of 8 bytes */
+    void updateDisplayArea(uint8_t x, uint8_t y, uint8_t w, uint8_t h)
+    {
+        tilesSent += w * h;
+        areas.push_back({x, y, w, h});
+        if(onArea != nullptr)
+        {
+            onArea();
+        }
+        for(uint8_t row = y; row < y + h; row++)
+        {
+            memcpy(&panel[(row * 16 + x) * 8], &buffer[(row * 16 + x) * 8], w * 8);
+        }
+    }
+    void begin(void) {}
+    void setPowerSave(uint8_t) {}
+    /** Drawing only counts, nothing is rendered */
+    void clearBuffer(void) { memset(buffer, 0, sizeof(buffer)); }
+    void setFont(const uint8_t *) {}
+    void drawStr(int16_t, int16_t, const char *) { draws++; }
+    void drawGlyph(int16_t, int16_t, uint16_t) { draws++; }
+    void drawLine(int16_t, int16_t, int16_t, int16_t) { draws++; }
+    void drawXBM(int16_t, int16_t, int16_t, int16_t, const uint8_t *) { draws++; }
+    uint8_t buffer[1024] = {0};
+    /** What the display shows */
+    uint8_t panel[1024] = {0};
+    std::vector<u8g2_area_s> areas;
+    /** Called after each area, while the bus is held */
+    void (*onArea)(void) = nullptr;
+    uint32_t tilesSent = 0;
+    uint32_t draws = 0;
+};
+
+#define U8G2_R0 nullptr
+#define U8G2_R2 nullptr
+class U8G2_SSD1306_128X64_NONAME_F_HW_I2C : public U8G2
+{
+public:
+    U8G2_SSD1306_128X64_NONAME_F_HW_I2C(const void *) {}
+};
+static const uint8_t u8g2_font_micro_mr[1] = {0};
+static const uint8_t u8g2_font_siji_t_6x10[1] = {0};
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * @file WProgram.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Pre 1.0 Arduino core header, libraries that check ARDUINO include it
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_WPROGRAM_H
+#define HOST_WPROGRAM_H
+
+#include <Arduino.h>
+
+#endif
@@ -0,0 +1,24 @@
+/**
+ * @file Wire.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in for the Arduino Wire library
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+    void begin(void) {}
+};
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * @file WisBlock-API.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Host stand-in for the WisBlock-API globals src/ uses
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_WISBLOCK_API_H
+#define HOST_WISBLOCK_API_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+/** LoRaMacRegion_t order */
+enum
+{
+    LORAMAC_REGION_AS923 = 0,
+    LORAMAC_REGION_AU915,
+    LORAMAC_REGION_CN470,
+    LORAMAC_REGION_CN779,
+    LORAMAC_REGION_EU433,
+    LORAMAC_REGION_EU868,
+    LORAMAC_REGION_KR920,
+    LORAMAC_REGION_IN865,
+    LORAMAC_REGION_US915,
+    LORAMAC_REGION_AS923_2,
+    LORAMAC_REGION_AS923_3,
+    LORAMAC_REGION_AS923_4,
+    LORAMAC_REGION_RU864,
+};
+
+typedef enum
+{
+    LMH_UNCONFIRMED_MSG = 0,
+    LMH_CONFIRMED_MSG = 1,
+} lmh_confirm;
+
+typedef enum
+{
+    LMH_SUCCESS = 0,
+    LMH_BUSY = -1,
+    LMH_ERROR = -2,
+} lmh_error_status;
+
+/** The fields of the WisBlock-API settings src/ reads */
+struct s_lorawan_settings
+{
+    uint32_t send_repeat_time = 0;
+    uint8_t join_trials = 5;
+    uint8_t data_rate = 0;
+    uint8_t lora_region = LORAMAC_REGION_EU868;
+    uint8_t subband_channels = 1;
+    lmh_confirm confirmed_msg_enabled = LMH_UNCONFIRMED_MSG;
+};
+
+extern s_lorawan_settings g_lorawan_settings;
+extern int16_t g_last_rssi;
+extern int8_t g_last_snr;
+/** Battery in mV, host_batt_mv */
+float read_batt(void);
+extern float host_batt_mv;
+extern volatile uint16_t g_task_event_type;
+extern SemaphoreHandle_t g_task_sem;
+
+/** Events the API sets in g_task_event_type */
+#define STATUS 0b0000000000000001
+#define N_STATUS 0b1111111111111110
+#define LORA_JOIN_FIN 0b0000000001000000
+#define N_LORA_JOIN_FIN 0b1111111110111111
+
+extern bool g_join_result;
+extern bool g_lpwan_has_joined;
+/** Defined by the tests that send */
+lmh_error_status send_lora_packet(uint8_t *data, uint8_t size, uint8_t fport = 0);
+/** BLE UART, writes are kept for the tests to look at */
+class BLEUart : public HardwareSerial
+{
+};
+extern BLEUart g_ble_uart;
+extern bool g_ble_uart_is_connected;
+extern uint8_t g_rx_lora_data[256];
+extern uint8_t g_rx_data_len;
+extern char *region_names[];
+uint8_t mv_to_percent(float mvolts);
+
+#endif
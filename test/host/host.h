@@ -0,0 +1,124 @@
+/**
+ * @file host.h
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Globals of the host stand-ins, include once per test before the sources
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * A test is one translation unit, it includes this file, then the
+ * src/ files it tests, then its test cases.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdarg.h>
+#include <Arduino.h>
+#include <WisBlock-API.h>
+#include <app_log.h>
+
+uint64_t host_now_us = 0;
+void (*host_delay_hook)(void) = nullptr;
+TaskHandle_t host_task = (TaskHandle_t)1;
+host_scb_s host_scb = {0};
+HardwareSerial Serial;
+HardwareSerial Serial1;
+s_lorawan_settings g_lorawan_settings;
+int16_t g_last_rssi = 0;
+int8_t g_last_snr = 0;
+float host_batt_mv = 4000.0f;
+float read_batt(void) { return host_batt_mv; }
+volatile uint16_t g_task_event_type = 0;
+SemaphoreHandle_t g_task_sem = xSemaphoreCreateBinary();
+BaseType_t g_higher_priority_task_woken = pdFALSE;
+bool g_join_result = false;
+bool g_lpwan_has_joined = false;
+BLEUart g_ble_uart;
+bool g_ble_uart_is_connected = false;
+uint8_t g_rx_lora_data[256];
+uint8_t g_rx_data_len = 0;
+char *region_names[] = {(char *)"AS923", (char *)"AU915", (char *)"CN470", (char *)"CN779", (char *)"EU433", (char *)"EU868", (char *)"KR920",
+                        (char *)"IN865", (char *)"US915", (char *)"AS923-2", (char *)"AS923-3", (char *)"AS923-4", (char *)"RU864"};
+/** Linear 3.0V to 4.2V, close enough for the display */
+uint8_t mv_to_percent(float mvolts) { return constrain((mvolts - 3000) / 12, 0, 100); }
+TwoWire Wire;
+
+/** Print the log with -DHOST_LOG=1 */
+#ifndef HOST_LOG
+#define HOST_LOG 0
+#endif
+
+/** Tests of log_sink.cpp define HOST_LOG_SINK and get the real one */
+#ifndef HOST_LOG_SINK
+/**
+ * @brief Log sink, formats at once instead of queueing
+ *
+ */
+void log_push(uint8_t sinks, const char *tag, const char *fmt, const log_arg_u *args, uint8_t count)
+{
+    (void)sinks;
+    if(!HOST_LOG)
+    {
+        return;
+    }
+    /** Same as the log task, every argument is 32 bit or a pointer */
+    char line[256];
+    const char *p = fmt;
+    size_t len = 0;
+    uint8_t arg = 0;
+    while(*p != '\0' && len < sizeof(line) - 1)
+    {
+        if(*p != '%' || p[1] == '%' || arg >= count)
+        {
+            line[len++] = *p;
+            p += (*p == '%' && p[1] == '%') ? 2 : 1;
+            continue;
+        }
+        char spec[16];
+        uint8_t specLen = 0;
+        while(*p != '\0' && specLen < sizeof(spec) - 1)
+        {
+            spec[specLen++] = *p;
+            if(strchr("diouxXcsfeEgG", *p++) != nullptr && specLen > 1)
+            {
+                break;
+            }
+        }
+        spec[specLen] = '\0';
+        char conv = spec[specLen - 1];
+        int n;
+        if(conv == 's')
+        {
+            n = snprintf(&line[len], sizeof(line) - len, spec, args[arg].s);
+        }
+        else if(strchr("feEgG", conv) != nullptr)
+        {
+            n = snprintf(&line[len], sizeof(line) - len, spec, (double)args[arg].f);
+        }
+        else
+        {
+            /** %ld and %d alike, the value is 32 bit */
+            char flat[16];
+            uint8_t f = 0;
+            for(uint8_t i = 0; i < specLen; i++)
+            {
+                if(spec[i] != 'l')
+                {
+                    flat[f++] = spec[i];
+                }
+            }
+            flat[f] = '\0';
+            n = snprintf(&line[len], sizeof(line) - len, flat, args[arg].i);
+        }
+        arg++;
+        len = min(len + (n > 0 ? n : 0), sizeof(line) - 1);
+    }
+    line[len] = '\0';
+    printf("[%s] %s\n", tag, line);
+}
+#endif
+
+#endif
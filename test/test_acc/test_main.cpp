@@ -0,0 +1,137 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief LIS3DH reads on a mock bus, I2C transactions per read and per batch
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include "../../src/activity.cpp"
+#include "../../src/acc.cpp"
+
+/** The bus is always free */
+bool i2c_acquire(uint8_t dev) { return true; }
+void i2c_release(uint8_t dev) {}
+
+/** CTRL_REG5 as init_acc() leaves it, FIFO and latched INT1 */
+static const uint8_t ctrlReg5 = ACC_FIFO_EN | ACC_LIR_INT1;
+
+/**
+ * @brief read_acc() before the burst read, each axis read to convert and again for the log
+ *
+ */
+static void readAccFloat(int16_t &acc_x, int16_t &acc_y, int16_t &acc_z)
+{
+    acc_x = (int16_t)(acc_sensor.readFloatAccelX() * 1000.0);
+    acc_y = (int16_t)(acc_sensor.readFloatAccelY() * 1000.0);
+    acc_z = (int16_t)(acc_sensor.readFloatAccelZ() * 1000.0);
+    acc_sensor.readFloatAccelX();
+    acc_sensor.readFloatAccelY();
+    acc_sensor.readFloatAccelZ();
+}
+
+void setUp(void)
+{
+    acc_sensor.present = true;
+    acc_sensor.fifo.clear();
+    acc_sensor.overrun = false;
+    TEST_ASSERT_TRUE(init_acc());
+    acc_sensor.transactions = 0;
+    acc_sensor.readBytesMax = 0;
+    g_acc_i2c_transactions = 0;
+}
+void tearDown(void) {}
+
+/** One burst instead of six register pair reads, same mg */
+static void test_read_acc(void)
+{
+    /** FIFO off, OUT_X_L..OUT_Z_H is the newest sample */
+    acc_sensor.writeRegister(LIS3DH_CTRL_REG5, ctrlReg5 & ~ACC_FIFO_EN);
+    acc_sensor.push(-252, 36, 1012);
+    acc_sensor.transactions = 0;
+
+    int16_t x, y, z;
+    readAccFloat(x, y, z);
+    uint32_t before = acc_sensor.transactions;
+    TEST_ASSERT_EQUAL_UINT32(6, before);
+    /** The library scales by 1/15987g per count, a bit off the 4mg per LSB */
+    TEST_ASSERT_INT32_WITHIN(2, -252, x);
+    TEST_ASSERT_INT32_WITHIN(2, 1012, z);
+
+    acc_sensor.transactions = 0;
+    TEST_ASSERT_TRUE(read_acc(x, y, z));
+    TEST_ASSERT_EQUAL_UINT32(1, acc_sensor.transactions);
+    TEST_ASSERT_EQUAL_UINT32(1, g_acc_i2c_transactions);
+    TEST_ASSERT_EQUAL_UINT8(ACC_SAMPLE_BYTES, acc_sensor.readBytesMax);
+    TEST_ASSERT_EQUAL_INT16(-252, x);
+    TEST_ASSERT_EQUAL_INT16(36, y);
+    TEST_ASSERT_EQUAL_INT16(1012, z);
+    printf("read_acc    %lu transaction, was %lu\n", (unsigned long)acc_sensor.transactions, (unsigned long)before);
+}
+
+/** A full FIFO batch in bursts that fit the Wire buffer */
+static void test_read_block(void)
+{
+    for(int16_t i = 0; i < 30; i++)
+    {
+        acc_sensor.push(i * 4, -i * 8, 1000 + i * 4);
+    }
+    int16_t x[ACC_FIFO_SIZE], y[ACC_FIFO_SIZE], z[ACC_FIFO_SIZE];
+    TEST_ASSERT_EQUAL_UINT8(30, read_acc_block(x, y, z, 30));
+    TEST_ASSERT_EQUAL_UINT32(3, acc_sensor.transactions);
+    TEST_ASSERT_EQUAL_UINT32(3, g_acc_i2c_transactions);
+    TEST_ASSERT_TRUE(acc_sensor.readBytesMax <= 64);
+    TEST_ASSERT_TRUE(acc_sensor.fifo.empty());
+    for(int16_t i = 0; i < 30; i++)
+    {
+        TEST_ASSERT_EQUAL_INT16(i * 4, x[i]);
+        TEST_ASSERT_EQUAL_INT16(-i * 8, y[i]);
+        TEST_ASSERT_EQUAL_INT16(1000 + i * 4, z[i]);
+    }
+    /** Not ready, nothing read */
+    acc_ready = false;
+    TEST_ASSERT_EQUAL_UINT8(0, read_acc_block(x, y, z, 30));
+    TEST_ASSERT_FALSE(read_acc(x[0], y[0], z[0]));
+    acc_ready = true;
+    TEST_ASSERT_EQUAL_UINT32(3, acc_sensor.transactions);
+}
+
+/** Every transaction of a batch wakeup is counted, walking at 2 steps per second */
+static void test_batch(void)
+{
+    for(uint8_t i = 0; i < ACC_FIFO_WTM; i++)
+    {
+        int16_t swing = (int16_t)(lround(75.0 * sin(2 * M_PI * 2.0 * i / ACC_ODR_HZ)) * 4);
+        acc_sensor.push(20, -40, 1000 + swing);
+    }
+    acc_mode = ACC_MODE_MOVEMENT;
+    TEST_ASSERT_EQUAL_UINT8(ACTIVITY_WALKING, acc_batch());
+    TEST_ASSERT_EQUAL_UINT8(ACC_MODE_BATCH, acc_mode);
+    /** FIFO_SRC, 3 bursts, CTRL_REG3 for the watermark, INT1_SRC */
+    TEST_ASSERT_EQUAL_UINT32(6, acc_sensor.transactions);
+    TEST_ASSERT_EQUAL_UINT32(acc_sensor.transactions, g_acc_i2c_transactions);
+    printf("acc_batch   %lu transactions for %u samples\n", (unsigned long)acc_sensor.transactions, ACC_FIFO_WTM);
+
+    /** Overrun while waiting for the watermark is counted */
+    for(uint8_t i = 0; i < ACC_FIFO_SIZE + 4; i++)
+    {
+        acc_sensor.push(0, 0, 1000);
+    }
+    uint32_t overruns = g_acc_overruns;
+    acc_batch();
+    TEST_ASSERT_EQUAL_UINT32(overruns + 1, g_acc_overruns);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_read_acc);
+    RUN_TEST(test_read_block);
+    RUN_TEST(test_batch);
+    return UNITY_END();
+}
@@ -0,0 +1,200 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Region tables, time on air and duty cycle of airtime.cpp
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Time on air values are the Semtech LoRa calculator (AN1200.13) with
+ * the settings airtime.cpp assumes: 8 symbol preamble, explicit header,
+ * CRC on, CR 4/5, low data rate optimize at SF11/SF12 125kHz.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include "../../src/airtime.cpp"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+struct toa_case_s
+{
+    uint8_t sf;
+    uint16_t bw;
+    uint8_t phy_len;
+    uint32_t us;
+};
+
+/** PHY 13 is an empty LoRaWAN uplink, 23 a 10 byte payload, 64 the EU868 DR0 max, 255 the LoRa max */
+static const toa_case_s toaCases[] = {
+    {7, 125, 13, 46336}, {7, 125, 23, 61696}, {7, 125, 64, 118016}, {7, 125, 255, 399616},
+    {8, 125, 13, 82432}, {8, 125, 23, 113152}, {8, 125, 64, 215552}, {8, 125, 255, 707072},
+    {9, 125, 13, 164864}, {9, 125, 23, 205824}, {9, 125, 64, 390144}, {9, 125, 255, 1250304},
+    {10, 125, 13, 288768}, {10, 125, 23, 370688}, {10, 125, 64, 698368}, {10, 125, 255, 2295808},
+    {11, 125, 13, 577536}, {11, 125, 23, 823296}, {11, 125, 64, 1560576}, {11, 125, 255, 5001216},
+    {12, 125, 13, 1155072}, {12, 125, 23, 1482752}, {12, 125, 64, 2793472}, {12, 125, 255, 9019392},
+    {7, 250, 13, 23168}, {7, 250, 23, 30848}, {7, 250, 64, 59008}, {7, 250, 255, 199808},
+    {7, 500, 13, 11584}, {7, 500, 23, 15424}, {7, 500, 64, 29504}, {7, 500, 255, 99904},
+    {8, 500, 13, 20608}, {8, 500, 23, 28288}, {8, 500, 64, 53888}, {8, 500, 255, 176768},
+    {9, 500, 13, 41216}, {9, 500, 23, 51456}, {9, 500, 64, 97536}, {9, 500, 255, 312576},
+    {10, 500, 13, 72192}, {10, 500, 23, 92672}, {10, 500, 64, 174592}, {10, 500, 255, 573952},
+    {11, 500, 13, 144384}, {11, 500, 23, 185344}, {11, 500, 64, 328704}, {11, 500, 255, 1045504},
+    {12, 500, 13, 288768}, {12, 500, 23, 329728}, {12, 500, 64, 616448}, {12, 500, 255, 1927168},
+};
+
+static void test_time_on_air(void)
+{
+    char msg[48];
+    for(const toa_case_s &c : toaCases)
+    {
+        snprintf(msg, sizeof(msg), "SF%d BW%d %d bytes", c.sf, c.bw, c.phy_len);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(c.us, lora_time_on_air_us(c.sf, c.bw, c.phy_len), msg);
+    }
+}
+
+/** Uplink airtime adds the LoRaWAN overhead and rounds up to ms */
+static void test_uplink_airtime(void)
+{
+    g_lorawan_settings.lora_region = LORAMAC_REGION_EU868;
+    g_lorawan_settings.data_rate = 0;
+    TEST_ASSERT_EQUAL_UINT32(1483, lora_uplink_airtime_ms(10));
+    g_lorawan_settings.data_rate = 5;
+    TEST_ASSERT_EQUAL_UINT32(62, lora_uplink_airtime_ms(10));
+    g_lorawan_settings.data_rate = 6;
+    TEST_ASSERT_EQUAL_UINT32(31, lora_uplink_airtime_ms(10));
+    g_lorawan_settings.lora_region = LORAMAC_REGION_US915;
+    g_lorawan_settings.data_rate = 4;
+    TEST_ASSERT_EQUAL_UINT32(29, lora_uplink_airtime_ms(10));
+    /** RFU */
+    g_lorawan_settings.data_rate = 5;
+    TEST_ASSERT_EQUAL_UINT32(0, lora_uplink_airtime_ms(10));
+}
+
+static void test_region_tables(void)
+{
+    TEST_ASSERT_EQUAL_INT8(12, lora_dr_sf(LORAMAC_REGION_EU868, 0));
+    TEST_ASSERT_EQUAL_INT8(7, lora_dr_sf(LORAMAC_REGION_EU868, 6));
+    TEST_ASSERT_EQUAL_UINT8(51, lora_dr_max_payload(LORAMAC_REGION_EU868, 0));
+    TEST_ASSERT_EQUAL_UINT8(222, lora_dr_max_payload(LORAMAC_REGION_EU868, 5));
+    TEST_ASSERT_EQUAL_INT8(0, lora_dr_sf(LORAMAC_REGION_EU868, 7));
+
+    TEST_ASSERT_EQUAL_INT8(10, lora_dr_sf(LORAMAC_REGION_US915, 0));
+    TEST_ASSERT_EQUAL_UINT8(11, lora_dr_max_payload(LORAMAC_REGION_US915, 0));
+    TEST_ASSERT_EQUAL_INT8(8, lora_dr_sf(LORAMAC_REGION_US915, 4));
+    TEST_ASSERT_EQUAL_INT8(0, lora_dr_sf(LORAMAC_REGION_US915, 5));
+    TEST_ASSERT_EQUAL_INT8(12, lora_dr_sf(LORAMAC_REGION_US915, 8));
+    TEST_ASSERT_EQUAL_UINT8(0, lora_dr_max_payload(LORAMAC_REGION_US915, 14));
+
+    /** Dwell time limited, DR0/DR1 carry nothing */
+    TEST_ASSERT_EQUAL_UINT8(0, lora_dr_max_payload(LORAMAC_REGION_AS923, 0));
+    TEST_ASSERT_EQUAL_UINT8(11, lora_dr_max_payload(LORAMAC_REGION_AS923_3, 2));
+    TEST_ASSERT_EQUAL_INT8(8, lora_dr_sf(LORAMAC_REGION_AU915, 6));
+    TEST_ASSERT_EQUAL_UINT8(242, lora_dr_max_payload(LORAMAC_REGION_CN470, 5));
+
+    TEST_ASSERT_EQUAL_INT8(0, lora_dr_sf(13, 0));
+    TEST_ASSERT_EQUAL_UINT8(0, lora_dr_max_payload(255, 0));
+}
+
+/** Every max payload of an uplink data rate of a dwell limited region fits in 400ms */
+static void test_dwell_time(void)
+{
+    /** Region and its uplink data rates, the US915 DR8+ are downlink only */
+    static const uint8_t dwellRegions[][2] = {{LORAMAC_REGION_AS923, 7}, {LORAMAC_REGION_AU915, 7}, {LORAMAC_REGION_US915, 5}, {LORAMAC_REGION_AS923_4, 7}};
+    for(const uint8_t *entry : dwellRegions)
+    {
+        uint8_t region = entry[0];
+        g_lorawan_settings.lora_region = region;
+        for(uint8_t dr = 0; dr < entry[1]; dr++)
+        {
+            g_lorawan_settings.data_rate = dr;
+            uint8_t max = lora_dr_max_payload(region, dr);
+            if(max == 0)
+            {
+                continue;
+            }
+            TEST_ASSERT_TRUE(airtime_payload_ok(max));
+            TEST_ASSERT_LESS_OR_EQUAL_UINT32(400, lora_uplink_airtime_ms(max));
+            TEST_ASSERT_FALSE(airtime_payload_ok(max + 1));
+        }
+    }
+    /** US915 DR0, 11 bytes is 371ms */
+    g_lorawan_settings.lora_region = LORAMAC_REGION_US915;
+    g_lorawan_settings.data_rate = 0;
+    TEST_ASSERT_EQUAL_UINT32(371, lora_uplink_airtime_ms(11));
+}
+
+/** No duty cycle, only the TX cycle between uplinks */
+static void test_no_duty_cycle(void)
+{
+    g_lorawan_settings.lora_region = LORAMAC_REGION_US915;
+    g_lorawan_settings.data_rate = 0;
+    TEST_ASSERT_EQUAL_UINT32(0, airtime_wait_ms(11));
+    airtime_tx_started(11);
+    TEST_ASSERT_EQUAL_UINT32(AIRTIME_TX_CYCLE_MS, airtime_wait_ms(11));
+    host_advance_ms(1000);
+    TEST_ASSERT_EQUAL_UINT32(AIRTIME_TX_CYCLE_MS - 1000, airtime_wait_ms(11));
+    host_advance_ms(AIRTIME_TX_CYCLE_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, airtime_wait_ms(11));
+}
+
+/** 1 %: the next uplink starts 100 x airtime after the last one started */
+static void test_duty_cycle_off_time(void)
+{
+    g_lorawan_settings.lora_region = LORAMAC_REGION_EU868;
+    g_lorawan_settings.data_rate = 0;
+    host_advance_ms(DUTY_CYCLE_WINDOW_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, airtime_wait_ms(10));
+    airtime_tx_started(10);
+    TEST_ASSERT_EQUAL_UINT32(148300, airtime_wait_ms(10));
+    host_advance_ms(148300 - 1);
+    TEST_ASSERT_EQUAL_UINT32(1, airtime_wait_ms(10));
+    host_advance_ms(1);
+    TEST_ASSERT_EQUAL_UINT32(0, airtime_wait_ms(10));
+    /** Faster data rates free the channel sooner */
+    g_lorawan_settings.data_rate = 5;
+    airtime_tx_started(10);
+    TEST_ASSERT_EQUAL_UINT32(62 * 100, airtime_wait_ms(10));
+}
+
+/** Uplinks sent without waiting (i.e. retries) drain the hourly budget */
+static void test_duty_cycle_budget(void)
+{
+    g_lorawan_settings.lora_region = LORAMAC_REGION_EU868;
+    g_lorawan_settings.data_rate = 0;
+    /** Refill to the full 36s of the hour */
+    host_advance_ms(DUTY_CYCLE_WINDOW_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, airtime_wait_ms(10));
+    TEST_ASSERT_EQUAL_UINT32(DUTY_CYCLE_WINDOW_MS / 100, budgetMs);
+    for(uint8_t i = 0; i < 25; i++)
+    {
+        airtime_tx_started(10);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, budgetMs);
+    /** A longer uplink is held by the budget, not the last uplink's off time */
+    uint32_t longAirtime = lora_uplink_airtime_ms(51);
+    TEST_ASSERT_EQUAL_UINT32(2794, longAirtime);
+    TEST_ASSERT_EQUAL_UINT32(longAirtime * 100, airtime_wait_ms(51));
+    /** Refills at 1 ms per 100 ms */
+    host_advance_ms(100000);
+    TEST_ASSERT_EQUAL_UINT32((longAirtime - 1000) * 100, airtime_wait_ms(51));
+    TEST_ASSERT_EQUAL_UINT32(1000, budgetMs);
+    host_advance_ms(DUTY_CYCLE_WINDOW_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, airtime_wait_ms(51));
+    TEST_ASSERT_EQUAL_UINT32(DUTY_CYCLE_WINDOW_MS / 100, budgetMs);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_time_on_air);
+    RUN_TEST(test_uplink_airtime);
+    RUN_TEST(test_region_tables);
+    RUN_TEST(test_dwell_time);
+    RUN_TEST(test_no_duty_cycle);
+    RUN_TEST(test_duty_cycle_off_time);
+    RUN_TEST(test_duty_cycle_budget);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Counter log on the InternalFS stand-in, flash cost per beacon and the log switch
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The flash cost is what the stand-in programs and erases for LittleFS
+ * v1, seen through the hookFlash() callbacks like on the device.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include "../../src/crc.cpp"
+#include "../../src/counters.cpp"
+
+/** Forget everything in RAM, like a reboot */
+static void reboot(void)
+{
+    g_lifetime_tx = 0;
+    g_lifetime_rx = 0;
+    seq = 0;
+    activeLog = 0;
+    activeRecords = 0;
+    countersReady = false;
+    counters_init();
+}
+
+/** Records in a log file, 0 if there is none */
+static uint32_t recordsIn(const char *name)
+{
+    return InternalFS.exists(name) ? InternalFS.files[name]->size() / sizeof(counter_record_s) : 0;
+}
+
+void setUp(void)
+{
+    InternalFS.format();
+    InternalFS.blockCount = 5;
+    InternalFS.progBytes = 0;
+    InternalFS.erases = 0;
+    g_counter_flash_writes = 0;
+    g_counter_flash_prog_bytes = 0;
+    g_counter_flash_erases = 0;
+    reboot();
+}
+void tearDown(void) {}
+
+/** Bytes programmed and blocks erased for each beacon, across two log switches */
+static void test_flash_per_beacon(void)
+{
+    const uint32_t beacons = 2 * COUNTER_LOG_MAX_RECORDS + 8;
+    uint32_t progMax = 0;
+    uint32_t erasesMax = 0;
+    uint32_t switchProg = 0;
+    uint32_t switchErases = 0;
+    for(uint32_t i = 0; i < beacons; i++)
+    {
+        uint32_t prog = g_counter_flash_prog_bytes;
+        uint32_t erases = g_counter_flash_erases;
+        bool switching = activeRecords >= COUNTER_LOG_MAX_RECORDS;
+        counters_tx();
+        prog = g_counter_flash_prog_bytes - prog;
+        erases = g_counter_flash_erases - erases;
+        if(switching)
+        {
+            switchProg = max(switchProg, prog);
+            switchErases = max(switchErases, erases);
+            continue;
+        }
+        progMax = max(progMax, prog);
+        erasesMax = max(erasesMax, erases);
+        /** The tail block copied and the new record, plus the directory */
+        TEST_ASSERT_TRUE(prog >= (activeRecords - 1) % (FS_BLOCK_SIZE / sizeof(counter_record_s)) * sizeof(counter_record_s) + sizeof(counter_record_s));
+    }
+
+    /** Every program and erase of a record went through the hook */
+    TEST_ASSERT_EQUAL_UINT32(InternalFS.progBytes, g_counter_flash_prog_bytes);
+    TEST_ASSERT_EQUAL_UINT32(InternalFS.erases, g_counter_flash_erases);
+    TEST_ASSERT_EQUAL_UINT32(beacons, g_counter_flash_writes);
+    TEST_ASSERT_EQUAL_UINT32(1, InternalFS.files.size());
+    /** Bounded by the log size, not by the records ever written */
+    TEST_ASSERT_TRUE(progMax <= COUNTER_LOG_SIZE + 64);
+    /** Data block and directory, the first record also creates the file */
+    TEST_ASSERT_EQUAL_UINT32(3, erasesMax);
+    printf("%lu beacons: %lu bytes programmed (mean %lu, max %lu), %lu erases (max %lu) per beacon, a log switch %lu bytes and %lu erases\n",
+           (unsigned long)beacons, (unsigned long)g_counter_flash_prog_bytes, (unsigned long)(g_counter_flash_prog_bytes / beacons), (unsigned long)progMax,
+           (unsigned long)(g_counter_flash_erases / beacons), (unsigned long)erasesMax, (unsigned long)switchProg, (unsigned long)switchErases);
+}
+
+/** The newest record comes back after a reboot, from the log written last */
+static void test_reboot(void)
+{
+    for(uint32_t i = 0; i < COUNTER_LOG_MAX_RECORDS + 44; i++)
+    {
+        counters_rx();
+        counters_tx();
+    }
+    /** A reply after the last beacon is lost */
+    counters_rx();
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(COUNTER_LOG_MAX_RECORDS + 44, g_lifetime_tx);
+    TEST_ASSERT_EQUAL_UINT32(COUNTER_LOG_MAX_RECORDS + 44, g_lifetime_rx);
+    TEST_ASSERT_EQUAL_UINT8(1, activeLog);
+    TEST_ASSERT_EQUAL_UINT16(44, activeRecords);
+    TEST_ASSERT_FALSE(InternalFS.exists(logFiles[0]));
+}
+
+/** A record cut by a power loss fails its CRC, the one before it wins */
+static void test_torn_record(void)
+{
+    for(uint8_t i = 0; i < 10; i++)
+    {
+        counters_tx();
+    }
+    std::vector<uint8_t> &log = *InternalFS.files[logFiles[0]];
+    log[log.size() - 1] ^= 0xFF;
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(9, g_lifetime_tx);
+    /** Appending goes on after it */
+    counters_tx();
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(10, g_lifetime_tx);
+}
+
+/** No room for the other log, the full one is kept until the switch works */
+static void test_switch_fails(void)
+{
+    for(uint32_t i = 0; i < COUNTER_LOG_MAX_RECORDS; i++)
+    {
+        counters_tx();
+    }
+    TEST_ASSERT_EQUAL_UINT32(COUNTER_LOG_MAX_RECORDS, recordsIn(logFiles[0]));
+
+    InternalFS.blockCount = InternalFS.usedBlocks();
+    counters_tx();
+    TEST_ASSERT_EQUAL_UINT32(COUNTER_LOG_MAX_RECORDS, recordsIn(logFiles[0]));
+    TEST_ASSERT_FALSE(InternalFS.exists(logFiles[1]));
+    TEST_ASSERT_EQUAL_UINT8(0, activeLog);
+    TEST_ASSERT_EQUAL_UINT32(COUNTER_LOG_MAX_RECORDS, g_counter_flash_writes);
+
+    /** The beacon that didn't make it is lost, the ones before are not */
+    uint32_t tx = g_lifetime_tx;
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(tx - 1, g_lifetime_tx);
+    g_lifetime_tx = tx;
+
+    InternalFS.blockCount = 5;
+    counters_tx();
+    TEST_ASSERT_FALSE(InternalFS.exists(logFiles[0]));
+    TEST_ASSERT_EQUAL_UINT32(1, recordsIn(logFiles[1]));
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(tx + 1, g_lifetime_tx);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_flash_per_beacon);
+    RUN_TEST(test_reboot);
+    RUN_TEST(test_torn_record);
+    RUN_TEST(test_switch_fails);
+    return UNITY_END();
+}
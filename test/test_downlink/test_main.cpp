@@ -0,0 +1,210 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Round trip of tools/downlink_encode.py payloads through downlink_decode()
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The binary payloads are the encoder output for the fields next to them,
+ * i.e. downlink_encode.py encode --name a --rssi -97 --snr -7.25 --hex
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <string>
+#include "../../src/downlink.cpp"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/**
+ * @brief Hex string to bytes
+ *
+ */
+static uint16_t fromHex(const char *hex, uint8_t *out)
+{
+    uint16_t len = 0;
+    for(; hex[0] != '\0' && hex[1] != '\0'; hex += 2)
+    {
+        char byte[3] = {hex[0], hex[1], '\0'};
+        out[len++] = (uint8_t)strtoul(byte, nullptr, 16);
+    }
+    return len;
+}
+
+static bool decodeHex(const char *hex, downlink_hotspot_s &hs)
+{
+    uint8_t buf[128];
+    uint16_t len = fromHex(hex, buf);
+    return downlink_decode(buf, len, hs);
+}
+
+static bool decodeText(const char *json, downlink_hotspot_s &hs)
+{
+    return downlink_decode((const uint8_t *)json, strlen(json), hs);
+}
+
+/** --name bumpy-red-fox --rssi -112 --snr 4.5 --lat 45.42153 --long -75.69719 --hotspots 3 */
+static void test_binary_all_fields(void)
+{
+    downlink_hotspot_s hs;
+    TEST_ASSERT_TRUE(decodeHex("a1010d62756d70792d7265642d666f78020290120308c94e4500c97e8cff040103", hs));
+    TEST_ASSERT_EQUAL_STRING("bumpy-red-fox", hs.name);
+    TEST_ASSERT_EQUAL_INT(-112, hs.rssi);
+    TEST_ASSERT_EQUAL_INT(45, hs.snr_x10);
+    TEST_ASSERT_TRUE(hs.has_pos);
+    TEST_ASSERT_EQUAL_INT32(4542153, hs.lat);
+    TEST_ASSERT_EQUAL_INT32(-7569719, hs.lon);
+    TEST_ASSERT_EQUAL_UINT8(3, hs.hotspots);
+}
+
+/** Same hot spot from the legacy JSON and from the encoder fed that JSON */
+static void test_json_and_binary_agree(void)
+{
+    downlink_hotspot_s json;
+    downlink_hotspot_s bin;
+    TEST_ASSERT_TRUE(decodeText("{\"name\":\"bumpy-red-fox\",\"rssi\":-112,\"snr\":4.5,\"lat\":45.42153,\"long\":-75.69719}", json));
+    TEST_ASSERT_TRUE(decodeHex("a1010d62756d70792d7265642d666f78020290120308c94e4500c97e8cff", bin));
+    TEST_ASSERT_EQUAL_STRING(json.name, bin.name);
+    TEST_ASSERT_EQUAL_INT(json.rssi, bin.rssi);
+    TEST_ASSERT_EQUAL_INT(json.snr_x10, bin.snr_x10);
+    TEST_ASSERT_EQUAL_INT32(json.lat, bin.lat);
+    TEST_ASSERT_EQUAL_INT32(json.lon, bin.lon);
+    TEST_ASSERT_TRUE(json.has_pos);
+    TEST_ASSERT_EQUAL(json.has_pos, bin.has_pos);
+    TEST_ASSERT_EQUAL_UINT8(0, json.hotspots);
+}
+
+/** Members in any order, the ones not displayed are filtered out */
+static void test_json_filter(void)
+{
+    downlink_hotspot_s hs;
+    TEST_ASSERT_TRUE(decodeText("{\"hotspot_id\":\"112RbfG2qJZ1rP2\",\"long\":-151.2093,\"snr\":-3,\"lat\":-33.86882,\"name\":\"south-west\",\"rssi\":-120,\"hotspots\":4}", hs));
+    TEST_ASSERT_EQUAL_STRING("south-west", hs.name);
+    TEST_ASSERT_EQUAL_INT(-120, hs.rssi);
+    TEST_ASSERT_EQUAL_INT(-30, hs.snr_x10);
+    TEST_ASSERT_TRUE(hs.has_pos);
+    TEST_ASSERT_EQUAL_INT32(-3386882, hs.lat);
+    TEST_ASSERT_EQUAL_INT32(-15120930, hs.lon);
+    /** Only the binary format carries the count */
+    TEST_ASSERT_EQUAL_UINT8(0, hs.hotspots);
+    TEST_ASSERT_FALSE(jsonFilter().overflowed());
+}
+
+/** The document holds a name of DL_JSON_NAME_MAX, the display keeps what fits */
+static void test_json_long_name(void)
+{
+    std::string name(DL_JSON_NAME_MAX, 'x');
+    std::string json = "{\"name\":\"" + name + "\",\"rssi\":-97,\"snr\":-7.25,\"lat\":45.42153,\"long\":-75.69719}";
+    downlink_hotspot_s hs;
+    TEST_ASSERT_TRUE(decodeText(json.c_str(), hs));
+    TEST_ASSERT_EQUAL(sizeof(hs.name) - 1, strlen(hs.name));
+    TEST_ASSERT_TRUE(hs.has_pos);
+
+    name += 'x';
+    json = "{\"name\":\"" + name + "\",\"rssi\":-97,\"snr\":-7.25,\"lat\":45.42153,\"long\":-75.69719}";
+    TEST_ASSERT_FALSE(decodeText(json.c_str(), hs));
+}
+
+/** SNR steps of 0.25dB that are not whole 0.1dB round like the JSON path */
+static void test_snr_rounding(void)
+{
+    downlink_hotspot_s hs;
+    /** --name a --rssi -97 --snr -7.25 */
+    TEST_ASSERT_TRUE(decodeHex("a101016102029fe3", hs));
+    TEST_ASSERT_EQUAL_INT(-97, hs.rssi);
+    TEST_ASSERT_EQUAL_INT(-73, hs.snr_x10);
+    /** --name b --rssi -120 --snr 0.75 */
+    TEST_ASSERT_TRUE(decodeHex("a101016202028803", hs));
+    TEST_ASSERT_EQUAL_INT(8, hs.snr_x10);
+    /** --name c --rssi 10 --snr -0.25 */
+    TEST_ASSERT_TRUE(decodeHex("a101016302020aff", hs));
+    TEST_ASSERT_EQUAL_INT(10, hs.rssi);
+    TEST_ASSERT_EQUAL_INT(-3, hs.snr_x10);
+
+    TEST_ASSERT_TRUE(decodeText("{\"name\":\"a\",\"rssi\":-97,\"snr\":-7.25}", hs));
+    TEST_ASSERT_EQUAL_INT(-73, hs.snr_x10);
+    TEST_ASSERT_TRUE(decodeText("{\"name\":\"c\",\"rssi\":10,\"snr\":-0.25}", hs));
+    TEST_ASSERT_EQUAL_INT(-3, hs.snr_x10);
+}
+
+/** --name south-west --lat -33.86882 --long -151.20930 */
+static void test_negative_position(void)
+{
+    downlink_hotspot_s hs;
+    TEST_ASSERT_TRUE(decodeHex("a1010a736f7574682d776573740308fe51ccffde4519ff", hs));
+    TEST_ASSERT_EQUAL_STRING("south-west", hs.name);
+    TEST_ASSERT_TRUE(hs.has_pos);
+    TEST_ASSERT_EQUAL_INT32(-3386882, hs.lat);
+    TEST_ASSERT_EQUAL_INT32(-15120930, hs.lon);
+    TEST_ASSERT_EQUAL_INT(0, hs.rssi);
+}
+
+/** A TLV running past the end of the payload fails the whole payload */
+static void test_truncated_tlv(void)
+{
+    downlink_hotspot_s hs;
+    /** Position TLV says 8 bytes, 4 are there */
+    TEST_ASSERT_FALSE(decodeHex("a1010d62756d70792d7265642d666f780308c94e4500", hs));
+    /** Name cut */
+    TEST_ASSERT_FALSE(decodeHex("a1010d62756d7079", hs));
+    /** Only a type byte after the name is ignored */
+    TEST_ASSERT_TRUE(decodeHex("a101016103", hs));
+    TEST_ASSERT_EQUAL_STRING("a", hs.name);
+    TEST_ASSERT_FALSE(hs.has_pos);
+}
+
+/** Newer integrations can add types, older firmware skips them */
+static void test_unknown_type_skipped(void)
+{
+    downlink_hotspot_s hs;
+    TEST_ASSERT_TRUE(decodeHex("a10903aabbcc0101610401ff", hs));
+    TEST_ASSERT_EQUAL_STRING("a", hs.name);
+    TEST_ASSERT_EQUAL_UINT8(255, hs.hotspots);
+}
+
+static void test_rejects(void)
+{
+    downlink_hotspot_s hs;
+    /** No name */
+    TEST_ASSERT_FALSE(decodeHex("a10202900e", hs));
+    /** Version 2 */
+    TEST_ASSERT_FALSE(decodeHex("a2010161", hs));
+    TEST_ASSERT_FALSE(decodeText("{\"rssi\":-100}", hs));
+    TEST_ASSERT_FALSE(decodeText("{\"name\":", hs));
+    TEST_ASSERT_FALSE(decodeText("{\"name\":\"\",\"rssi\":-100}", hs));
+    TEST_ASSERT_FALSE(downlink_decode(nullptr, 0, hs));
+}
+
+/** A name longer than the buffer is cut, not overrun */
+static void test_long_name(void)
+{
+    char hex[2 * (3 + 60) + 1];
+    strcpy(hex, "a1013c");
+    for(uint8_t i = 0; i < 60; i++)
+    {
+        strcat(hex, "78");
+    }
+    downlink_hotspot_s hs;
+    TEST_ASSERT_TRUE(decodeHex(hex, hs));
+    TEST_ASSERT_EQUAL(sizeof(hs.name) - 1, strlen(hs.name));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_binary_all_fields);
+    RUN_TEST(test_json_and_binary_agree);
+    RUN_TEST(test_json_filter);
+    RUN_TEST(test_json_long_name);
+    RUN_TEST(test_snr_rounding);
+    RUN_TEST(test_negative_position);
+    RUN_TEST(test_truncated_tlv);
+    RUN_TEST(test_unknown_type_skipped);
+    RUN_TEST(test_rejects);
+    RUN_TEST(test_long_name);
+    return UNITY_END();
+}
@@ -0,0 +1,244 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief downlink_decode() on truncated, mutated and random payloads, and its speed
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The seeds are the payloads of test_downlink. Every payload is copied to
+ * a heap buffer of exactly its length, so a read past the end shows up
+ * with -fsanitize=address. The generator is seeded, every run is the
+ * same. A rejected payload must come back false, an accepted one with a
+ * terminated, non empty name.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../../src/downlink.cpp"
+
+/** Random payloads and mutations of the seeds */
+#define FUZZ_RANDOM 20000
+#define FUZZ_MUTATIONS 2000
+/** Decodes of each seed for the timing */
+#define BENCH_ROUNDS 20000
+
+static const char *binarySeeds[] = {
+    "a1010d62756d70792d7265642d666f78020290120308c94e4500c97e8cff040103",
+    "a1010a736f7574682d776573740308fe51ccffde4519ff",
+    "a101016102029fe3",
+    "a10903aabbcc0101610401ff",
+};
+
+static const char *jsonSeeds[] = {
+    "{\"name\":\"bumpy-red-fox\",\"rssi\":-112,\"snr\":4.5,\"lat\":45.42153,\"long\":-75.69719}",
+    "{\"name\":\"a\",\"rssi\":-97,\"snr\":-7.25}",
+    "{\"rssi\":-100,\"name\":\"south-west\",\"hotspot_id\":\"112xyz\",\"long\":-151.2093,\"lat\":-33.86882}",
+};
+
+static uint32_t seed = 0x2545F491;
+
+/** xorshift32 */
+static uint32_t nextRandom(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static std::vector<uint8_t> fromHex(const char *hex)
+{
+    std::vector<uint8_t> out;
+    for(; hex[0] != '\0' && hex[1] != '\0'; hex += 2)
+    {
+        char byte[3] = {hex[0], hex[1], '\0'};
+        out.push_back((uint8_t)strtoul(byte, nullptr, 16));
+    }
+    return out;
+}
+
+static std::vector<uint8_t> fromText(const char *json)
+{
+    return std::vector<uint8_t>(json, json + strlen(json));
+}
+
+/**
+ * @brief Decode the first len bytes from a buffer of exactly that size
+ *
+ */
+static bool decode(const std::vector<uint8_t> &payload, size_t len, downlink_hotspot_s &hs)
+{
+    uint8_t *exact = new uint8_t[len != 0 ? len : 1];
+    memcpy(exact, payload.data(), len);
+    bool ok = downlink_decode(exact, len, hs);
+    delete[] exact;
+    return ok;
+}
+
+/** The name is terminated in its buffer and there when accepted, nothing is left when rejected */
+static void checkResult(bool ok, const downlink_hotspot_s &hs)
+{
+    TEST_ASSERT_TRUE(memchr(hs.name, '\0', sizeof(hs.name)) != nullptr);
+    if(ok)
+    {
+        TEST_ASSERT_NOT_EQUAL(0, hs.name[0]);
+        return;
+    }
+    TEST_ASSERT_EQUAL(0, hs.name[0]);
+    TEST_ASSERT_EQUAL_INT(0, hs.rssi);
+    TEST_ASSERT_EQUAL_INT(0, hs.snr_x10);
+    TEST_ASSERT_FALSE(hs.has_pos);
+    TEST_ASSERT_EQUAL_UINT8(0, hs.hotspots);
+}
+
+/** A binary payload cut at len ends between two TLVs, or after a lone type byte */
+static bool atTlvBoundary(const std::vector<uint8_t> &payload, size_t len)
+{
+    size_t idx = 1;
+    while(idx + 2 <= len)
+    {
+        idx += 2 + payload[idx + 1];
+    }
+    return idx == len || idx + 1 == len;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/** Every prefix of every seed */
+static void test_truncated(void)
+{
+    uint32_t accepted = 0;
+    for(const char *hex : binarySeeds)
+    {
+        std::vector<uint8_t> payload = fromHex(hex);
+        for(size_t len = 0; len < payload.size(); len++)
+        {
+            downlink_hotspot_s hs;
+            bool ok = decode(payload, len, hs);
+            checkResult(ok, hs);
+            /** A TLV cut in its value fails the whole payload */
+            if(ok)
+            {
+                TEST_ASSERT_TRUE(atTlvBoundary(payload, len));
+                accepted++;
+            }
+        }
+    }
+    for(const char *json : jsonSeeds)
+    {
+        std::vector<uint8_t> payload = fromText(json);
+        for(size_t len = 0; len < payload.size(); len++)
+        {
+            downlink_hotspot_s hs;
+            bool ok = decode(payload, len, hs);
+            checkResult(ok, hs);
+            /** Without the closing brace it is never JSON */
+            TEST_ASSERT_FALSE(ok);
+        }
+    }
+    printf("truncated   %u binary prefixes accepted at a TLV boundary, no JSON prefix\n", accepted);
+}
+
+/** One to three bytes of a seed changed */
+static void test_mutated(void)
+{
+    std::vector<std::vector<uint8_t>> seeds;
+    for(const char *hex : binarySeeds)
+    {
+        seeds.push_back(fromHex(hex));
+    }
+    for(const char *json : jsonSeeds)
+    {
+        seeds.push_back(fromText(json));
+    }
+
+    uint32_t accepted = 0;
+    for(uint32_t i = 0; i < FUZZ_MUTATIONS; i++)
+    {
+        std::vector<uint8_t> payload = seeds[nextRandom() % seeds.size()];
+        for(uint32_t flips = 1 + nextRandom() % 3; flips > 0; flips--)
+        {
+            payload[nextRandom() % payload.size()] = (uint8_t)nextRandom();
+        }
+        downlink_hotspot_s hs;
+        bool ok = decode(payload, payload.size(), hs);
+        checkResult(ok, hs);
+        accepted += ok ? 1 : 0;
+    }
+    printf("mutated     %u of %u accepted\n", accepted, FUZZ_MUTATIONS);
+}
+
+/** Random bytes, half of them behind the binary marker, some behind a brace */
+static void test_random(void)
+{
+    uint32_t accepted = 0;
+    for(uint32_t i = 0; i < FUZZ_RANDOM; i++)
+    {
+        std::vector<uint8_t> payload(1 + nextRandom() % 96);
+        for(uint8_t &b : payload)
+        {
+            b = (uint8_t)nextRandom();
+        }
+        switch(i % 4)
+        {
+            case 0:
+            case 1:
+                payload[0] = DOWNLINK_BIN_MAGIC | DOWNLINK_BIN_VERSION;
+                break;
+            case 2:
+                payload[0] = '{';
+                break;
+            default:
+                break;
+        }
+        downlink_hotspot_s hs;
+        bool ok = decode(payload, payload.size(), hs);
+        checkResult(ok, hs);
+        accepted += ok ? 1 : 0;
+    }
+    printf("random      %u of %u accepted\n", accepted, FUZZ_RANDOM);
+}
+
+/** ns per decode of the same hot spot, binary and JSON */
+static void test_speed(void)
+{
+    std::vector<uint8_t> binary = fromHex(binarySeeds[0]);
+    std::vector<uint8_t> json = fromText(jsonSeeds[0]);
+    downlink_hotspot_s hs;
+    volatile uint32_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < BENCH_ROUNDS; i++)
+    {
+        sink += downlink_decode(binary.data(), binary.size(), hs);
+    }
+    double binaryNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < BENCH_ROUNDS; i++)
+    {
+        sink += downlink_decode(json.data(), json.size(), hs);
+    }
+    double jsonNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("binary %u bytes %.0f ns/decode, JSON %u bytes %.0f ns/decode (%.1fx)\n", (unsigned)binary.size(), binaryNs / BENCH_ROUNDS,
+           (unsigned)json.size(), jsonNs / BENCH_ROUNDS, jsonNs / binaryNs);
+    TEST_ASSERT_EQUAL_UINT32(2 * BENCH_ROUNDS, sink);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_mutated);
+    RUN_TEST(test_random);
+    RUN_TEST(test_speed);
+    return UNITY_END();
+}
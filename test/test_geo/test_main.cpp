@@ -0,0 +1,322 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Error of geo_distance_m() and geo_bearing_cdeg() against double precision
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The reference is haversine and the great circle initial bearing in
+ * double on the same sphere, so only the float math and the short range
+ * approximation are measured, not the sphere against WGS84.
+ * The bounds are the ones in the geo.cpp header. test_speed times both
+ * against the double reference, on the host FPU, the nRF52840 has no
+ * double precision FPU so the reference is slower still there.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <chrono>
+#include <vector>
+#include "../../src/geo.cpp"
+
+/** Pairs per range and times they are run for the timing */
+#define BENCH_PAIRS 4096
+#define BENCH_ROUNDS 50
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const double R = 6371009.0;
+static const double E5 = M_PI / 18000000.0;
+
+static double refDistance(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    double sinLat = sin((lat2 - (double)lat1) * E5 / 2);
+    double sinLon = sin((lon2 - (double)lon1) * E5 / 2);
+    double h = sinLat * sinLat + cos(lat1 * E5) * cos(lat2 * E5) * sinLon * sinLon;
+    return 2 * R * asin(sqrt(min(h, 1.0)));
+}
+
+/** 0.01 deg, 0 is north */
+static double refBearing(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    double dlon = (lon2 - (double)lon1) * E5;
+    double x = sin(dlon) * cos(lat2 * E5);
+    double y = cos(lat1 * E5) * sin(lat2 * E5) - sin(lat1 * E5) * cos(lat2 * E5) * cos(dlon);
+    double b = atan2(x, y) * 18000.0 / M_PI;
+    return b < 0 ? b + 36000.0 : b;
+}
+
+/** Smallest difference of two bearings, 0.01 deg */
+static double bearingDiff(double a, double b)
+{
+    double d = fabs(a - b);
+    return d > 18000.0 ? 36000.0 - d : d;
+}
+
+/** Deterministic pairs, no libc rand() differences between hosts */
+static uint32_t rng = 1;
+static int32_t randRange(int32_t low, int32_t high)
+{
+    rng = rng * 1664525UL + 1013904223UL;
+    return low + (int32_t)((rng >> 8) % (uint32_t)(high - low + 1));
+}
+
+/** Worst relative distance error in 1e-6 and bearing error in 0.01 deg over the pairs */
+struct geo_error_s
+{
+    double distPpm = 0;
+    double distAbsM = 0;
+    double bearingCdeg = 0;
+};
+
+static void measure(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, geo_error_s &err)
+{
+    double ref = refDistance(lat1, lon1, lat2, lon2);
+    double got = geo_distance_m(lat1, lon1, lat2, lon2);
+    double diff = fabs(got - ref);
+    /** The result is whole meters */
+    double diffBeyondRounding = max(diff - 0.5, 0.0);
+    err.distAbsM = max(err.distAbsM, diff);
+    if(ref > 100.0)
+    {
+        err.distPpm = max(err.distPpm, diffBeyondRounding / ref * 1e6);
+    }
+    if(ref > 100.0)
+    {
+        double b = bearingDiff(geo_bearing_cdeg(lat1, lon1, lat2, lon2), refBearing(lat1, lon1, lat2, lon2));
+        err.bearingCdeg = max(err.bearingCdeg, b);
+    }
+}
+
+/** Random pairs up to 50 km apart, +/-85 deg lat, bound < 0.002 % */
+static void test_short_range(void)
+{
+    geo_error_s err;
+    for(uint32_t i = 0; i < 20000; i++)
+    {
+        int32_t lat1 = randRange(-8500000, 8500000);
+        int32_t lon1 = randRange(-18000000, 17999999);
+        /** Up to ~0.45 deg north-south, east-west scaled to stay near 50 km */
+        int32_t dlat = randRange(-45000, 45000);
+        int32_t dlonMax = (int32_t)min(45000 / max(cos(lat1 * E5), 0.01), 18000000.0);
+        int32_t lat2 = lat1 + dlat;
+        int32_t lon2 = deltaLon(0, lon1 + randRange(-dlonMax, dlonMax));
+        measure(lat1, lon1, lat2, lon2, err);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(20, (int32_t)err.distPpm, "distance ppm");
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(1, (int32_t)err.bearingCdeg, "bearing cdeg");
+}
+
+/** Random pairs anywhere, +/-85 deg lat, bound < 0.0005 % */
+static void test_long_range(void)
+{
+    geo_error_s err;
+    for(uint32_t i = 0; i < 20000; i++)
+    {
+        int32_t lat1 = randRange(-8500000, 8500000);
+        int32_t lon1 = randRange(-18000000, 17999999);
+        int32_t lat2 = randRange(-8500000, 8500000);
+        int32_t lon2 = randRange(-18000000, 17999999);
+        /** Float asin is not accurate near antipodes, a mapper never sees that range */
+        if(refDistance(lat1, lon1, lat2, lon2) > 15000000.0)
+        {
+            continue;
+        }
+        measure(lat1, lon1, lat2, lon2, err);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(5, (int32_t)err.distPpm, "distance ppm");
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(1, (int32_t)err.bearingCdeg, "bearing cdeg");
+}
+
+/** Both sides of the switch from equirectangular to haversine */
+static void test_switch_at_50km(void)
+{
+    geo_error_s err;
+    static const int32_t lats[] = {0, 4542153, -3386882, 6000000, 8000000, -8400000};
+    for(uint8_t l = 0; l < sizeof(lats) / sizeof(lats[0]); l++)
+    {
+        for(uint16_t b = 0; b < 36000; b += 500)
+        {
+            for(int32_t d = 49000; d <= 51000; d += 250)
+            {
+                int32_t lat2, lon2;
+                /** Destination on the sphere in double, geo_offset() is only good for short range */
+                double arc = d / R;
+                double phi1 = lats[l] * E5;
+                double theta = b * M_PI / 18000.0;
+                double phi2 = asin(sin(phi1) * cos(arc) + cos(phi1) * sin(arc) * cos(theta));
+                double lambda2 = atan2(sin(theta) * sin(arc) * cos(phi1), cos(arc) - sin(phi1) * sin(phi2));
+                lat2 = lround(phi2 / E5);
+                lon2 = lround(lambda2 / E5) + 1234567;
+                measure(lats[l], 1234567, lat2, lon2, err);
+            }
+        }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(20, (int32_t)err.distPpm, "distance ppm");
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(1, (int32_t)err.bearingCdeg, "bearing cdeg");
+}
+
+/** Crossing +/-180 deg longitude is short, not half way around */
+static void test_antimeridian(void)
+{
+    /** 0.02 deg of longitude at the equator, ~2.2 km east */
+    TEST_ASSERT_UINT32_WITHIN(1, lround(refDistance(0, 17999000, 0, -17999000)), geo_distance_m(0, 17999000, 0, -17999000));
+    TEST_ASSERT_UINT32_WITHIN(1, 9000, geo_bearing_cdeg(0, 17999000, 0, -17999000));
+    TEST_ASSERT_UINT32_WITHIN(1, 27000, geo_bearing_cdeg(0, -17999000, 0, 17999000));
+    /** Long range across it, Fiji to Samoa */
+    int32_t d = geo_distance_m(-1771300, 17806500, -1383300, -17176600);
+    TEST_ASSERT_UINT32_WITHIN(10, lround(refDistance(-1771300, 17806500, -1383300, -17176600)), d);
+    TEST_ASSERT_LESS_THAN(1500000, d);
+    TEST_ASSERT_UINT32_WITHIN(2, lround(refBearing(-1771300, 17806500, -1383300, -17176600)), geo_bearing_cdeg(-1771300, 17806500, -1383300, -17176600));
+}
+
+/** Near the poles a small distance can span any longitude */
+static void test_poles(void)
+{
+    /** Across the north pole, 0.002 deg of arc (~222 m) */
+    TEST_ASSERT_UINT32_WITHIN(1, lround(refDistance(8999900, 0, 8999900, 18000000)), geo_distance_m(8999900, 0, 8999900, 18000000));
+    TEST_ASSERT_UINT32_WITHIN(1, 0, geo_bearing_cdeg(8999900, 0, 8999900, 18000000) % 36000);
+    /** Along a circle of latitude at 89.9 deg */
+    TEST_ASSERT_UINT32_WITHIN(1, lround(refDistance(8990000, 0, 8990000, 9000000)), geo_distance_m(8990000, 0, 8990000, 9000000));
+    TEST_ASSERT_UINT32_WITHIN(2, lround(refBearing(8990000, 0, 8990000, 9000000)), geo_bearing_cdeg(8990000, 0, 8990000, 9000000));
+    /** South pole to a point 1 km away */
+    TEST_ASSERT_UINT32_WITHIN(1, lround(refDistance(-9000000, 0, -8999100, 4500000)), geo_distance_m(-9000000, 0, -8999100, 4500000));
+
+    geo_error_s err;
+    for(uint32_t i = 0; i < 20000; i++)
+    {
+        int32_t lat1 = randRange(8500000, 9000000) * (i & 1 ? 1 : -1);
+        int32_t lon1 = randRange(-18000000, 17999999);
+        int32_t lat2 = min(max(lat1 + randRange(-45000, 45000), -9000000), 9000000);
+        int32_t lon2 = randRange(-18000000, 17999999);
+        measure(lat1, lon1, lat2, lon2, err);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(20, (int32_t)err.distPpm, "distance ppm");
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(2, (int32_t)err.distAbsM, "distance m");
+}
+
+/** Haversine in float at every range, what geo_distance_m() does above 50 km */
+static uint32_t floatHaversine(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    float sinLat = sinf((lat2 - lat1) * GEO_E5_TO_RAD * 0.5f);
+    float sinLon = sinf(deltaLon(lon1, lon2) * GEO_E5_TO_RAD * 0.5f);
+    float h = min(sinLat * sinLat + cosLat(lat1) * cosLat(lat2) * sinLon * sinLon, 1.0f);
+    return (uint32_t)(2.0f * GEO_EARTH_RADIUS_M * asinf(sqrtf(h)) + 0.5f);
+}
+
+struct geo_pair_s
+{
+    int32_t lat1;
+    int32_t lon1;
+    int32_t lat2;
+    int32_t lon2;
+};
+
+/** ns per call over the pairs */
+template <typename F>
+static double timeCalls(const std::vector<geo_pair_s> &pairs, F call)
+{
+    volatile double sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(const geo_pair_s &p : pairs)
+        {
+            sink += call(p);
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_TRUE(sink > 0);
+    return ns / (BENCH_ROUNDS * pairs.size());
+}
+
+/** The equirectangular/haversine split, float haversine alone and the double reference */
+static void test_speed(void)
+{
+    std::vector<geo_pair_s> shortPairs;
+    std::vector<geo_pair_s> longPairs;
+    while(shortPairs.size() < BENCH_PAIRS)
+    {
+        int32_t lat1 = randRange(-8500000, 8500000);
+        int32_t lon1 = randRange(-18000000, 17999999);
+        /** Hot spots a mapper hears, up to ~30 km */
+        int32_t lat2 = lat1 + randRange(-27000, 27000);
+        int32_t lon2 = deltaLon(0, lon1 + randRange(-27000, 27000));
+        if(refDistance(lat1, lon1, lat2, lon2) < GEO_SHORT_RANGE_M)
+        {
+            shortPairs.push_back({lat1, lon1, lat2, lon2});
+        }
+    }
+    while(longPairs.size() < BENCH_PAIRS)
+    {
+        int32_t lat1 = randRange(-8500000, 8500000);
+        int32_t lon1 = randRange(-18000000, 17999999);
+        int32_t lat2 = randRange(-8500000, 8500000);
+        int32_t lon2 = randRange(-18000000, 17999999);
+        if(refDistance(lat1, lon1, lat2, lon2) > GEO_SHORT_RANGE_M)
+        {
+            longPairs.push_back({lat1, lon1, lat2, lon2});
+        }
+    }
+
+    auto split = [](const geo_pair_s &p) { return (double)geo_distance_m(p.lat1, p.lon1, p.lat2, p.lon2); };
+    auto haversine = [](const geo_pair_s &p) { return (double)floatHaversine(p.lat1, p.lon1, p.lat2, p.lon2); };
+    auto reference = [](const geo_pair_s &p) { return refDistance(p.lat1, p.lon1, p.lat2, p.lon2); };
+    auto bearing = [](const geo_pair_s &p) { return (double)geo_bearing_cdeg(p.lat1, p.lon1, p.lat2, p.lon2) + 1; };
+    auto refBearingCall = [](const geo_pair_s &p) { return refBearing(p.lat1, p.lon1, p.lat2, p.lon2) + 1; };
+
+    const struct
+    {
+        const char *name;
+        const std::vector<geo_pair_s> &pairs;
+    } ranges[] = {{"< 50 km", shortPairs}, {"> 50 km", longPairs}};
+    for(const auto &r : ranges)
+    {
+        double splitNs = timeCalls(r.pairs, split);
+        double haversineNs = timeCalls(r.pairs, haversine);
+        double refNs = timeCalls(r.pairs, reference);
+        double bearingNs = timeCalls(r.pairs, bearing);
+        double refBearingNs = timeCalls(r.pairs, refBearingCall);
+        printf("%s distance: split %.1f ns, float haversine %.1f ns, double %.1f ns (%.1fx); bearing %.1f ns, double %.1f ns (%.1fx)\n",
+               r.name, splitNs, haversineNs, refNs, refNs / splitNs, bearingNs, refBearingNs, refBearingNs / bearingNs);
+    }
+
+    /** The split gives the haversine result where it hands over */
+    for(const geo_pair_s &p : longPairs)
+    {
+        TEST_ASSERT_EQUAL_UINT32(floatHaversine(p.lat1, p.lon1, p.lat2, p.lon2), geo_distance_m(p.lat1, p.lon1, p.lat2, p.lon2));
+    }
+}
+
+/** geo_offset() and back */
+static void test_offset_round_trip(void)
+{
+    for(uint16_t b = 0; b < 36000; b += 1500)
+    {
+        int32_t lat2, lon2;
+        geo_offset(4542153, -7569719, b, 1000, lat2, lon2);
+        TEST_ASSERT_UINT32_WITHIN(2, 1000, geo_distance_m(4542153, -7569719, lat2, lon2));
+        TEST_ASSERT_UINT32_WITHIN(20, b, geo_bearing_cdeg(4542153, -7569719, lat2, lon2));
+    }
+    /** Wraps at +/-180 deg */
+    int32_t lat2, lon2;
+    geo_offset(0, 17999900, 9000, 1000, lat2, lon2);
+    TEST_ASSERT_INT32_WITHIN(2, -17999200, lon2);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_short_range);
+    RUN_TEST(test_long_range);
+    RUN_TEST(test_switch_at_50km);
+    RUN_TEST(test_antimeridian);
+    RUN_TEST(test_poles);
+    RUN_TEST(test_offset_round_trip);
+    RUN_TEST(test_speed);
+    return UNITY_END();
+}
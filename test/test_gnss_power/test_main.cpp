@@ -0,0 +1,347 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief GNSS power manager against a simulated module, lead time learning per start type
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The module stand-in behind gnss_module_*() starts hot, warm or cold from
+ * how long it was off and whether it had a fix before, and gets its time
+ * to first fix from a fixed list per start type. Beacons run like
+ * app_event_handler(): wake, poll for up to GNSS_POLL_WAIT_MS, fix, sleep.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include "../../src/gnss_power.cpp"
+
+bool gnss_trace_replaying(void) { return false; }
+
+/** Time to first fix per start type, used in turn */
+static const uint32_t hotTtff[] = {4200, 3100, 5600, 3800, 4500, 3300, 6100, 3900};
+static const uint32_t warmTtff[] = {36000, 27000, 31000, 29000, 33000, 26000};
+static const uint32_t coldTtff[] = {46000, 52000, 41000};
+static const uint32_t *modelTtff[GNSS_STARTS] = {hotTtff, warmTtff, coldTtff};
+static const uint8_t modelLen[GNSS_STARTS] = {8, 6, 3};
+
+/** The simulated module */
+struct module_s
+{
+    bool asleep;
+    /** Backup mode start and timed wake up, 0 is UART only */
+    uint32_t sleptAt;
+    uint32_t wakeAfter;
+    uint32_t onSince;
+    /** First fix of this start, 0 until the sky is open */
+    uint32_t fixAt;
+    uint32_t ttff;
+    bool ephemeris;
+    /** No signal before this */
+    uint32_t skyFrom;
+    uint8_t starts[GNSS_STARTS];
+    uint8_t used[GNSS_STARTS];
+    uint32_t firstSleepAt;
+};
+static module_s sim;
+
+/** What the beacons saw */
+static uint32_t beacons = 0;
+static uint32_t fixes = 0;
+static uint32_t waitedMs = 0;
+static uint32_t bootMs = 0;
+
+/**
+ * @brief Module powers up, picks its start type and time to first fix
+ *
+ * @param at millis() of the power up
+ */
+static void powerOn(uint32_t at)
+{
+    uint8_t type = GNSS_START_COLD;
+    if(sim.ephemeris)
+    {
+        type = (at - sim.sleptAt) <= GNSS_HOT_OFF_MS ? GNSS_START_HOT : GNSS_START_WARM;
+    }
+    sim.asleep = false;
+    sim.onSince = at;
+    sim.ttff = modelTtff[type][sim.used[type]++ % modelLen[type]];
+    sim.fixAt = max(at, sim.skyFrom) + sim.ttff;
+    sim.starts[type]++;
+}
+
+/** A timed backup mode that is over */
+static void simUpdate(void)
+{
+    if(sim.asleep && sim.wakeAfter != 0 && (millis() - sim.sleptAt) >= sim.wakeAfter)
+    {
+        powerOn(sim.sleptAt + sim.wakeAfter);
+    }
+}
+
+void gnss_module_sleep(uint8_t gnss_option, uint32_t duration_ms)
+{
+    simUpdate();
+    if(!sim.asleep && millis() >= sim.fixAt)
+    {
+        sim.ephemeris = true;
+    }
+    if(sim.firstSleepAt == 0)
+    {
+        sim.firstSleepAt = millis();
+    }
+    sim.asleep = true;
+    sim.sleptAt = millis();
+    sim.wakeAfter = duration_ms;
+}
+
+void gnss_module_wake(uint8_t gnss_option)
+{
+    simUpdate();
+    if(sim.asleep)
+    {
+        powerOn(millis());
+    }
+}
+
+/** RAK12500 counts from its start like NAV-STATUS, RAK1910 from the NMEA first fix */
+uint32_t gnss_module_ttff(uint8_t gnss_option, uint32_t woke_at)
+{
+    simUpdate();
+    if(sim.asleep || millis() < sim.fixAt)
+    {
+        return 0;
+    }
+    if(gnss_option == RAK12500_GNSS)
+    {
+        return sim.fixAt - sim.onSince;
+    }
+    return (int32_t)(sim.fixAt - woke_at) < 0 ? 0 : sim.fixAt - woke_at;
+}
+
+/** poll_gnss(), a fix as soon as the module has one, up to GNSS_POLL_WAIT_MS */
+static bool poll(void)
+{
+    simUpdate();
+    uint32_t now = millis();
+    if(sim.asleep || sim.fixAt > now + GNSS_POLL_WAIT_MS)
+    {
+        host_advance_ms(GNSS_POLL_WAIT_MS);
+        waitedMs += GNSS_POLL_WAIT_MS;
+        return false;
+    }
+    if(sim.fixAt > now)
+    {
+        waitedMs += sim.fixAt - now;
+        host_advance_ms(sim.fixAt - now);
+    }
+    return true;
+}
+
+/**
+ * @brief One beacon like app_event_handler()
+ *
+ * @param interval send_repeat_time
+ * @return Time the poll waited for the fix, ms
+ */
+static uint32_t beacon(uint32_t interval)
+{
+    uint32_t waited = waitedMs;
+    gnss_power_wake();
+    bool fix = poll();
+    gnss_power_fix(fix);
+    gnss_power_sleep(interval);
+    beacons++;
+    fixes += fix ? 1 : 0;
+    return waitedMs - waited;
+}
+
+/** Slowest of the last GNSS_TTFF_HISTORY of the first used model values */
+static uint32_t slowest(uint8_t type, uint32_t used)
+{
+    uint32_t ttff = 0;
+    for(uint32_t i = 0; i < min(used, (uint32_t)GNSS_TTFF_HISTORY); i++)
+    {
+        ttff = max(ttff, modelTtff[type][(used - 1 - i) % modelLen[type]]);
+    }
+    return ttff;
+}
+
+/** Time per state adds up to the time since init */
+static void checkBooked(void)
+{
+    updateState();
+    uint32_t booked = millis() - stateSince;
+    for(uint8_t i = 0; i < GNSS_PWR_STATES; i++)
+    {
+        booked += g_gnss_power_ms[i];
+    }
+    TEST_ASSERT_EQUAL_UINT32(millis() - bootMs, booked);
+}
+
+static void report(const char *name)
+{
+    updateState();
+    uint32_t total = millis() - bootMs;
+    uint32_t asleep = g_gnss_power_ms[GNSS_PWR_SLEEP] + (state == GNSS_PWR_SLEEP ? millis() - stateSince : 0);
+    printf("%-10s %3lu beacons, %3lu fixes, polls waited %6.1fs, asleep %3lu%%, starts hot/warm/cold %u/%u/%u, lead %ld/%ld/%ldms\n",
+           name, (unsigned long)beacons, (unsigned long)fixes, waitedMs / 1000.0, (unsigned long)((uint64_t)asleep * 100 / total),
+           sim.starts[GNSS_START_HOT], sim.starts[GNSS_START_WARM], sim.starts[GNSS_START_COLD],
+           (long)leadTime(GNSS_START_HOT), (long)leadTime(GNSS_START_WARM), (long)leadTime(GNSS_START_COLD));
+}
+
+/** Boot with the module on, a cold start */
+static void boot(uint8_t gnss_option)
+{
+    memset(ttffHistory, 0, sizeof(ttffHistory));
+    memset(ttffCount, 0, sizeof(ttffCount));
+    memset(ttffNext, 0, sizeof(ttffNext));
+    memset(g_gnss_power_ms, 0, sizeof(g_gnss_power_ms));
+    g_gnss_sleeps = 0;
+    g_gnss_early_wakes = 0;
+    g_gnss_ttff_last = 0;
+    slept = false;
+    sleepAt = 0;
+    sleepFor = 0;
+    sim = module_s();
+    beacons = 0;
+    fixes = 0;
+    waitedMs = 0;
+    host_now_us += 1000000;
+    bootMs = millis();
+    powerOn(bootMs);
+    gnss_power_init(gnss_option);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/** Short interval, after the cold start every wake up is hot and the fix is there before the poll */
+static void test_hot_lead(void)
+{
+    const uint32_t interval = 120000;
+    boot(RAK12500_GNSS);
+    host_advance_ms(interval);
+    TEST_ASSERT_EQUAL_UINT32(0, beacon(interval));
+    TEST_ASSERT_EQUAL_UINT32(coldTtff[0], ttffHistory[GNSS_START_COLD][0]);
+    TEST_ASSERT_EQUAL_UINT8(GNSS_PWR_SLEEP, state);
+    for(uint8_t i = 0; i < 30; i++)
+    {
+        host_advance_ms(interval);
+        TEST_ASSERT_EQUAL_UINT32(0, beacon(interval));
+        TEST_ASSERT_EQUAL_UINT32(hotTtff[i % 8], g_gnss_ttff_last);
+        TEST_ASSERT_EQUAL_UINT32(slowest(GNSS_START_HOT, i + 1) + GNSS_LEAD_MARGIN_MS, leadTime(GNSS_START_HOT));
+    }
+    report("hot");
+    TEST_ASSERT_EQUAL_UINT8(30, sim.starts[GNSS_START_HOT]);
+    TEST_ASSERT_EQUAL_UINT32(31, fixes);
+    TEST_ASSERT_EQUAL_UINT32(31, g_gnss_sleeps);
+    /** Awake only for the lead time of each beacon */
+    TEST_ASSERT_TRUE(g_gnss_power_ms[GNSS_PWR_SLEEP] > (millis() - bootMs) * 85 / 100);
+    checkBooked();
+}
+
+/** Three hours apart, warm starts, the poll waits only while the slowest value is not in the history */
+static void test_warm_lead(void)
+{
+    const uint32_t interval = 3 * 3600000;
+    boot(RAK1910_GNSS);
+    host_advance_ms(interval);
+    beacon(interval);
+    /** No history yet, the typical 30s plus margin */
+    TEST_ASSERT_EQUAL_UINT32(interval - 32000, sleepFor);
+    TEST_ASSERT_EQUAL_UINT8(GNSS_START_WARM, startType);
+    uint32_t waits[7];
+    for(uint8_t i = 0; i < 7; i++)
+    {
+        host_advance_ms(interval);
+        waits[i] = beacon(interval);
+        TEST_ASSERT_EQUAL_UINT32(warmTtff[i % 6], g_gnss_ttff_last);
+        TEST_ASSERT_EQUAL_UINT32(slowest(GNSS_START_WARM, i + 1) + GNSS_LEAD_MARGIN_MS, leadTime(GNSS_START_WARM));
+    }
+    report("warm");
+    /** 36s against the default 32s lead, later 36s again after it left the history of 4 */
+    TEST_ASSERT_EQUAL_UINT32(4000, waits[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, waits[1] + waits[2] + waits[3] + waits[4] + waits[5]);
+    TEST_ASSERT_EQUAL_UINT32(1000, waits[6]);
+    TEST_ASSERT_EQUAL_UINT8(7, sim.starts[GNSS_START_WARM]);
+    TEST_ASSERT_EQUAL_UINT8(0, sim.starts[GNSS_START_HOT]);
+    TEST_ASSERT_EQUAL_UINT32(8, fixes);
+    checkBooked();
+}
+
+/** No sky at first, it keeps acquiring for GNSS_ACQUIRE_MAX_MS before it sleeps, then stays cold until a fix */
+static void test_cold_no_fix(void)
+{
+    const uint32_t interval = 60000;
+    boot(RAK12500_GNSS);
+    sim.skyFrom = bootMs + 20 * 60000;
+    sim.fixAt = sim.skyFrom + sim.ttff;
+    while(millis() < sim.skyFrom)
+    {
+        host_advance_ms(interval);
+        beacon(interval);
+        TEST_ASSERT_EQUAL_UINT8(GNSS_START_COLD, startType);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, fixes);
+    TEST_ASSERT_TRUE(sim.firstSleepAt - bootMs >= GNSS_ACQUIRE_MAX_MS);
+    TEST_ASSERT_TRUE(g_gnss_sleeps > 0);
+    TEST_ASSERT_EQUAL_UINT8(0, ttffCount[GNSS_START_COLD]);
+    /** Every wake up since was cold too */
+    TEST_ASSERT_EQUAL_UINT8(0, sim.starts[GNSS_START_HOT] + sim.starts[GNSS_START_WARM]);
+
+    uint32_t skyBeacons = 0;
+    while(fixes == 0)
+    {
+        host_advance_ms(interval);
+        beacon(interval);
+        skyBeacons++;
+        TEST_ASSERT_TRUE(skyBeacons <= 3);
+    }
+    TEST_ASSERT_EQUAL_UINT8(1, ttffCount[GNSS_START_COLD]);
+    TEST_ASSERT_EQUAL_UINT8(GNSS_PWR_SLEEP, state);
+    TEST_ASSERT_EQUAL_UINT8(GNSS_START_HOT, startType);
+    for(uint8_t i = 0; i < 5; i++)
+    {
+        host_advance_ms(interval);
+        TEST_ASSERT_EQUAL_UINT32(0, beacon(interval));
+    }
+    report("cold");
+    TEST_ASSERT_EQUAL_UINT8(5, sim.starts[GNSS_START_HOT]);
+    checkBooked();
+}
+
+/** An accelerometer beacon in the middle of a sleep wakes the module at once, hot */
+static void test_early_wake(void)
+{
+    const uint32_t interval = 3600000;
+    boot(RAK1910_GNSS);
+    host_advance_ms(interval);
+    beacon(interval);
+    TEST_ASSERT_EQUAL_UINT8(GNSS_PWR_SLEEP, state);
+    host_advance_ms(20 * 60000);
+    TEST_ASSERT_EQUAL_UINT32(hotTtff[0], beacon(interval));
+    TEST_ASSERT_EQUAL_UINT32(1, g_gnss_early_wakes);
+    TEST_ASSERT_EQUAL_UINT8(1, sim.starts[GNSS_START_HOT]);
+    TEST_ASSERT_EQUAL_UINT8(1, ttffCount[GNSS_START_HOT]);
+    TEST_ASSERT_EQUAL_UINT32(hotTtff[0] + GNSS_LEAD_MARGIN_MS, leadTime(GNSS_START_HOT));
+    /** The next timer beacon has the learned lead */
+    host_advance_ms(interval);
+    TEST_ASSERT_EQUAL_UINT32(0, beacon(interval));
+    report("acc wake");
+    TEST_ASSERT_EQUAL_UINT32(3, fixes);
+    TEST_ASSERT_EQUAL_UINT32(3, g_gnss_sleeps);
+    checkBooked();
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hot_lead);
+    RUN_TEST(test_warm_lead);
+    RUN_TEST(test_cold_no_fix);
+    RUN_TEST(test_early_wake);
+    return UNITY_END();
+}
@@ -0,0 +1,471 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief poll_gnss() and ftester_gps_fix() on recorded GNSS traces, in virtual time
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Each scenario (cold start, urban canyon, tunnel) is one fix state per
+ * second. For the RAK1910 it is sent as RMC/GGA at 9600 baud into Serial1
+ * and recorded by gnss_trace.cpp like on the device, then init_gnss()
+ * replays that trace. For the RAK12500 the same epochs come out of the
+ * u-blox stand-in as NAV-PVT/NAV-DOP. The beacon loop of app.cpp polls
+ * every BENCH_BEACON_MS and tells the tester the result. Every run prints
+ * the time to the first fix decision, the polls that timed out and the
+ * No-GPS beacon rate, the same numbers every time.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define GNSS_REPLAY 1
+
+#include <unity.h>
+#include <host.h>
+#include <string>
+#include <vector>
+#include "../../src/nmea.cpp"
+#include "../../src/geo.cpp"
+#include "../../src/airtime.cpp"
+#include "../../src/downlink.cpp"
+#include "../../src/oled.cpp"
+#include "../../src/gnss_trace.cpp"
+#include "../../src/gnss.cpp"
+#include "../../src/fieldtester.cpp"
+
+/** Time between two beacons */
+#define BENCH_BEACON_MS 5000
+/** The module starts sending an epoch this long after the second */
+#define BENCH_OUTPUT_MS 80
+/** 9600 baud, 10 bits per byte */
+#define BENCH_BYTE_US 1042
+
+/** Modules not under test */
+uint32_t g_lifetime_tx = 0;
+uint32_t g_lifetime_rx = 0;
+static uint32_t queued = 0;
+void counters_init(void) {}
+void counters_tx(void) {}
+void counters_rx(void) {}
+void session_log_hotspot(const downlink_hotspot_s &hs) { (void)hs; }
+void uplink_queue_add(const gnss_fix_s *fix, uint16_t batt_mv, uint8_t prio) { queued++; }
+void uplink_queue_drain(void) {}
+/** The bus is free unless a test takes it away */
+static bool busFree = true;
+bool i2c_acquire(uint8_t dev) { return busFree; }
+void i2c_release(uint8_t dev) {}
+bool i2c_yield(uint8_t dev) { return true; }
+
+/** One second of a scenario */
+struct epoch_s
+{
+    bool fix;
+    uint8_t siv;
+    uint16_t hdop;
+    int32_t lat;
+    int32_t lon;
+};
+
+struct scenario_s
+{
+    const char *name;
+    std::vector<epoch_s> epochs;
+};
+
+/** What one run gives */
+struct report_s
+{
+    uint32_t first_fix_ms;
+    uint32_t polls;
+    uint32_t timeouts;
+    uint32_t zero_packets;
+    uint32_t decision_max_ms;
+    uint32_t module_reads;
+};
+
+static uint32_t rngState = 20261017;
+static uint32_t rng(uint32_t range)
+{
+    rngState = rngState * 1664525 + 1013904223;
+    return (rngState >> 8) % range;
+}
+
+/** Module being replayed and when its epoch 0 started */
+static uint8_t module = 0;
+static const scenario_s *current = nullptr;
+static uint32_t scenarioStart = 0;
+static int32_t lastEpoch = -1;
+static uint64_t nextDrainUs = 0;
+
+void setUp(void)
+{
+    host_delay_hook = nullptr;
+    module = 0;
+}
+void tearDown(void) {}
+
+/** Position and accuracy move on, with or without fix */
+static void walk(epoch_s &e, bool fix, uint8_t sivMin, uint8_t sivRange)
+{
+    e.fix = fix;
+    e.siv = fix ? sivMin + rng(sivRange) : rng(3);
+    e.hdop = fix ? 90 + rng(100) * sivRange : 9999;
+    e.lat += 8;
+    e.lon += 11;
+}
+
+static scenario_s coldStart(void)
+{
+    scenario_s s = {"cold start", {}};
+    epoch_s e = {false, 0, 9999, 4542153, -7569719};
+    for(uint8_t sec = 0; sec < 60; sec++)
+    {
+        walk(e, sec >= 32, 6, 4);
+        s.epochs.push_back(e);
+    }
+    return s;
+}
+
+/** Short drops of the fix between buildings */
+static scenario_s urbanCanyon(void)
+{
+    scenario_s s = {"urban canyon", {}};
+    epoch_s e = {false, 0, 9999, 4541000, -7570000};
+    uint8_t outage = 0;
+    for(uint8_t sec = 0; sec < 50; sec++)
+    {
+        if(outage == 0 && sec > 2 && rng(6) == 0)
+        {
+            outage = 2 + rng(6);
+        }
+        walk(e, outage == 0, 4, 3);
+        outage -= outage > 0;
+        s.epochs.push_back(e);
+    }
+    return s;
+}
+
+/** Fix, nothing at all for 18s, then the fix is back */
+static scenario_s tunnel(void)
+{
+    scenario_s s = {"tunnel", {}};
+    epoch_s e = {false, 0, 9999, 4540000, -7571000};
+    for(uint8_t sec = 0; sec < 50; sec++)
+    {
+        walk(e, sec < 20 || sec >= 38, 7, 3);
+        if(sec >= 20 && sec < 38)
+        {
+            e.siv = 0;
+        }
+        s.epochs.push_back(e);
+    }
+    return s;
+}
+
+/** Body to a full sentence with its checksum */
+static std::string withChecksum(const std::string &body)
+{
+    uint8_t sum = 0;
+    for(char c : body)
+    {
+        sum ^= c;
+    }
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+    return "$" + body + tail;
+}
+
+/** 1e-5 deg to ddmm.mmmmm or dddmm.mmmmm and its hemisphere */
+static std::string degreesField(int32_t e5, bool lon, char pos, char neg)
+{
+    uint32_t deg = abs(e5) / 100000 % 1000;
+    uint32_t minE5 = abs(e5) % 100000 * 60;
+    char text[24];
+    snprintf(text, sizeof(text), lon ? "%03u%02u.%05u,%c" : "%02u%02u.%05u,%c", deg % 1000, minE5 / 100000 % 100, minE5 % 100000, e5 < 0 ? neg : pos);
+    return text;
+}
+
+/** RMC and GGA of one epoch, what init_gnss() leaves the RAK1910 sending */
+static std::string nmeaEpoch(const epoch_s &e, uint32_t sec)
+{
+    uint32_t day = 12 * 3600 + sec;
+    char time[16];
+    snprintf(time, sizeof(time), "%02u%02u%02u.00", day / 3600, day / 60 % 60, day % 60);
+    std::string pos = degreesField(e.lat, false, 'N', 'S') + "," + degreesField(e.lon, true, 'E', 'W');
+    char body[128];
+    std::string out;
+    if(e.fix)
+    {
+        snprintf(body, sizeof(body), "GPRMC,%s,A,%s,23.412,47.10,171026,,,A", time, pos.c_str());
+        out += withChecksum(body);
+        snprintf(body, sizeof(body), "GPGGA,%s,%s,1,%02u,%u.%02u,70.1,M,-34.0,M,,", time, pos.c_str(), e.siv, e.hdop / 100, e.hdop % 100);
+        out += withChecksum(body);
+    } else {
+        snprintf(body, sizeof(body), "GPRMC,%s,V,,,,,,,171026,,,N", time);
+        out += withChecksum(body);
+        snprintf(body, sizeof(body), "GPGGA,%s,,,,,0,%02u,99.99,,,,,,", time, e.siv);
+        out += withChecksum(body);
+    }
+    return out;
+}
+
+/** The RAK1910 task, it drains the UART every GNSS_RX_PERIOD_MS */
+static void rxTask(void)
+{
+    while(host_now_us >= nextDrainUs)
+    {
+        nextDrainUs += GNSS_RX_PERIOD_MS * 1000;
+        if(module == RAK1910_GNSS)
+        {
+            gnss_rx_drain();
+        }
+    }
+}
+
+/** Everything since boot back to zero, the trace file stays */
+static void resetGnss(void)
+{
+    g_nmea = nmea_fix_s();
+    step = NMEA_WAIT_START;
+    gnss_rx_fix = gnss_fix_s();
+    gnss_rx_siv = 0;
+    gnss_rx_first_fix = 0;
+    gnss_pvt_fix = gnss_fix_s();
+    gnss_pvt_siv = 0;
+    gnss_pvt_hdop = 0;
+    g_gnss_polls = 0;
+    g_gnss_poll_timeouts = 0;
+    g_gnss_decision_ms_max = 0;
+    g_gnss_decision_ms_total = 0;
+    g_gnss_first_fix_ms = 0;
+    g_gnss_i2c_polls = 0;
+    g_gnss_rx_bytes = 0;
+    traceFile.close();
+    replaying = false;
+    recording = false;
+    haveNext = false;
+    batchLen = 0;
+    traceSize = 0;
+    g_gnss_replay_loops = 0;
+    g_zero_packets = 0;
+    ftester_gpsLock = false;
+    my_rak12500_gnss.present = false;
+    my_rak12500_gnss.onCheck = nullptr;
+    my_rak12500_gnss.reads = 0;
+    Serial1.rxPos = Serial1.rxLen = 0;
+    lastEpoch = -1;
+}
+
+/**
+ * @brief Send the scenario into Serial1 at 9600 baud and record it like a GNSS_RECORD build
+ *
+ * @return Is the whole scenario in the trace
+ */
+static bool recordTrace(const scenario_s &s)
+{
+    resetGnss();
+    InternalFS.remove(traceName);
+    module = RAK1910_GNSS;
+    if(gnss_rx_fix_sem == NULL)
+    {
+        gnss_rx_fix_sem = xSemaphoreCreateBinary();
+    }
+    recording = true;
+    lastChunk = millis();
+    uint64_t start = host_now_us;
+    nextDrainUs = start;
+    host_delay_hook = rxTask;
+    for(uint32_t sec = 0; sec < s.epochs.size(); sec++)
+    {
+        std::string nmea = nmeaEpoch(s.epochs[sec], sec);
+        uint64_t sent = start + (uint64_t)(sec * 1000 + BENCH_OUTPUT_MS) * 1000;
+        while(host_now_us < sent)
+        {
+            delay(1);
+        }
+        for(char c : nmea)
+        {
+            Serial1.feed((const uint8_t *)&c, 1);
+            host_now_us += BENCH_BYTE_US;
+            rxTask();
+        }
+    }
+    delay(GNSS_RX_PERIOD_MS);
+    bool complete = recording;
+    /** What a GNSS_RECORD build has in RAM at power off */
+    writeBatch();
+    host_delay_hook = nullptr;
+    return complete;
+}
+
+/** RAK12500 stand-in, NAV-PVT/NAV-DOP of the newest epoch the module has output */
+static void ubloxOutput(SFE_UBLOX_GNSS &gnss)
+{
+    uint32_t elapsed = millis() - scenarioStart;
+    if(elapsed < BENCH_OUTPUT_MS)
+    {
+        return;
+    }
+    int32_t sec = (elapsed - BENCH_OUTPUT_MS) / 1000;
+    if(sec <= lastEpoch || sec >= (int32_t)current->epochs.size())
+    {
+        return;
+    }
+    lastEpoch = sec;
+    const epoch_s &e = current->epochs[sec];
+    gnss.pvt = UBX_NAV_PVT_data_t();
+    gnss.pvt.flags.bits.gnssFixOK = e.fix;
+    gnss.pvt.fixType = e.fix ? 3 : 0;
+    gnss.pvt.numSV = e.siv;
+    gnss.pvt.lat = e.lat * 100;
+    gnss.pvt.lon = e.lon * 100;
+    gnss.pvt.hMSL = 70100;
+    gnss.pvt.year = 2026;
+    gnss.pvt.month = 10;
+    gnss.pvt.day = 17;
+    gnss.pvt.valid.bits.validDate = 1;
+    gnss.pvt.valid.bits.validTime = 1;
+    gnss.dop.hDOP = e.hdop;
+    gnss.pvtFresh = true;
+    gnss.dopFresh = true;
+}
+
+/** The beacon loop of app.cpp over one scenario */
+static report_s run(uint8_t gnss_option, const scenario_s &s)
+{
+    resetGnss();
+    current = &s;
+    if(gnss_option == RAK12500_GNSS)
+    {
+        /** No trace, init_gnss() finds the module */
+        traceFile.close();
+        InternalFS.remove(traceName);
+        my_rak12500_gnss.present = true;
+        my_rak12500_gnss.onCheck = ubloxOutput;
+    }
+    TEST_ASSERT_EQUAL_UINT8(gnss_option, init_gnss());
+    module = gnss_option;
+    scenarioStart = millis();
+    nextDrainUs = host_now_us;
+    host_delay_hook = rxTask;
+
+    uint32_t duration = s.epochs.size() * 1000;
+    while(millis() - scenarioStart + GNSS_POLL_WAIT_MS <= duration)
+    {
+        uint32_t pollAt = millis();
+        ftester_gps_fix(poll_gnss(gnss_option));
+        while(millis() - pollAt < BENCH_BEACON_MS)
+        {
+            delay(10);
+        }
+    }
+    host_delay_hook = nullptr;
+    TEST_ASSERT_EQUAL_UINT32(0, g_gnss_replay_loops);
+
+    report_s r;
+    r.first_fix_ms = g_gnss_first_fix_ms != 0 ? g_gnss_first_fix_ms - scenarioStart : 0;
+    r.polls = g_gnss_polls;
+    r.timeouts = g_gnss_poll_timeouts;
+    r.zero_packets = g_zero_packets;
+    r.decision_max_ms = g_gnss_decision_ms_max;
+    r.module_reads = gnss_option == RAK1910_GNSS ? g_gnss_rx_bytes : my_rak12500_gnss.reads;
+    printf("%-12s %-8s first fix decision %5.1fs, %2u polls, %2u timed out, %2u No-GPS (%3u%%), decision max %5.1fs, %5u %s\n", s.name,
+           gnss_option == RAK1910_GNSS ? "RAK1910" : "RAK12500", r.first_fix_ms / 1000.0, r.polls, r.timeouts, r.zero_packets,
+           r.polls ? r.zero_packets * 100 / r.polls : 0, r.decision_max_ms / 1000.0, r.module_reads,
+           gnss_option == RAK1910_GNSS ? "NMEA bytes" : "I2C reads");
+    return r;
+}
+
+/** First second of the scenario with a fix */
+static uint32_t firstFix(const scenario_s &s)
+{
+    for(uint32_t sec = 0; sec < s.epochs.size(); sec++)
+    {
+        if(s.epochs[sec].fix)
+        {
+            return sec;
+        }
+    }
+    return 0;
+}
+
+/** Same scenario through both modules, the same rules for both */
+static void checkScenario(const scenario_s &s)
+{
+    TEST_ASSERT_TRUE(recordTrace(s));
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(GNSS_TRACE_MAX, InternalFS.files[traceName]->size());
+    for(uint8_t gnss_option : {RAK1910_GNSS, RAK12500_GNSS})
+    {
+        report_s r = run(gnss_option, s);
+        /** A fix shows within one epoch of a running poll, or at the next beacon */
+        uint32_t fixAt = firstFix(s) * 1000;
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(fixAt, r.first_fix_ms);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(fixAt + BENCH_BEACON_MS + 1000, r.first_fix_ms);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(GNSS_POLL_WAIT_MS + 10, r.decision_max_ms);
+        /** Every poll without a fix sends a No-GPS beacon */
+        TEST_ASSERT_EQUAL_UINT32(r.timeouts, r.zero_packets);
+    }
+}
+
+static void test_cold_start(void)
+{
+    checkScenario(coldStart());
+    /** The first polls wait the whole GNSS_POLL_WAIT_MS */
+    TEST_ASSERT_GREATER_THAN(0, g_gnss_poll_timeouts);
+}
+
+static void test_urban_canyon(void)
+{
+    checkScenario(urbanCanyon());
+}
+
+static void test_tunnel(void)
+{
+    scenario_s s = tunnel();
+    checkScenario(s);
+    /** Lost in the tunnel, back after it */
+    TEST_ASSERT_GREATER_THAN(0, g_gnss_poll_timeouts);
+    TEST_ASSERT_TRUE(ftester_gpsLock);
+}
+
+/** A full flash stops the recording, only what was written is counted */
+static void test_record_flash_full(void)
+{
+    InternalFS.format();
+    /** Something else has all blocks but one */
+    File other(InternalFS);
+    other.open("/other", FILE_O_WRITE);
+    std::vector<uint8_t> fill((InternalFS.blockCount - 1) * Adafruit_LittleFS::blockSize, 0);
+    other.write(fill.data(), fill.size());
+    other.close();
+
+    TEST_ASSERT_FALSE(recordTrace(coldStart()));
+    TEST_ASSERT_EQUAL_UINT32(Adafruit_LittleFS::blockSize, traceSize);
+    TEST_ASSERT_EQUAL_UINT32(traceSize, InternalFS.files[traceName]->size());
+    InternalFS.format();
+}
+
+/** No bus at power up, the RAK12500 isn't probed and the RAK1910 is used */
+static void test_init_no_bus(void)
+{
+    resetGnss();
+    InternalFS.remove(traceName);
+    my_rak12500_gnss.present = true;
+    busFree = false;
+    uint8_t option = init_gnss();
+    busFree = true;
+    TEST_ASSERT_EQUAL_UINT8(RAK1910_GNSS, option);
+    TEST_ASSERT_EQUAL_UINT8(RAK12500_GNSS, init_gnss());
+    my_rak12500_gnss.present = false;
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_cold_start);
+    RUN_TEST(test_urban_canyon);
+    RUN_TEST(test_tunnel);
+    RUN_TEST(test_record_flash_full);
+    RUN_TEST(test_init_no_bus);
+    return UNITY_END();
+}
@@ -0,0 +1,238 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief I2C bus arbitration: a sensor between two OLED rows, nested acquires, timeouts
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The host runs one task at a time. A sensor task that blocks on the
+ * bus is played by counting it as waiting, it runs from the delay hook
+ * once the task holding the bus waits, like the scheduler would switch
+ * to it. A tile row takes OLED_ROW_MS on the bus, 133 bytes at 400kHz.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include "../../src/i2c_bus.cpp"
+#include "../../src/oled.cpp"
+
+/** One tile row and its area overhead on the bus */
+#define OLED_ROW_MS 3
+/** A sensor read */
+#define SENSOR_READ_MS 1
+
+static TaskHandle_t const appTask = (TaskHandle_t)1;
+static TaskHandle_t const accTask = (TaskHandle_t)2;
+static TaskHandle_t const gnssTask = (TaskHandle_t)3;
+
+static U8G2 display;
+
+/** The sensor shows up halfway through this row, -1 never */
+static int8_t sensorRow = -1;
+/** The sensor is blocked on the bus */
+static bool sensorBlocked = false;
+static uint64_t sensorArrivedUs = 0;
+static uint64_t sensorGotBusUs = 0;
+/** The GNSS task lets the bus go at this time */
+static uint64_t gnssReleaseUs = 0;
+
+/** A tile row on the bus, the sensor may come in the middle of it */
+static void rowOnBus(void)
+{
+    host_advance_ms(OLED_ROW_MS / 2);
+    if((int8_t)(display.areas.size() - 1) == sensorRow)
+    {
+        /** Between setWaiting() and xSemaphoreTake() of its i2c_acquire() */
+        waiting[I2C_DEV_ACC]++;
+        sensorBlocked = true;
+        sensorArrivedUs = host_now_us;
+    }
+    host_advance_ms(OLED_ROW_MS - OLED_ROW_MS / 2);
+}
+
+/** The app task waits, the other tasks run */
+static void otherTasks(void)
+{
+    static bool running = false;
+    if(running)
+    {
+        return;
+    }
+    running = true;
+    TaskHandle_t self = host_task;
+    if(gnssReleaseUs != 0 && host_now_us >= gnssReleaseUs)
+    {
+        gnssReleaseUs = 0;
+        host_task = gnssTask;
+        i2c_release(I2C_DEV_GNSS);
+    }
+    if(sensorBlocked && owner == nullptr)
+    {
+        /** The sensor's i2c_acquire() goes on, it counts itself again */
+        sensorBlocked = false;
+        waiting[I2C_DEV_ACC]--;
+        host_task = accTask;
+        TEST_ASSERT_TRUE(i2c_acquire(I2C_DEV_ACC));
+        sensorGotBusUs = host_now_us;
+        host_advance_ms(SENSOR_READ_MS);
+        i2c_release(I2C_DEV_ACC);
+    }
+    host_task = self;
+    running = false;
+}
+
+void setUp(void)
+{
+    delete busLock;
+    busLock = nullptr;
+    i2c_bus_init();
+    owner = nullptr;
+    ownerDepth = 0;
+    for(uint8_t dev = 0; dev < I2C_DEV_COUNT; dev++)
+    {
+        waiting[dev] = 0;
+        busyRestUs[dev] = 0;
+        g_i2c_stats[dev] = i2c_bus_stats_s();
+    }
+    host_task = appTask;
+    host_delay_hook = otherTasks;
+    sensorRow = -1;
+    sensorBlocked = false;
+    gnssReleaseUs = 0;
+    for(uint16_t i = 0; i < sizeof(display.buffer); i++)
+    {
+        display.buffer[i] = (uint8_t)(i * 37);
+    }
+    display.areas.clear();
+    display.onArea = rowOnBus;
+    oled_invalidate();
+}
+void tearDown(void)
+{
+    host_delay_hook = nullptr;
+    display.onArea = nullptr;
+}
+
+/** A sensor in the middle of a frame waits for the row, not the frame */
+static void test_sensor_between_rows(void)
+{
+    sensorRow = 2;
+    uint64_t start = host_now_us;
+    TEST_ASSERT_EQUAL_UINT16(8 * (16 * OLED_TILE_BYTES + OLED_AREA_OVERHEAD), oled_flush(display));
+    uint64_t frameUs = host_now_us - start;
+
+    /** Whole frame sent, once, the sensor in between */
+    TEST_ASSERT_EQUAL_UINT32(8, display.areas.size());
+    TEST_ASSERT_EQUAL_MEMORY(display.buffer, display.panel, sizeof(display.panel));
+    TEST_ASSERT_FALSE(sensorBlocked);
+    TEST_ASSERT_EQUAL_UINT32(1, g_i2c_stats[I2C_DEV_OLED].preempted);
+    TEST_ASSERT_EQUAL_UINT32(1, g_i2c_stats[I2C_DEV_ACC].transactions);
+    /** The OLED got the bus again once, after the sensor */
+    TEST_ASSERT_EQUAL_UINT32(2, g_i2c_stats[I2C_DEV_OLED].transactions);
+    TEST_ASSERT_EQUAL_UINT32(0, g_i2c_stats[I2C_DEV_OLED].timeouts);
+    TEST_ASSERT_TRUE(owner == nullptr);
+
+    uint32_t waitedUs = sensorGotBusUs - sensorArrivedUs;
+    /** The rest of its row and one tick of the OLED noticing */
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(OLED_ROW_MS * 1000 + 1000, waitedUs);
+    printf("sensor waited %luus for the bus, a frame is %luus on the bus\n", (unsigned long)waitedUs, (unsigned long)frameUs);
+
+    /** No sensor, no yield */
+    sensorRow = -1;
+    display.areas.clear();
+    oled_invalidate();
+    oled_flush(display);
+    TEST_ASSERT_EQUAL_UINT32(1, g_i2c_stats[I2C_DEV_OLED].preempted);
+}
+
+/** The task that owns the bus acquires it again, others wait for the last release */
+static void test_nested(void)
+{
+    host_task = gnssTask;
+    TEST_ASSERT_TRUE(i2c_acquire(I2C_DEV_GNSS));
+    /** ftester_SetGPSType() draws while the GNSS init has the bus */
+    TEST_ASSERT_TRUE(i2c_acquire(I2C_DEV_OLED));
+    TEST_ASSERT_EQUAL_UINT8(2, ownerDepth);
+    /** Nested, the bus isn't given up for a waiting sensor */
+    waiting[I2C_DEV_ACC]++;
+    TEST_ASSERT_TRUE(i2c_yield(I2C_DEV_OLED));
+    TEST_ASSERT_TRUE(owner == gnssTask);
+    waiting[I2C_DEV_ACC]--;
+    i2c_release(I2C_DEV_OLED);
+    TEST_ASSERT_TRUE(owner == gnssTask);
+    /** One transaction, counted on the device that got the bus */
+    TEST_ASSERT_EQUAL_UINT32(1, g_i2c_stats[I2C_DEV_GNSS].transactions);
+    TEST_ASSERT_EQUAL_UINT32(0, g_i2c_stats[I2C_DEV_OLED].transactions);
+
+    /** Another task releasing changes nothing */
+    host_task = appTask;
+    i2c_release(I2C_DEV_OLED);
+    TEST_ASSERT_TRUE(owner == gnssTask);
+    TEST_ASSERT_EQUAL_UINT8(1, ownerDepth);
+
+    /** Still held, the GNSS task gives it up while the app task waits */
+    gnssReleaseUs = host_now_us + 200000;
+    uint64_t start = host_now_us;
+    TEST_ASSERT_TRUE(i2c_acquire(I2C_DEV_OLED));
+    TEST_ASSERT_TRUE(owner == appTask);
+    TEST_ASSERT_TRUE(host_now_us - start >= 200000);
+    TEST_ASSERT_TRUE(host_now_us - start <= 202000);
+    i2c_release(I2C_DEV_OLED);
+    TEST_ASSERT_TRUE(owner == nullptr);
+}
+
+/** A bus held too long, the OLED and the sensors give up and say so */
+static void test_timeout(void)
+{
+    /** saveConfigSelective() stuck */
+    host_task = gnssTask;
+    TEST_ASSERT_TRUE(i2c_acquire(I2C_DEV_GNSS));
+    host_task = appTask;
+
+    uint64_t start = host_now_us;
+    TEST_ASSERT_FALSE(i2c_acquire(I2C_DEV_OLED));
+    TEST_ASSERT_EQUAL_UINT32(I2C_WAIT_MAX_MS * 1000, host_now_us - start);
+    TEST_ASSERT_EQUAL_UINT32(1, g_i2c_stats[I2C_DEV_OLED].timeouts);
+    TEST_ASSERT_EQUAL_UINT32(I2C_WAIT_MAX_MS * 1000, g_i2c_stats[I2C_DEV_OLED].wait_us_max);
+    TEST_ASSERT_EQUAL_UINT8(0, waiting[I2C_DEV_OLED]);
+
+    /** A flush without the bus sends nothing, the frame goes next time */
+    TEST_ASSERT_EQUAL_UINT16(0, oled_flush(display));
+    TEST_ASSERT_EQUAL_UINT32(0, display.areas.size());
+    TEST_ASSERT_EQUAL_UINT32(2, g_i2c_stats[I2C_DEV_OLED].timeouts);
+
+    /** A sensor waits in line just as long */
+    host_task = accTask;
+    start = host_now_us;
+    TEST_ASSERT_FALSE(i2c_acquire(I2C_DEV_ACC));
+    TEST_ASSERT_EQUAL_UINT32(I2C_WAIT_MAX_MS * 1000, host_now_us - start);
+    TEST_ASSERT_EQUAL_UINT32(1, g_i2c_stats[I2C_DEV_ACC].timeouts);
+    TEST_ASSERT_EQUAL_UINT8(0, waiting[I2C_DEV_ACC]);
+
+    host_task = gnssTask;
+    i2c_release(I2C_DEV_GNSS);
+
+    /** The OLED doesn't take a free bus from a sensor that waits for it, and gives up */
+    host_task = appTask;
+    waiting[I2C_DEV_ACC]++;
+    TEST_ASSERT_FALSE(i2c_acquire(I2C_DEV_OLED));
+    TEST_ASSERT_EQUAL_UINT32(3, g_i2c_stats[I2C_DEV_OLED].timeouts);
+    TEST_ASSERT_TRUE(owner == nullptr);
+    waiting[I2C_DEV_ACC]--;
+
+    /** Free again */
+    TEST_ASSERT_EQUAL_UINT16(8 * (16 * OLED_TILE_BYTES + OLED_AREA_OVERHEAD), oled_flush(display));
+    TEST_ASSERT_EQUAL_MEMORY(display.buffer, display.panel, sizeof(display.panel));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sensor_between_rows);
+    RUN_TEST(test_nested);
+    RUN_TEST(test_timeout);
+    return UNITY_END();
+}
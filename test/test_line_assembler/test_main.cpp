@@ -0,0 +1,123 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief LineAssembler as the AT command input uses it
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <app.h>
+#include <string>
+#include <vector>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/** Lines completed while pushing text, like one BLE UART packet */
+static std::vector<std::string> feed(LineAssembler<AT_LINE_MAX> &lines, const char *packet)
+{
+    std::vector<std::string> done;
+    for(const char *p = packet; *p != '\0'; p++)
+    {
+        if(lines.push(*p))
+        {
+            done.push_back(lines.line());
+            TEST_ASSERT_EQUAL(done.back().size(), lines.length());
+        }
+    }
+    return done;
+}
+
+static void test_line_across_packets(void)
+{
+    LineAssembler<AT_LINE_MAX> lines;
+    TEST_ASSERT_EQUAL(0, feed(lines, "AT+EX").size());
+    TEST_ASSERT_TRUE(lines.pending());
+    TEST_ASSERT_EQUAL(0, feed(lines, "PORT=12").size());
+    std::vector<std::string> done = feed(lines, "34\r\nAT+EXPORT=?");
+    TEST_ASSERT_EQUAL(1, done.size());
+    TEST_ASSERT_EQUAL_STRING("AT+EXPORT=1234", done[0].c_str());
+    done = feed(lines, "\r\n");
+    TEST_ASSERT_EQUAL(1, done.size());
+    TEST_ASSERT_EQUAL_STRING("AT+EXPORT=?", done[0].c_str());
+    TEST_ASSERT_FALSE(lines.pending());
+}
+
+/** CR, LF and CRLF each end one line, CRLF split over two packets too */
+static void test_line_ends(void)
+{
+    LineAssembler<AT_LINE_MAX> lines;
+    std::vector<std::string> done = feed(lines, "a\rb\nc\r\n\r\n\n\rd\r");
+    TEST_ASSERT_EQUAL(4, done.size());
+    TEST_ASSERT_EQUAL_STRING("a", done[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("b", done[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("c", done[2].c_str());
+    TEST_ASSERT_EQUAL_STRING("d", done[3].c_str());
+    /** The \n of d's CRLF comes in the next packet */
+    done = feed(lines, "\ne\r\n");
+    TEST_ASSERT_EQUAL(1, done.size());
+    TEST_ASSERT_EQUAL_STRING("e", done[0].c_str());
+}
+
+/** AT_LINE_MAX - 1 characters fit, one more drops the line up to its end */
+static void test_overflow(void)
+{
+    LineAssembler<AT_LINE_MAX> lines;
+    std::string full(AT_LINE_MAX - 1, 'x');
+    std::vector<std::string> done = feed(lines, (full + "\r\n").c_str());
+    TEST_ASSERT_EQUAL(1, done.size());
+    TEST_ASSERT_EQUAL(AT_LINE_MAX - 1, done[0].size());
+    TEST_ASSERT_EQUAL_UINT32(0, lines.overflows());
+
+    /** Too long, in two packets */
+    std::string tooLong(AT_LINE_MAX, 'y');
+    TEST_ASSERT_EQUAL(0, feed(lines, tooLong.substr(0, 100).c_str()).size());
+    TEST_ASSERT_EQUAL(0, feed(lines, (tooLong.substr(100) + "zzz").c_str()).size());
+    TEST_ASSERT_TRUE(lines.pending());
+    done = feed(lines, "\r\nAT\r\n");
+    TEST_ASSERT_EQUAL(1, done.size());
+    TEST_ASSERT_EQUAL_STRING("AT", done[0].c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, lines.overflows());
+}
+
+/** A line without a line end is ended by the idle timeout */
+static void test_idle_flush(void)
+{
+    LineAssembler<AT_LINE_MAX> lines;
+    TEST_ASSERT_FALSE(lines.flush());
+    feed(lines, "AT+EXPORT");
+    TEST_ASSERT_TRUE(lines.pending());
+    TEST_ASSERT_TRUE(lines.flush());
+    TEST_ASSERT_EQUAL_STRING("AT+EXPORT", lines.line());
+    TEST_ASSERT_FALSE(lines.pending());
+    /** Nothing left for a second timeout */
+    TEST_ASSERT_FALSE(lines.flush());
+    std::vector<std::string> done = feed(lines, "AT\n");
+    TEST_ASSERT_EQUAL(1, done.size());
+    TEST_ASSERT_EQUAL_STRING("AT", done[0].c_str());
+
+    /** An overflowed line is dropped by the timeout as well */
+    feed(lines, std::string(AT_LINE_MAX + 5, 'x').c_str());
+    TEST_ASSERT_TRUE(lines.pending());
+    TEST_ASSERT_FALSE(lines.flush());
+    TEST_ASSERT_FALSE(lines.pending());
+    TEST_ASSERT_EQUAL_UINT32(1, lines.overflows());
+    done = feed(lines, "ATZ\r");
+    TEST_ASSERT_EQUAL(1, done.size());
+    TEST_ASSERT_EQUAL_STRING("ATZ", done[0].c_str());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_line_across_packets);
+    RUN_TEST(test_line_ends);
+    RUN_TEST(test_overflow);
+    RUN_TEST(test_idle_flush);
+    return UNITY_END();
+}
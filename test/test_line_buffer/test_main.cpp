@@ -0,0 +1,194 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief LineBuffer as the OLED log uses it, and against the old vector log
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * pushVector() is sendToDisplay() before the ring buffer, a
+ * std::vector<std::string> that erased its first line once full. Both
+ * get the same lines and must show the same text, then both are timed
+ * on a push and a read of all lines, like sendToDisplay() and
+ * refreshDisplay().
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <app.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/** The OLED log, 9 lines of 32 characters */
+#define LOG_LINES 9
+#define LOG_COLS 32
+/** Lines pushed for the timing */
+#define BENCH_LINES 200000
+
+typedef LineBuffer<LOG_LINES, LOG_COLS> OledLog;
+
+/** The old display buffer */
+static void pushVector(std::vector<std::string> &lines, std::string s)
+{
+    if(lines.size() >= LOG_LINES)
+    {
+        lines.erase(lines.begin());
+    }
+    if(s.length() <= LOG_COLS)
+    {
+        lines.push_back(s);
+    } else {
+        s.resize(30);
+        lines.push_back(s + "..");
+    }
+}
+
+/** Lines like the ones shown: downlinks, signal info, joins, long hot spot names */
+static std::string lineOf(uint32_t i)
+{
+    char line[80];
+    switch(i % 4)
+    {
+        case 0:
+            snprintf(line, sizeof(line), "%lu.bumpy-red-fox (%lu) 1.%02lukm", (unsigned long)i, (unsigned long)(i % 7), (unsigned long)(i % 100));
+            break;
+        case 1:
+            snprintf(line, sizeof(line), "RSSI:-%lu/-112 SNR:%lu/4.5 SF:%lu", (unsigned long)(60 + i % 60), (unsigned long)(i % 12), (unsigned long)(7 + i % 6));
+            break;
+        case 2:
+            snprintf(line, sizeof(line), "Joined Helium Network! (EU868)");
+            break;
+        default:
+            snprintf(line, sizeof(line), "%lu.striped-crimson-alligator-of-the-north (%lu)", (unsigned long)i, (unsigned long)(i % 9));
+            break;
+    }
+    return line;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/** Lines come back oldest first until the buffer is full */
+static void test_order(void)
+{
+    OledLog log;
+    TEST_ASSERT_EQUAL_UINT8(0, log.size());
+    log.push("first");
+    log.push("second");
+    log.push("third");
+    TEST_ASSERT_EQUAL_UINT8(3, log.size());
+    TEST_ASSERT_EQUAL_STRING("first", log[0]);
+    TEST_ASSERT_EQUAL_STRING("second", log[1]);
+    TEST_ASSERT_EQUAL_STRING("third", log[2]);
+
+    log.clear();
+    TEST_ASSERT_EQUAL_UINT8(0, log.size());
+    log.push("again");
+    TEST_ASSERT_EQUAL_UINT8(1, log.size());
+    TEST_ASSERT_EQUAL_STRING("again", log[0]);
+}
+
+/** Once full each line drops the oldest, for several turns of the ring */
+static void test_wrap(void)
+{
+    OledLog log;
+    char line[LOG_COLS + 1];
+    for(uint8_t i = 0; i < 3 * LOG_LINES + 4; i++)
+    {
+        snprintf(line, sizeof(line), "%u", i);
+        log.push(line);
+        TEST_ASSERT_EQUAL_UINT8(min(i + 1, LOG_LINES), log.size());
+        /** The newest is last, the ones before it in order */
+        for(uint8_t y = 0; y < log.size(); y++)
+        {
+            snprintf(line, sizeof(line), "%u", i + 1 - log.size() + y);
+            TEST_ASSERT_EQUAL_STRING(line, log[y]);
+        }
+    }
+}
+
+/** Up to 32 characters are kept, longer lines are 30 of them and ".." */
+static void test_truncate(void)
+{
+    OledLog log;
+    std::string fits(LOG_COLS, 'a');
+    std::string over = std::string(LOG_COLS - 2, 'b') + "cde";
+    std::string overCut = std::string(LOG_COLS - 2, 'b') + "..";
+    std::string fitsCut = std::string(LOG_COLS - 2, 'a') + "..";
+    std::string oneOver = fits + "z";
+    log.push(fits.c_str());
+    log.push(over.c_str());
+    log.push(oneOver.c_str());
+    log.push("");
+    TEST_ASSERT_EQUAL_STRING(fits.c_str(), log[0]);
+    TEST_ASSERT_EQUAL_STRING(overCut.c_str(), log[1]);
+    TEST_ASSERT_EQUAL_STRING(fitsCut.c_str(), log[2]);
+    TEST_ASSERT_EQUAL_UINT32(LOG_COLS, strlen(log[2]));
+    TEST_ASSERT_EQUAL_STRING("", log[3]);
+}
+
+/** Same lines as the vector log, and the time per line */
+static void test_vs_vector(void)
+{
+    OledLog log;
+    std::vector<std::string> lines;
+    for(uint32_t i = 0; i < 4 * LOG_LINES; i++)
+    {
+        std::string s = lineOf(i);
+        log.push(s.c_str());
+        pushVector(lines, s);
+        TEST_ASSERT_EQUAL_UINT32(lines.size(), log.size());
+        for(uint8_t y = 0; y < log.size(); y++)
+        {
+            TEST_ASSERT_EQUAL_STRING(lines[y].c_str(), log[y]);
+        }
+    }
+
+    /** The text is made before the timing, both get the same */
+    std::vector<std::string> text;
+    for(uint32_t i = 0; i < 64; i++)
+    {
+        text.push_back(lineOf(i));
+    }
+    volatile uint32_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < BENCH_LINES; i++)
+    {
+        pushVector(lines, text[i % text.size()]);
+        for(uint8_t y = 0; y < lines.size(); y++)
+        {
+            sink += lines[y].c_str()[0];
+        }
+    }
+    double vectorNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < BENCH_LINES; i++)
+    {
+        log.push(text[i % text.size()].c_str());
+        for(uint8_t y = 0; y < log.size(); y++)
+        {
+            sink += log[y][0];
+        }
+    }
+    double ringNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("push and read %u lines: vector %.0f ns/line, ring %.0f ns/line (%.1fx), ring %u bytes in place\n", LOG_LINES,
+           vectorNs / BENCH_LINES, ringNs / BENCH_LINES, vectorNs / ringNs, (unsigned)sizeof(OledLog));
+    TEST_ASSERT_EQUAL_UINT32(LOG_LINES * (LOG_COLS + 1) + 2, sizeof(OledLog));
+    TEST_ASSERT_TRUE(sink != 0);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_order);
+    RUN_TEST(test_wrap);
+    RUN_TEST(test_truncate);
+    RUN_TEST(test_vs_vector);
+    return UNITY_END();
+}
@@ -0,0 +1,215 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Log ring: wrap, drops when full, formatting of the raw arguments, sinks
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Records go in with app_log() like MYLOG/APP_LOG, drainRing() is what
+ * the log task runs when notified. The Serial and BLE stand-ins keep
+ * what was written.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define HOST_LOG_SINK 1
+
+#include <unity.h>
+#include <host.h>
+#include <string>
+#include <vector>
+#include "../../src/log_sink.cpp"
+
+static bool exportActive = false;
+bool ble_export_active(void) { return exportActive; }
+
+static char line[LOG_LINE_MAX];
+
+/** Lines written to a sink since the last call */
+static std::vector<std::string> linesOf(HardwareSerial &port)
+{
+    std::vector<std::string> lines;
+    std::string text((const char *)port.tx, port.txLen);
+    size_t start = 0;
+    for(size_t end = text.find('\n'); end != std::string::npos; end = text.find('\n', start))
+    {
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    port.txLen = 0;
+    return lines;
+}
+
+/** Format of the record queued last, in line */
+static const char *formatLast(void)
+{
+    const log_record_s &rec = ring[(ringHead - 1) & (LOG_RING_SIZE - 1)];
+    uint16_t len = formatRecord(rec, line, sizeof(line));
+    TEST_ASSERT_EQUAL_UINT32(strlen(line), len);
+    return line;
+}
+
+/** Ring at position start, every slot ready for its next use */
+static void resetRing(uint32_t start)
+{
+    for(uint32_t slot = 0; slot < LOG_RING_SIZE; slot++)
+    {
+        ring[slot] = log_record_s();
+        /** Slot i is next used at the first position >= start with that index */
+        uint32_t pos = start + ((slot - start) & (LOG_RING_SIZE - 1));
+        ring[slot].seq = pos - slot;
+    }
+    ringHead = start;
+    ringTail = start;
+}
+
+void setUp(void)
+{
+    resetRing(0);
+    g_log_records = 0;
+    g_log_dropped = 0;
+    reportedDrops = 0;
+    Serial.txLen = 0;
+    g_ble_uart.txLen = 0;
+    g_ble_uart_is_connected = false;
+    exportActive = false;
+}
+void tearDown(void) {}
+
+/** Each conversion takes its 32 bit argument the way it was stored */
+static void test_format(void)
+{
+    app_log(LOG_SERIAL, "T", "%ld/%lu", (long)-123456, (unsigned long)4000000000UL);
+    TEST_ASSERT_EQUAL_STRING("-123456/4000000000", formatLast());
+    app_log(LOG_SERIAL, "T", "%u %d %x %X", 4000000000U, INT32_MIN, 255, 0xBEEF);
+    TEST_ASSERT_EQUAL_STRING("4000000000 -2147483648 ff BEEF", formatLast());
+    app_log(LOG_SERIAL, "T", "%f %.1f %.3f", 2.5, 3.14159f, -0.0625);
+    TEST_ASSERT_EQUAL_STRING("2.500000 3.1 -0.062", formatLast());
+    app_log(LOG_SERIAL, "T", "%s and %s", "static text", (const char *)nullptr);
+    TEST_ASSERT_EQUAL_STRING("static text and (null)", formatLast());
+    app_log(LOG_SERIAL, "T", "100%% %d%%", 42);
+    TEST_ASSERT_EQUAL_STRING("100% 42%", formatLast());
+    /** Flags and width are kept */
+    app_log(LOG_SERIAL, "T", "[%5d|%-4s|%05.1f|%+d]", 42, "ab", 1.25, 7);
+    TEST_ASSERT_EQUAL_STRING("[   42|ab  |001.2|+7]", formatLast());
+    /** A 64 bit argument is cut to 32 bit */
+    app_log(LOG_SERIAL, "T", "%lld", (long long)0x100000007LL);
+    TEST_ASSERT_EQUAL_STRING("7", formatLast());
+    /** Missing arguments drop their conversion, a lone % at the end is dropped */
+    app_log(LOG_SERIAL, "T", "%d and %d, 5%", 7);
+    TEST_ASSERT_EQUAL_STRING("7 and , 5", formatLast());
+    app_log(LOG_SERIAL, "T", "no arguments");
+    TEST_ASSERT_EQUAL_STRING("no arguments", formatLast());
+}
+
+/** A line longer than LOG_LINE_MAX is cut, never overrun */
+static void test_long_line(void)
+{
+    static char text[3 * LOG_LINE_MAX];
+    memset(text, 'x', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    app_log(LOG_SERIAL, "T", "%s%d", text, 1);
+    TEST_ASSERT_EQUAL_UINT32(LOG_LINE_MAX - 1, strlen(formatLast()));
+    app_log(LOG_SERIAL, "T", "%d %s", 12345, text);
+    TEST_ASSERT_EQUAL_UINT32(LOG_LINE_MAX - 1, strlen(formatLast()));
+    TEST_ASSERT_EQUAL_INT(0, strncmp("12345 xxx", line, 9));
+}
+
+/** Records come out in order over several turns of the ring, and across 2^32 */
+static void test_wrap(void)
+{
+    for(uint32_t start : {0UL, 0xFFFFFFFFUL - LOG_RING_SIZE - 20})
+    {
+        resetRing(start);
+        g_log_records = 0;
+        uint32_t next = 0;
+        for(uint32_t batch = 0; batch < 3 * LOG_RING_SIZE / 10 + 2; batch++)
+        {
+            /** Batches that don't line up with the ring */
+            for(uint8_t i = 0; i < 10; i++)
+            {
+                app_log(LOG_SERIAL, "W", "record %lu", (unsigned long)(batch * 10 + i));
+            }
+            drainRing(line);
+            std::vector<std::string> lines = linesOf(Serial);
+            TEST_ASSERT_EQUAL_UINT32(10, lines.size());
+            for(const std::string &l : lines)
+            {
+                char expected[32];
+                snprintf(expected, sizeof(expected), "[W] record %lu", (unsigned long)next++);
+                TEST_ASSERT_EQUAL_STRING(expected, l.c_str());
+            }
+        }
+        TEST_ASSERT_EQUAL_UINT32(next, g_log_records);
+        TEST_ASSERT_EQUAL_UINT32(start + next, ringTail);
+        TEST_ASSERT_EQUAL_UINT32(ringHead, ringTail);
+        TEST_ASSERT_EQUAL_UINT32(0, g_log_dropped);
+    }
+}
+
+/** A full ring drops the newest records, the count comes out before the next line */
+static void test_full(void)
+{
+    for(uint32_t i = 0; i < LOG_RING_SIZE + 7; i++)
+    {
+        app_log(LOG_SERIAL, "F", "record %lu", (unsigned long)i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(7, g_log_dropped);
+    TEST_ASSERT_EQUAL_UINT32(LOG_RING_SIZE, ringHead - ringTail);
+
+    drainRing(line);
+    std::vector<std::string> lines = linesOf(Serial);
+    TEST_ASSERT_EQUAL_UINT32(LOG_RING_SIZE + 1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("[LOG] 7 records dropped", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("[F] record 0", lines[1].c_str());
+    char last[32];
+    snprintf(last, sizeof(last), "[F] record %lu", (unsigned long)(LOG_RING_SIZE - 1));
+    TEST_ASSERT_EQUAL_STRING(last, lines.back().c_str());
+
+    /** Room again, the drops are told once */
+    app_log(LOG_SERIAL, "F", "after");
+    drainRing(line);
+    lines = linesOf(Serial);
+    TEST_ASSERT_EQUAL_UINT32(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("[F] after", lines[0].c_str());
+    TEST_ASSERT_EQUAL_UINT32(LOG_RING_SIZE + 1, g_log_records);
+}
+
+/** BLE gets its lines without the tag, only while connected and no export runs
+*   The sinks are looked at when the log task gets to the record */
+static void test_sinks(void)
+{
+    app_log(LOG_SERIAL | LOG_BLE, "B", "not connected");
+    drainRing(line);
+    g_ble_uart_is_connected = true;
+    app_log(LOG_SERIAL | LOG_BLE, "B", "connected %d", 1);
+    app_log(LOG_BLE, "B", "BLE only");
+    drainRing(line);
+    exportActive = true;
+    app_log(LOG_SERIAL | LOG_BLE, "B", "exporting");
+    drainRing(line);
+
+    std::vector<std::string> serial = linesOf(Serial);
+    std::vector<std::string> ble = linesOf(g_ble_uart);
+    TEST_ASSERT_EQUAL_UINT32(3, serial.size());
+    TEST_ASSERT_EQUAL_STRING("[B] not connected", serial[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("[B] connected 1", serial[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("[B] exporting", serial[2].c_str());
+    TEST_ASSERT_EQUAL_UINT32(2, ble.size());
+    TEST_ASSERT_EQUAL_STRING("connected 1", ble[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("BLE only", ble[1].c_str());
+    /** Every record is taken off the ring, sent or not */
+    TEST_ASSERT_EQUAL_UINT32(4, g_log_records);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_format);
+    RUN_TEST(test_long_line);
+    RUN_TEST(test_wrap);
+    RUN_TEST(test_full);
+    RUN_TEST(test_sinks);
+    return UNITY_END();
+}
@@ -0,0 +1,263 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Dead reckoning replay, predicted against true tracks and GNSS polls avoided
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * A true track is built from legs of constant speed and heading, in
+ * double meters. Every ACC_FIFO_SIZE / ACC_ODR_HZ while moving the
+ * accelerometer batch wakes the app, like the ACC_TRIGGER event does:
+ * motion_wake(), beacon_wake_needed() and, when it says so, a GNSS poll
+ * that returns the true position. Without dead reckoning every moving
+ * batch was a poll.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <vector>
+#include "../../src/geo.cpp"
+#include "../../src/motion.cpp"
+#include "../../src/beacon_sched.cpp"
+
+const char *activity_name(uint8_t activity)
+{
+    static const char *names[ACTIVITY_CLASSES] = {"still", "walking", "driving"};
+    return names[activity];
+}
+
+/** Meters per degree on the geo.cpp sphere */
+static const double M_PER_DEG = 6371009.0 * M_PI / 180.0;
+static const double LAT0 = 45.42153;
+static const double LON0 = -75.69719;
+
+/** Constant speed and heading for a while */
+struct leg_s
+{
+    uint32_t seconds;
+    double speed;
+    double heading;
+};
+
+/** True position, meters from the start */
+struct truth_s
+{
+    double north;
+    double east;
+    double speed;
+    double heading;
+};
+
+static truth_s truth;
+
+struct replay_s
+{
+    uint32_t wakes;
+    uint32_t polls;
+    uint32_t beacons;
+    double errSum;
+    double errMax;
+    uint32_t errCount;
+    uint32_t withinSigma;
+    /** Worst true distance from the last beacon at a wakeup without a poll */
+    double skippedMax;
+};
+
+static int32_t toLatE5(const truth_s &t)
+{
+    return lround((LAT0 + t.north / M_PER_DEG) * 100000.0);
+}
+
+static int32_t toLonE5(const truth_s &t)
+{
+    return lround((LON0 + t.east / (M_PER_DEG * cos(LAT0 * M_PI / 180.0))) * 100000.0);
+}
+
+/** Meters between a 1e-5 deg position and the truth */
+static double errorM(int32_t lat, int32_t lon, const truth_s &t)
+{
+    double north = (lat - toLatE5(t)) / 100000.0 * M_PER_DEG;
+    double east = (lon - toLonE5(t)) / 100000.0 * M_PER_DEG * cos(LAT0 * M_PI / 180.0);
+    return sqrt(north * north + east * east);
+}
+
+/** What poll_gnss() gets, the true position with a 1.0 hDOP */
+static gnss_fix_s trueFix(const truth_s &t)
+{
+    gnss_fix_s fix;
+    fix.lat = toLatE5(t);
+    fix.lon = toLonE5(t);
+    fix.hdop = 100;
+    fix.speed = lround(t.speed * 1000.0);
+    fix.heading = lround(fmod(t.heading + 360.0, 360.0) * 100.0) % 36000;
+    fix.siv = 9;
+    fix.time = millis();
+    fix.valid = true;
+    return fix;
+}
+
+/** Accelerometer class of the true speed */
+static uint8_t trueActivity(const truth_s &t)
+{
+    if(t.speed < 0.3)
+    {
+        return ACTIVITY_STILL;
+    }
+    return t.speed < 3.0 ? ACTIVITY_WALKING : ACTIVITY_DRIVING;
+}
+
+/** Poll, dead reckoning starts over, beacon if it is worth one */
+static void pollAndBeacon(const truth_s &t, replay_s &r)
+{
+    gnss_fix_s fix = trueFix(t);
+    r.polls++;
+    motion_fix(fix);
+    if(beacon_should_send(fix))
+    {
+        beacon_sent(fix);
+        r.beacons++;
+    }
+}
+
+/**
+ * @brief Run the legs in 100ms steps, the app wakes on every full FIFO while moving
+ *
+ * @param legs True track
+ * @return replay_s What the wakeups saw
+ */
+static replay_s replay(const std::vector<leg_s> &legs)
+{
+    anchor = gnss_fix_s();
+    alongMm = 0;
+    sigmaMm = 0;
+    lastBeacon = gnss_fix_s();
+    g_gnss_polls_avoided = 0;
+    g_wakes_suppressed = 0;
+    g_lorawan_settings.send_repeat_time = 0;
+
+    replay_s r = {};
+    truth = truth_s();
+    truth.speed = legs[0].speed;
+    truth.heading = legs[0].heading;
+    /** Boot beacon */
+    pollAndBeacon(truth, r);
+
+    const uint32_t batchMs = ACC_FIFO_SIZE * 1000 / ACC_ODR_HZ;
+    uint32_t sinceBatch = 0;
+    bool wasMoving = true;
+    for(const leg_s &leg : legs)
+    {
+        truth.speed = leg.speed;
+        truth.heading = leg.heading;
+        for(uint32_t step = 0; step < leg.seconds * 10; step++)
+        {
+            host_advance_ms(100);
+            truth.north += leg.speed * 0.1 * cos(leg.heading * M_PI / 180.0);
+            truth.east += leg.speed * 0.1 * sin(leg.heading * M_PI / 180.0);
+            uint8_t batch = trueActivity(truth);
+            if(batch == ACTIVITY_STILL && !wasMoving)
+            {
+                /** No interrupt while it lies still */
+                sinceBatch = 0;
+                continue;
+            }
+            sinceBatch += 100;
+            if(sinceBatch < batchMs)
+            {
+                continue;
+            }
+            sinceBatch = 0;
+            wasMoving = batch != ACTIVITY_STILL;
+            motion_wake(batch);
+            if(batch == ACTIVITY_STILL)
+            {
+                continue;
+            }
+            r.wakes++;
+
+            int32_t lat, lon;
+            uint32_t sigma = motion_predict(lat, lon);
+            double err = errorM(lat, lon, truth);
+            r.errSum += err;
+            r.errCount++;
+            r.errMax = max(r.errMax, err);
+            r.withinSigma += err <= sigma ? 1 : 0;
+
+            if(beacon_wake_needed())
+            {
+                pollAndBeacon(truth, r);
+                continue;
+            }
+            truth_s beaconAt = {};
+            double north = (lastBeacon.lat - toLatE5(beaconAt)) / 100000.0 * M_PER_DEG;
+            double east = (lastBeacon.lon - toLonE5(beaconAt)) / 100000.0 * M_PER_DEG * cos(LAT0 * M_PI / 180.0);
+            r.skippedMax = max(r.skippedMax, hypot(truth.north - north, truth.east - east));
+        }
+    }
+    return r;
+}
+
+static void report(const char *name, const replay_s &r)
+{
+    printf("%-8s %4lu moving wakes, %3lu polls, %3lu avoided (%2lu%%), %3lu beacons, error mean %5.1fm max %5.1fm, %3lu%% within the uncertainty, skipped up to %5.1fm from the last beacon\n",
+           name, (unsigned long)r.wakes, (unsigned long)r.polls, (unsigned long)g_gnss_polls_avoided,
+           (unsigned long)(r.wakes != 0 ? g_gnss_polls_avoided * 100 / r.wakes : 0), (unsigned long)r.beacons,
+           r.errSum / max(r.errCount, (uint32_t)1), r.errMax, (unsigned long)(r.errCount != 0 ? r.withinSigma * 100 / r.errCount : 0), r.skippedMax);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/** Walking around blocks with a coffee stop */
+static void test_walk(void)
+{
+    std::vector<leg_s> legs = {
+        {240, 1.4, 0}, {180, 1.3, 90}, {120, 0, 90}, {300, 1.5, 90}, {200, 1.4, 180}, {60, 1.2, 225}, {240, 1.4, 270},
+    };
+    replay_s r = replay(legs);
+    report("walk", r);
+    TEST_ASSERT_TRUE(g_gnss_polls_avoided * 100 / r.wakes >= 80);
+    TEST_ASSERT_EQUAL_UINT32(r.wakes, r.polls - 1 + g_gnss_polls_avoided);
+    TEST_ASSERT_TRUE(r.skippedMax < BEACON_MIN_DISTANCE_M);
+    TEST_ASSERT_TRUE(r.withinSigma * 100 / r.errCount >= 90);
+}
+
+/** City drive, lights and turns */
+static void test_drive(void)
+{
+    std::vector<leg_s> legs = {
+        {60, 11, 0}, {30, 0, 0}, {45, 14, 90}, {20, 6, 135}, {90, 16, 180}, {40, 0, 180}, {60, 9, 270}, {120, 25, 300},
+    };
+    replay_s r = replay(legs);
+    report("drive", r);
+    TEST_ASSERT_TRUE(g_gnss_polls_avoided > 0);
+    TEST_ASSERT_EQUAL_UINT32(r.wakes, r.polls - 1 + g_gnss_polls_avoided);
+    TEST_ASSERT_TRUE(r.skippedMax < BEACON_MIN_DISTANCE_M);
+    TEST_ASSERT_TRUE(r.withinSigma * 100 / r.errCount >= 90);
+}
+
+/** Walk to the car, drive, walk in, sit at the desk */
+static void test_commute(void)
+{
+    std::vector<leg_s> legs = {
+        {90, 1.4, 45}, {10, 0, 45}, {300, 13, 10}, {180, 20, 80}, {30, 0, 80}, {120, 1.3, 170}, {600, 0, 170},
+    };
+    replay_s r = replay(legs);
+    report("commute", r);
+    TEST_ASSERT_TRUE(g_gnss_polls_avoided > 0);
+    TEST_ASSERT_EQUAL_UINT32(r.wakes, r.polls - 1 + g_gnss_polls_avoided);
+    TEST_ASSERT_TRUE(r.skippedMax < BEACON_MIN_DISTANCE_M);
+    TEST_ASSERT_TRUE(r.withinSigma * 100 / r.errCount >= 90);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_walk);
+    RUN_TEST(test_drive);
+    RUN_TEST(test_commute);
+    return UNITY_END();
+}
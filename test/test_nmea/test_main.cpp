@@ -0,0 +1,214 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief nmea_encode(): checksums, hemispheres and field parsing
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <string>
+#include "../../src/nmea.cpp"
+
+void setUp(void)
+{
+    g_nmea = nmea_fix_s();
+    g_nmea_sentences = 0;
+    g_nmea_bad_checksum = 0;
+    step = NMEA_WAIT_START;
+}
+void tearDown(void) {}
+
+/** Feed text, returns the last sentence type taken over */
+static uint8_t feed(const char *text)
+{
+    uint8_t last = NMEA_NONE;
+    for(const char *p = text; *p != '\0'; p++)
+    {
+        uint8_t type = nmea_encode(*p);
+        if(type != NMEA_NONE)
+        {
+            last = type;
+        }
+    }
+    return last;
+}
+
+/** Body to a full sentence with its checksum */
+static std::string withChecksum(const char *body)
+{
+    uint8_t sum = 0;
+    for(const char *p = body; *p != '\0'; p++)
+    {
+        sum ^= *p;
+    }
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+    return std::string("$") + body + tail;
+}
+
+static void test_field_fixed(void)
+{
+    TEST_ASSERT_EQUAL_INT32(545, fieldFixed("545.4", 0));
+    TEST_ASSERT_EQUAL_INT32(90, fieldFixed("0.9", 2));
+    TEST_ASSERT_EQUAL_INT32(123, fieldFixed("1.23456", 2));
+    TEST_ASSERT_EQUAL_INT32(1200, fieldFixed("12", 2));
+    TEST_ASSERT_EQUAL_INT32(-125, fieldFixed("-12.5", 1));
+    TEST_ASSERT_EQUAL_INT32(-12, fieldFixed("-12.9", 0));
+    TEST_ASSERT_EQUAL_INT32(50, fieldFixed(".5", 2));
+    TEST_ASSERT_EQUAL_INT32(0, fieldFixed("", 3));
+    /** Stops at anything that is not a digit */
+    TEST_ASSERT_EQUAL_INT32(1200, fieldFixed("12M", 2));
+}
+
+static void test_field_degrees(void)
+{
+    /** 48 deg 7.038 min */
+    TEST_ASSERT_EQUAL_INT32(4811730, fieldDegrees("4807.038"));
+    /** 11 deg 31 min, 0.516666 rounds up */
+    TEST_ASSERT_EQUAL_INT32(1151667, fieldDegrees("01131.000"));
+    /** 5 decimals of minutes, the most a u-blox sends */
+    TEST_ASSERT_EQUAL_INT32(4542153, fieldDegrees("4525.29180"));
+    /** 179.9999998 deg rounds to 180 */
+    TEST_ASSERT_EQUAL_INT32(18000000, fieldDegrees("17959.99999"));
+    TEST_ASSERT_EQUAL_INT32(17999998, fieldDegrees("17959.99880"));
+    TEST_ASSERT_EQUAL_INT32(0, fieldDegrees("0000.00000"));
+    /** More decimals are cut */
+    TEST_ASSERT_EQUAL_INT32(4542153, fieldDegrees("4525.2918049"));
+}
+
+static void test_gga(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(NMEA_GGA, feed("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"));
+    TEST_ASSERT_EQUAL_INT32(4811730, g_nmea.lat);
+    TEST_ASSERT_EQUAL_INT32(1151667, g_nmea.lon);
+    TEST_ASSERT_EQUAL_INT32(545, g_nmea.alt);
+    TEST_ASSERT_EQUAL_UINT16(90, g_nmea.hdop);
+    TEST_ASSERT_EQUAL_UINT8(8, g_nmea.siv);
+    TEST_ASSERT_TRUE(g_nmea.pos_valid);
+    TEST_ASSERT_TRUE(g_nmea.alt_valid);
+    TEST_ASSERT_EQUAL_UINT32(1, g_nmea_sentences);
+
+    /** No fix, empty fields */
+    TEST_ASSERT_EQUAL_UINT8(NMEA_GGA, feed(withChecksum("GNGGA,000012.00,,,,,0,00,99.99,,,,,,").c_str()));
+    TEST_ASSERT_FALSE(g_nmea.pos_valid);
+    TEST_ASSERT_FALSE(g_nmea.alt_valid);
+    TEST_ASSERT_EQUAL_UINT16(9999, g_nmea.hdop);
+}
+
+static void test_hemispheres(void)
+{
+    struct hemi_case_s
+    {
+        const char *ns;
+        const char *ew;
+        int32_t lat;
+        int32_t lon;
+    };
+    static const hemi_case_s cases[] = {
+        {"N", "E", 4542153, 7569719},
+        {"N", "W", 4542153, -7569719},
+        {"S", "E", -4542153, 7569719},
+        {"S", "W", -4542153, -7569719},
+    };
+    for(const hemi_case_s &c : cases)
+    {
+        char body[96];
+        snprintf(body, sizeof(body), "GNGGA,101010.00,4525.29180,%s,07541.83140,%s,1,09,1.02,70.1,M,-34.0,M,,", c.ns, c.ew);
+        TEST_ASSERT_EQUAL_UINT8(NMEA_GGA, feed(withChecksum(body).c_str()));
+        TEST_ASSERT_EQUAL_INT32(c.lat, g_nmea.lat);
+        TEST_ASSERT_EQUAL_INT32(c.lon, g_nmea.lon);
+    }
+    /** Negative altitude below the geoid */
+    TEST_ASSERT_EQUAL_UINT8(NMEA_GGA, feed(withChecksum("GPGGA,101010.00,3129.00000,N,03507.00000,E,1,09,1.0,-412.7,M,20.0,M,,").c_str()));
+    TEST_ASSERT_EQUAL_INT32(-412, g_nmea.alt);
+}
+
+static void test_rmc(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(NMEA_RMC, feed(withChecksum("GNRMC,083559.00,A,4525.29180,N,07541.83140,W,022.4,084.4,170926,,,A").c_str()));
+    /** 22.4 knots */
+    TEST_ASSERT_EQUAL_UINT32(11523, g_nmea.speed);
+    TEST_ASSERT_EQUAL_UINT16(8440, g_nmea.heading);
+    TEST_ASSERT_TRUE(g_nmea.date_valid);
+    TEST_ASSERT_EQUAL_UINT16(2026, g_nmea.year);
+    TEST_ASSERT_EQUAL_UINT8(9, g_nmea.month);
+    TEST_ASSERT_EQUAL_UINT8(17, g_nmea.day);
+    TEST_ASSERT_EQUAL_UINT8(8, g_nmea.hour);
+    TEST_ASSERT_EQUAL_UINT8(35, g_nmea.minute);
+    TEST_ASSERT_EQUAL_UINT8(59, g_nmea.second);
+    /** RMC leaves the GGA position alone */
+    TEST_ASSERT_EQUAL_INT32(0, g_nmea.lat);
+
+    /** Void, no speed, heading or date */
+    TEST_ASSERT_EQUAL_UINT8(NMEA_RMC, feed(withChecksum("GPRMC,083600.00,V,,,,,1.5,90.0,170926,,,N").c_str()));
+    TEST_ASSERT_EQUAL_UINT32(0, g_nmea.speed);
+    TEST_ASSERT_EQUAL_UINT16(0, g_nmea.heading);
+    TEST_ASSERT_FALSE(g_nmea.date_valid);
+    /** 360.0 deg is north */
+    feed(withChecksum("GPRMC,083601.00,A,4525.29180,N,07541.83140,W,1.0,360.00,170926,,,A").c_str());
+    TEST_ASSERT_EQUAL_UINT16(0, g_nmea.heading);
+}
+
+static void test_checksum(void)
+{
+    const char *good = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+    TEST_ASSERT_EQUAL_UINT8(NMEA_GGA, feed(good));
+
+    /** One digit changed, the old values stay */
+    TEST_ASSERT_EQUAL_UINT8(NMEA_NONE, feed("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,645.4,M,46.9,M,,*47\r\n"));
+    TEST_ASSERT_EQUAL_INT32(545, g_nmea.alt);
+    TEST_ASSERT_EQUAL_UINT32(1, g_nmea_bad_checksum);
+    /** Wrong checksum digits */
+    TEST_ASSERT_EQUAL_UINT8(NMEA_NONE, feed("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*48\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(2, g_nmea_bad_checksum);
+    /** Not hex */
+    TEST_ASSERT_EQUAL_UINT8(NMEA_NONE, feed("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*4G\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(3, g_nmea_bad_checksum);
+    /** No checksum at all is not trusted, and not counted as bad */
+    TEST_ASSERT_EQUAL_UINT8(NMEA_NONE, feed("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,745.4,M,46.9,M,,\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(3, g_nmea_bad_checksum);
+    TEST_ASSERT_EQUAL_INT32(545, g_nmea.alt);
+    TEST_ASSERT_EQUAL_UINT32(1, g_nmea_sentences);
+
+    /** Other sentences are checked but not taken over */
+    TEST_ASSERT_EQUAL_UINT8(NMEA_NONE, feed(withChecksum("GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00").c_str()));
+    TEST_ASSERT_EQUAL_UINT32(3, g_nmea_bad_checksum);
+    TEST_ASSERT_EQUAL_UINT32(1, g_nmea_sentences);
+}
+
+/** A '$' in the middle starts over, the cut sentence is lost */
+static void test_broken_sentence(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(NMEA_GGA, feed("$GPGGA,123519,4807.0$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"));
+    TEST_ASSERT_EQUAL_INT32(4811730, g_nmea.lat);
+    /** A field longer than the buffer is cut, not overrun */
+    std::string body = "GPGGA,123519," + std::string(40, '1') + ",N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,";
+    TEST_ASSERT_EQUAL_UINT8(NMEA_GGA, feed(withChecksum(body.c_str()).c_str()));
+    TEST_ASSERT_EQUAL_INT32(1151667, g_nmea.lon);
+}
+
+static void test_send(void)
+{
+    Serial1.txLen = 0;
+    nmea_send("PUBX,40,GSV,0,0,0,0,0,0");
+    TEST_ASSERT_EQUAL_STRING(withChecksum("PUBX,40,GSV,0,0,0,0,0,0").c_str(), std::string((const char *)Serial1.tx, Serial1.txLen).c_str());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_field_fixed);
+    RUN_TEST(test_field_degrees);
+    RUN_TEST(test_gga);
+    RUN_TEST(test_hemispheres);
+    RUN_TEST(test_rmc);
+    RUN_TEST(test_checksum);
+    RUN_TEST(test_broken_sentence);
+    RUN_TEST(test_send);
+    return UNITY_END();
+}
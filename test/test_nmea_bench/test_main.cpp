@@ -0,0 +1,321 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief nmea_encode() against TinyGPSPlus on a replayed NMEA corpus
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The corpus is generated, the same every run: a u-blox with all its
+ * default sentences on (RMC, VTG, GGA, GSA, 3x GSV), a cold start without
+ * a fix, a drive that crosses midnight and then the southern and eastern
+ * hemispheres, GN then GP talkers. About 1 in 200 sentences has a digit
+ * changed, about 1 in 300 is cut off before its checksum, like a UART
+ * overrun. Both decoders must take over the same sentences with the same
+ * values, then both are timed on the whole corpus.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <TinyGPS++.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../../src/nmea.cpp"
+
+/** Seconds of the drive, the first ones without a fix */
+#define BENCH_EPOCHS 3000
+#define BENCH_COLD_START 45
+/** Times the corpus is replayed for the timing */
+#define BENCH_ROUNDS 20
+
+enum bench_kind_e
+{
+    BENCH_OTHER,
+    BENCH_GGA,
+    BENCH_RMC
+};
+
+/** One sentence as sent, with what was put in it */
+struct bench_sentence_s
+{
+    std::string text;
+    uint8_t kind;
+    bool damaged;
+    uint32_t knots1000;
+};
+
+static std::vector<bench_sentence_s> corpus;
+static size_t corpusBytes = 0;
+
+void setUp(void)
+{
+    g_nmea = nmea_fix_s();
+    g_nmea_sentences = 0;
+    g_nmea_bad_checksum = 0;
+    step = NMEA_WAIT_START;
+}
+void tearDown(void) {}
+
+static uint32_t rngState = 20261017;
+static uint32_t rng(uint32_t range)
+{
+    rngState = rngState * 1664525 + 1013904223;
+    return (rngState >> 8) % range;
+}
+
+/** Body to a full sentence with its checksum */
+static std::string withChecksum(const std::string &body)
+{
+    uint8_t sum = 0;
+    for(char c : body)
+    {
+        sum ^= c;
+    }
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+    return "$" + body + tail;
+}
+
+/** 1e-5 deg to ddmm.mmmmm or dddmm.mmmmm and its hemisphere */
+static std::string degreesField(int32_t e5, bool lon, char pos, char neg)
+{
+    uint32_t minE5 = abs(e5) % 100000 * 60;
+    uint32_t deg = abs(e5) / 100000 % 1000;
+    char text[24];
+    snprintf(text, sizeof(text), lon ? "%03u%02u.%05u,%c" : "%02u%02u.%05u,%c", deg, minE5 / 100000 % 100, minE5 % 100000, e5 < 0 ? neg : pos);
+    return text;
+}
+
+static void add(const std::string &body, uint8_t kind, uint32_t knots1000 = 0)
+{
+    bench_sentence_s s = {withChecksum(body), kind, false, knots1000};
+    if(rng(200) == 0)
+    {
+        /** One digit changed, the checksum stays */
+        size_t at;
+        do
+        {
+            at = 1 + rng(s.text.size() - 6);
+        } while(s.text[at] < '0' || s.text[at] > '9');
+        s.text[at] = '0' + (s.text[at] - '0' + 1 + rng(9)) % 10;
+        s.damaged = true;
+    } else if(rng(300) == 0) {
+        /** Cut before the '*' */
+        s.text.resize(1 + rng(s.text.size() - 6));
+        s.damaged = true;
+    }
+    corpusBytes += s.text.size();
+    corpus.push_back(s);
+}
+
+static void makeCorpus(void)
+{
+    /** Ottawa, later Sydney */
+    int32_t lat = 4542153;
+    int32_t lon = -7569719;
+    int32_t altDm = 701;
+    uint32_t course = 8440;
+    /** 2026-09-17 23:50:00 UTC */
+    uint32_t seconds = 23 * 3600 + 50 * 60;
+    uint8_t day = 17;
+    for(uint32_t epoch = 0; epoch < BENCH_EPOCHS; epoch++)
+    {
+        const char *talker = epoch < BENCH_EPOCHS / 2 ? "GN" : "GP";
+        if(epoch == BENCH_EPOCHS * 2 / 3)
+        {
+            lat = -3385678;
+            lon = 15121500;
+            altDm = -35;
+        }
+        bool fix = epoch >= BENCH_COLD_START;
+        uint32_t knots1000 = rng(60000);
+        course = (course + 36000 + rng(1001) - 500) % 36000;
+        lat += (int32_t)rng(41) - 20;
+        lon += (int32_t)rng(41) - 20;
+        altDm = constrain(altDm + (int32_t)rng(21) - 10, -400, 2500);
+        uint8_t siv = fix ? 4 + rng(9) : 0;
+        uint16_t hdop = fix ? 60 + rng(300) : 9999;
+        if(seconds == 24 * 3600)
+        {
+            seconds = 0;
+            day++;
+        }
+        char time[16];
+        snprintf(time, sizeof(time), "%02u%02u%02u.00", seconds / 3600, seconds / 60 % 60, seconds % 60);
+        char date[8];
+        snprintf(date, sizeof(date), "%02u0926", day);
+        std::string position = degreesField(lat, false, 'N', 'S') + "," + degreesField(lon, true, 'E', 'W');
+        char body[160];
+
+        if(fix)
+        {
+            snprintf(body, sizeof(body), "%sRMC,%s,A,%s,%u.%03u,%u.%02u,%s,,,A", talker, time, position.c_str(), knots1000 / 1000, knots1000 % 1000, course / 100, course % 100, date);
+        } else {
+            snprintf(body, sizeof(body), "%sRMC,%s,V,,,,,,,%s,,,N", talker, epoch < 3 ? "" : time, epoch < 3 ? "" : date);
+        }
+        add(body, BENCH_RMC, knots1000);
+
+        if(fix)
+        {
+            snprintf(body, sizeof(body), "%sVTG,%u.%02u,T,,M,%u.%03u,N,%u.%03u,K,A", talker, course / 100, course % 100, knots1000 / 1000, knots1000 % 1000, knots1000 * 1852 / 1000000, knots1000 * 1852 / 1000 % 1000);
+        } else {
+            snprintf(body, sizeof(body), "%sVTG,,,,,,,,,N", talker);
+        }
+        add(body, BENCH_OTHER);
+
+        if(fix)
+        {
+            snprintf(body, sizeof(body), "%sGGA,%s,%s,1,%02u,%u.%02u,%s%u.%u,M,-34.0,M,,", talker, time, position.c_str(), siv, hdop / 100, hdop % 100, altDm < 0 ? "-" : "", abs(altDm) / 10, abs(altDm) % 10);
+        } else {
+            snprintf(body, sizeof(body), "%sGGA,%s,,,,,0,00,99.99,,,,,,", talker, epoch < 3 ? "" : time);
+        }
+        add(body, BENCH_GGA);
+
+        snprintf(body, sizeof(body), "%sGSA,A,%u,02,05,13,15,18,20,29,,,,,,2.51,%u.%02u,2.21", talker, fix ? 3 : 1, hdop / 100, hdop % 100);
+        add(body, BENCH_OTHER);
+
+        uint8_t inView = 11;
+        for(uint8_t msg = 1; msg <= 3; msg++)
+        {
+            std::string gsv;
+            char part[24];
+            snprintf(part, sizeof(part), "%sGSV,3,%u,%02u", talker, msg, inView);
+            gsv = part;
+            for(uint8_t sat = (msg - 1) * 4; sat < min(msg * 4, inView); sat++)
+            {
+                snprintf(part, sizeof(part), ",%02u,%02u,%03u,%02u", 2 + sat * 3, rng(90), rng(360), fix ? 20 + rng(25) : 0);
+                gsv += part;
+            }
+            add(gsv, BENCH_OTHER);
+        }
+        seconds++;
+    }
+}
+
+/** Feed one sentence, true when it was taken over */
+static bool feedOurs(const std::string &text)
+{
+    bool taken = false;
+    for(char c : text)
+    {
+        taken |= nmea_encode(c) != NMEA_NONE;
+    }
+    return taken;
+}
+
+static bool feedTiny(TinyGPSPlus &gps, const std::string &text)
+{
+    bool taken = false;
+    for(char c : text)
+    {
+        taken |= gps.encode(c);
+    }
+    return taken;
+}
+
+/** TinyGPSPlus degrees to 1e-5 deg */
+static int32_t tinyE5(const RawDegrees &raw)
+{
+    int32_t e5 = raw.deg * 100000 + (raw.billionths + 5000) / 10000;
+    return raw.negative ? -e5 : e5;
+}
+
+/** Both decoders agree on every sentence of the corpus */
+static void test_same_as_tinygps(void)
+{
+    TinyGPSPlus gps;
+    uint32_t taken = 0;
+    uint32_t damaged = 0;
+    uint32_t fixes = 0;
+    char msg[64];
+    for(size_t i = 0; i < corpus.size(); i++)
+    {
+        const bench_sentence_s &s = corpus[i];
+        snprintf(msg, sizeof(msg), "sentence %u: %.40s", (unsigned)i, s.text.c_str());
+        bool ours = feedOurs(s.text);
+        bool tiny = feedTiny(gps, s.text);
+        TEST_ASSERT_EQUAL_MESSAGE(tiny, ours, msg);
+        TEST_ASSERT_EQUAL_MESSAGE(s.kind != BENCH_OTHER && !s.damaged, ours, msg);
+        damaged += s.damaged;
+        if(!ours)
+        {
+            continue;
+        }
+        taken++;
+        if(s.kind == BENCH_GGA)
+        {
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(gps.satellites.value(), g_nmea.siv, msg);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(gps.hdop.value(), g_nmea.hdop, msg);
+            TEST_ASSERT_EQUAL_MESSAGE(gps.location.isUpdated(), g_nmea.pos_valid, msg);
+            if(g_nmea.pos_valid)
+            {
+                fixes++;
+                TEST_ASSERT_INT32_WITHIN_MESSAGE(1, tinyE5(gps.location.rawLat()), g_nmea.lat, msg);
+                TEST_ASSERT_INT32_WITHIN_MESSAGE(1, tinyE5(gps.location.rawLng()), g_nmea.lon, msg);
+                TEST_ASSERT_EQUAL_INT32_MESSAGE(gps.altitude.value() / 100, g_nmea.alt, msg);
+            }
+        } else if(g_nmea.date_valid) {
+            /** 3 decimals of knots here, TinyGPSPlus keeps 2 */
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE((uint64_t)s.knots1000 * 514444 / 1000000, g_nmea.speed, msg);
+            TEST_ASSERT_UINT32_WITHIN_MESSAGE(6, (uint64_t)gps.speed.value() * 10 * 514444 / 1000000, g_nmea.speed, msg);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(gps.course.value(), g_nmea.heading, msg);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(gps.date.year(), g_nmea.year, msg);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(gps.date.month(), g_nmea.month, msg);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(gps.date.day(), g_nmea.day, msg);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(gps.time.hour(), g_nmea.hour, msg);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(gps.time.minute(), g_nmea.minute, msg);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(gps.time.second(), g_nmea.second, msg);
+        } else {
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, g_nmea.speed, msg);
+        }
+        /** Clear isUpdated() for the next GGA */
+        gps.location.rawLat();
+    }
+    TEST_ASSERT_EQUAL_UINT32(gps.failedChecksum(), g_nmea_bad_checksum);
+    TEST_ASSERT_EQUAL_UINT32(taken, g_nmea_sentences);
+    TEST_ASSERT_GREATER_THAN(BENCH_EPOCHS * 7 / 300, damaged);
+    TEST_ASSERT_GREATER_THAN((BENCH_EPOCHS - BENCH_COLD_START) * 9 / 10, fixes);
+    printf("%u sentences, %u bytes, %u damaged, %u taken over, %u bad checksums\n", (unsigned)corpus.size(), (unsigned)corpusBytes, damaged, taken, g_nmea_bad_checksum);
+}
+
+/** ns per received byte, the whole corpus BENCH_ROUNDS times */
+static void test_speed(void)
+{
+    volatile uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(uint8_t round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(const bench_sentence_s &s : corpus)
+        {
+            sink += feedOurs(s.text);
+        }
+    }
+    double oursNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    TinyGPSPlus gps;
+    start = std::chrono::steady_clock::now();
+    for(uint8_t round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(const bench_sentence_s &s : corpus)
+        {
+            sink += feedTiny(gps, s.text);
+        }
+    }
+    double tinyNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    double bytes = (double)corpusBytes * BENCH_ROUNDS;
+    printf("nmea_encode %.2f ns/byte, TinyGPSPlus %.2f ns/byte (%.2fx)\n", oursNs / bytes, tinyNs / bytes, tinyNs / oursNs);
+    TEST_ASSERT_NOT_EQUAL(0, sink);
+}
+
+int main(int argc, char **argv)
+{
+    makeCorpus();
+    UNITY_BEGIN();
+    RUN_TEST(test_same_as_tinygps);
+    RUN_TEST(test_speed);
+    return UNITY_END();
+}
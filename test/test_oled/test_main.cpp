@@ -0,0 +1,267 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief oled_flush() on pairs of frames, the areas sent and what the panel shows
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The U8G2 stand-in copies every area sent to its panel, after a flush
+ * the panel must show the frame. The bus is stubbed, the test decides
+ * when the OLED gets it and when it loses it between two tile rows.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <set>
+#include <utility>
+#include "../../src/oled.cpp"
+
+/** Frame pairs of the random test */
+#define RANDOM_FRAMES 500
+
+/** 16x8 tiles of 8 bytes */
+#define TILES_X 16
+#define TILES_Y 8
+/** A full frame, every tile row with its area overhead */
+#define FULL_FRAME_BYTES (TILES_Y * (TILES_X * OLED_TILE_BYTES + OLED_AREA_OVERHEAD))
+
+static U8G2 display;
+
+/** Bus stubs, i2c_yield() fails before tile row yieldFailRow */
+static bool acquireOk = true;
+static int16_t yieldFailRow = -1;
+static uint8_t yields = 0;
+bool i2c_acquire(uint8_t dev)
+{
+    yields = 0;
+    return acquireOk;
+}
+void i2c_release(uint8_t dev) {}
+bool i2c_yield(uint8_t dev)
+{
+    yields++;
+    return yields != yieldFailRow;
+}
+
+static uint32_t seed = 20261017;
+/** xorshift32 */
+static uint32_t nextRandom(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+/** Set one pixel of a tile, tiles are 8 columns of 8 pixel bytes */
+static void setPixel(uint8_t tx, uint8_t ty, uint8_t col, uint8_t bit)
+{
+    display.buffer[(ty * TILES_X + tx) * OLED_TILE_BYTES + col] ^= 1 << bit;
+}
+
+/** Tiles of the frame that differ from the panel */
+static std::set<std::pair<uint8_t, uint8_t>> changedTiles(void)
+{
+    std::set<std::pair<uint8_t, uint8_t>> tiles;
+    for(uint8_t ty = 0; ty < TILES_Y; ty++)
+    {
+        for(uint8_t tx = 0; tx < TILES_X; tx++)
+        {
+            uint16_t offset = (ty * TILES_X + tx) * OLED_TILE_BYTES;
+            if(memcmp(&display.buffer[offset], &display.panel[offset], OLED_TILE_BYTES) != 0)
+            {
+                tiles.insert({tx, ty});
+            }
+        }
+    }
+    return tiles;
+}
+
+/**
+ * @brief Flush and check the areas against the tiles that changed
+ * Every changed tile is sent once, nothing else, runs are never next to each other
+ *
+ */
+static uint16_t flushChecked(void)
+{
+    std::set<std::pair<uint8_t, uint8_t>> changed = changedTiles();
+    display.areas.clear();
+    uint16_t sent = oled_flush(display);
+
+    std::set<std::pair<uint8_t, uint8_t>> areaTiles;
+    uint16_t bytes = 0;
+    for(size_t i = 0; i < display.areas.size(); i++)
+    {
+        const u8g2_area_s &area = display.areas[i];
+        TEST_ASSERT_EQUAL_UINT8(1, area.h);
+        TEST_ASSERT_TRUE(area.x + area.w <= TILES_X);
+        for(uint8_t tx = area.x; tx < area.x + area.w; tx++)
+        {
+            TEST_ASSERT_TRUE(areaTiles.insert({tx, area.y}).second);
+        }
+        bytes += area.w * OLED_TILE_BYTES + OLED_AREA_OVERHEAD;
+        if(i > 0 && display.areas[i - 1].y == area.y)
+        {
+            /** Two runs in a row have an unchanged tile between them */
+            TEST_ASSERT_TRUE(display.areas[i - 1].x + display.areas[i - 1].w < area.x);
+        }
+    }
+    TEST_ASSERT_TRUE(areaTiles == changed);
+    TEST_ASSERT_EQUAL_UINT16(bytes, sent);
+    TEST_ASSERT_EQUAL_UINT16(sent, g_oled_bytes_last);
+    TEST_ASSERT_EQUAL_MEMORY(display.buffer, display.panel, sizeof(display.panel));
+    return sent;
+}
+
+void setUp(void)
+{
+    memset(display.buffer, 0, sizeof(display.buffer));
+    memset(display.panel, 0xA5, sizeof(display.panel));
+    display.areas.clear();
+    acquireOk = true;
+    yieldFailRow = -1;
+    g_oled_bytes_last = 0;
+    g_oled_bytes_total = 0;
+    g_oled_bytes_full = 0;
+    oled_invalidate();
+    /** The first frame after a reset goes out whole */
+    TEST_ASSERT_EQUAL_UINT16(FULL_FRAME_BYTES, oled_flush(display));
+    TEST_ASSERT_EQUAL_UINT32(TILES_Y, display.areas.size());
+    TEST_ASSERT_EQUAL_MEMORY(display.buffer, display.panel, sizeof(display.panel));
+}
+void tearDown(void) {}
+
+/** Hand made pairs, the areas and bytes of each */
+static void test_frame_pairs(void)
+{
+    /** Same frame, nothing sent */
+    TEST_ASSERT_EQUAL_UINT16(0, flushChecked());
+    TEST_ASSERT_EQUAL_UINT32(0, display.areas.size());
+
+    /** One pixel, one tile */
+    setPixel(3, 2, 5, 1);
+    TEST_ASSERT_EQUAL_UINT16(OLED_TILE_BYTES + OLED_AREA_OVERHEAD, flushChecked());
+    TEST_ASSERT_EQUAL_UINT8(3, display.areas[0].x);
+    TEST_ASSERT_EQUAL_UINT8(2, display.areas[0].y);
+    TEST_ASSERT_EQUAL_UINT8(1, display.areas[0].w);
+
+    /** A run of three tiles and the last tile of the last row */
+    setPixel(4, 0, 0, 0);
+    setPixel(5, 0, 7, 7);
+    setPixel(6, 0, 3, 2);
+    setPixel(15, 7, 1, 1);
+    TEST_ASSERT_EQUAL_UINT16(4 * OLED_TILE_BYTES + 2 * OLED_AREA_OVERHEAD, flushChecked());
+    TEST_ASSERT_EQUAL_UINT32(2, display.areas.size());
+    TEST_ASSERT_EQUAL_UINT8(4, display.areas[0].x);
+    TEST_ASSERT_EQUAL_UINT8(3, display.areas[0].w);
+    TEST_ASSERT_EQUAL_UINT8(15, display.areas[1].x);
+    TEST_ASSERT_EQUAL_UINT8(7, display.areas[1].y);
+
+    /** Two runs in one row, the status bar and the battery */
+    setPixel(0, 0, 0, 0);
+    setPixel(1, 0, 0, 0);
+    setPixel(14, 0, 0, 0);
+    setPixel(15, 0, 0, 0);
+    TEST_ASSERT_EQUAL_UINT16(4 * OLED_TILE_BYTES + 2 * OLED_AREA_OVERHEAD, flushChecked());
+    TEST_ASSERT_EQUAL_UINT32(2, display.areas.size());
+
+    /** A whole row changes, one area per row like a full frame */
+    for(uint8_t tx = 0; tx < TILES_X; tx++)
+    {
+        setPixel(tx, 4, 2, 2);
+    }
+    TEST_ASSERT_EQUAL_UINT16(TILES_X * OLED_TILE_BYTES + OLED_AREA_OVERHEAD, flushChecked());
+
+    /** Changed and back before the flush, nothing to send */
+    setPixel(9, 6, 1, 1);
+    setPixel(9, 6, 1, 1);
+    TEST_ASSERT_EQUAL_UINT16(0, flushChecked());
+
+    /** A full push would have sent every frame whole */
+    TEST_ASSERT_EQUAL_UINT32(7 * FULL_FRAME_BYTES, g_oled_bytes_full);
+    TEST_ASSERT_EQUAL_UINT32(FULL_FRAME_BYTES + 13 + 2 * 42 + 133, g_oled_bytes_total);
+}
+
+/** Random frame pairs, a few pixels to half of the frame */
+static void test_random_pairs(void)
+{
+    uint32_t bytes = 0;
+    for(uint16_t i = 0; i < RANDOM_FRAMES; i++)
+    {
+        uint16_t pixels = 1 << (nextRandom() % 10);
+        for(uint16_t p = 0; p < pixels; p++)
+        {
+            uint32_t r = nextRandom();
+            setPixel(r % TILES_X, (r >> 4) % TILES_Y, (r >> 8) % 8, (r >> 12) % 8);
+        }
+        bytes += flushChecked();
+    }
+    printf("%u random frames: %lu bytes sent, %lu for full frames (%lu%%)\n", RANDOM_FRAMES, (unsigned long)bytes,
+           (unsigned long)(RANDOM_FRAMES * FULL_FRAME_BYTES), (unsigned long)(bytes * 100 / (RANDOM_FRAMES * FULL_FRAME_BYTES)));
+    TEST_ASSERT_TRUE(bytes < RANDOM_FRAMES * FULL_FRAME_BYTES);
+}
+
+/** After a reset the whole frame goes again, even if it didn't change */
+static void test_invalidate(void)
+{
+    setPixel(1, 1, 1, 1);
+    oled_invalidate();
+    display.areas.clear();
+    TEST_ASSERT_EQUAL_UINT16(FULL_FRAME_BYTES, oled_flush(display));
+    TEST_ASSERT_EQUAL_UINT32(TILES_Y, display.areas.size());
+    TEST_ASSERT_EQUAL_UINT16(0, flushChecked());
+}
+
+/** No bus, nothing sent, the tiles are still changed next time */
+static void test_bus_busy(void)
+{
+    setPixel(2, 3, 4, 5);
+    acquireOk = false;
+    display.areas.clear();
+    TEST_ASSERT_EQUAL_UINT16(0, oled_flush(display));
+    TEST_ASSERT_EQUAL_UINT32(0, display.areas.size());
+    acquireOk = true;
+    TEST_ASSERT_EQUAL_UINT16(OLED_TILE_BYTES + OLED_AREA_OVERHEAD, flushChecked());
+}
+
+/** Bus lost between two tile rows, the rows after it go with the next flush */
+static void test_preempted(void)
+{
+    for(uint8_t ty = 0; ty < TILES_Y; ty++)
+    {
+        setPixel(ty, ty, 0, 0);
+    }
+    /** Fails before row 5 */
+    yieldFailRow = 5;
+    display.areas.clear();
+    TEST_ASSERT_EQUAL_UINT16(5 * (OLED_TILE_BYTES + OLED_AREA_OVERHEAD), oled_flush(display));
+    TEST_ASSERT_EQUAL_UINT32(5, display.areas.size());
+    TEST_ASSERT_EQUAL_UINT8(4, display.areas.back().y);
+    yieldFailRow = -1;
+    TEST_ASSERT_EQUAL_UINT16(3 * (OLED_TILE_BYTES + OLED_AREA_OVERHEAD), flushChecked());
+    TEST_ASSERT_EQUAL_UINT8(5, display.areas[0].y);
+
+    /** A full frame cut the same way is sent whole again */
+    oled_invalidate();
+    yieldFailRow = 3;
+    display.areas.clear();
+    TEST_ASSERT_EQUAL_UINT16(3 * (TILES_X * OLED_TILE_BYTES + OLED_AREA_OVERHEAD), oled_flush(display));
+    yieldFailRow = -1;
+    display.areas.clear();
+    TEST_ASSERT_EQUAL_UINT16(FULL_FRAME_BYTES, oled_flush(display));
+    TEST_ASSERT_EQUAL_UINT16(0, flushChecked());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_pairs);
+    RUN_TEST(test_random_pairs);
+    RUN_TEST(test_invalidate);
+    RUN_TEST(test_bus_busy);
+    RUN_TEST(test_preempted);
+    return UNITY_END();
+}
@@ -0,0 +1,276 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Session log batches, and the log held still under an export
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * The log is decoded here like tools/session_log_decode.py does, only
+ * the fields the tests look at are kept.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <vector>
+#include "../../src/crc.cpp"
+#include "../../src/airtime.cpp"
+#include "../../src/session_log.cpp"
+
+void setUp(void)
+{
+    session_log_read_done();
+    InternalFS.format();
+    resetBatch();
+    hasPending = false;
+}
+void tearDown(void) {}
+
+struct decoded_s
+{
+    uint32_t time;
+    bool uptime;
+    int16_t rssi;
+    uint8_t batch;
+};
+
+static uint32_t getVarint(const std::vector<uint8_t> &data, size_t &pos)
+{
+    uint32_t value = 0;
+    for(uint8_t shift = 0; pos < data.size(); shift += 7)
+    {
+        uint8_t byte = data[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80))
+        {
+            break;
+        }
+    }
+    return value;
+}
+
+/** Old file then current file, every batch checked */
+static std::vector<decoded_s> decodeLog(void)
+{
+    std::vector<uint8_t> data;
+    for(const char *name : logFiles)
+    {
+        if(InternalFS.exists(name))
+        {
+            data.insert(data.end(), InternalFS.files[name]->begin(), InternalFS.files[name]->end());
+        }
+    }
+    std::vector<decoded_s> records;
+    uint8_t batchNum = 0;
+    for(size_t pos = 0; pos < data.size(); batchNum++)
+    {
+        TEST_ASSERT_EQUAL_HEX8(SESSION_LOG_SYNC, data[pos]);
+        uint16_t len = data[pos + 1] | data[pos + 2] << 8;
+        uint16_t crc = data[pos + 3] | data[pos + 4] << 8;
+        pos += SESSION_LOG_HEADER;
+        TEST_ASSERT_EQUAL_HEX16(crc, crc16_ccitt(&data[pos], len));
+        size_t end = pos + len;
+        uint32_t time = 0;
+        while(pos < end)
+        {
+            decoded_s rec;
+            uint8_t flags = data[pos++];
+            time += getVarint(data, pos);
+            rec.time = time;
+            rec.uptime = flags & SLOG_UPTIME;
+            rec.rssi = 0;
+            rec.batch = batchNum;
+            pos++;
+            if(flags & SLOG_POS)
+            {
+                getVarint(data, pos);
+                getVarint(data, pos);
+                getVarint(data, pos);
+                pos++;
+            }
+            if(flags & SLOG_HOTSPOT)
+            {
+                rec.rssi = -data[pos];
+                pos += 5;
+                pos += (flags & SLOG_NAME_NEW) ? 1 + data[pos] : 1;
+            }
+            if(flags & SLOG_BATT)
+            {
+                getVarint(data, pos);
+            }
+            records.push_back(rec);
+        }
+        TEST_ASSERT_EQUAL(end, pos);
+    }
+    return records;
+}
+
+/** One beacon with its downlink, UTC time if epoch is set */
+static void beacon(uint32_t epoch, int16_t rssi = -100)
+{
+    gnss_fix_s fix;
+    fix.valid = epoch != 0;
+    fix.epoch = epoch;
+    fix.lat = 4542153;
+    fix.lon = -7569719;
+    session_log_beacon(fix);
+    downlink_hotspot_s hs;
+    strcpy(hs.name, "bumpy-red-fox");
+    hs.rssi = -110;
+    g_last_rssi = rssi;
+    session_log_hotspot(hs);
+}
+
+static void test_batch_round_trip(void)
+{
+    for(uint8_t i = 0; i < SESSION_LOG_BATCH_RECORDS + 3; i++)
+    {
+        beacon(1700000000 + i * 30);
+    }
+    session_log_flush();
+    std::vector<decoded_s> records = decodeLog();
+    TEST_ASSERT_EQUAL(SESSION_LOG_BATCH_RECORDS + 3, records.size());
+    TEST_ASSERT_EQUAL_UINT32(1700000000, records[0].time);
+    TEST_ASSERT_EQUAL_UINT32(1700000000 + (SESSION_LOG_BATCH_RECORDS + 2) * 30, records.back().time);
+    TEST_ASSERT_EQUAL(1, records.back().batch);
+    TEST_ASSERT_EQUAL_INT16(-100, records[0].rssi);
+}
+
+/** A positive RSSI is stored as 0, not wrapped */
+static void test_rssi_clamped(void)
+{
+    beacon(1700000000, 5);
+    beacon(1700000030, -300);
+    session_log_flush();
+    std::vector<decoded_s> records = decodeLog();
+    TEST_ASSERT_EQUAL_INT16(0, records[0].rssi);
+    TEST_ASSERT_EQUAL_INT16(-255, records[1].rssi);
+}
+
+/** Nothing is written while a reader has the files pinned */
+static void test_export_pins_files(void)
+{
+    /** Current file close to its rotation */
+    for(uint32_t time = 1600000000; InternalFS.files.count(logFiles[1]) == 0 || InternalFS.files[logFiles[1]]->size() < SESSION_LOG_FILE_MAX - 200; time += 30)
+    {
+        beacon(time);
+    }
+    session_log_flush();
+    std::vector<uint8_t> before = *InternalFS.files[logFiles[1]];
+    uint32_t id = session_log_id();
+    uint32_t size = session_log_read_start();
+    TEST_ASSERT_EQUAL_UINT32(before.size(), size);
+
+    uint8_t buf[64];
+    TEST_ASSERT_EQUAL_UINT16(sizeof(buf), session_log_read(0, buf, sizeof(buf)));
+    /** A full batch is due, it is held */
+    for(uint8_t i = 0; i < SESSION_LOG_BATCH_RECORDS; i++)
+    {
+        beacon(1700001000 + i);
+    }
+    TEST_ASSERT_TRUE(session_log_reading());
+    TEST_ASSERT_NOT_EQUAL(0, heldLen);
+    TEST_ASSERT_FALSE(InternalFS.exists(logFiles[0]));
+    TEST_ASSERT_TRUE(before == *InternalFS.files[logFiles[1]]);
+    TEST_ASSERT_EQUAL_UINT32(id, session_log_id());
+    TEST_ASSERT_EQUAL_UINT16(sizeof(buf), session_log_read(size - sizeof(buf), buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_MEMORY(&before[size - sizeof(buf)], buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_UINT16(0, session_log_read(size, buf, sizeof(buf)));
+
+    /** Export done, the held batch goes out and rotates the log */
+    session_log_read_done();
+    TEST_ASSERT_EQUAL(0, heldLen);
+    TEST_ASSERT_TRUE(InternalFS.exists(logFiles[0]));
+    std::vector<decoded_s> records = decodeLog();
+    TEST_ASSERT_EQUAL_UINT32(1700001000 + SESSION_LOG_BATCH_RECORDS - 1, records.back().time);
+    /** The old file keeps its offsets, a resume is still good */
+    TEST_ASSERT_EQUAL_UINT32(id, session_log_id());
+
+    /** Until it is dropped by the next rotation */
+    for(uint32_t time = 1800000000; InternalFS.files[logFiles[1]]->size() < SESSION_LOG_FILE_MAX - 200; time += 30)
+    {
+        beacon(time);
+    }
+    TEST_ASSERT_EQUAL_UINT32(id, session_log_id());
+    for(uint8_t i = 0; i < SESSION_LOG_BATCH_RECORDS; i++)
+    {
+        beacon(1900000000 + i);
+    }
+    TEST_ASSERT_NOT_EQUAL(id, session_log_id());
+}
+
+/** A change of time base under an export starts a new batch, it doesn't mix */
+static void test_time_base_during_export(void)
+{
+    beacon(0);
+    beacon(0);
+    session_log_flush();
+    session_log_read_start();
+    beacon(0);
+    beacon(0);
+    /** GNSS time arrives */
+    beacon(1700000000);
+    beacon(1700000030);
+    session_log_read_done();
+    session_log_flush();
+    std::vector<decoded_s> records = decodeLog();
+    TEST_ASSERT_EQUAL(6, records.size());
+    for(const decoded_s &rec : records)
+    {
+        for(const decoded_s &other : records)
+        {
+            if(rec.batch == other.batch)
+            {
+                TEST_ASSERT_EQUAL(rec.uptime, other.uptime);
+            }
+        }
+    }
+    TEST_ASSERT_FALSE(records[5].uptime);
+    TEST_ASSERT_EQUAL_UINT32(1700000030, records[5].time);
+}
+
+/** A second batch while one is held cuts the export, both are written in order */
+static void test_export_cut_off(void)
+{
+    beacon(1700000000);
+    session_log_flush();
+    uint32_t size = session_log_read_start();
+    for(uint8_t i = 0; i < 2 * SESSION_LOG_BATCH_RECORDS; i++)
+    {
+        beacon(1700000100 + i);
+    }
+    TEST_ASSERT_FALSE(session_log_reading());
+    uint8_t buf[16];
+    TEST_ASSERT_EQUAL_UINT16(0, session_log_read(0, buf, sizeof(buf)));
+    TEST_ASSERT_GREATER_THAN(size, session_log_size());
+    std::vector<decoded_s> records = decodeLog();
+    TEST_ASSERT_EQUAL(1 + 2 * SESSION_LOG_BATCH_RECORDS, records.size());
+    for(size_t i = 1; i < records.size(); i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(1700000100 + i - 1, records[i].time);
+    }
+}
+
+/** Time deltas are uint32 differences, a clock going back wraps */
+static void test_time_wraps(void)
+{
+    beacon(1700000000);
+    beacon(1600000000);
+    session_log_flush();
+    std::vector<decoded_s> records = decodeLog();
+    TEST_ASSERT_EQUAL_UINT32(1600000000, records[1].time);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_round_trip);
+    RUN_TEST(test_rssi_clamped);
+    RUN_TEST(test_export_pins_files);
+    RUN_TEST(test_time_base_during_export);
+    RUN_TEST(test_export_cut_off);
+    RUN_TEST(test_time_wraps);
+    return UNITY_END();
+}
@@ -0,0 +1,313 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief TextBuf formatting, and against the iostream/to_string display text it replaced
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * streamLines() builds the downlink lines of parseDownlink() the way it
+ * did before TextBuf, with std::to_string and std::ostringstream. Both
+ * must give the same text, then both are timed and their heap use is
+ * counted through operator new. The flash side can't be seen here,
+ * the host links libstdc++ as a shared library.
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <unity.h>
+#include <host.h>
+#include <app.h>
+#include <chrono>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string>
+
+/** Line pairs built for the timing */
+#define BENCH_LINES 100000
+
+/** Heap use while counting */
+static bool countHeap = false;
+static uint32_t heapAllocs = 0;
+static size_t heapBytes = 0;
+
+void *operator new(size_t size)
+{
+    if(countHeap)
+    {
+        heapAllocs++;
+        heapBytes += size;
+    }
+    void *p = malloc(size != 0 ? size : 1);
+    if(p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t size) noexcept { free(p); }
+
+/** What parseDownlink() shows for a hot spot */
+struct shown_s
+{
+    int32_t rxCount;
+    const char *name;
+    uint8_t hotspots;
+    uint32_t distM;
+    int16_t lastRssi;
+    int8_t lastSnr;
+    int16_t rssi;
+    int16_t snrX10;
+    int8_t sf;
+};
+
+static const shown_s shown[] = {
+    {7, "bumpy-red-fox", 3, 1240, -97, 6, -112, 45, 7},
+    {12, "a", 1, 80, -120, -12, -97, -73, 12},
+    {999, "south-west", 2, 25600, -61, 9, -130, -5, 9},
+    {30, "striped-crimson-alligator", 14, 350000, -100, 0, -101, 0, 10},
+};
+
+/** The display lines before TextBuf */
+static void streamLines(const shown_s &s, std::string &displayName, std::string &signalInfo)
+{
+    std::string hsNameS = s.name;
+    std::ostringstream snrss;
+    snrss << std::fixed << std::setprecision(1) << (s.snrX10 / 10.0);
+    std::string rxrssi = std::to_string(s.lastRssi);
+    std::string rxsnr = std::to_string(s.lastSnr);
+    std::string distS = "";
+    if(s.distM <= 100)
+    {
+        distS = "<0.1";
+    } else {
+        std::ostringstream dss;
+        dss << std::fixed << std::setprecision(1) << ((s.distM + 50) / 100) / 10.0;
+        distS = dss.str();
+    }
+    std::string hsCountS = "";
+    if(s.hotspots > 1)
+    {
+        hsCountS = " +" + std::to_string(s.hotspots - 1);
+    }
+    std::string lenCheck = std::to_string(s.rxCount) + "." + hsNameS + hsCountS + " " + distS + "km";
+    int16_t nameLen = lenCheck.length();
+    if(nameLen > 32)
+    {
+        int16_t pos = hsNameS.find("-");
+        hsNameS.erase(pos + 1, nameLen - 32);
+    }
+    displayName = std::to_string(s.rxCount) + "." + hsNameS + hsCountS + " " + distS + "km";
+    signalInfo = "RSSI:" + rxrssi + "/" + std::to_string(s.rssi) + " SNR:" + rxsnr + "/" + snrss.str() + " SF:" + std::to_string(s.sf);
+}
+
+/** The display lines as parseDownlink() builds them */
+static void textLines(const shown_s &s, TextBuf<40> &displayName, TextBuf<48> &signalInfo)
+{
+    TextBuf<sizeof(downlink_hotspot_s::name)> hsName;
+    hsName.add(s.name);
+    TextBuf<12> distS;
+    if(s.distM <= 100)
+    {
+        distS.add("<0.1");
+    } else {
+        distS.addFixed((s.distM + 50) / 100, 1);
+    }
+    TextBuf<8> hsCount;
+    if(s.hotspots > 1)
+    {
+        hsCount.add(" +").addInt(s.hotspots - 1);
+    }
+    TextBuf<12> rxCountS;
+    rxCountS.addCompact(s.rxCount).add('.');
+    int16_t nameLen = rxCountS.length() + hsName.length() + hsCount.length() + 1 + distS.length() + 2;
+    if(nameLen > 32)
+    {
+        const char *dash = strchr(hsName.c_str(), '-');
+        int16_t pos = dash != nullptr ? dash - hsName.c_str() : -1;
+        hsName.erase(pos + 1, nameLen - 32);
+    }
+    displayName.clear();
+    displayName.add(rxCountS.c_str()).add(hsName.c_str()).add(hsCount.c_str()).add(' ').add(distS.c_str()).add("km");
+    signalInfo.clear();
+    signalInfo.add("RSSI:").addInt(s.lastRssi).add('/').addInt(s.rssi)
+              .add(" SNR:").addInt(s.lastSnr).add('/').addFixed(s.snrX10, 1)
+              .add(" SF:").addInt(s.sf);
+}
+
+/** Compact text back to the smallest count it stands for */
+static uint64_t compactLow(const char *text)
+{
+    double value = atof(text);
+    switch(text[strlen(text) - 1])
+    {
+        case 'k':
+            return (uint64_t)llround(value * 1e3);
+        case 'M':
+            return (uint64_t)llround(value * 1e6);
+        case 'G':
+            return (uint64_t)llround(value * 1e9);
+        default:
+            return (uint64_t)value;
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/** Text is cut at N-1 characters and always terminated */
+static void test_add(void)
+{
+    TextBuf<8> text;
+    TEST_ASSERT_EQUAL_STRING("", text.c_str());
+    text.add("abc").add('d');
+    TEST_ASSERT_EQUAL_STRING("abcd", text.c_str());
+    text.add("efghij");
+    TEST_ASSERT_EQUAL_STRING("abcdefg", text.c_str());
+    TEST_ASSERT_EQUAL_UINT32(7, text.length());
+    text.add('h').addInt(1);
+    TEST_ASSERT_EQUAL_STRING("abcdefg", text.c_str());
+    text.clear();
+    text.addInt(-12345678);
+    TEST_ASSERT_EQUAL_STRING("-123456", text.c_str());
+}
+
+static void test_fixed(void)
+{
+    static const struct
+    {
+        int32_t value;
+        uint8_t decimals;
+        const char *text;
+    } cases[] = {
+        {0, 0, "0"}, {0, 1, "0.0"}, {-55, 1, "-5.5"}, {55, 1, "5.5"}, {-5, 1, "-0.5"}, {5, 2, "0.05"}, {-5, 3, "-0.005"},
+        {1240, 1, "124.0"}, {INT32_MAX, 0, "2147483647"}, {INT32_MIN, 0, "-2147483648"}, {INT32_MIN, 1, "-214748364.8"},
+        {INT32_MIN, 9, "-2.147483648"}, {INT32_MIN, 10, "-0.2147483648"}, {1, 10, "0.0000000001"},
+    };
+    for(const auto &c : cases)
+    {
+        TextBuf<16> text;
+        text.addFixed(c.value, c.decimals);
+        TEST_ASSERT_EQUAL_STRING(c.text, text.c_str());
+    }
+    TextBuf<16> text;
+    text.addInt(INT32_MIN);
+    TEST_ASSERT_EQUAL_STRING("-2147483648", text.c_str());
+}
+
+/** The steps from 999 to G, and never more than 4 characters */
+static void test_compact(void)
+{
+    static const struct
+    {
+        uint32_t value;
+        const char *text;
+    } cases[] = {
+        {0, "0"}, {999, "999"}, {1000, "1.0k"}, {1099, "1.0k"}, {1999, "1.9k"}, {9999, "9.9k"}, {10000, "10k"},
+        {999999, "999k"}, {1000000, "1.0M"}, {9999999, "9.9M"}, {10000000, "10M"}, {999999999, "999M"},
+        {1000000000, "1.0G"}, {UINT32_MAX, "4.2G"},
+    };
+    for(const auto &c : cases)
+    {
+        TextBuf<8> text;
+        text.addCompact(c.value);
+        TEST_ASSERT_EQUAL_STRING(c.text, text.c_str());
+    }
+
+    /** Cut, never rounded up, and within 10% */
+    for(uint64_t value = 1; value <= UINT32_MAX; value = value * 11 / 10 + 1)
+    {
+        TextBuf<8> text;
+        text.addCompact((uint32_t)value);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(4, text.length());
+        uint64_t low = compactLow(text.c_str());
+        TEST_ASSERT_TRUE(low <= value);
+        TEST_ASSERT_TRUE(value - low < value / 10 + 1);
+    }
+}
+
+static void test_erase(void)
+{
+    TextBuf<16> text;
+    text.add("bumpy-red-fox");
+    /** The hot spot name case, keep the first '-' */
+    text.erase(6, 4);
+    TEST_ASSERT_EQUAL_STRING("bumpy-fox", text.c_str());
+    TEST_ASSERT_EQUAL_UINT32(9, text.length());
+    /** More than is left cuts the end */
+    text.erase(5, 100);
+    TEST_ASSERT_EQUAL_STRING("bumpy", text.c_str());
+    /** At or past the end does nothing */
+    text.erase(5, 1);
+    text.erase(200, 1);
+    TEST_ASSERT_EQUAL_STRING("bumpy", text.c_str());
+    text.erase(0, 0);
+    TEST_ASSERT_EQUAL_STRING("bumpy", text.c_str());
+    text.erase(0, 1);
+    TEST_ASSERT_EQUAL_STRING("umpy", text.c_str());
+    /** Appending goes on after the erase */
+    text.add("-1");
+    TEST_ASSERT_EQUAL_STRING("umpy-1", text.c_str());
+}
+
+/** Same lines as before, the time per line pair and the heap it takes */
+static void test_vs_stream(void)
+{
+    std::string displayName;
+    std::string signalInfo;
+    TextBuf<40> name;
+    TextBuf<48> signal;
+    for(const shown_s &s : shown)
+    {
+        streamLines(s, displayName, signalInfo);
+        textLines(s, name, signal);
+        TEST_ASSERT_EQUAL_STRING(displayName.c_str(), name.c_str());
+        TEST_ASSERT_EQUAL_STRING(signalInfo.c_str(), signal.c_str());
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(32, name.length());
+    }
+
+    volatile uint32_t sink = 0;
+    countHeap = true;
+    heapAllocs = 0;
+    heapBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < BENCH_LINES; i++)
+    {
+        streamLines(shown[i % 4], displayName, signalInfo);
+        sink += displayName.length() + signalInfo.length();
+    }
+    double streamNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    uint32_t streamAllocs = heapAllocs;
+    size_t streamBytes = heapBytes;
+
+    heapAllocs = 0;
+    heapBytes = 0;
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < BENCH_LINES; i++)
+    {
+        textLines(shown[i % 4], name, signal);
+        sink += name.length() + signal.length();
+    }
+    double textNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    countHeap = false;
+
+    TEST_ASSERT_EQUAL_UINT32(0, heapAllocs);
+    TEST_ASSERT_TRUE(streamAllocs > 0);
+    printf("line pair: streams %.0f ns, %.1f allocations, %.0f heap bytes; TextBuf %.0f ns (%.1fx), no heap, %u bytes of stack\n",
+           streamNs / BENCH_LINES, (double)streamAllocs / BENCH_LINES, (double)streamBytes / BENCH_LINES, textNs / BENCH_LINES,
+           streamNs / textNs, (unsigned)(sizeof(TextBuf<48>) * 2 + sizeof(TextBuf<40>) + sizeof(TextBuf<12>) * 2 + sizeof(TextBuf<8>)));
+    TEST_ASSERT_TRUE(sink != 0);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_add);
+    RUN_TEST(test_fixed);
+    RUN_TEST(test_compact);
+    RUN_TEST(test_erase);
+    RUN_TEST(test_vs_stream);
+    return UNITY_END();
+}
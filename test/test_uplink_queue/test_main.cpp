@@ -0,0 +1,296 @@
+/**
+ * @file test_main.cpp
+ * @author r4wk (r4wknet@gmail.com)
+ * @brief Uplink queue: eviction by priority, stale beacons, packing per DR, LMH errors
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * Built with the compact payload, the one that packs, and without
+ * UPLINK_QUEUE_SPILL like the native env. send_lora_packet()
+ * takes what fits the DR like the LoRaWAN stack and fails the rest with
+ * LMH_ERROR. The retry timer and LORA_TX_FIN are played by run().
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define PAYLOAD_PROFILE PAYLOAD_COMPACT
+
+#include <unity.h>
+#include <host.h>
+#include <algorithm>
+#include <vector>
+#include "../../src/crc.cpp"
+#include "../../src/airtime.cpp"
+#include "../../src/payload.cpp"
+#include "../../src/uplink_queue.cpp"
+
+bool lora_busy = false;
+
+/** What went out, uplink lengths and beacons per uplink */
+static std::vector<uint8_t> uplinkLens;
+static std::vector<uint8_t> uplinkBeacons;
+/** Position beacons sent, by the id in their latitude, and No-GPS beacons */
+static std::vector<int32_t> sentIds;
+static uint32_t sentNoGps = 0;
+static lmh_error_status sendResult = LMH_SUCCESS;
+
+lmh_error_status send_lora_packet(uint8_t *data, uint8_t size, uint8_t fport)
+{
+    if(sendResult != LMH_SUCCESS)
+    {
+        return sendResult;
+    }
+    if(size > lora_dr_max_payload(g_lorawan_settings.lora_region, g_lorawan_settings.data_rate))
+    {
+        return LMH_ERROR;
+    }
+    uplinkLens.push_back(size);
+    uplinkBeacons.push_back(0);
+    return LMH_SUCCESS;
+}
+
+/** Called for every beacon of an uplink after it is sent */
+void session_log_beacon(const gnss_fix_s &fix)
+{
+    uplinkBeacons.back()++;
+    if(fix.valid)
+    {
+        sentIds.push_back(fix.lat % 1000);
+    } else {
+        sentNoGps++;
+    }
+}
+
+/** Position 100m apart per id, the id is in the last digits of the latitude */
+static gnss_fix_s fixOf(int32_t id)
+{
+    gnss_fix_s fix;
+    fix.lat = 4542000 + id * 1000 + id;
+    fix.lon = -7569719 + id * 1000;
+    fix.alt = 70 + id;
+    fix.hdop = 120;
+    fix.valid = true;
+    return fix;
+}
+
+static void addFix(int32_t id)
+{
+    gnss_fix_s fix = fixOf(id);
+    uplink_queue_add(&fix, 3900, UPLINK_PRIO_FIX);
+    host_advance_ms(1000);
+}
+
+static void addNoGps(void)
+{
+    uplink_queue_add(nullptr, 3900, UPLINK_PRIO_NOGPS);
+    host_advance_ms(1000);
+}
+
+/** TX cycles and retries until the queue is empty */
+static void run(void)
+{
+    for(uint16_t i = 0; i < 1000 && uplink_queue_depth() > 0; i++)
+    {
+        if(lora_busy)
+        {
+            /** LORA_TX_FIN after RX2 */
+            host_advance_ms(5000);
+            lora_busy = false;
+        } else {
+            TEST_ASSERT_TRUE(drainTimer.running);
+            host_advance_ms(drainTimer.period);
+            drainTimer.running = false;
+        }
+        uplink_queue_drain();
+    }
+    TEST_ASSERT_EQUAL_UINT16(0, uplink_queue_depth());
+}
+
+void setUp(void)
+{
+    for(uplink_entry_s &entry : queue)
+    {
+        entry = uplink_entry_s();
+    }
+    depth = 0;
+    spillWritten = 0;
+    spillRead = 0;
+    g_uplink_queued = 0;
+    g_uplink_dropped = 0;
+    g_uplink_packed = 0;
+    g_uplink_depth_max = 0;
+    g_uplink_age_last_ms = 0;
+    g_uplink_age_max_ms = 0;
+    sent = payload_state_s();
+    hasTx = false;
+    budgetInit = false;
+    lora_busy = false;
+    g_lpwan_has_joined = false;
+    g_lorawan_settings.lora_region = LORAMAC_REGION_EU868;
+    g_lorawan_settings.data_rate = 0;
+    sendResult = LMH_SUCCESS;
+    uplinkLens.clear();
+    uplinkBeacons.clear();
+    sentIds.clear();
+    sentNoGps = 0;
+    InternalFS.format();
+    uplink_queue_init();
+}
+void tearDown(void) {}
+
+/** No-GPS beacons make room first, then the oldest position */
+static void test_priority_eviction(void)
+{
+    addNoGps();
+    addNoGps();
+    addNoGps();
+    for(int32_t id = 0; id < 5; id++)
+    {
+        addFix(id);
+    }
+    TEST_ASSERT_EQUAL_UINT16(UPLINK_QUEUE_LEN, uplink_queue_depth());
+    TEST_ASSERT_EQUAL_UINT32(0, g_uplink_dropped);
+    /** Not joined, the retry timer runs */
+    TEST_ASSERT_TRUE(drainTimer.running);
+
+    for(int32_t id = 5; id < 8; id++)
+    {
+        addFix(id);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, g_uplink_dropped);
+    /** All positions, a No-GPS beacon doesn't push one out */
+    addNoGps();
+    TEST_ASSERT_EQUAL_UINT32(4, g_uplink_dropped);
+    /** The oldest position makes room */
+    addFix(8);
+    TEST_ASSERT_EQUAL_UINT32(5, g_uplink_dropped);
+    TEST_ASSERT_EQUAL_UINT16(UPLINK_QUEUE_LEN, uplink_queue_depth());
+    TEST_ASSERT_EQUAL_UINT8(UPLINK_QUEUE_LEN, g_uplink_depth_max);
+
+    g_lpwan_has_joined = true;
+    uplink_queue_drain();
+    run();
+    std::sort(sentIds.begin(), sentIds.end());
+    std::vector<int32_t> expected = {1, 2, 3, 4, 5, 6, 7, 8};
+    TEST_ASSERT_TRUE(sentIds == expected);
+    TEST_ASSERT_EQUAL_UINT32(0, sentNoGps);
+    TEST_ASSERT_EQUAL_UINT32(13, g_uplink_queued);
+}
+
+/** A beacon older than UPLINK_QUEUE_MAX_AGE_MS is dropped, not sent */
+static void test_stale(void)
+{
+    addFix(1);
+    host_advance_ms(UPLINK_QUEUE_MAX_AGE_MS / 2 - 1000);
+    addFix(2);
+    host_advance_ms(UPLINK_QUEUE_MAX_AGE_MS / 2 - 1000 + 1);
+    /** Beacon 1 is one ms too old, beacon 2 half as old */
+    g_lpwan_has_joined = true;
+    uplink_queue_drain();
+    TEST_ASSERT_EQUAL_UINT32(1, g_uplink_dropped);
+    TEST_ASSERT_EQUAL_UINT32(1, sentIds.size());
+    TEST_ASSERT_EQUAL_INT32(2, sentIds[0]);
+    TEST_ASSERT_EQUAL_UINT32(UPLINK_QUEUE_MAX_AGE_MS / 2 + 1, g_uplink_age_last_ms);
+    TEST_ASSERT_EQUAL_UINT16(0, uplink_queue_depth());
+}
+
+struct packing_case_s
+{
+    uint8_t region;
+    uint8_t dr;
+    bool noGps;
+    const char *name;
+};
+
+/** As many beacons per uplink as min(DR max payload, UPLINK_PACK_MAX) takes */
+static void test_packing(void)
+{
+    /** Position frames need more than the 11 bytes of US915 DR0, No-GPS frames are 2 or 3 */
+    static const packing_case_s cases[] = {
+        {LORAMAC_REGION_EU868, 0, false, "EU868 DR0"}, {LORAMAC_REGION_EU868, 5, false, "EU868 DR5"},
+        {LORAMAC_REGION_US915, 1, false, "US915 DR1"}, {LORAMAC_REGION_US915, 3, false, "US915 DR3"},
+        {LORAMAC_REGION_AS923, 3, false, "AS923 DR3"}, {LORAMAC_REGION_US915, 0, true, "US915 DR0"},
+    };
+    for(const packing_case_s &c : cases)
+    {
+        setUp();
+        g_lorawan_settings.lora_region = c.region;
+        g_lorawan_settings.data_rate = c.dr;
+        for(int32_t id = 0; id < UPLINK_QUEUE_LEN; id++)
+        {
+            if(c.noGps)
+            {
+                addNoGps();
+            } else {
+                addFix(id);
+            }
+        }
+        g_lpwan_has_joined = true;
+        uplink_queue_drain();
+        run();
+
+        uint8_t space = min(lora_dr_max_payload(c.region, c.dr), (uint8_t)UPLINK_PACK_MAX);
+        uint32_t beacons = 0;
+        printf("%-10s %2u bytes:", c.name, space);
+        for(size_t i = 0; i < uplinkLens.size(); i++)
+        {
+            TEST_ASSERT_TRUE(uplinkLens[i] <= space);
+            beacons += uplinkBeacons[i];
+            printf(" %u (%u)", uplinkLens[i], uplinkBeacons[i]);
+        }
+        printf("\n");
+        TEST_ASSERT_EQUAL_UINT32(UPLINK_QUEUE_LEN, beacons);
+        TEST_ASSERT_EQUAL_UINT32(UPLINK_QUEUE_LEN, sentIds.size() + sentNoGps);
+        TEST_ASSERT_EQUAL_UINT32(UPLINK_QUEUE_LEN - uplinkLens.size(), g_uplink_packed);
+        TEST_ASSERT_EQUAL_UINT32(0, g_uplink_dropped);
+        /** Every uplink but the last is too full for one more frame */
+        for(size_t i = 0; i + 1 < uplinkLens.size(); i++)
+        {
+            TEST_ASSERT_TRUE(uplinkLens[i] > space - (c.noGps ? 3 : PAYLOAD_MAX_LEN));
+        }
+        TEST_ASSERT_TRUE(uplinkLens.size() < UPLINK_QUEUE_LEN);
+    }
+}
+
+/** A beacon the DR can't carry is dropped, the next one still goes, a busy stack keeps it */
+static void test_lmh_error(void)
+{
+    /** US915 DR0 carries 11 bytes, an absolute position frame is 14 */
+    g_lorawan_settings.lora_region = LORAMAC_REGION_US915;
+    g_lorawan_settings.data_rate = 0;
+    addNoGps();
+    addFix(1);
+    TEST_ASSERT_EQUAL_UINT16(2, uplink_queue_depth());
+    g_lpwan_has_joined = true;
+    uplink_queue_drain();
+    /** The position goes first and is dropped */
+    TEST_ASSERT_EQUAL_UINT32(1, g_uplink_dropped);
+    TEST_ASSERT_EQUAL_UINT16(1, uplink_queue_depth());
+    TEST_ASSERT_TRUE(uplinkLens.empty());
+    run();
+    TEST_ASSERT_EQUAL_UINT32(1, sentNoGps);
+    TEST_ASSERT_EQUAL_UINT32(0, sentIds.size());
+
+    /** LMH_BUSY keeps the beacon for the retry */
+    g_lorawan_settings.lora_region = LORAMAC_REGION_EU868;
+    sendResult = LMH_BUSY;
+    addFix(2);
+    TEST_ASSERT_EQUAL_UINT16(1, uplink_queue_depth());
+    TEST_ASSERT_TRUE(drainTimer.running);
+    TEST_ASSERT_EQUAL_UINT32(UPLINK_RETRY_MS, drainTimer.period);
+    sendResult = LMH_SUCCESS;
+    run();
+    TEST_ASSERT_EQUAL_UINT32(1, sentIds.size());
+    TEST_ASSERT_EQUAL_UINT32(1, g_uplink_dropped);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_priority_eviction);
+    RUN_TEST(test_stale);
+    RUN_TEST(test_packing);
+    RUN_TEST(test_lmh_error);
+    return UNITY_END();
+}
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""
+Replay accelerometer traces through the LIS3DH wakeup logic and the batch
+classifier, and compare MCU wakeups per hour with the old interrupt scheme.
+
+today    Latched INT1 over the movement threshold (INT1_THS 0x03, 48mg on
+         the high pass filtered axes). Every interrupt wakes the MCU, the
+         latch is cleared clear_ms later by the STATUS event.
+batched  Same interrupt while still. After a change INT1 is the FIFO
+         watermark, one wakeup per ACC_FIFO_WTM samples. Steady walking or
+         driving is checked every ACC_PACE_MS (see src/acc.cpp). Every
+         wakeup classifies the FIFO like src/activity.cpp.
+
+Trace CSV: ms,x,y,z[,label] with x/y/z in mg at 10Hz, label still, walking
+or driving. Without a trace a labelled synthetic hour is used.
+
+Examples:
+  acc_classify.py                      synthetic hour
+  acc_classify.py --clear-ms 120000    today, latch cleared only by the timer beacon
+  acc_classify.py trace.csv            recorded trace
+"""
+
+import argparse
+import csv
+import math
+import random
+import sys
+
+ODR_HZ = 10
+FIFO_SIZE = 32
+FIFO_WTM = 30
+STILL_BATCHES = 2
+STEADY_BATCHES = 2
+PACE_MS = 30000
+MOVEMENT, BATCH, PACED = range(3)
+INT1_THS_MG = 3 * 16
+# First order stand-in for the LIS3DH high pass filter on the interrupt
+HP_K = 0.1
+
+STILL_MG = 15
+WALK_MG = 60
+HYST_MG = 20
+STEP_MIN_HZ_X10 = 10
+STEP_MAX_HZ_X10 = 35
+
+CLASSES = ["still", "walking", "driving"]
+
+
+def classify(samples):
+    """Same integer math as activity_classify()."""
+    count = min(len(samples), FIFO_SIZE)
+    if count < 2:
+        return 2
+    samples = samples[-count:]
+    magnitude = [int(math.sqrt(x * x + y * y + z * z)) for x, y, z in samples]
+    mean = sum(magnitude) // count
+    deviation = 0
+    crossings = 0
+    side = 0
+    for m in magnitude:
+        d = m - mean
+        deviation += abs(d)
+        if d > HYST_MG or d < -HYST_MG:
+            now = 1 if d > 0 else -1
+            if side != 0 and now != side:
+                crossings += 1
+            side = now
+    activity_mg = deviation // count
+    hz_x10 = crossings * 10 * ODR_HZ // (2 * count)
+    if activity_mg < STILL_MG:
+        return 0
+    if activity_mg >= WALK_MG and STEP_MIN_HZ_X10 <= hz_x10 <= STEP_MAX_HZ_X10:
+        return 1
+    return 2
+
+
+def movement_events(trace):
+    """Per sample, is any high pass filtered axis over the INT1 threshold."""
+    low = list(trace[0][:3])
+    events = []
+    for sample in trace:
+        over = False
+        for axis in range(3):
+            low[axis] += (sample[axis] - low[axis]) * HP_K
+            over |= sample[axis] - low[axis] > INT1_THS_MG
+        events.append(over)
+    return events
+
+
+def today(events, clear_ms):
+    clear_samples = max(1, clear_ms * ODR_HZ // 1000)
+    wakes = []
+    latched_until = -1
+    for i, over in enumerate(events):
+        if over and i >= latched_until:
+            wakes.append(i)
+            latched_until = i + clear_samples
+    return wakes
+
+
+def batched(trace, events, pace_ms):
+    wakes = []
+    results = []
+    mode = MOVEMENT
+    last = 0
+    same = 0
+    due = 0
+    for i, over in enumerate(events):
+        if not (over if mode == MOVEMENT else i >= due):
+            continue
+        batch = [s[:3] for s in trace[max(0, i + 1 - FIFO_SIZE):i + 1]]
+        activity = classify(batch)
+        wakes.append(i)
+        labels = [s[3] for s in trace[max(0, i + 1 - len(batch)):i + 1] if s[3] is not None]
+        if labels:
+            results.append((max(set(labels), key=labels.count), activity))
+        same = same + 1 if activity == last else 1
+        last = activity
+        if activity == 0:
+            mode = MOVEMENT if mode == MOVEMENT or same >= STILL_BATCHES else BATCH
+        else:
+            mode = PACED if same >= STEADY_BATCHES else BATCH
+        due = i + (FIFO_WTM if mode == BATCH else pace_ms * ODR_HZ // 1000)
+    return wakes, results
+
+
+def synthetic_trace(seed=1):
+    """One hour: still, walk, drive, still, walk, 10Hz, gravity on z."""
+    rng = random.Random(seed)
+    plan = [("still", 10), ("walking", 10), ("driving", 20), ("still", 10), ("walking", 10)]
+    trace = []
+    t = 0.0
+    for label, minutes in plan:
+        step_hz = rng.uniform(1.6, 2.0)
+        for _ in range(minutes * 60 * ODR_HZ):
+            t += 1.0 / ODR_HZ
+            x, y, z = 0.0, 0.0, 1000.0
+            if label == "still":
+                noise = 2
+            elif label == "walking":
+                noise = 20
+                phase = 2 * math.pi * step_hz * t
+                z += 300 * math.sin(phase) + 80 * math.sin(2 * phase)
+                x += 100 * math.sin(phase / 2)
+            else:
+                noise = 25
+                if rng.random() < 0.02:
+                    z += rng.uniform(80, 200)
+            x += rng.gauss(0, noise)
+            y += rng.gauss(0, noise)
+            z += rng.gauss(0, noise)
+            # 10 bit output, 4mg per LSB
+            trace.append((int(x) // 4 * 4, int(y) // 4 * 4, int(z) // 4 * 4, CLASSES.index(label)))
+    return trace
+
+
+def csv_trace(path):
+    trace = []
+    with open(path, newline="") as src:
+        for row in csv.reader(src):
+            if not row or not row[0].strip().lstrip("-").isdigit():
+                continue
+            label = CLASSES.index(row[4].strip()) if len(row) > 4 and row[4].strip() in CLASSES else None
+            trace.append((int(row[1]), int(row[2]), int(row[3]), label))
+    return trace
+
+
+def per_hour(wakes, trace, label=None):
+    if label is None:
+        samples = len(trace)
+        count = len(wakes)
+    else:
+        samples = sum(1 for s in trace if s[3] == label)
+        count = sum(1 for i in wakes if trace[i][3] == label)
+    return count * 3600.0 * ODR_HZ / samples if samples else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", nargs="?", help="CSV ms,x,y,z[,label] in mg at 10Hz")
+    parser.add_argument("--clear-ms", type=int, default=2000, help="today: time until STATUS clears the latched interrupt")
+    parser.add_argument("--pace-ms", type=int, default=PACE_MS, help="batched: interval while steadily moving")
+    args = parser.parse_args()
+
+    trace = csv_trace(args.trace) if args.trace else synthetic_trace()
+    if not trace:
+        print("empty trace", file=sys.stderr)
+        return 1
+    events = movement_events(trace)
+    old = today(events, args.clear_ms)
+    new, results = batched(trace, events, args.pace_ms)
+
+    print("%.1f min of samples" % (len(trace) / ODR_HZ / 60))
+    print("\nwakeups/h   today  batched")
+    print("all        %6.0f   %6.0f" % (per_hour(old, trace), per_hour(new, trace)))
+    for label, name in enumerate(CLASSES):
+        if any(s[3] == label for s in trace):
+            print("%-9s  %6.0f   %6.0f" % (name, per_hour(old, trace, label), per_hour(new, trace, label)))
+
+    if results:
+        correct = sum(1 for label, got in results if label == got)
+        print("\nbatches classified %d, %.0f%% right" % (len(results), 100.0 * correct / len(results)))
+        print("label \\ got  " + "  ".join("%7s" % name for name in CLASSES))
+        for label, name in enumerate(CLASSES):
+            row = [sum(1 for l, g in results if l == label and g == got) for got in range(len(CLASSES))]
+            print("%-11s  " % name + "  ".join("%7d" % n for n in row))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
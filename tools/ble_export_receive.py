@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""
+Receive the R4K Field Mapper session log export (AT+EXPORT) and measure it.
+
+Frame (see src/ble_export.cpp), CRC-16/CCITT-FALSE over everything before it:
+  0xA5, uint16 seq, uint32 offset, uint8 len, len bytes, uint16 crc
+A frame with len 0 ends the export, its offset is the log size.
+A resume sends AT+EXPORT=<offset>,<id>, the id is bytes 1..4 of the log
+(length and CRC of its first batch) with bit 31 cleared. The device
+answers "+EXPORT:log changed" if its log no longer starts there.
+
+Modes:
+  ble       Pull the log from the device over the Nordic UART service
+            (needs `pip install bleak`). With --resume an existing output
+            file is continued from its size.
+              ble_export_receive.py ble -a AA:BB:CC:DD:EE:FF -o slog.raw
+  loopback  Benchmark against a local stand-in for the device: a thread
+            frames a file like the firmware and paces it like a BLE link,
+            with MTU, connection interval and packets per interval.
+              ble_export_receive.py loopback --size 16384 --mtu 247 \\
+                  --interval-ms 7.5 --per-interval 4 --drop-at 5000
+
+The output is the old and the current log file back to back, it decodes
+with session_log_decode.py as is.
+"""
+
+import argparse
+import asyncio
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+
+SYNC = 0xA5
+HEADER = struct.Struct("<BHIB")
+OVERHEAD = HEADER.size + 2
+NUS_RX = "6e400002-b5a3-f393-e0a9-e50e24dcca9e"
+NUS_TX = "6e400003-b5a3-f393-e0a9-e50e24dcca9e"
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def log_id(head):
+    """Id of a log from its first bytes, 0 if it is empty."""
+    if len(head) < 5:
+        return 0
+    return struct.unpack_from("<I", head, 1)[0] & 0x7FFFFFFF
+
+
+def build_frame(seq, offset, data):
+    head = HEADER.pack(SYNC, seq & 0xFFFF, offset, len(data)) + data
+    return head + struct.pack("<H", crc16_ccitt(head))
+
+
+class Receiver:
+    """Reassembles frames from a byte stream into the output file."""
+
+    def __init__(self, out, offset=0):
+        self.out = out
+        self.offset = offset
+        self.buf = bytearray()
+        self.size = None
+        self.bad = 0
+        self.bytes = 0
+        self.start = None
+        self.error = None
+
+    def feed(self, chunk):
+        """Add received bytes, returns True when the export ended."""
+        if self.start is None:
+            self.start = time.monotonic()
+        self.buf += chunk
+        while len(self.buf) >= OVERHEAD:
+            if self.buf[0] != SYNC:
+                # Text answers of AT commands end up here, skip to the next frame
+                if self.buf.startswith(b"+EXPORT:") and b"\n" in self.buf:
+                    answer = bytes(self.buf[8:self.buf.index(b"\n")]).strip()
+                    if not answer[:1].isdigit():
+                        self.error = answer.decode(errors="replace")
+                        return True
+                del self.buf[0]
+                continue
+            _, seq, offset, length = HEADER.unpack_from(self.buf)
+            if len(self.buf) < OVERHEAD + length:
+                return False
+            frame = bytes(self.buf[:OVERHEAD + length])
+            crc, = struct.unpack_from("<H", frame, HEADER.size + length)
+            if crc16_ccitt(frame[:HEADER.size + length]) != crc:
+                self.bad += 1
+                del self.buf[0]
+                continue
+            del self.buf[:OVERHEAD + length]
+            if offset != self.offset:
+                # Lost or repeated frame, keep what we have and resume
+                self.bad += 1
+                continue
+            if length == 0:
+                self.size = offset
+                return True
+            self.out.write(frame[HEADER.size:HEADER.size + length])
+            self.offset += length
+            self.bytes += length
+        return False
+
+    def report(self):
+        elapsed = max(time.monotonic() - (self.start or time.monotonic()), 1e-6)
+        print("%d bytes in %.2fs, %.1f KB/s, %d bad frames, offset %d of %s"
+              % (self.bytes, elapsed, self.bytes / 1024 / elapsed, self.bad,
+                 self.offset, self.size if self.size is not None else "?"),
+              file=sys.stderr)
+
+
+def fake_device(sock, log, mtu, interval, per_interval, drop_at):
+    """Answer AT+EXPORT like the firmware, paced like a BLE connection."""
+    data_len = min(mtu - 3, 244) - OVERHEAD
+    dropped = False
+    line = b""
+    while True:
+        chunk = sock.recv(64)
+        if not chunk:
+            return
+        line += chunk
+        if b"\n" not in line:
+            continue
+        cmd, line = line.split(b"\n", 1)
+        cmd = cmd.strip().upper()
+        if not cmd.startswith(b"AT+EXPORT"):
+            continue
+        offset = int(cmd[10:].split(b",")[0]) if cmd.startswith(b"AT+EXPORT=") else 0
+        if offset and cmd[10:].split(b",")[1:] != [b"%d" % log_id(log)]:
+            sock.sendall(b"+EXPORT:log changed\r\n")
+            continue
+        seq = 0
+        while True:
+            data = log[offset:offset + data_len]
+            if drop_at is not None and not dropped and offset >= drop_at:
+                # Link lost, the receiver has to resume
+                dropped = True
+                sock.sendall(b"\x00" * 4)
+                break
+            sock.sendall(build_frame(seq, offset, data))
+            seq += 1
+            offset += len(data)
+            if seq % per_interval == 0:
+                time.sleep(interval)
+            if not data:
+                break
+
+
+def run_loopback(args):
+    log = os.urandom(args.size)
+    host, dev = socket.socketpair()
+    threading.Thread(target=fake_device, daemon=True,
+                     args=(dev, log, args.mtu, args.interval_ms / 1000,
+                           args.per_interval, args.drop_at)).start()
+
+    out = bytearray()
+
+    class Sink:
+        def write(self, data):
+            out.extend(data)
+
+    rx = Receiver(Sink())
+    host.sendall(b"AT+EXPORT\r\n")
+    host.settimeout(1.0)
+    while True:
+        try:
+            chunk = host.recv(4096)
+        except socket.timeout:
+            print("Stalled at %d, resuming" % rx.offset, file=sys.stderr)
+            host.sendall(b"AT+EXPORT=%d,%d\r\n" % (rx.offset, log_id(out)))
+            continue
+        if rx.feed(chunk):
+            break
+    if rx.error:
+        sys.exit("Device: %s" % rx.error)
+    rx.report()
+    if bytes(out) != log:
+        sys.exit("Loopback data mismatch")
+
+
+async def run_ble(args):
+    try:
+        from bleak import BleakClient
+    except ImportError:
+        sys.exit("ble mode needs bleak: pip install bleak")
+
+    offset = 0
+    log_start = b""
+    if args.resume and os.path.exists(args.output):
+        offset = os.path.getsize(args.output)
+        with open(args.output, "rb") as old:
+            log_start = old.read(5)
+    with open(args.output, "ab" if offset else "wb") as out:
+        rx = Receiver(out, offset)
+        done = asyncio.Event()
+
+        def on_notify(_, data):
+            if rx.feed(bytes(data)):
+                done.set()
+
+        async with BleakClient(args.address) as client:
+            await client.start_notify(NUS_TX, on_notify)
+            cmd = b"AT+EXPORT=%d,%d\r\n" % (offset, log_id(log_start)) if offset else b"AT+EXPORT\r\n"
+            await client.write_gatt_char(NUS_RX, cmd)
+            await asyncio.wait_for(done.wait(), args.timeout)
+        if rx.error:
+            sys.exit("Device: %s, export again without --resume" % rx.error)
+        rx.report()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="mode", required=True)
+    ble = sub.add_parser("ble", help="receive from the device")
+    ble.add_argument("-a", "--address", required=True)
+    ble.add_argument("-o", "--output", default="slog.raw")
+    ble.add_argument("--resume", action="store_true")
+    ble.add_argument("--timeout", type=float, default=120)
+    loop = sub.add_parser("loopback", help="benchmark against a local stand-in")
+    loop.add_argument("--size", type=int, default=16384)
+    loop.add_argument("--mtu", type=int, default=247)
+    loop.add_argument("--interval-ms", type=float, default=7.5)
+    loop.add_argument("--per-interval", type=int, default=4)
+    loop.add_argument("--drop-at", type=int)
+    args = parser.parse_args()
+
+    if args.mode == "ble":
+        asyncio.run(run_ble(args))
+    else:
+        run_loopback(args)
+
+
+if __name__ == "__main__":
+    main()
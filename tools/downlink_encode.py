@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Encode/decode R4K Field Mapper hot spot downlinks (binary TLV v1).
+
+Format (see src/downlink.cpp):
+  0xA1 then [type][len][value...]
+  0x01 name      utf-8 bytes
+  0x02 signal    int8 RSSI (dBm), int8 SNR (0.25 dB)
+  0x03 position  int32 lat, int32 long (1e-5 deg, little endian)
+  0x04 hotspots  uint8 number of hot spots that heard the beacon
+
+Examples:
+  downlink_encode.py encode --name bumpy-red-fox --rssi -112 --snr 4.5 \\
+      --lat 45.42153 --long -75.69719 --hotspots 3
+  echo '{"name":"bumpy-red-fox","rssi":-112,"snr":4.5}' | downlink_encode.py encode --json -
+  downlink_encode.py decode oQENYnVtcHktcmVkLWZveA==
+"""
+
+import argparse
+import base64
+import json
+import struct
+import sys
+
+MAGIC_V1 = 0xA1
+TLV_NAME = 0x01
+TLV_SIGNAL = 0x02
+TLV_POSITION = 0x03
+TLV_HOTSPOTS = 0x04
+
+
+def clamp(value, low, high):
+    return max(low, min(high, value))
+
+
+def encode(name, rssi=None, snr=None, lat=None, lon=None, hotspots=None):
+    """Build a v1 binary downlink, returns bytes."""
+    out = bytearray([MAGIC_V1])
+    name_b = name.encode("utf-8")[:255]
+    out += bytes([TLV_NAME, len(name_b)]) + name_b
+    if rssi is not None or snr is not None:
+        rssi_i = clamp(int(round(rssi or 0)), -128, 127)
+        snr_q = clamp(int(round((snr or 0) * 4)), -128, 127)
+        out += bytes([TLV_SIGNAL, 2]) + struct.pack("<bb", rssi_i, snr_q)
+    if lat is not None and lon is not None:
+        out += bytes([TLV_POSITION, 8]) + struct.pack("<ii", int(round(lat * 1e5)), int(round(lon * 1e5)))
+    if hotspots is not None:
+        out += bytes([TLV_HOTSPOTS, 1, clamp(int(hotspots), 0, 255)])
+    return bytes(out)
+
+
+def decode(data):
+    """Decode a binary or JSON downlink the same way the device does."""
+    if not data:
+        raise ValueError("empty payload")
+    if data[0] & 0xF0 != 0xA0:
+        return json.loads(data.decode("utf-8"))
+    if data[0] != MAGIC_V1:
+        raise ValueError("unknown version %d" % (data[0] & 0x0F))
+    result = {}
+    idx = 1
+    while idx + 2 <= len(data):
+        tlv_type, tlv_len = data[idx], data[idx + 1]
+        value = data[idx + 2:idx + 2 + tlv_len]
+        if len(value) != tlv_len:
+            raise ValueError("truncated TLV at %d" % idx)
+        if tlv_type == TLV_NAME:
+            result["name"] = value.decode("utf-8", "replace")
+        elif tlv_type == TLV_SIGNAL and tlv_len >= 2:
+            rssi, snr_q = struct.unpack_from("<bb", value)
+            result["rssi"] = rssi
+            result["snr"] = snr_q / 4.0
+        elif tlv_type == TLV_POSITION and tlv_len >= 8:
+            lat, lon = struct.unpack_from("<ii", value)
+            result["lat"] = lat / 1e5
+            result["long"] = lon / 1e5
+        elif tlv_type == TLV_HOTSPOTS and tlv_len >= 1:
+            result["hotspots"] = value[0]
+        idx += 2 + tlv_len
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    enc = sub.add_parser("encode", help="encode a downlink")
+    enc.add_argument("--json", help="read fields from a JSON file ('-' for stdin) in the legacy format")
+    enc.add_argument("--name")
+    enc.add_argument("--rssi", type=float)
+    enc.add_argument("--snr", type=float)
+    enc.add_argument("--lat", type=float)
+    enc.add_argument("--long", dest="lon", type=float)
+    enc.add_argument("--hotspots", type=int)
+    enc.add_argument("--hex", action="store_true", help="print hex instead of base64")
+
+    dec = sub.add_parser("decode", help="decode a base64 or hex downlink")
+    dec.add_argument("payload")
+
+    args = parser.parse_args()
+
+    if args.cmd == "encode":
+        fields = {}
+        if args.json:
+            src = sys.stdin if args.json == "-" else open(args.json)
+            fields = json.load(src)
+        name = args.name or fields.get("name")
+        if not name:
+            parser.error("a hot spot name is required")
+        payload = encode(
+            name,
+            args.rssi if args.rssi is not None else fields.get("rssi"),
+            args.snr if args.snr is not None else fields.get("snr"),
+            args.lat if args.lat is not None else fields.get("lat"),
+            args.lon if args.lon is not None else fields.get("long"),
+            args.hotspots if args.hotspots is not None else fields.get("hotspots"),
+        )
+        print(payload.hex() if args.hex else base64.b64encode(payload).decode())
+    else:
+        try:
+            data = bytes.fromhex(args.payload)
+        except ValueError:
+            data = base64.b64decode(args.payload)
+        print(json.dumps(decode(data)))
+
+
+if __name__ == "__main__":
+    main()
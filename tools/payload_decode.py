@@ -0,0 +1,384 @@
+#!/usr/bin/env python3
+"""
+Decode R4K Field Mapper uplinks and compare the payload layouts.
+
+Layouts (see src/payload.cpp):
+  legacy   14 bytes, int32 lat, int32 long (1e-5 deg), int16 alt (m),
+           uint16 hdop*100, uint16 battery mV, little endian
+  compact  header, seq, then by header flags
+    0x20 absolute   int32 lat, int32 long, int16 alt, uint8 hdop*10
+         else delta ref seq, zigzag varint lat/long/alt deltas, uint8 hdop*10
+    0x08 no position (No-GPS beacon), no position fields
+    0x10 battery    uint8 (mV - 2500) / 10
+  Header bits 7..6 are the version (1). Deltas are from the frame with
+  ref seq: the last acknowledged one with confirmed uplinks, the last
+  absolute one with unconfirmed uplinks, or an earlier frame of the same
+  uplink. An uplink can carry several frames back to back, a backlog sent
+  when the radio was free again. Decode uplinks in order with one Decoder.
+
+Examples:
+  payload_decode.py decode 4000 ...            compact uplinks in order, hex or base64
+  payload_decode.py decode --legacy <payload>  14 byte layout
+  payload_decode.py bench                      synthetic drive, bytes and airtime per DR
+  payload_decode.py bench --csv session.csv    track from session_log_decode.py
+  payload_decode.py bench --loss 5 --confirmed every 5th uplink lost, confirmed uplinks
+  payload_decode.py bench --backlog 6          queued fixes packed into EU868 DR0 uplinks
+"""
+
+import argparse
+import base64
+import csv
+import json
+import math
+import struct
+import sys
+
+VERSION = 0x40
+VERSION_MASK = 0xC0
+F_ABS = 0x20
+F_BATT = 0x10
+F_NOPOS = 0x08
+ABS_EVERY = 8
+ABS_LEN = 10
+BATT_BASE_MV = 2500
+BATT_STEP_MV = 10
+LEGACY_LEN = 14
+
+# LoRaWAN MHDR + FHDR + FPort + MIC
+LORAWAN_OVERHEAD = 13
+# (sf, bw kHz, max payload) per DR, like src/airtime.cpp
+REGIONS = {
+    "EU868": [(12, 125, 51), (11, 125, 51), (10, 125, 51), (9, 125, 115), (8, 125, 222), (7, 125, 222), (7, 250, 222)],
+    "US915": [(10, 125, 11), (9, 125, 53), (8, 125, 125), (7, 125, 242), (8, 500, 242)],
+    "AS923": [(10, 125, 11), (9, 125, 53), (8, 125, 125), (7, 125, 242), (7, 250, 242)],
+}
+
+
+def time_on_air_us(sf, bw_khz, phy_len):
+    """Same integer formula as lora_time_on_air_us()."""
+    tsym = (1 << sf) * 1000 // bw_khz
+    de = 1 if sf >= 11 and bw_khz == 125 else 0
+    num = 8 * phy_len - 4 * sf + 28 + 16
+    den = 4 * (sf - 2 * de)
+    blocks = (num + den - 1) // den if num > 0 else 0
+    return (49 * tsym) // 4 + (8 + blocks * 5) * tsym
+
+
+def zigzag(value):
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def put_varint(out, value):
+    value = zigzag(value)
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def quantize_batt(batt_mv):
+    if batt_mv <= BATT_BASE_MV:
+        return 0
+    return min((batt_mv - BATT_BASE_MV + BATT_STEP_MV // 2) // BATT_STEP_MV, 255)
+
+
+def clamp(value, low, high):
+    return max(low, min(high, value))
+
+
+def encode_legacy(fix, batt_mv):
+    """14 byte layout, a No-GPS beacon has all position fields 0."""
+    if fix is None:
+        fix = {"lat": 0, "lon": 0, "alt": 0, "hdop": 0}
+    return struct.pack("<iihHH", fix["lat"], fix["lon"], clamp(fix["alt"], -32768, 32767),
+                       clamp(fix["hdop"], 0, 0xFFFF), clamp(batt_mv, 0, 0xFFFF))
+
+
+class Encoder:
+    """Reference of the compact encoder in payload.cpp."""
+
+    def __init__(self, confirmed=False):
+        self.confirmed = confirmed
+        self.sent = {"seq": 0, "ref": None, "batt": None, "since_abs": 0}
+        self.pending = None
+        self.pending_abs = None
+
+    def build(self, fix, batt_mv):
+        """Start an uplink. fix is a dict with lat, lon (1e-5 deg), alt (m), hdop (0.01) or None."""
+        self.pending = dict(self.sent)
+        self.pending_abs = None
+        return self.append(fix, batt_mv, 14)
+
+    def append(self, fix, batt_mv, space):
+        """Pack one more frame into the uplink, b"" if it doesn't fit."""
+        state = dict(self.pending)
+        header = VERSION
+        out = bytearray(2)
+        absolute = False
+        if fix is None:
+            header |= F_NOPOS
+        else:
+            alt = clamp(fix["alt"], -32768, 32767)
+            ref = state["ref"]
+            absolute = ref is None or state["since_abs"] >= ABS_EVERY - 1
+            if not absolute:
+                out.append(ref["seq"])
+                put_varint(out, fix["lat"] - ref["lat"])
+                put_varint(out, fix["lon"] - ref["lon"])
+                put_varint(out, alt - ref["alt"])
+                absolute = len(out) > 2 + ABS_LEN
+            if absolute:
+                header |= F_ABS
+                out = bytearray(2) + struct.pack("<iih", fix["lat"], fix["lon"], alt)
+            out.append(min(fix["hdop"] // 10, 255))
+            state["ref"] = {"lat": fix["lat"], "lon": fix["lon"], "alt": alt, "seq": state["seq"]}
+            state["since_abs"] = 0 if absolute else state["since_abs"] + 1
+        batt = quantize_batt(batt_mv)
+        if absolute or state["batt"] is None or batt != state["batt"]:
+            header |= F_BATT
+            out.append(batt)
+            state["batt"] = batt
+        out[0] = header
+        out[1] = state["seq"]
+        state["seq"] = (state["seq"] + 1) & 0xFF
+        if len(out) > space:
+            return b""
+        self.pending = state
+        if absolute:
+            self.pending_abs = state["ref"]
+        return bytes(out)
+
+    def queued(self):
+        self.sent["seq"] = self.pending["seq"]
+
+    def tx_done(self, success):
+        if not success:
+            return
+        if self.confirmed:
+            self.sent["ref"] = self.pending["ref"]
+        elif self.pending_abs is not None:
+            self.sent["ref"] = self.pending_abs
+        self.sent["since_abs"] = self.pending["since_abs"]
+        self.sent["batt"] = self.pending["batt"]
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def unpack(self, fmt):
+        values = struct.unpack_from(fmt, self.data, self.pos)
+        self.pos += struct.calcsize(fmt)
+        return values
+
+    def zigzag(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.byte()
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return (value >> 1) ^ -(value & 1)
+
+
+def decode_legacy(data):
+    if len(data) != LEGACY_LEN:
+        raise ValueError("legacy payload is %d bytes, not %d" % (len(data), LEGACY_LEN))
+    lat, lon, alt, hdop, batt = struct.unpack("<iihHH", data)
+    return {"lat": lat / 1e5, "long": lon / 1e5, "alt": alt, "hdop": hdop / 100, "batt_mv": batt}
+
+
+class Decoder:
+    """Decodes compact uplinks in the order they were received."""
+
+    def __init__(self):
+        self.positions = {}
+        self.batt_mv = None
+
+    def decode(self, data):
+        """All frames of one uplink, more than one if the device packed a backlog."""
+        reader = Reader(data)
+        frames = []
+        while reader.pos < len(data):
+            frames.append(self.frame(reader))
+        return frames
+
+    def frame(self, reader):
+        header = reader.byte()
+        if header & VERSION_MASK != VERSION:
+            raise ValueError("unknown version %d" % (header >> 6))
+        result = {"seq": reader.byte()}
+        if header & F_NOPOS:
+            result["no_gps"] = True
+        elif header & F_ABS:
+            lat, lon, alt = reader.unpack("<iih")
+            result.update(lat=lat, lon=lon, alt=alt, hdop=reader.byte() * 10)
+        else:
+            ref_seq = reader.byte()
+            deltas = (reader.zigzag(), reader.zigzag(), reader.zigzag())
+            hdop = reader.byte() * 10
+            ref = self.positions.get(ref_seq)
+            if ref is None:
+                result["error"] = "reference %d missing, wait for an absolute frame" % ref_seq
+            else:
+                result.update(lat=ref[0] + deltas[0], lon=ref[1] + deltas[1], alt=ref[2] + deltas[2], hdop=hdop)
+        if header & F_BATT:
+            self.batt_mv = BATT_BASE_MV + reader.byte() * BATT_STEP_MV
+        if self.batt_mv is not None:
+            result["batt_mv"] = self.batt_mv
+        if "lat" in result:
+            self.positions[result["seq"]] = (result["lat"], result["lon"], result["alt"])
+            result["lat"] /= 1e5
+            result["long"] = result.pop("lon") / 1e5
+            result["hdop"] /= 100
+        return result
+
+
+def synthetic_track(count=200):
+    """Drive with beacons every ~150 m, a few No-GPS beacons and slow battery drain."""
+    lat, lon, alt = 5237000, 490000, 12
+    heading = 0.0
+    track = []
+    for i in range(count):
+        heading += math.radians(15 if i % 10 < 3 else -5)
+        lat += int(round(150 / 1.11 * math.cos(heading)))
+        lon += int(round(150 / 1.11 * math.sin(heading) / math.cos(math.radians(lat / 1e5))))
+        alt += (i % 7) - 3
+        batt = 4100 - i * 2
+        fix = None if i % 25 == 24 else {"lat": lat, "lon": lon, "alt": alt, "hdop": 90 + (i % 5) * 20}
+        track.append((fix, batt))
+    return track
+
+
+def csv_track(path):
+    track = []
+    with open(path, newline="") as src:
+        for row in csv.DictReader(src):
+            batt = int(float(row.get("batt_mv") or 0)) or 3900
+            if row.get("lat"):
+                fix = {"lat": int(round(float(row["lat"]) * 1e5)), "lon": int(round(float(row["long"]) * 1e5)),
+                       "alt": int(float(row.get("alt") or 0)), "hdop": int(round(float(row.get("hdop") or 0) * 100))}
+            else:
+                fix = None
+            track.append((fix, batt))
+    return track
+
+
+def bench(track, loss, confirmed):
+    """Encode the track both ways, check the round trip, print bytes and airtime per DR."""
+    encoder = Encoder(confirmed)
+    decoder = Decoder()
+    compact = []
+    undecoded = 0
+    for i, (fix, batt) in enumerate(track):
+        frame = encoder.build(fix, batt)
+        encoder.queued()
+        compact.append(len(frame))
+        # Every loss-th uplink never reaches the network server, only a confirmed uplink notices
+        lost = loss and i % loss == loss - 1
+        encoder.tx_done(not (lost and confirmed))
+        if lost:
+            continue
+        result = decoder.decode(frame)[0]
+        if "error" in result:
+            undecoded += 1
+        elif fix is not None:
+            assert round(result["lat"] * 1e5) == fix["lat"] and round(result["long"] * 1e5) == fix["lon"], (i, result)
+    count = len(compact)
+    print("%d beacons, legacy %d bytes, compact avg %.1f bytes (min %d, max %d), %d undecodable after loss"
+          % (count, LEGACY_LEN, sum(compact) / count, min(compact), max(compact), undecoded))
+    for region, drs in REGIONS.items():
+        print("\n%s  DR  SF/BW      legacy ms  compact ms  saved" % region)
+        for dr, (sf, bw, max_payload) in enumerate(drs):
+            legacy_us = time_on_air_us(sf, bw, LEGACY_LEN + LORAWAN_OVERHEAD) if LEGACY_LEN <= max_payload else None
+            fits = [n for n in compact if n <= max_payload]
+            compact_us = sum(time_on_air_us(sf, bw, n + LORAWAN_OVERHEAD) for n in fits) / len(fits) if fits else None
+            legacy_text = "%9.1f" % (legacy_us / 1000) if legacy_us else "  too big"
+            compact_text = "%10.1f" % (compact_us / 1000) if compact_us else "   too big"
+            if len(fits) < count:
+                compact_text += "*"
+            saved = "%5.0f%%" % (100 - 100 * compact_us / legacy_us) if legacy_us and compact_us else "     -"
+            print("       %2d  SF%-2d/%-3d  %s  %s  %s" % (dr, sf, bw, legacy_text, compact_text, saved))
+    print("\n* some compact frames don't fit this DR, average of those that do")
+
+
+def bench_pack(track, backlog, region, dr):
+    """Send the track as backlogs of up to backlog fixes, packed as far as the DR allows."""
+    sf, bw, max_payload = REGIONS[region][dr]
+    encoder = Encoder()
+    decoder = Decoder()
+    uplinks = []
+    i = 0
+    while i < len(track):
+        frame = encoder.build(*track[i])
+        payload = bytearray(frame)
+        taken = 1
+        while taken < backlog and i + taken < len(track):
+            frame = encoder.append(*track[i + taken], space=max_payload - len(payload))
+            if not frame:
+                break
+            payload += frame
+            taken += 1
+        encoder.queued()
+        encoder.tx_done(True)
+        for (fix, _), result in zip(track[i:i + taken], decoder.decode(bytes(payload))):
+            assert "error" not in result and (fix is None or round(result["lat"] * 1e5) == fix["lat"]), result
+        uplinks.append(len(payload))
+        i += taken
+    packed_ms = sum(time_on_air_us(sf, bw, n + LORAWAN_OVERHEAD) for n in uplinks) / 1000
+    print("%d fixes, backlogs of %d, %s DR%d: %d uplinks of avg %.1f bytes, %.0fms on air"
+          % (len(track), backlog, region, dr, len(uplinks), sum(uplinks) / len(uplinks), packed_ms))
+
+
+def read_payload(text):
+    try:
+        return bytes.fromhex(text)
+    except ValueError:
+        return base64.b64decode(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    dec = sub.add_parser("decode", help="decode uplinks, hex or base64, in the order received")
+    dec.add_argument("--legacy", action="store_true", help="14 byte layout")
+    dec.add_argument("payloads", nargs="+")
+
+    ben = sub.add_parser("bench", help="compare bytes and airtime of both layouts")
+    ben.add_argument("--csv", help="track from session_log_decode.py instead of a synthetic one")
+    ben.add_argument("--loss", type=int, default=0, help="drop every Nth uplink on the way")
+    ben.add_argument("--confirmed", action="store_true", help="confirmed uplinks, a lost one is not acknowledged")
+    ben.add_argument("--backlog", type=int, default=0, help="also send the track as backlogs of N queued fixes")
+    ben.add_argument("--region", default="EU868", choices=REGIONS, help="region for --backlog")
+    ben.add_argument("--dr", type=int, default=0, help="data rate for --backlog")
+
+    args = parser.parse_args()
+
+    if args.cmd == "decode":
+        decoder = Decoder()
+        for text in args.payloads:
+            data = read_payload(text)
+            if args.legacy:
+                print(json.dumps(decode_legacy(data)))
+                continue
+            for frame in decoder.decode(data):
+                print(json.dumps(frame))
+    else:
+        track = csv_track(args.csv) if args.csv else synthetic_track()
+        bench(track, args.loss, args.confirmed)
+        if args.backlog > 1:
+            print()
+            bench_pack(track, 1, args.region, args.dr)
+            bench_pack(track, args.backlog, args.region, args.dr)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""
+Decode the R4K Field Mapper binary session log to CSV or GeoJSON.
+
+Format (see src/session_log.cpp):
+  Batch   0x5A, uint16 length, uint16 CRC-16/CCITT-FALSE, records
+  Record  flags, uvarint time delta, dr | sf << 4, then by flag
+    0x01 position  zigzag varint lat/long (1e-5 deg), alt (m) deltas, hdop/10
+    0x02 hot spot  -rssi, snr (dB), -hs rssi, hs snr (0.25 dB), hot spots,
+                   0x04 new name: length + bytes, else name index
+    0x08 battery   zigzag varint mV delta
+    0x10 time is seconds since boot instead of UTC
+  Deltas and the name table reset at the start of every batch.
+
+Copy /slog.old and /slog.bin from the device, then:
+  session_log_decode.py slog.old slog.bin > session.csv
+  session_log_decode.py --geojson slog.old slog.bin > session.geojson
+"""
+
+import argparse
+import csv
+import datetime
+import json
+import struct
+import sys
+
+SYNC = 0x5A
+F_POS = 0x01
+F_HOTSPOT = 0x02
+F_NAME_NEW = 0x04
+F_BATT = 0x08
+F_UPTIME = 0x10
+
+FIELDS = ["time", "uptime", "dr", "sf", "lat", "long", "alt", "hdop",
+          "rssi", "snr", "hs_name", "hs_rssi", "hs_snr", "hotspots", "batt_mv"]
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def int8(self):
+        value = self.byte()
+        return value - 256 if value > 127 else value
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.byte()
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    def zigzag(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def raw(self, length):
+        value = self.data[self.pos:self.pos + length]
+        self.pos += length
+        return value
+
+
+def decode_batch(payload):
+    """Yield one dict per record of a batch."""
+    rd = Reader(payload)
+    time = lat = lon = alt = batt = 0
+    names = []
+    while rd.pos < len(payload):
+        flags = rd.byte()
+        # The device takes the delta as a uint32 difference
+        time = (time + rd.varint()) & 0xFFFFFFFF
+        dr_sf = rd.byte()
+        rec = {"time": time, "uptime": bool(flags & F_UPTIME),
+               "dr": dr_sf & 0x0F, "sf": dr_sf >> 4}
+        if flags & F_POS:
+            lat += rd.zigzag()
+            lon += rd.zigzag()
+            alt += rd.zigzag()
+            rec.update(lat=lat / 1e5, long=lon / 1e5, alt=alt,
+                       hdop=rd.byte() / 10)
+        if flags & F_HOTSPOT:
+            rec["rssi"] = -rd.byte()
+            rec["snr"] = rd.int8()
+            rec["hs_rssi"] = -rd.byte()
+            rec["hs_snr"] = rd.int8() / 4
+            rec["hotspots"] = rd.byte()
+            if flags & F_NAME_NEW:
+                name = rd.raw(rd.byte()).decode("utf-8", "replace")
+                names.append(name)
+            else:
+                index = rd.byte()
+                name = names[index] if index < len(names) else "?"
+            rec["hs_name"] = name
+        if flags & F_BATT:
+            batt += rd.zigzag()
+        rec["batt_mv"] = batt
+        yield rec
+
+
+def decode(data):
+    """Yield all records, skipping batches that fail their CRC."""
+    pos = 0
+    while pos + 5 <= len(data):
+        if data[pos] != SYNC:
+            pos += 1
+            continue
+        length, crc = struct.unpack_from("<HH", data, pos + 1)
+        payload = data[pos + 5:pos + 5 + length]
+        if len(payload) != length or crc16_ccitt(payload) != crc:
+            print("Bad batch at %d, skipped" % pos, file=sys.stderr)
+            pos += 1
+            continue
+        yield from decode_batch(payload)
+        pos += 5 + length
+
+
+def time_text(rec):
+    if rec["uptime"]:
+        return "+%ds" % rec["time"]
+    return datetime.datetime.fromtimestamp(
+        rec["time"], datetime.timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+
+
+def write_csv(records, out):
+    writer = csv.DictWriter(out, fieldnames=FIELDS)
+    writer.writeheader()
+    for rec in records:
+        rec["time"] = time_text(rec)
+        writer.writerow(rec)
+
+
+def write_geojson(records, out):
+    out.write('{"type":"FeatureCollection","features":[\n')
+    first = True
+    for rec in records:
+        if "lat" not in rec:
+            continue
+        rec["time"] = time_text(rec)
+        feature = {"type": "Feature",
+                   "geometry": {"type": "Point",
+                                "coordinates": [rec.pop("long"), rec.pop("lat")]},
+                   "properties": rec}
+        out.write(("" if first else ",\n") + json.dumps(feature))
+        first = False
+    out.write("\n]}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("files", nargs="+", help="log files, oldest first")
+    parser.add_argument("--geojson", action="store_true", help="GeoJSON instead of CSV")
+    args = parser.parse_args()
+
+    def records():
+        for name in args.files:
+            with open(name, "rb") as f:
+                yield from decode(f.read())
+
+    if args.geojson:
+        write_geojson(records(), sys.stdout)
+    else:
+        write_csv(records(), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()